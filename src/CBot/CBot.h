@@ -27,7 +27,9 @@
 #include "CBot/CBotClass.h"
 #include "CBot/CBotToken.h"
 #include "CBot/CBotProgram.h"
+#include "CBot/CBotProfiler.h"
 #include "CBot/CBotTypResult.h"
+#include "CBot/CBotWorkerPool.h"
 
 #include "CBot/CBotVar/CBotVar.h"
 
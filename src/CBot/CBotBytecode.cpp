@@ -0,0 +1,440 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+#include "CBot/CBotBytecode.h"
+
+#include "CBot/CBotStack.h"
+
+#include "CBot/CBotInstr/CBotTwoOpExpr.h"
+#include "CBot/CBotInstr/CBotExprUnaire.h"
+#include "CBot/CBotInstr/CBotExprVar.h"
+#include "CBot/CBotInstr/CBotExprLitBool.h"
+#include "CBot/CBotInstr/CBotExprLitNum.h"
+#include "CBot/CBotInstr/CBotFunction.h"
+
+#include "CBot/CBotVar/CBotVar.h"
+
+#include <cmath>
+#include <string>
+
+namespace CBot
+{
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotBytecode::LowerTree(CBotInstr* root)
+{
+    int count = 0;
+
+    // walk the tree without recursion, long programs have very long m_next chains
+    std::vector<CBotInstr*> pending;
+    pending.push_back(root);
+    while (!pending.empty())
+    {
+        CBotInstr* instr = pending.back();
+        pending.pop_back();
+
+        CBotTwoOpExpr* expr = dynamic_cast<CBotTwoOpExpr*>(instr);
+        if (expr != nullptr && expr->m_constant == nullptr)
+        {
+            delete expr->m_bytecode;
+            expr->m_bytecode = Lower(expr);
+            if (expr->m_bytecode != nullptr)
+            {
+                count++;
+                // the operands are a part of the bytecode now, only the next instruction remains
+                if (expr->m_next != nullptr) pending.push_back(expr->m_next);
+                continue;
+            }
+        }
+
+        for (const auto& it : instr->GetDebugLinks())
+        {
+            if (it.second == nullptr) continue;
+            if (dynamic_cast<CBotFunction*>(it.second) != nullptr) continue;
+            pending.push_back(it.second);
+        }
+    }
+
+    return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CBotBytecode* CBotBytecode::Lower(CBotInstr* expr)
+{
+    CBotBytecode* code = new CBotBytecode();
+    code->m_result = code->LowerNode(expr);
+    if (code->m_result < 0)
+    {
+        delete code;
+        return nullptr;
+    }
+    return code;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotBytecode::Emit(Op op, int a, int b)
+{
+    if (m_registers >= MAX_REGISTERS) return -1;
+
+    Instruction instr;
+    instr.op = op;
+    instr.dst = static_cast<unsigned char>(m_registers);
+    instr.a = static_cast<unsigned char>(a);
+    instr.b = static_cast<unsigned char>(b);
+    instr.ident = 0;
+    instr.slot = -1;
+    m_code.push_back(instr);
+
+    return m_registers++;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotBytecode::LowerNode(CBotInstr* instr)
+{
+    if (instr == nullptr) return -1;
+    if (instr->m_next3 != nullptr) return -1;                   // indexes, fields and method calls
+
+    if (CBotExprLitNum<int>* lit = dynamic_cast<CBotExprLitNum<int>*>(instr))
+    {
+        if (instr->GetTokenType() == TokenTypDef) return -1;    // keep the name of the constant
+
+        int r = Emit(Op::LoadInt);
+        if (r >= 0) m_code.back().valInt = lit->m_value;
+        return r;
+    }
+
+    if (CBotExprLitNum<float>* lit = dynamic_cast<CBotExprLitNum<float>*>(instr))
+    {
+        if (instr->GetTokenType() == TokenTypDef) return -1;    // keep the name of the constant
+
+        int r = Emit(Op::LoadFloat);
+        if (r >= 0) m_code.back().valFloat = lit->m_value;
+        return r;
+    }
+
+    // long and double literals stay in the tree
+
+    if (dynamic_cast<CBotExprLitBool*>(instr) != nullptr)
+    {
+        int r = Emit(Op::LoadBool);
+        if (r >= 0) m_code.back().valInt = instr->GetTokenType() == ID_TRUE ? 1 : 0;
+        return r;
+    }
+
+    if (CBotExprVar* var = dynamic_cast<CBotExprVar*>(instr))
+    {
+        if (var->m_nIdent == -2) return -1;                     // "this"
+
+        int r = Emit(Op::LoadVar);
+        if (r >= 0)
+        {
+            m_code.back().ident = var->m_nIdent;
+            m_code.back().slot = var->m_nSlot;
+        }
+        return r;
+    }
+
+    if (CBotExprUnaire* unary = dynamic_cast<CBotExprUnaire*>(instr))
+    {
+        if (unary->m_constant != nullptr) return LowerConstant(unary->m_constant);
+
+        int a = LowerNode(unary->m_expr);
+        if (a < 0) return -1;
+
+        switch (instr->GetTokenType())
+        {
+        case ID_ADD:
+            return a;
+        case ID_SUB:
+            return Emit(Op::Neg, a);
+        case ID_NOT:
+        case ID_LOG_NOT:
+        case ID_TXT_NOT:
+            return Emit(Op::Not, a);
+        default:
+            return -1;
+        }
+    }
+
+    if (CBotTwoOpExpr* expr = dynamic_cast<CBotTwoOpExpr*>(instr))
+    {
+        if (expr->m_constant != nullptr) return LowerConstant(expr->m_constant);
+
+        int tokenType = instr->GetTokenType();
+
+        int a = LowerNode(expr->m_leftop);
+        if (a < 0) return -1;
+
+        if (tokenType == ID_LOG_AND || tokenType == ID_TXT_AND ||
+            tokenType == ID_LOG_OR  || tokenType == ID_TXT_OR)
+        {
+            // keep the short-circuit evaluation, the right operand may not be valid
+            bool isAnd = (tokenType == ID_LOG_AND || tokenType == ID_TXT_AND);
+            std::size_t jump = m_code.size();
+            if (Emit(isAnd ? Op::JumpIfFalse : Op::JumpIfTrue, a) < 0) return -1;
+
+            int b = LowerNode(expr->m_rightop);
+            if (b < 0) return -1;
+            if (Emit(Op::Move, b) < 0) return -1;
+            m_code.back().dst = static_cast<unsigned char>(a);
+            m_code[jump].target = static_cast<int>(m_code.size());
+            return a;
+        }
+
+        int b = LowerNode(expr->m_rightop);
+        if (b < 0) return -1;
+
+        switch (tokenType)
+        {
+        case ID_ADD:    return Emit(Op::Add, a, b);
+        case ID_SUB:    return Emit(Op::Sub, a, b);
+        case ID_MUL:    return Emit(Op::Mul, a, b);
+        case ID_DIV:    return Emit(Op::Div, a, b);
+        case ID_MODULO: return Emit(Op::Modulo, a, b);
+        case ID_POWER:  return Emit(Op::Power, a, b);
+        case ID_AND:    return Emit(Op::And, a, b);
+        case ID_OR:     return Emit(Op::Or, a, b);
+        case ID_XOR:    return Emit(Op::XOr, a, b);
+        case ID_SL:     return Emit(Op::SL, a, b);
+        case ID_SR:     return Emit(Op::SR, a, b);
+        case ID_ASR:    return Emit(Op::ASR, a, b);
+        case ID_LO:     return Emit(Op::Lo, a, b);
+        case ID_HI:     return Emit(Op::Hi, a, b);
+        case ID_LS:     return Emit(Op::Ls, a, b);
+        case ID_HS:     return Emit(Op::Hs, a, b);
+        case ID_EQ:     return Emit(Op::Eq, a, b);
+        case ID_NE:     return Emit(Op::Ne, a, b);
+        default:        return -1;
+        }
+    }
+
+    return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotBytecode::LowerConstant(CBotVar* constant)
+{
+    // expression folded by CBotOptimizer
+    int r = -1;
+    switch (constant->GetType())
+    {
+    case CBotTypInt:
+        if (constant->GetValString() != std::to_string(constant->GetValInt())) break;   // keep the name of the constant
+        r = Emit(Op::LoadInt);
+        if (r >= 0) m_code.back().valInt = constant->GetValInt();
+        break;
+    case CBotTypFloat:
+        r = Emit(Op::LoadFloat);
+        if (r >= 0) m_code.back().valFloat = constant->GetValFloat();
+        break;
+    case CBotTypBoolean:
+        r = Emit(Op::LoadBool);
+        if (r >= 0) m_code.back().valInt = constant->GetValInt() != 0 ? 1 : 0;
+        break;
+    default:
+        break;
+    }
+    return r;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotBytecode::Execute(CBotStack* pile, CBotVar*& result)
+{
+    Register regs[MAX_REGISTERS];
+
+    const std::size_t length = m_code.size();
+    for (std::size_t pc = 0; pc < length; ++pc)
+    {
+        const Instruction& instr = m_code[pc];
+        Register& dst = regs[instr.dst];
+
+        switch (instr.op)
+        {
+        case Op::LoadInt:
+            dst.type = CBotTypInt;
+            dst.i = instr.valInt;
+            break;
+
+        case Op::LoadBool:
+            dst.type = CBotTypBoolean;
+            dst.i = instr.valInt;
+            break;
+
+        case Op::LoadFloat:
+            dst.type = CBotTypFloat;
+            dst.f = instr.valFloat;
+            break;
+
+        case Op::LoadVar:
+        {
+            CBotVar* var = pile->FindVar(instr.ident, instr.slot, true);
+            if (var == nullptr || var->GetInit() != CBotVar::InitType::DEF) return false;
+            dst.type = var->GetType();
+            switch (dst.type)
+            {
+            case CBotTypInt:
+            case CBotTypBoolean:
+                dst.i = var->GetValInt();
+                break;
+            case CBotTypFloat:
+                dst.f = var->GetValFloat();
+                break;
+            default:
+                return false;
+            }
+            break;
+        }
+
+        case Op::Move:
+            dst = regs[instr.a];
+            break;
+
+        case Op::Neg:
+            dst = regs[instr.a];
+            if (dst.type == CBotTypInt) dst.i = static_cast<int>(0u - static_cast<unsigned>(dst.i));
+            else if (dst.type == CBotTypFloat) dst.f = -dst.f;
+            else return false;
+            break;
+
+        case Op::Not:
+            dst = regs[instr.a];
+            if (dst.type == CBotTypInt) dst.i = ~dst.i;
+            else if (dst.type == CBotTypBoolean) dst.i = !dst.i;
+            else return false;
+            break;
+
+        case Op::JumpIfFalse:
+        case Op::JumpIfTrue:
+        {
+            const Register& cond = regs[instr.a];
+            if (cond.type != CBotTypBoolean) return false;
+            if ((cond.i != 0) == (instr.op == Op::JumpIfTrue)) pc = instr.target - 1;
+            break;
+        }
+
+        default:
+            if (!ExecuteBinary(instr.op, dst, regs[instr.a], regs[instr.b])) return false;
+            break;
+        }
+    }
+
+    const Register& res = regs[m_result];
+    result = CBotVar::Create("", res.type);
+    if (res.type == CBotTypFloat) result->SetValFloat(res.f);
+    else                          result->SetValInt(res.i);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotBytecode::ExecuteBinary(Op op, Register& dst, const Register& a, const Register& b)
+{
+    if (a.type == CBotTypBoolean || b.type == CBotTypBoolean)
+    {
+        if (a.type != b.type) return false;
+        dst.type = CBotTypBoolean;
+        switch (op)
+        {
+        case Op::And:   dst.i = a.i && b.i; return true;
+        case Op::Or:    dst.i = a.i || b.i; return true;
+        case Op::XOr:   dst.i = (a.i != 0) ^ (b.i != 0); return true;
+        case Op::Eq:    dst.i = (a.i != 0) == (b.i != 0); return true;
+        case Op::Ne:    dst.i = (a.i != 0) != (b.i != 0); return true;
+        default:        return false;
+        }
+    }
+
+    if (a.type == CBotTypInt && b.type == CBotTypInt)
+    {
+        // wrap around on overflow instead of relying on undefined behaviour
+        unsigned ua = static_cast<unsigned>(a.i), ub = static_cast<unsigned>(b.i);
+        dst.type = CBotTypInt;
+        switch (op)
+        {
+        case Op::Add:    dst.i = static_cast<int>(ua + ub); return true;
+        case Op::Sub:    dst.i = static_cast<int>(ua - ub); return true;
+        case Op::Mul:    dst.i = static_cast<int>(ua * ub); return true;
+        case Op::Div:
+            if (b.i == 0) return false;                     // CBotErrZeroDiv is reported by the tree
+            dst.i = a.i / b.i;
+            return true;
+        case Op::Modulo:
+            if (b.i == 0) return false;
+            dst.i = a.i % b.i;
+            return true;
+        case Op::Power:  dst.i = static_cast<int>(pow(a.i, b.i)); return true;
+        case Op::And:    dst.i = a.i & b.i; return true;
+        case Op::Or:     dst.i = a.i | b.i; return true;
+        case Op::XOr:    dst.i = a.i ^ b.i; return true;
+        case Op::SL:     dst.i = static_cast<int>(ua << b.i); return true;
+        case Op::SR:     dst.i = static_cast<int>(ua >> b.i); return true;
+        case Op::ASR:    dst.i = a.i >> b.i; return true;
+        default:         break;
+        }
+
+        dst.type = CBotTypBoolean;
+        switch (op)
+        {
+        case Op::Lo:     dst.i = a.i <  b.i; return true;
+        case Op::Hi:     dst.i = a.i >  b.i; return true;
+        case Op::Ls:     dst.i = a.i <= b.i; return true;
+        case Op::Hs:     dst.i = a.i >= b.i; return true;
+        case Op::Eq:     dst.i = a.i == b.i; return true;
+        case Op::Ne:     dst.i = a.i != b.i; return true;
+        default:         return false;
+        }
+    }
+
+    if ((a.type != CBotTypInt && a.type != CBotTypFloat) ||
+        (b.type != CBotTypInt && b.type != CBotTypFloat)) return false;
+
+    // mixed operands are computed as float, like CBotTwoOpExpr::Execute() does
+    float fa = a.type == CBotTypFloat ? a.f : static_cast<float>(a.i);
+    float fb = b.type == CBotTypFloat ? b.f : static_cast<float>(b.i);
+    dst.type = CBotTypFloat;
+    switch (op)
+    {
+    case Op::Add:    dst.f = fa + fb; return true;
+    case Op::Sub:    dst.f = fa - fb; return true;
+    case Op::Mul:    dst.f = fa * fb; return true;
+    case Op::Div:
+        if (fb == 0.0f) return false;
+        dst.f = fa / fb;
+        return true;
+    case Op::Modulo:
+        if (fb == 0.0f) return false;
+        dst.f = fmod(fa, fb);
+        return true;
+    case Op::Power:  dst.f = pow(fa, fb); return true;
+    default:         break;
+    }
+
+    dst.type = CBotTypBoolean;
+    switch (op)
+    {
+    case Op::Lo:     dst.i = fa <  fb; return true;
+    case Op::Hi:     dst.i = fa >  fb; return true;
+    case Op::Ls:     dst.i = fa <= fb; return true;
+    case Op::Hs:     dst.i = fa >= fb; return true;
+    case Op::Eq:     dst.i = fa == fb; return true;
+    case Op::Ne:     dst.i = fa != fb; return true;
+    default:         return false;
+    }
+}
+
+} // namespace CBot
@@ -0,0 +1,141 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+#pragma once
+
+#include "CBot/CBotEnums.h"
+
+#include <vector>
+
+namespace CBot
+{
+
+class CBotInstr;
+class CBotStack;
+class CBotVar;
+
+/**
+ * \brief Register bytecode for side-effect free expressions
+ *
+ * The instruction tree executor allocates a CBotStack level for almost every
+ * sub-expression. Expressions built only from int, float and boolean literals,
+ * local variables and arithmetic, comparison and logic operators can instead be
+ * lowered to a flat list of register instructions which is evaluated in one go.
+ *
+ * Lowering is done after compilation by CBotProgram::Compile() (see
+ * CBotProgram::SetBytecodeEnabled()). The instruction tree is kept as it was -
+ * whenever the bytecode can't produce the same result as the tree (uninitialized
+ * variable, division by zero, unexpected variable type...) Execute() gives up and
+ * the expression is executed by walking the tree instead, which also takes care
+ * of reporting the error.
+ *
+ * This is only a first step towards a bytecode backend, and it is disabled by
+ * default. Only expressions whose root is a CBotTwoOpExpr are lowered. Statements,
+ * control flow (if, loops, return), assignments, function and method calls,
+ * strings, long and double values, arrays and fields are always executed by the
+ * instruction tree, and so are the lowered expressions in step by step mode.
+ */
+class CBotBytecode
+{
+public:
+    /**
+     * \brief Lower all suitable expressions in the given instruction tree
+     * \param root Root of the instruction tree, usually a CBotFunction
+     * \return Number of expressions that were lowered
+     */
+    static int LowerTree(CBotInstr* root);
+
+    /**
+     * \brief Try to lower a single expression
+     * \param expr Expression to lower
+     * \return Lowered expression, or nullptr if the expression can't be lowered
+     */
+    static CBotBytecode* Lower(CBotInstr* expr);
+
+    /**
+     * \brief Evaluate the expression
+     * \param pile Stack used to find the local variables
+     * \param[out] result Newly created variable holding the result
+     * \return false if the expression has to be executed by the instruction tree instead
+     */
+    bool Execute(CBotStack* pile, CBotVar*& result);
+
+    /**
+     * \brief Number of instructions, used to charge the execution timer
+     */
+    int GetLength() { return static_cast<int>(m_code.size()); }
+
+private:
+    CBotBytecode() = default;
+
+    enum class Op : unsigned char
+    {
+        LoadInt, LoadFloat, LoadBool, LoadVar, Move,
+        Add, Sub, Mul, Div, Modulo, Power,
+        And, Or, XOr, SL, SR, ASR,
+        Lo, Hi, Ls, Hs, Eq, Ne,
+        Neg, Not,
+        JumpIfFalse, JumpIfTrue
+    };
+
+    struct Instruction
+    {
+        Op op;
+        unsigned char dst;
+        unsigned char a;
+        unsigned char b;
+        //! Slot of the variable in the function frame (LoadVar only)
+        int slot;
+        union
+        {
+            int valInt;
+            float valFloat;
+            long ident;
+            int target;
+        };
+    };
+
+    struct Register
+    {
+        CBotType type;
+        union
+        {
+            int i;
+            float f;
+        };
+    };
+
+    //! Maximum number of registers a single expression can use
+    static const int MAX_REGISTERS = 32;
+
+    int LowerNode(CBotInstr* instr);
+    int LowerConstant(CBotVar* constant);
+    int Emit(Op op, int a = 0, int b = 0);
+
+    static bool ExecuteBinary(Op op, Register& dst, const Register& a, const Register& b);
+
+private:
+    std::vector<Instruction> m_code;
+    //! Number of registers used
+    int m_registers = 0;
+    //! Register holding the value of the whole expression
+    int m_result = -1;
+};
+
+} // namespace CBot
@@ -171,14 +171,14 @@ void CBotCStack::SetType(CBotTypResult& type)
 CBotVar* CBotCStack::FindVar(CBotToken* &pToken)
 {
     CBotCStack*    p = this;
-    std::string    name = pToken->GetString();
+    int            nameId = pToken->GetNameId();
 
     while (p != nullptr)
     {
         CBotVar*    pp = p->m_listVar;
         while ( pp != nullptr)
         {
-            if (name == pp->GetName())
+            if (pp->GetNameId() == nameId)
             {
                 return pp;
             }
@@ -369,14 +369,14 @@ void CBotCStack::CreateMemberVars(CBotClass* pClass, bool setDefined)
 bool CBotCStack::CheckVarLocal(CBotToken* &pToken)
 {
     CBotCStack*    p = this;
-    std::string    name = pToken->GetString();
+    int            nameId = pToken->GetNameId();
 
     while (p != nullptr)
     {
         CBotVar*    pp = p->m_listVar;
         while ( pp != nullptr)
         {
-            if (name == pp->GetName())
+            if (pp->GetNameId() == nameId)
                 return true;
             pp = pp->m_next;
         }
@@ -44,6 +44,9 @@ namespace CBot
 
 ////////////////////////////////////////////////////////////////////////////////
 std::set<CBotClass*> CBotClass::m_publicClasses{};
+std::mutex CBotClass::m_lockMutex;
+std::atomic<uint32_t> CBotClass::m_lastLayout{0};
+std::atomic<uint32_t> CBotClass::m_methodRevision{0};
 
 ////////////////////////////////////////////////////////////////////////////////
 CBotClass::CBotClass(const std::string& name,
@@ -55,9 +58,11 @@ CBotClass::CBotClass(const std::string& name,
     m_pVar      = nullptr;
     m_externalMethods = new CBotExternalCallList();
     m_rUpdate   = nullptr;
+    m_rUpdateItem = nullptr;
     m_IsDef     = true;
     m_bIntrinsic= bIntrinsic;
     m_nbVar     = m_parent == nullptr ? 0 : m_parent->m_nbVar;
+    m_layout    = ++m_lastLayout;
 
     m_publicClasses.insert(this);
 }
@@ -100,11 +105,40 @@ void CBotClass::Purge()
     m_IsDef     = false;
 
     m_nbVar     = m_parent == nullptr ? 0 : m_parent->m_nbVar;
+    NewLayout();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotClass::NewLayout()
+{
+    for (CBotClass* pClass : m_publicClasses)
+    {
+        if (pClass->IsChildOf(this)) pClass->m_layout = ++m_lastLayout;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint32_t CBotClass::GetLayout() const
+{
+    return m_layout.load(std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t CBotClass::GetMethodCacheKey() const
+{
+    return (static_cast<uint64_t>(GetLayout()) << 32) | m_methodRevision.load(std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotClass::InvalidateMethodCaches()
+{
+    ++m_methodRevision;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 bool CBotClass::Lock(CBotProgram* prog)
 {
+    std::lock_guard<std::mutex> lock(m_lockMutex);
     if (m_lockProg.size() == 0)
     {
         m_lockCurrentCount = 1;
@@ -130,6 +164,7 @@ bool CBotClass::Lock(CBotProgram* prog)
 ////////////////////////////////////////////////////////////////////////////////
 void CBotClass::Unlock()
 {
+    std::lock_guard<std::mutex> lock(m_lockMutex);
     if (--m_lockCurrentCount > 0) return; // if called Lock() multiple times, wait for all to unlock
 
     m_lockProg.pop_front();
@@ -138,6 +173,7 @@ void CBotClass::Unlock()
 ////////////////////////////////////////////////////////////////////////////////
 void CBotClass::FreeLock(CBotProgram* prog)
 {
+    std::lock_guard<std::mutex> lock(m_lockMutex);
     for (CBotClass* pClass : m_publicClasses)
     {
         if (pClass->m_lockProg.size() > 0 && prog == pClass->m_lockProg[0])
@@ -187,6 +223,7 @@ bool CBotClass::AddItem(CBotVar* pVar)
     if ( m_pVar == nullptr ) m_pVar = pVar;
     else m_pVar->AddNext(pVar);
 
+    NewLayout();
     return true;
 }
 
@@ -224,10 +261,11 @@ CBotVar* CBotClass::GetVar()
 CBotVar* CBotClass::GetItem(const std::string& name)
 {
     CBotVar*    p = m_pVar;
+    int         nameId = CBotToken::InternName(name);
 
     while ( p != nullptr )
     {
-        if ( p->GetName() == name ) return p;
+        if ( p->GetNameId() == nameId ) return p;
         p = p->GetNext();
     }
     if (m_parent != nullptr ) return m_parent->GetItem(name);
@@ -252,10 +290,11 @@ CBotVar* CBotClass::GetItemRef(int nIdent)
 bool CBotClass::CheckVar(const std::string &name)
 {
     CBotVar*    p = m_pVar;
+    int         nameId = CBotToken::InternName(name);
 
     while ( p != nullptr )
     {
-        if ( p->GetName() == name ) return true;
+        if ( p->GetNameId() == nameId ) return true;
         p = p->GetNext();
     }
     return false;
@@ -287,9 +326,11 @@ CBotClass* CBotClass::Find(const std::string& name)
 ////////////////////////////////////////////////////////////////////////////////
 bool CBotClass::AddFunction(const std::string& name,
                             bool rExec(CBotVar* pThis, CBotVar* pVar, CBotVar* pResult, int& Exception, void* user),
-                            CBotTypResult rCompile(CBotVar* pThis, CBotVar*& pVar))
+                            CBotTypResult rCompile(CBotVar* pThis, CBotVar*& pVar),
+                            bool threadSafe)
 {
-    return m_externalMethods->AddFunction(name, std::unique_ptr<CBotExternalCall>(new CBotExternalCallClass(rExec, rCompile)));
+    NewLayout();
+    return m_externalMethods->AddFunction(name, std::unique_ptr<CBotExternalCall>(new CBotExternalCallClass(rExec, rCompile, threadSafe)));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -299,6 +340,19 @@ bool CBotClass::SetUpdateFunc(void rUpdate(CBotVar* thisVar, void* user))
     return true;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool CBotClass::SetUpdateItemFunc(void rUpdateItem(CBotVar* thisVar, CBotVar* item, void* user))
+{
+    m_rUpdateItem = rUpdateItem;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotClass::IsUpdatedByItem()
+{
+    return m_rUpdateItem != nullptr;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 CBotTypResult CBotClass::CompileMethode(CBotToken* name,
                                         CBotVar* pThis,
@@ -322,7 +376,7 @@ CBotTypResult CBotClass::CompileMethode(CBotToken* name,
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool CBotClass::ExecuteMethode(long& nIdent,
+bool CBotClass::ExecuteMethode(long nIdent,
                                CBotVar* pThis,
                                CBotVar** ppParams,
                                CBotTypResult pResultType,
@@ -343,7 +397,25 @@ bool CBotClass::ExecuteMethode(long& nIdent,
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void CBotClass::RestoreMethode(long& nIdent,
+CBotFunction* CBotClass::FindCachableMethod(long nIdent,
+                                            const std::string& name,
+                                            CBotVar** ppParams,
+                                            CBotProgram* program)
+{
+    for (CBotClass* pClass = this; pClass != nullptr; pClass = pClass->m_parent)
+    {
+        if (pClass->m_externalMethods->CheckCall(name)) return nullptr;
+        if (CBotFunction::HasOutOfClassMethods(pClass->m_name)) return nullptr;
+
+        CBotTypResult type;
+        CBotFunction* pt = CBotFunction::FindMethod(nIdent, name, ppParams, type, pClass, program);
+        if (pt != nullptr) return pt;
+    }
+    return nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotClass::RestoreMethode(long nIdent,
                                CBotToken* name,
                                CBotVar* pThis,
                                CBotVar** ppParams,
@@ -599,6 +671,7 @@ bool CBotClass::CompileDefItem(CBotToken* &p, CBotCStack* pStack, bool bSecond)
                     if ( f == nullptr ) return false;
 
                     m_pMethod.push_back(f);
+                    NewLayout();
                 }
                 else
                 {
@@ -803,6 +876,7 @@ CBotClass* CBotClass::Compile(CBotToken* &p, CBotCStack* pStack)
         }
 
         pOld->m_IsDef = true;           // complete definition
+        pOld->NewLayout();              // the parent may have changed
         if (pStack->IsOk()) return pOld;
     }
     pStack->SetError(CBotErrNoTerminator, p);
@@ -814,4 +888,9 @@ void CBotClass::Update(CBotVar* var, void* user)
     m_rUpdate(var, user);
 }
 
+void CBotClass::UpdateItem(CBotVar* var, CBotVar* item, void* user)
+{
+    m_rUpdateItem(var, item, user);
+}
+
 } // namespace CBot
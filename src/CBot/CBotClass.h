@@ -23,8 +23,11 @@
 #include "CBot/CBotTypResult.h"
 #include "CBot/CBotVar/CBotVar.h"
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <deque>
+#include <mutex>
 #include <set>
 #include <list>
 
@@ -140,7 +143,8 @@ public:
      */
     bool AddFunction(const std::string& name,
                      bool rExec(CBotVar* pThis, CBotVar* pVar, CBotVar* pResult, int& Exception, void* user),
-                     CBotTypResult rCompile(CBotVar* pThis, CBotVar*& pVar));
+                     CBotTypResult rCompile(CBotVar* pThis, CBotVar*& pVar),
+                     bool threadSafe = false);
 
     /*!
      * \brief SetUpdateFunc Defines routine to be called to update the elements
@@ -149,7 +153,24 @@ public:
      * \return
      */
     bool SetUpdateFunc(void rUpdate(CBotVar* thisVar, void* user));
-    //
+
+    /*!
+     * \brief SetUpdateItemFunc Defines routine to be called to update a single
+     * element of the class.
+     *
+     * When defined, it replaces the routine given to SetUpdateFunc(): updating
+     * an instance only marks its elements as out of date, and each element is
+     * refreshed by this routine the next time it is read.
+     * \param rUpdateItem
+     * \return
+     */
+    bool SetUpdateItemFunc(void rUpdateItem(CBotVar* thisVar, CBotVar* item, void* user));
+
+    /*!
+     * \brief IsUpdatedByItem
+     * \return true if the elements are updated one by one, see SetUpdateItemFunc()
+     */
+    bool IsUpdatedByItem();
 
     /*!
      * \brief AddItem Adds an element to the class.
@@ -255,9 +276,43 @@ public:
      * \param pToken
      * \return
      */
-    bool ExecuteMethode(long &nIdent, CBotVar* pThis, CBotVar** ppParams, CBotTypResult pResultType,
+    bool ExecuteMethode(long nIdent, CBotVar* pThis, CBotVar** ppParams, CBotTypResult pResultType,
                         CBotStack*&pStack, CBotToken* pToken);
 
+    /*!
+     * \brief Find the method a call resolves to, if the result may be cached
+     *
+     * Follows the same search as ExecuteMethode() without calling anything. External methods and
+     * classes with out-of-class methods are not cached, because they depend on the calling program.
+     * \param nIdent Unique identifier of the method found by the compiler
+     * \param name Name of the method
+     * \param ppParams Arguments of the call
+     * \param program The current program
+     * \return The method declared in a class body, or nullptr if the call must go through ExecuteMethode()
+     */
+    CBotFunction* FindCachableMethod(long nIdent, const std::string& name, CBotVar** ppParams, CBotProgram* program);
+
+    /*!
+     * \brief Identifier of the current layout of this class, used as key by the inline caches
+     *
+     * Changes whenever the members or methods of this class or of one of its parents change,
+     * so instances built from different definitions never share a layout (see CBotInlineCache).
+     */
+    uint32_t GetLayout() const;
+
+    /*!
+     * \brief Key of the method inline caches for calls on this class
+     *
+     * Combines GetLayout() with a revision that changes whenever public functions or
+     * out-of-class methods are added or removed, see InvalidateMethodCaches().
+     */
+    uint64_t GetMethodCacheKey() const;
+
+    /*!
+     * \brief Invalidate the method inline caches of all classes, see GetMethodCacheKey()
+     */
+    static void InvalidateMethodCaches();
+
     /*!
      * \brief RestoreMethode Restored the execution stack.
      * \param nIdent
@@ -266,7 +321,7 @@ public:
      * \param ppParams
      * \param pStack
      */
-    void RestoreMethode(long &nIdent,
+    void RestoreMethode(long nIdent,
                         CBotToken* name,
                         CBotVar* pThis,
                         CBotVar** ppParams,
@@ -380,9 +435,22 @@ public:
 
     void Update(CBotVar* var, void* user);
 
+    void UpdateItem(CBotVar* var, CBotVar* item, void* user);
+
 private:
     //! List of all public classes
     static std::set<CBotClass*> m_publicClasses;
+    //! Guards m_lockProg of all classes, see Lock()
+    static std::mutex m_lockMutex;
+    //! Last layout given to a class, see GetLayout()
+    static std::atomic<uint32_t> m_lastLayout;
+    //! Revision of the public functions and out-of-class methods, see GetMethodCacheKey()
+    static std::atomic<uint32_t> m_methodRevision;
+
+    /*!
+     * \brief Give a new layout to this class and to all classes derived from it
+     */
+    void NewLayout();
 
 
     //! true if this class is fully compiled, false if only precompiled
@@ -402,6 +470,7 @@ private:
     //! List of all class methods
     std::list<CBotFunction*> m_pMethod{};
     void (*m_rUpdate)(CBotVar* thisVar, void* user);
+    void (*m_rUpdateItem)(CBotVar* thisVar, CBotVar* item, void* user);
 
     CBotToken* m_pOpenblk;
 
@@ -409,6 +478,8 @@ private:
     int m_lockCurrentCount = 0;
     //! Programs waiting for lock. m_lockProg[0] is the program currently holding the lock, if any
     std::deque<CBotProgram*> m_lockProg{};
+    //! Current layout, read by programs running on other threads
+    std::atomic<uint32_t> m_layout;
 };
 
 } // namespace CBot
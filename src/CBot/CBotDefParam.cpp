@@ -26,6 +26,7 @@
 #include "CBot/CBotCStack.h"
 
 #include "CBot/CBotVar/CBotVarClass.h"
+#include "CBot/CBotVar/CBotVarString.h"
 
 #include <cassert>
 
@@ -36,6 +37,7 @@ namespace CBot
 CBotDefParam::CBotDefParam()
 {
     m_nIdent = 0;
+    m_nSlot = -1;
     m_expr = nullptr;
 }
 
@@ -198,7 +200,7 @@ bool CBotDefParam::Execute(CBotVar** ppVars, CBotStack* &pj)
                 newvar->SetInit(pVar->GetInit()); // copy nan
                 break;
             case CBotTypString:
-                newvar->SetValString(pVar->GetValString());
+                static_cast<CBotVarString*>(newvar)->SetValSharedString(CBotVarString::GetSharedString(pVar));
                 break;
             case CBotTypBoolean:
                 newvar->SetValInt(pVar->GetValInt());
@@ -222,7 +224,7 @@ bool CBotDefParam::Execute(CBotVar** ppVars, CBotStack* &pj)
             }
         }
         newvar->SetUniqNum(p->m_nIdent);
-        pj->AddVar(newvar);     // add a variable
+        pj->AddVar(newvar, p->m_nSlot);     // add a variable
         p = p->m_next;
         if (!useDefault) i++;
     }
@@ -102,9 +102,13 @@ private:
     //! Type of paramteter.
     CBotTypResult m_type;
     long m_nIdent;
+    //! Slot of the parameter in the function frame.
+    int m_nSlot;
 
     //! Default value expression for the parameter.
     CBotInstr* m_expr;
+
+    friend class CBotFunction;
 };
 
 } // namespace CBot
@@ -23,6 +23,7 @@
 #include "CBot/CBotStack.h"
 #include "CBot/CBotCStack.h"
 #include "CBot/CBotUtils.h"
+#include "CBot/CBotWorkerPool.h"
 
 #include "CBot/CBotVar/CBotVar.h"
 
@@ -32,14 +33,21 @@ namespace CBot
 void CBotExternalCallList::Clear()
 {
     m_list.clear();
+    m_revision++;
 }
 
 bool CBotExternalCallList::AddFunction(const std::string& name, std::unique_ptr<CBotExternalCall> call)
 {
     m_list[name] = std::move(call);
+    m_revision++;
     return true;
 }
 
+long CBotExternalCallList::GetRevision()
+{
+    return m_revision;
+}
+
 CBotTypResult CBotExternalCallList::CompileCall(CBotToken*& p, CBotVar* thisVar, CBotVar** ppVar, CBotCStack* pStack)
 {
     if (m_list.count(p->GetString()) == 0)
@@ -83,6 +91,10 @@ int CBotExternalCallList::DoCall(CBotToken* token, CBotVar* thisVar, CBotVar** p
     CBotExternalCall* pt = m_list[token->GetString()].get();
 
     if (pStack->IsCallFinished()) return true;
+
+    // the instruction calls again once the program runs outside of the batch
+    if (!pt->IsThreadSafe() && CBotWorkerPool::IsRunningSlice()) return pStack->DeferCall();
+
     CBotStack* pile = pStack->AddStackExternalCall(pt);
 
     // lists the parameters depending on the contents of the stack (pStackVar)
@@ -97,6 +109,7 @@ int CBotExternalCallList::DoCall(CBotToken* token, CBotVar* thisVar, CBotVar** p
     pile2->SetVar(pResult);
 
     pile->SetError(CBotNoErr, token); // save token for the position in case of error
+
     return pt->Run(thisVar, pStack);
 }
 
@@ -116,17 +129,23 @@ bool CBotExternalCallList::RestoreCall(CBotToken* token, CBotVar* thisVar, CBotV
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-CBotExternalCall::CBotExternalCall()
+CBotExternalCall::CBotExternalCall(bool threadSafe)
 {
+    m_threadSafe = threadSafe;
 }
 
 CBotExternalCall::~CBotExternalCall()
 {
 }
 
+bool CBotExternalCall::IsThreadSafe()
+{
+    return m_threadSafe;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-CBotExternalCallDefault::CBotExternalCallDefault(RuntimeFunc rExec, CompileFunc rCompile)
+CBotExternalCallDefault::CBotExternalCallDefault(RuntimeFunc rExec, CompileFunc rCompile, bool threadSafe) : CBotExternalCall(threadSafe)
 {
     m_rExec = rExec;
     m_rComp = rCompile;
@@ -170,7 +189,7 @@ bool CBotExternalCallDefault::Run(CBotVar* thisVar, CBotStack* pStack)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-CBotExternalCallClass::CBotExternalCallClass(RuntimeFunc rExec, CompileFunc rCompile)
+CBotExternalCallClass::CBotExternalCallClass(RuntimeFunc rExec, CompileFunc rCompile, bool threadSafe) : CBotExternalCall(threadSafe)
 {
     m_rExec = rExec;
     m_rComp = rCompile;
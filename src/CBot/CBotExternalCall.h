@@ -47,9 +47,10 @@ class CBotExternalCall
 public:
     /**
      * \brief Constructor
+     * \param threadSafe true if the call may run while other programs run in parallel, see IsThreadSafe()
      * \see CBotProgram::AddFunction()
      */
-    CBotExternalCall();
+    CBotExternalCall(bool threadSafe = false);
 
     /**
      * \brief Destructor
@@ -73,6 +74,18 @@ public:
      * \return false to request program interruption, true otherwise
      */
     virtual bool Run(CBotVar* thisVar, CBotStack* pStack) = 0;
+
+    /**
+     * \brief Tells whether the call may run during a batch of CBotWorkerPool
+     *
+     * Thread safe calls only read the state of the host application, several of them may run at the same time.
+     * The other calls are deferred: the program stops before the call and executes it on the next call
+     * to CBotProgram::Run(), outside of the batch (see CBotProgram::IsCallDeferred()).
+     */
+    bool IsThreadSafe();
+
+private:
+    bool m_threadSafe;
 };
 
 /**
@@ -88,9 +101,10 @@ public:
      * \brief Constructor
      * \param rExec Runtime function
      * \param rCompile Compilation function
+     * \param threadSafe See CBotExternalCall::IsThreadSafe()
      * \see CBotProgram::AddFunction()
      */
-    CBotExternalCallDefault(RuntimeFunc rExec, CompileFunc rCompile);
+    CBotExternalCallDefault(RuntimeFunc rExec, CompileFunc rCompile, bool threadSafe = false);
 
     /**
      * \brief Destructor
@@ -118,9 +132,10 @@ public:
      * \brief Constructor
      * \param rExec Runtime function
      * \param rCompile Compilation function
+     * \param threadSafe See CBotExternalCall::IsThreadSafe()
      * \see CBotProgram::AddFunction()
      */
-    CBotExternalCallClass(RuntimeFunc rExec, CompileFunc rCompile);
+    CBotExternalCallClass(RuntimeFunc rExec, CompileFunc rCompile, bool threadSafe = false);
 
     /**
      * \brief Destructor
@@ -211,9 +226,17 @@ public:
      */
     void Clear();
 
+    /**
+     * \brief Returns a number which changes every time the list of registered functions is modified
+     *
+     * Used to tell whether code compiled earlier is still valid (see CBotProgramCache)
+     */
+    long GetRevision();
+
 private:
     std::map<std::string, std::unique_ptr<CBotExternalCall>> m_list{};
     void* m_user = nullptr;
+    long m_revision = 0;
 };
 
 } // namespace CBot
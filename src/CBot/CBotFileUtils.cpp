@@ -353,10 +353,9 @@ bool ReadStream(std::istream& istr, std::ostream &ostr)
     if (!ReadLong(istr, length)) return false;
     if (length == 0) return true;
 
-    while (length-- > 0)
-    {
-        if (!(ostr << istr.get())) return false;
-    }
+    std::string buffer(length, '\0');
+    if (!istr.read(&buffer[0], length)) return false;
+    if (!ostr.write(buffer.data(), length)) return false;
     return true;
 }
 
@@ -0,0 +1,116 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace CBot
+{
+
+/**
+ * \brief Inline cache of an instruction, remembers the result of a lookup for the last few keys
+ *
+ * Used by CBotFieldExpr and CBotInstrMethode to skip the search for a member or a method
+ * when the receiver has the same class layout as in a previous execution (see CBotClass::GetLayout()).
+ *
+ * The instructions are shared by all the programs compiled from the same code, and those programs
+ * may run on different threads (see CBotWorkerPool), so the cache is a small seqlock: Find() never
+ * blocks and reports a miss if the entries are being changed, Store() gives up if another thread
+ * is already storing. When all the entries are taken, the next Store() starts over.
+ *
+ * \tparam T Cached value, must be small enough for std::atomic
+ */
+template<typename T>
+class CBotInlineCache
+{
+public:
+    CBotInlineCache() : m_sequence(0), m_count(0)
+    {
+        for (int i = 0; i < SIZE; i++)
+        {
+            m_keys[i].store(0, std::memory_order_relaxed);
+            m_values[i].store(T(), std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * \brief Look up a key
+     * \param key Key to find, 0 is never stored
+     * \param[out] value Value stored for this key
+     * \return true if the key was found
+     */
+    bool Find(uint64_t key, T& value) const
+    {
+        unsigned int sequence = m_sequence.load(std::memory_order_acquire);
+        if ((sequence & 1) != 0) return false;
+
+        bool found = false;
+        int count = m_count.load(std::memory_order_relaxed);
+        for (int i = 0; i < count; i++)
+        {
+            if (m_keys[i].load(std::memory_order_relaxed) == key)
+            {
+                value = m_values[i].load(std::memory_order_relaxed);
+                found = true;
+                break;
+            }
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return found && m_sequence.load(std::memory_order_relaxed) == sequence;
+    }
+
+    /**
+     * \brief Remember the value of a key, may silently do nothing
+     * \param key Key of the value, 0 is ignored
+     * \param value Value to store
+     */
+    void Store(uint64_t key, T value)
+    {
+        if (key == 0) return;
+
+        unsigned int sequence = m_sequence.load(std::memory_order_relaxed);
+        if ((sequence & 1) != 0) return;
+        if (!m_sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_relaxed)) return;
+        std::atomic_thread_fence(std::memory_order_release);
+
+        int count = m_count.load(std::memory_order_relaxed);
+        if (count == SIZE) count = 0;
+        m_keys[count].store(key, std::memory_order_relaxed);
+        m_values[count].store(value, std::memory_order_relaxed);
+        m_count.store(count + 1, std::memory_order_relaxed);
+
+        m_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+private:
+    //! Number of entries, a call site seldom sees more classes than that
+    static const int SIZE = 4;
+
+    //! Odd while Store() is changing the entries
+    std::atomic<unsigned int> m_sequence;
+    //! Number of entries in use
+    std::atomic<int> m_count;
+    std::atomic<uint64_t> m_keys[SIZE];
+    std::atomic<T> m_values[SIZE];
+};
+
+} // namespace CBot
@@ -191,7 +191,7 @@ bool CBotDefArray::Execute(CBotStack* &pj)
         CBotVar*    var = CBotVar::Create(*(m_var->GetToken()), m_typevar);
         var->SetPointer(nullptr);
         var->SetUniqNum((static_cast<CBotLeftExprVar*>(m_var))->m_nIdent);
-        pj->AddVar(var);
+        pj->AddVar(var, (static_cast<CBotLeftExprVar*>(m_var))->m_nSlot);
 
 #if        STACKMEM
         pile1->AddStack()->Delete();
@@ -205,7 +205,8 @@ bool CBotDefArray::Execute(CBotStack* &pj)
     {
         if (m_listass != nullptr)                                      // there is the assignment for this table
         {
-            CBotVar* pVar = pj->FindVar((static_cast<CBotLeftExprVar*>(m_var))->m_nIdent, false);
+            CBotLeftExprVar* var = static_cast<CBotLeftExprVar*>(m_var);
+            CBotVar* pVar = pj->FindVar(var->m_nIdent, var->m_nSlot, false);
 
             if (!m_listass->Execute(pile1, pVar)) return false;
         }
@@ -280,11 +280,15 @@ bool CBotDefClass::Execute(CBotStack* &pj)
         }
 
         pThis->SetUniqNum((static_cast<CBotLeftExprVar*>(m_var))->m_nIdent); // its attribute as unique number
-        pile->AddVar(pThis);                                    // place on the stack
+        pile->AddVar(pThis, (static_cast<CBotLeftExprVar*>(m_var))->m_nSlot); // place on the stack
         pile->IncState();
     }
 
-    if ( pThis == nullptr ) pThis = pile->FindVar((static_cast<CBotLeftExprVar*>(m_var))->m_nIdent, false);
+    if ( pThis == nullptr )
+    {
+        CBotLeftExprVar* var = static_cast<CBotLeftExprVar*>(m_var);
+        pThis = pile->FindVar(var->m_nIdent, var->m_nSlot, false);
+    }
 
     if ( pile->GetState()<3)
     {
@@ -497,6 +501,7 @@ std::map<std::string, CBotInstr*> CBotDefClass::GetDebugLinks()
     links["m_var"] = m_var;
     links["m_parameters"] = m_parameters;
     links["m_expr"] = m_expr;
+    links["m_exprRetVar"] = m_exprRetVar;
     return links;
 }
 
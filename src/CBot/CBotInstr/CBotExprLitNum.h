@@ -66,6 +66,7 @@ private:
     CBotType m_numtype;
     //! Value
     T m_value;
+    friend class CBotBytecode;
 
 };
 
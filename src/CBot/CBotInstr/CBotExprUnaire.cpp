@@ -22,6 +22,7 @@
 
 #include "CBot/CBotStack.h"
 #include "CBot/CBotCStack.h"
+#include "CBot/CBotOptimizer.h"
 
 #include "CBot/CBotVar/CBotVar.h"
 
@@ -32,12 +33,14 @@ namespace CBot
 CBotExprUnaire::CBotExprUnaire()
 {
     m_expr = nullptr;
+    m_constant = nullptr;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 CBotExprUnaire::~CBotExprUnaire()
 {
     delete m_expr;
+    delete m_constant;
 }
 
 CBotInstr* CBotExprUnaire::Compile(CBotToken* &p, CBotCStack* pStack, bool bLiteral, bool bConstExpr)
@@ -79,6 +82,9 @@ CBotInstr* CBotExprUnaire::Compile(CBotToken* &p, CBotCStack* pStack, bool bLite
 ////////////////////////////////////////////////////////////////////////////////
 bool CBotExprUnaire::Execute(CBotStack* &pj)
 {
+    // the value was computed by the compiler
+    if (m_constant != nullptr) return CBotOptimizer::ExecuteConstant(this, m_constant, pj);
+
     CBotStack*    pile = pj->AddStack(this);
 
     if (pile->GetState() == 0)
@@ -115,6 +121,7 @@ void CBotExprUnaire::RestoreState(CBotStack* &pj, bool bMain)
 
     CBotStack*    pile = pj->RestoreStack(this);
     if ( pile == nullptr) return;
+    if (m_constant != nullptr) return;
 
     if (pile->GetState() == 0)
     {
@@ -123,6 +130,12 @@ void CBotExprUnaire::RestoreState(CBotStack* &pj, bool bMain)
     }
 }
 
+std::string CBotExprUnaire::GetDebugData()
+{
+    if (m_constant != nullptr) return m_token.GetString() + " = " + m_constant->GetValString();
+    return m_token.GetString();
+}
+
 std::map<std::string, CBotInstr*> CBotExprUnaire::GetDebugLinks()
 {
     auto links = CBotInstr::GetDebugLinks();
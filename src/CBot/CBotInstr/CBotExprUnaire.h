@@ -58,11 +58,16 @@ public:
 
 protected:
     virtual const std::string GetDebugName() override { return "CBotExprUnaire"; }
+    virtual std::string GetDebugData() override;
     virtual std::map<std::string, CBotInstr*> GetDebugLinks() override;
 
 private:
     //! Expression to be evaluated.
     CBotInstr* m_expr;
+    //! Value of the expression if it was folded to a constant (m_expr is then deleted)
+    CBotVar* m_constant;
+    friend class CBotBytecode;
+    friend class CBotOptimizer;
 };
 
 } // namespace CBot
@@ -36,6 +36,7 @@ namespace CBot
 CBotExprVar::CBotExprVar()
 {
     m_nIdent = 0;
+    m_nSlot = -1;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -286,7 +287,7 @@ bool CBotExprVar::ExecuteVar(CBotVar* &pVar, CBotStack* &pj, CBotToken* prevToke
 
     if (bStep && m_nIdent>0 && pj->IfStep()) return false;
 
-    pVar = pj->FindVar(m_nIdent, true);     // tries with the variable update if necessary
+    pVar = pj->FindVar(m_nIdent, m_nSlot, true);    // tries with the variable update if necessary
     if (pVar == nullptr)
     {
         assert(false);
@@ -95,8 +95,12 @@ protected:
 
 private:
     long m_nIdent;
+    //! Slot in the function frame, or -1 if the variable is not a local one
+    int m_nSlot;
     friend class CBotPostIncExpr;
     friend class CBotPreIncExpr;
+    friend class CBotBytecode;
+    friend class CBotFunction;
 
 };
 
@@ -91,13 +91,16 @@ bool CBotFieldExpr::ExecuteVar(CBotVar* &pVar, CBotStack* &pile, CBotToken* prev
 
     if (bStep && pile->IfStep()) return false;
 
-    pVar = pVar->GetItemRef(m_nIdent);
+    pVar = pItem->GetItemRef(m_nIdent, m_itemCache);
     if (pVar == nullptr)
     {
         pile->SetError(CBotErrUndefItem, &m_token);
         return pj->Return(pile);
     }
 
+    // refresh the element if the class updates them one by one
+    pItem->UpdateItem(pVar);
+
     if (pVar->IsStatic())
     {
         // for a static variable, takes it in the class itself
@@ -20,6 +20,7 @@
 #pragma once
 
 #include "CBot/CBotInstr/CBotInstr.h"
+#include "CBot/CBotInlineCache.h"
 
 namespace CBot
 {
@@ -86,6 +87,8 @@ protected:
 private:
     friend class CBotExpression;
     int m_nIdent;
+    //! Position of the field in the instances of each class layout, see CBotVarClass::GetItemRef()
+    CBotInlineCache<int> m_itemCache;
 };
 
 } // namespace CBot
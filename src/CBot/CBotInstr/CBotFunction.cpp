@@ -26,6 +26,10 @@
 #include "CBot/CBotInstr/CBotExpression.h"
 #include "CBot/CBotInstr/CBotEmpty.h"
 #include "CBot/CBotInstr/CBotListArray.h"
+#include "CBot/CBotInstr/CBotExprVar.h"
+#include "CBot/CBotInstr/CBotLeftExpr.h"
+#include "CBot/CBotInstr/CBotLeftExprVar.h"
+#include "CBot/CBotInstr/CBotNew.h"
 
 #include "CBot/CBotStack.h"
 #include "CBot/CBotCStack.h"
@@ -36,11 +40,25 @@
 #include "CBot/CBotVar/CBotVar.h"
 
 #include <cassert>
+#include <map>
 #include <sstream>
+#include <vector>
 
 namespace CBot
 {
 
+namespace
+{
+
+void MoveToken(CBotToken& token, int offset)
+{
+    // the tokens which were never set don't have a position
+    if (token.GetString().empty()) return;
+    token.SetPos(token.GetStart() + offset, token.GetEnd() + offset);
+}
+
+} // namespace
+
 ////////////////////////////////////////////////////////////////////////////////
 CBotFunction::CBotFunction()
 {
@@ -52,10 +70,13 @@ CBotFunction::CBotFunction()
 //  m_nThisIdent = 0;
     m_nFuncIdent = 0;
     m_bSynchro    = false;
+    m_nSlots     = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 std::set<CBotFunction*> CBotFunction::m_publicFunctions{};
+std::map<std::string, int> CBotFunction::m_outOfClassMethods{};
+std::mutex CBotFunction::m_outOfClassMutex;
 
 ////////////////////////////////////////////////////////////////////////////////
 CBotFunction::~CBotFunction()
@@ -67,6 +88,15 @@ CBotFunction::~CBotFunction()
     if (m_bPublic)
     {
         m_publicFunctions.erase(this);
+        CBotClass::InvalidateMethodCaches();
+    }
+
+    if (m_bOutOfClass)
+    {
+        std::lock_guard<std::mutex> lock(m_outOfClassMutex);
+        auto it = m_outOfClassMethods.find(m_MasterClass);
+        if (--it->second == 0) m_outOfClassMethods.erase(it);
+        CBotClass::InvalidateMethodCaches();
     }
 }
 
@@ -240,6 +270,7 @@ CBotFunction* CBotFunction::Compile(CBotToken* &p, CBotCStack* pStack, CBotFunct
                         pStk->ResetError(CBotErrNoReturn, errPos, errPos);
                         goto bad;
                     }
+                    func->ResolveSlots();
                     return pStack->ReturnFunc(func, pStk);
                 }
             }
@@ -311,6 +342,12 @@ CBotFunction* CBotFunction::Compile1(CBotToken* &p, CBotCStack* pStack, CBotClas
             if ( IsOfType( p, ID_DBLDOTS ) )        // method for a class
             {
                 func->m_MasterClass = pp->GetString();
+                {
+                    std::lock_guard<std::mutex> lock(m_outOfClassMutex);
+                    m_outOfClassMethods[func->m_MasterClass]++;
+                    func->m_bOutOfClass = true;
+                    CBotClass::InvalidateMethodCaches();
+                }
                 // existence of the class is checked
                 // later in CBotFunction::Compile()
                 pp = p;
@@ -398,7 +435,8 @@ bool CBotFunction::Execute(CBotVar** ppVars, CBotStack* &pj, CBotVar* pInstance)
     CBotStack*  pile = pj->AddStack(this, CBotStack::BlockVisibilityType::FUNCTION);               // one end of stack local to this function
 //  if ( pile == EOX ) return true;
 
-    pile->SetProgram(m_pProg);                              // bases for routines
+    if (m_pProg != nullptr) pile->SetProgram(m_pProg);     // bases for routines
+    pile->SetFrame(m_nSlots);                               // table of local variables
 
     if ( pile->IfStep() ) return false;
 
@@ -463,7 +501,8 @@ void CBotFunction::RestoreState(CBotVar** ppVars, CBotStack* &pj, CBotVar* pInst
     if ( pile == nullptr ) return;
     CBotStack*  pile2 = pile;
 
-    pile->SetProgram(m_pProg);                          // bases for routines
+    if (m_pProg != nullptr) pile->SetProgram(m_pProg);  // bases for routines
+    pile->SetFrame(m_nSlots);                           // table of local variables
 
     if ( pile->GetBlock() != CBotStack::BlockVisibilityType::FUNCTION)
     {
@@ -565,9 +604,10 @@ void CBotFunction::SearchList(const std::list<CBotFunction*>& functionList,
                               const std::string& name, CBotVar** ppVars, CBotTypResult& TypeOrError,
                               std::map<CBotFunction*, int>& funcMap, CBotClass* pClass)
 {
+    int nameId = CBotToken::InternName(name);
     for (CBotFunction* pt : functionList)
     {
-        if ( pt->m_token.GetString() == name )
+        if ( pt->m_token.GetNameId() == nameId )
         {
             if (pClass != nullptr) // looking for a method ?
             {
@@ -641,9 +681,10 @@ void CBotFunction::SearchPublic(const std::string& name, CBotVar** ppVars, CBotT
                                 std::map<CBotFunction*, int>& funcMap, CBotClass* pClass)
 {
     {
+        int nameId = CBotToken::InternName(name);
         for (CBotFunction* pt : m_publicFunctions)
         {
-            if ( pt->m_token.GetString() == name )
+            if ( pt->m_token.GetNameId() == nameId )
             {
                 if (pClass != nullptr) // looking for a method ?
                 {
@@ -745,7 +786,7 @@ CBotFunction* CBotFunction::BestFunction(std::map<CBotFunction*, int>& funcMap,
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-int CBotFunction::DoCall(CBotProgram* program, const std::list<CBotFunction*>& localFunctionList, long &nIdent, const std::string &name,
+int CBotFunction::DoCall(CBotProgram* program, const std::list<CBotFunction*>& localFunctionList, long nIdent, const std::string &name,
                          CBotVar** ppVars, CBotStack* pStack, CBotToken* pToken)
 {
     CBotTypResult   type;
@@ -759,7 +800,8 @@ int CBotFunction::DoCall(CBotProgram* program, const std::list<CBotFunction*>& l
         CBotStack*  pStk1 = pStack->AddStack(pt, CBotStack::BlockVisibilityType::FUNCTION);    // to put "this"
 //      if ( pStk1 == EOX ) return true;
 
-        pStk1->SetProgram(pt->m_pProg);                 // it may have changed module
+        if (pt->m_pProg != nullptr) pStk1->SetProgram(pt->m_pProg); // it may have changed module
+        pStk1->SetFrame(pt->m_nSlots);                  // table of local variables
 
         if ( pStk1->IfStep() ) return false;
 
@@ -805,7 +847,7 @@ int CBotFunction::DoCall(CBotProgram* program, const std::list<CBotFunction*>& l
             {
                 if (!pt->m_param->Execute(ppVars, pStk3)) // interupt here
                 {
-                    if (!pStk3->IsOk() && pt->m_pProg != program)
+                    if (!pStk3->IsOk() && pt->m_pProg != nullptr && pt->m_pProg != program)
                     {
                         pStk3->SetPosError(pToken);       // indicates the error on the procedure call
                     }
@@ -821,7 +863,7 @@ int CBotFunction::DoCall(CBotProgram* program, const std::list<CBotFunction*>& l
         if ( !pStk3->GetRetVar(                     // puts the result on the stack
             pt->m_block->Execute(pStk3) ))          // GetRetVar said if it is interrupted
         {
-            if ( !pStk3->IsOk() && pt->m_pProg != program )
+            if ( !pStk3->IsOk() && pt->m_pProg != nullptr && pt->m_pProg != program )
             {
                 pStk3->SetPosError(pToken);         // indicates the error on the procedure call
             }
@@ -835,7 +877,7 @@ int CBotFunction::DoCall(CBotProgram* program, const std::list<CBotFunction*>& l
 
 ////////////////////////////////////////////////////////////////////////////////
 void CBotFunction::RestoreCall(const std::list<CBotFunction*>& localFunctionList,
-                               long &nIdent, const std::string &name, CBotVar** ppVars, CBotStack* pStack)
+                               long nIdent, const std::string &name, CBotVar** ppVars, CBotStack* pStack)
 {
     CBotTypResult   type;
     CBotFunction*   pt = nullptr;
@@ -850,7 +892,8 @@ void CBotFunction::RestoreCall(const std::list<CBotFunction*>& localFunctionList
         pStk1 = pStack->RestoreStack(pt);
         if ( pStk1 == nullptr ) return;
 
-        pStk1->SetProgram(pt->m_pProg);                 // it may have changed module
+        if (pt->m_pProg != nullptr) pStk1->SetProgram(pt->m_pProg); // it may have changed module
+        pStk1->SetFrame(pt->m_nSlots);                  // table of local variables
 
         if ( pStk1->GetBlock() != CBotStack::BlockVisibilityType::FUNCTION)
         {
@@ -942,7 +985,7 @@ CBotFunction* CBotFunction::FindMethod(long& nIdent, const std::string& name,
 {
     TypeOrError.SetType(CBotErrUndefCall);      // no routine of the name
 
-    auto methods = pClass->GetFunctions();
+    const auto& methods = pClass->GetFunctions();
 
     if ( nIdent )
     {
@@ -1009,7 +1052,7 @@ CBotFunction* CBotFunction::FindMethod(long& nIdent, const std::string& name,
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-int CBotFunction::DoCall(long &nIdent, const std::string &name, CBotVar* pThis,
+int CBotFunction::DoCall(long nIdent, const std::string &name, CBotVar* pThis,
                          CBotVar** ppVars, CBotStack* pStack, CBotToken* pToken, CBotClass* pClass)
 {
     CBotTypResult   type;
@@ -1021,96 +1064,108 @@ int CBotFunction::DoCall(long &nIdent, const std::string &name, CBotVar* pThis,
     {
 //      DEBUG( "CBotFunction::DoCall" + pt->GetName(), 0, pStack);
 
-        CBotStack*  pStk = pStack->AddStack(pt, CBotStack::BlockVisibilityType::FUNCTION);
-//      if ( pStk == EOX ) return true;
+        return DoCall(pt, pThis, ppVars, pStack, pToken, pClass);
+    }
+    return -1;
+}
 
-        pStk->SetProgram(pt->m_pProg);                  // it may have changed module
-        CBotStack*  pStk3 = pStk->AddStack(nullptr, CBotStack::BlockVisibilityType::BLOCK); // to set parameters passed
+////////////////////////////////////////////////////////////////////////////////
+int CBotFunction::DoCall(CBotFunction* pt, CBotVar* pThis, CBotVar** ppVars,
+                         CBotStack* pStack, CBotToken* pToken, CBotClass* pClass)
+{
+    CBotProgram*    pProgCurrent = pStack->GetProgram();
 
-        // preparing parameters on the stack
+    if ( pt->m_bSynchro && pClass == nullptr ) pClass = CBotClass::Find(pt->m_MasterClass);
 
-        if ( pStk->GetState() == 0 )
-        {
-            // stack for parameters and default args
-            CBotStack* pStk3b = pStk3->AddStack();
+    CBotStack*  pStk = pStack->AddStack(pt, CBotStack::BlockVisibilityType::FUNCTION);
+//  if ( pStk == EOX ) return true;
 
-            if (pStk3b->GetState() == 0)
-            {
-                // sets the variable "this" on the stack
-                CBotVar* pthis = CBotVar::Create("this", CBotTypNullPointer);
-                pthis->Copy(pThis, false);
-                pthis->SetUniqNum(-2);      // special value
-                pStk->AddVar(pthis);
-
-                CBotClass*  pClass = pThis->GetClass()->GetParent();
-                if ( pClass )
-                {
-                    // sets the variable "super" on the stack
-                    CBotVar* psuper = CBotVar::Create("super", CBotTypNullPointer);
-                    psuper->Copy(pThis, false); // in fact identical to "this"
-                    psuper->SetUniqNum(-3);     // special value
-                    pStk->AddVar(psuper);
-                }
-            }
-            pStk3b->SetState(1); // set 'this' was created
+    if (pt->m_pProg != nullptr) pStk->SetProgram(pt->m_pProg); // it may have changed module
+    pStk->SetFrame(pt->m_nSlots);                   // table of local variables
+    CBotStack*  pStk3 = pStk->AddStack(nullptr, CBotStack::BlockVisibilityType::BLOCK); // to set parameters passed
 
-            // initializes the variables as parameters
-            if (pt->m_param != nullptr)
-            {
-                if (!pt->m_param->Execute(ppVars, pStk3)) // interupt here
-                {
-                    if (!pStk3->IsOk() && pt->m_pProg != pProgCurrent)
-                    {
-                        pStk3->SetPosError(pToken);       // indicates the error on the procedure call
-                    }
-                    return false;
-                }
-            }
-            pStk3b->Delete(); // done with param stack
-            pStk->IncState();
-        }
+    // preparing parameters on the stack
+
+    if ( pStk->GetState() == 0 )
+    {
+        // stack for parameters and default args
+        CBotStack* pStk3b = pStk3->AddStack();
 
-        if ( pStk->GetState() == 1 )
+        if (pStk3b->GetState() == 0)
         {
-            if ( pt->m_bSynchro )
+            // sets the variable "this" on the stack
+            CBotVar* pthis = CBotVar::Create("this", CBotTypNullPointer);
+            pthis->Copy(pThis, false);
+            pthis->SetUniqNum(-2);      // special value
+            pStk->AddVar(pthis);
+
+            CBotClass*  pClass = pThis->GetClass()->GetParent();
+            if ( pClass )
             {
-                CBotProgram* pProgBase = pStk->GetProgram(true);
-                if ( !pClass->Lock(pProgBase) ) return false; // try to lock, interrupt if failed
+                // sets the variable "super" on the stack
+                CBotVar* psuper = CBotVar::Create("super", CBotTypNullPointer);
+                psuper->Copy(pThis, false); // in fact identical to "this"
+                psuper->SetUniqNum(-3);     // special value
+                pStk->AddVar(psuper);
             }
-            pStk->IncState();
         }
-        // finally calls the found function
+        pStk3b->SetState(1); // set 'this' was created
 
-        if ( !pStk3->GetRetVar(                         // puts the result on the stack
-            pt->m_block->Execute(pStk3) ))          // GetRetVar said if it is interrupted
+        // initializes the variables as parameters
+        if (pt->m_param != nullptr)
         {
-            if ( !pStk3->IsOk() )
+            if (!pt->m_param->Execute(ppVars, pStk3)) // interupt here
             {
-                if ( pt->m_bSynchro )
+                if (!pStk3->IsOk() && pt->m_pProg != nullptr && pt->m_pProg != pProgCurrent)
                 {
-                    pClass->Unlock();                   // release function
-                }
-
-                if ( pt->m_pProg != pProgCurrent )
-                {
-                    pStk3->SetPosError(pToken);         // indicates the error on the procedure call
+                    pStk3->SetPosError(pToken);       // indicates the error on the procedure call
                 }
+                return false;
             }
-            return false;   // interrupt !
         }
+        pStk3b->Delete(); // done with param stack
+        pStk->IncState();
+    }
 
+    if ( pStk->GetState() == 1 )
+    {
         if ( pt->m_bSynchro )
         {
-            pClass->Unlock();                           // release function
+            CBotProgram* pProgBase = pStk->GetProgram(true);
+            if ( !pClass->Lock(pProgBase) ) return false; // try to lock, interrupt if failed
         }
+        pStk->IncState();
+    }
+    // finally calls the found function
 
-        return pStack->Return( pStk3 );
+    if ( !pStk3->GetRetVar(                         // puts the result on the stack
+        pt->m_block->Execute(pStk3) ))          // GetRetVar said if it is interrupted
+    {
+        if ( !pStk3->IsOk() )
+        {
+            if ( pt->m_bSynchro )
+            {
+                pClass->Unlock();                   // release function
+            }
+
+            if ( pt->m_pProg != nullptr && pt->m_pProg != pProgCurrent )
+            {
+                pStk3->SetPosError(pToken);         // indicates the error on the procedure call
+            }
+        }
+        return false;   // interrupt !
     }
-    return -1;
+
+    if ( pt->m_bSynchro )
+    {
+        pClass->Unlock();                           // release function
+    }
+
+    return pStack->Return( pStk3 );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool CBotFunction::RestoreCall(long &nIdent, const std::string &name, CBotVar* pThis,
+bool CBotFunction::RestoreCall(long nIdent, const std::string &name, CBotVar* pThis,
                                CBotVar** ppVars, CBotStack* pStack, CBotClass* pClass)
 {
     CBotTypResult   type;
@@ -1120,7 +1175,8 @@ bool CBotFunction::RestoreCall(long &nIdent, const std::string &name, CBotVar* p
     {
         CBotStack*  pStk = pStack->RestoreStack(pt);
         if ( pStk == nullptr ) return true;
-        pStk->SetProgram(pt->m_pProg);                  // it may have changed module
+        if (pt->m_pProg != nullptr) pStk->SetProgram(pt->m_pProg); // it may have changed module
+        pStk->SetFrame(pt->m_nSlots);                   // table of local variables
 
         CBotVar*    pthis = pStk->FindVar("this");
         pthis->SetUniqNum(-2);
@@ -1180,6 +1236,98 @@ bool CBotFunction::CheckParam(CBotDefParam* pParam)
     return ( pp == nullptr && pParam == nullptr );
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void CBotFunction::ResolveSlots()
+{
+    std::map<long, int> slots;
+    m_nSlots = 0;
+
+    // parameters first, then every variable declared in the body
+    for (CBotDefParam* param = m_param; param != nullptr; param = param->GetNext())
+    {
+        param->m_nSlot = m_nSlots++;
+        slots[param->m_nIdent] = param->m_nSlot;
+    }
+
+    // the tree is not walked in source order, so references are resolved
+    // only once all the declarations are known
+    std::vector<CBotExprVar*> references;
+    std::vector<CBotLeftExpr*> leftReferences;
+    std::vector<CBotInstr*> pending;
+    if (m_block != nullptr) pending.push_back(m_block);
+    while (!pending.empty())
+    {
+        CBotInstr* instr = pending.back();
+        pending.pop_back();
+
+        if (CBotLeftExprVar* var = dynamic_cast<CBotLeftExprVar*>(instr))
+        {
+            var->m_nSlot = m_nSlots++;
+            slots[var->m_nIdent] = var->m_nSlot;
+        }
+        else if (CBotExprVar* expr = dynamic_cast<CBotExprVar*>(instr))
+        {
+            references.push_back(expr);
+        }
+        else if (CBotLeftExpr* expr = dynamic_cast<CBotLeftExpr*>(instr))
+        {
+            leftReferences.push_back(expr);
+        }
+
+        for (const auto& it : instr->GetDebugLinks())
+        {
+            if (it.second != nullptr) pending.push_back(it.second);
+        }
+    }
+
+    // "this", "super" and the fields of the class are not in the table
+    for (CBotExprVar* expr : references)
+    {
+        auto it = slots.find(expr->m_nIdent);
+        if (it != slots.end()) expr->m_nSlot = it->second;
+    }
+    for (CBotLeftExpr* expr : leftReferences)
+    {
+        auto it = slots.find(expr->m_nIdent);
+        if (it != slots.end()) expr->m_nSlot = it->second;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotFunction::MovePosition(int offset)
+{
+    if (offset == 0) return;
+
+    for (CBotToken* token : { &m_token, &m_retToken, &m_classToken, &m_extern,
+                              &m_openpar, &m_closepar, &m_openblk, &m_closeblk })
+    {
+        MoveToken(*token, offset);
+    }
+
+    std::vector<CBotInstr*> pending;
+    if (m_block != nullptr) pending.push_back(m_block);
+    for (CBotDefParam* param = m_param; param != nullptr; param = param->GetNext())
+    {
+        MoveToken(param->m_token, offset);
+        if (param->m_expr != nullptr) pending.push_back(param->m_expr);
+    }
+
+    while (!pending.empty())
+    {
+        CBotInstr* instr = pending.back();
+        pending.pop_back();
+
+        MoveToken(instr->m_token, offset);
+        if (CBotNew* newInstr = dynamic_cast<CBotNew*>(instr))
+            MoveToken(newInstr->m_vartoken, offset);
+
+        for (const auto& it : instr->GetDebugLinks())
+        {
+            if (it.second != nullptr) pending.push_back(it.second);
+        }
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 const std::string& CBotFunction::GetName()
 {
@@ -1215,6 +1363,14 @@ const std::string& CBotFunction::GetClassName() const
 void CBotFunction::AddPublic(CBotFunction* func)
 {
     m_publicFunctions.insert(func);
+    CBotClass::InvalidateMethodCaches();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotFunction::HasOutOfClassMethods(const std::string& className)
+{
+    std::lock_guard<std::mutex> lock(m_outOfClassMutex);
+    return m_outOfClassMethods.find(className) != m_outOfClassMethods.end();
 }
 
 bool CBotFunction::HasReturn()
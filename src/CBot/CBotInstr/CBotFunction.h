@@ -21,6 +21,8 @@
 
 #include "CBot/CBotInstr/CBotInstr.h"
 
+#include <map>
+#include <mutex>
 #include <set>
 
 namespace CBot
@@ -179,7 +181,7 @@ public:
      * \return
      */
 
-    static int DoCall(CBotProgram* program, const std::list<CBotFunction*>& localFunctionList, long &nIdent, const std::string &name,
+    static int DoCall(CBotProgram* program, const std::list<CBotFunction*>& localFunctionList, long nIdent, const std::string &name,
                       CBotVar** ppVars, CBotStack* pStack, CBotToken* pToken);
 
     /*!
@@ -191,7 +193,7 @@ public:
      * \param pStack
      */
     static void RestoreCall(const std::list<CBotFunction*>& localFunctionList,
-                            long &nIdent, const std::string &name, CBotVar** ppVars, CBotStack* pStack);
+                            long nIdent, const std::string &name, CBotVar** ppVars, CBotStack* pStack);
 
     /*!
      * \brief Find a method matching the name and arguments.
@@ -230,9 +232,32 @@ public:
      * \param pClass
      * \return
      */
-    static int DoCall(long &nIdent, const std::string &name, CBotVar* pThis,
+    static int DoCall(long nIdent, const std::string &name, CBotVar* pThis,
                       CBotVar** ppVars, CBotStack* pStack, CBotToken* pToken, CBotClass* pClass);
 
+    /*!
+     * \brief Makes call of a method which was already found, see CBotClass::FindCachableMethod()
+     * \param pt The method to call
+     * \param pThis
+     * \param ppVars
+     * \param pStack
+     * \param pToken
+     * \param pClass Class the method belongs to, locked for synchronized methods, nullptr to find it by name
+     * \return false if the call was interrupted
+     */
+    static int DoCall(CBotFunction* pt, CBotVar* pThis, CBotVar** ppVars,
+                      CBotStack* pStack, CBotToken* pToken, CBotClass* pClass);
+
+    /*!
+     * \brief Check if methods of a class are declared outside of its body, as in "void classname::test()"
+     *
+     * Such methods belong to the program which declares them, so calls to this class
+     * depend on the calling program and are not kept in inline caches.
+     * \param className Name of the class
+     * \return true if a compiled program declares an out-of-class method of this class
+     */
+    static bool HasOutOfClassMethods(const std::string& className);
+
     /*!
      * \brief RestoreCall
      * \param nIdent
@@ -243,7 +268,7 @@ public:
      * \param pClass
      * \return Returns true if the method call was restored.
      */
-    static bool RestoreCall(long &nIdent, const std::string &name, CBotVar* pThis,
+    static bool RestoreCall(long nIdent, const std::string &name, CBotVar* pThis,
                             CBotVar** ppVars, CBotStack* pStack, CBotClass* pClass);
 
     /*!
@@ -326,7 +351,31 @@ protected:
 
 private:
     friend class CBotDebug;
+
+    /*!
+     * \brief Give every local variable of the function a slot in the frame
+     *
+     * Called once the function is compiled. Stores the slot in the declarations
+     * (CBotDefParam, CBotLeftExprVar) and in the expressions that refer to
+     * local variables (CBotExprVar, CBotLeftExpr), see CBotStack::SetFrame().
+     * CBot has no nested functions, so a variable is always looked up in the
+     * frame of the function being executed.
+     */
+    void ResolveSlots();
+
+    /*!
+     * \brief Move the function to another place in the source code
+     *
+     * Called by CBotProgram::Compile() when the function is reused although
+     * the code before it changed, so that the positions of the errors and of
+     * the running instruction stay right.
+     * \param offset Number of characters to move the positions of all the tokens by
+     */
+    void MovePosition(int offset);
+
     long m_nFuncIdent;
+    //! Number of local variable slots, see ResolveSlots()
+    int m_nSlots;
     //! Synchronized method.
     bool m_bSynchro;
 
@@ -350,6 +399,7 @@ private:
     std::string m_MasterClass;
     //! Token of the class we are part of
     CBotToken m_classToken;
+    //! Program the function belongs to, nullptr if the code is shared by several programs (see CBotProgramCache)
     CBotProgram* m_pProg;
     //! For the position of the word "extern".
     CBotToken m_extern;
@@ -360,6 +410,12 @@ private:
 
     //! List of public functions
     static std::set<CBotFunction*> m_publicFunctions;
+    //! Number of out-of-class methods of each class, see HasOutOfClassMethods()
+    static std::map<std::string, int> m_outOfClassMethods;
+    //! Guards m_outOfClassMethods, programs may be compiled while others run
+    static std::mutex m_outOfClassMutex;
+    //! true if this method is counted in m_outOfClassMethods
+    bool m_bOutOfClass = false;
 
     friend class CBotProgram;
     friend class CBotClass;
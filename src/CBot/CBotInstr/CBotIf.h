@@ -75,6 +75,7 @@ private:
     CBotInstr* m_block;
     //! Instruction
     CBotInstr* m_blockElse;
+    friend class CBotOptimizer;
 };
 
 } // namespace CBot
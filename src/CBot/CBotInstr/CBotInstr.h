@@ -27,6 +27,7 @@
 namespace CBot
 {
 class CBotDebug;
+class CBotBytecode;
 
 /**
  * \brief Class for one CBot instruction
@@ -278,6 +279,9 @@ public:
 
 protected:
     friend class CBotDebug;
+    friend class CBotBytecode;
+    friend class CBotOptimizer;
+    friend class CBotFunction;
     /**
      * \brief Returns the name of this class
      * \see CBotDebug
@@ -225,6 +225,7 @@ std::map<std::string, CBotInstr*> CBotInstrCall::GetDebugLinks()
 {
     auto links = CBotInstr::GetDebugLinks();
     links["m_parameters"] = m_parameters;
+    links["m_exprRetVar"] = m_exprRetVar;
     return links;
 }
 
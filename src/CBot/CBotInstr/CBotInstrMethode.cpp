@@ -21,6 +21,7 @@
 #include "CBot/CBotInstr/CBotInstrMethode.h"
 
 #include "CBot/CBotInstr/CBotExprRetVar.h"
+#include "CBot/CBotInstr/CBotFunction.h"
 #include "CBot/CBotInstr/CBotInstrUtils.h"
 
 #include "CBot/CBotStack.h"
@@ -177,7 +178,20 @@ bool CBotInstrMethode::ExecuteVar(CBotVar* &pVar, CBotStack* &pj, CBotToken* pre
     else
         pClass = pThis->GetClass();
 
-    if ( !pClass->ExecuteMethode(m_MethodeIdent, pThis, ppVars, m_typRes, pile2, GetToken())) return false;
+    // skip the search when this call already went to a method of the same class
+    const uint64_t key = pClass->GetMethodCacheKey();
+    CBotFunction* pt = nullptr;
+    if (!m_methodCache.Find(key, pt))
+    {
+        pt = pClass->FindCachableMethod(m_MethodeIdent, m_methodName, ppVars, pile2->GetProgram());
+        m_methodCache.Store(key, pt);
+    }
+
+    if (pt != nullptr)
+    {
+        if ( !CBotFunction::DoCall(pt, pThis, ppVars, pile2, GetToken(), nullptr)) return false;
+    }
+    else if ( !pClass->ExecuteMethode(m_MethodeIdent, pThis, ppVars, m_typRes, pile2, GetToken())) return false;
 
     if (m_exprRetVar != nullptr) // .func().member
     {
@@ -327,6 +341,7 @@ std::map<std::string, CBotInstr*> CBotInstrMethode::GetDebugLinks()
 {
     auto links = CBotInstr::GetDebugLinks();
     links["m_parameters"] = m_parameters;
+    links["m_exprRetVar"] = m_exprRetVar;
     return links;
 }
 
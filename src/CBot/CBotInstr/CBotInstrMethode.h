@@ -20,6 +20,7 @@
 #pragma once
 
 #include "CBot/CBotInstr/CBotInstr.h"
+#include "CBot/CBotInlineCache.h"
 
 namespace CBot
 {
@@ -86,6 +87,8 @@ private:
     std::string m_className;
     //! Variable ID
     long m_thisIdent;
+    //! Method called for each class, nullptr if the call can't be cached, see CBotClass::FindCachableMethod()
+    CBotInlineCache<CBotFunction*> m_methodCache;
 
     //! Instruction to return a member of the returned object.
     CBotInstr* m_exprRetVar;
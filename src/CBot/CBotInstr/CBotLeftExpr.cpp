@@ -36,6 +36,7 @@ namespace CBot
 CBotLeftExpr::CBotLeftExpr()
 {
     m_nIdent = 0;
+    m_nSlot = -1;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -220,7 +221,7 @@ bool CBotLeftExpr::ExecuteVar(CBotVar* &pVar, CBotStack* &pile, CBotToken* prevT
 {
     pile = pile->AddStack(this);
 
-    pVar = pile->FindVar(m_nIdent, false);
+    pVar = pile->FindVar(m_nIdent, m_nSlot, false);
     if (pVar == nullptr)
     {
         assert(false);
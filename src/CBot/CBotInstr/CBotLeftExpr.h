@@ -96,6 +96,9 @@ protected:
 
 private:
     long m_nIdent;
+    //! Slot in the function frame, or -1 if the variable is not a local one
+    int m_nSlot;
+    friend class CBotFunction;
 };
 
 } // namespace CBot
@@ -59,7 +59,7 @@ bool CBotLeftExprVar::Execute(CBotStack* &pj)
     // Create the variable
     CBotVar* var1 = CBotVar::Create(m_token.GetString(), m_typevar);
     var1->SetUniqNum(m_nIdent);
-    pj->AddVar(var1);
+    pj->AddVar(var1, m_nSlot);
 
     CBotVar* var2 = pj->GetVar(); // Initial value on the stack
     if (var2 != nullptr)
@@ -59,6 +59,8 @@ public:
     CBotTypResult m_typevar = -1;
     //! Unique identifier of that variable
     long m_nIdent = 0;
+    //! Slot of that variable in the function frame
+    int m_nSlot = -1;
 };
 
 } // namespace CBot
@@ -69,6 +69,8 @@ private:
     //! Instruction to chain method calls after constructor
     CBotInstr* m_exprRetVar;
 
+    friend class CBotFunction;
+
 };
 
 } // namespace CBot
@@ -25,6 +25,9 @@
 #include "CBot/CBotInstr/CBotLogicExpr.h"
 #include "CBot/CBotInstr/CBotExpression.h"
 
+#include "CBot/CBotBytecode.h"
+#include "CBot/CBotOptimizer.h"
+
 #include "CBot/CBotStack.h"
 #include "CBot/CBotCStack.h"
 
@@ -41,6 +44,8 @@ CBotTwoOpExpr::CBotTwoOpExpr()
 {
     m_leftop    = nullptr;
     m_rightop   = nullptr;
+    m_bytecode  = nullptr;
+    m_constant  = nullptr;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -48,6 +53,8 @@ CBotTwoOpExpr::~CBotTwoOpExpr()
 {
     delete  m_leftop;
     delete  m_rightop;
+    delete  m_bytecode;
+    delete  m_constant;
 }
 
 // This list contains all possible operations
@@ -321,10 +328,27 @@ static bool IsNan(CBotVar* left, CBotVar* right, CBotError* err = nullptr)
 ////////////////////////////////////////////////////////////////////////////////
 bool CBotTwoOpExpr::Execute(CBotStack* &pStack)
 {
+    // the value was computed by the compiler
+    if ( m_constant != nullptr ) return CBotOptimizer::ExecuteConstant(this, m_constant, pStack);
+
     CBotStack* pStk1 = pStack->AddStack(this);  // adds an item to the stack
                                                 // or return in case of recovery
 //  if ( pStk1 == EOX ) return true;
 
+    // evaluates the whole expression at once if it was lowered to bytecode
+    // (not in step by step mode, each operand has to be shown there)
+    if ( m_bytecode != nullptr && pStk1->GetState() == 0 && pStk1->GetTimer() > 0 )
+    {
+        CBotVar*    result = nullptr;
+        if ( m_bytecode->Execute(pStk1, result) )
+        {
+            pStk1->SetVar(result);
+            pStk1->SpendTimer(m_bytecode->GetLength());
+            return pStack->Return(pStk1);               // transmits the result
+        }
+        // otherwise continue in the instruction tree, which also reports the error
+    }
+
     // according to recovery, it may be in one of two states
 
     if ( pStk1->GetState() == 0 )                   // first state, evaluates the left operand
@@ -524,6 +548,7 @@ void CBotTwoOpExpr::RestoreState(CBotStack* &pStack, bool bMain)
     if ( !bMain ) return;
     CBotStack* pStk1 = pStack->RestoreStack(this);  // adds an item to the stack
     if ( pStk1 == nullptr ) return;
+    if ( m_constant != nullptr ) return;
 
     // according to recovery, it may be in one of two states
 
@@ -546,6 +571,7 @@ void CBotTwoOpExpr::RestoreState(CBotStack* &pStack, bool bMain)
 
 std::string CBotTwoOpExpr::GetDebugData()
 {
+    if ( m_constant != nullptr ) return m_token.GetString() + " = " + m_constant->GetValString();
     return m_token.GetString();
 }
 
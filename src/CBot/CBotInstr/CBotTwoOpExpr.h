@@ -91,6 +91,12 @@ private:
     CBotInstr* m_leftop;
     //! Right element
     CBotInstr* m_rightop;
+    //! The whole expression lowered to bytecode, nullptr if not available
+    CBotBytecode* m_bytecode;
+    //! Value of the expression if it was folded to a constant (the operands are then deleted)
+    CBotVar* m_constant;
+    friend class CBotBytecode;
+    friend class CBotOptimizer;
 };
 
 } // namespace CBot
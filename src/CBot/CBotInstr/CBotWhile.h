@@ -76,6 +76,7 @@ private:
     CBotInstr* m_block;
     //! A label if there is
     std::string m_label;
+    friend class CBotOptimizer;
 };
 
 } // namespace CBot
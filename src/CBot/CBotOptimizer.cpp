@@ -0,0 +1,221 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+#include "CBot/CBotOptimizer.h"
+
+#include "CBot/CBotStack.h"
+
+#include "CBot/CBotInstr/CBotTwoOpExpr.h"
+#include "CBot/CBotInstr/CBotExprLitBool.h"
+#include "CBot/CBotInstr/CBotExprLitNum.h"
+#include "CBot/CBotInstr/CBotExprLitString.h"
+#include "CBot/CBotInstr/CBotExprUnaire.h"
+#include "CBot/CBotInstr/CBotFunction.h"
+#include "CBot/CBotInstr/CBotIf.h"
+#include "CBot/CBotInstr/CBotWhile.h"
+
+#include "CBot/CBotVar/CBotVar.h"
+
+#include <vector>
+
+namespace CBot
+{
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotOptimizer::Optimize(CBotInstr* root)
+{
+    // list the whole tree without recursion, long programs have very long m_next chains
+    std::vector<CBotInstr*> nodes;
+    std::vector<CBotInstr*> pending;
+    pending.push_back(root);
+    while (!pending.empty())
+    {
+        CBotInstr* instr = pending.back();
+        pending.pop_back();
+        nodes.push_back(instr);
+
+        for (const auto& it : instr->GetDebugLinks())
+        {
+            if (it.second == nullptr) continue;
+            if (dynamic_cast<CBotFunction*>(it.second) != nullptr) continue;
+            pending.push_back(it.second);
+        }
+    }
+
+    // the operands are listed after their operation, fold them first
+    int removed = 0;
+    for (auto it = nodes.rbegin(); it != nodes.rend(); ++it)
+    {
+        removed += Fold(*it);
+        removed += RemoveDeadBranches(*it);
+    }
+    return removed;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotOptimizer::ExecuteConstant(CBotInstr* instr, CBotVar* constant, CBotStack* &pj)
+{
+    CBotStack* pile = pj->AddStack(instr);
+
+    if (pile->IfStep()) return false;
+
+    pile->SetCopyVar(constant);                     // place on the stack
+    return pj->Return(pile);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CBotVar* CBotOptimizer::Evaluate(CBotInstr* instr)
+{
+    // the stack has no program, so it isn't charged and never interrupted
+    CBotStack* pile = CBotStack::AllocateStack();
+    CBotVar* result = nullptr;
+
+    if (instr->Execute(pile) && pile->IsOk() && pile->GetVar() != nullptr)
+    {
+        CBotVar* var = pile->GetVar();
+        result = CBotVar::Create("", var->GetTypResult(CBotVar::GetTypeMode::CLASS_AS_INTRINSIC));
+        result->Copy(var);
+    }
+
+    pile->Delete();
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotOptimizer::Fold(CBotInstr* instr)
+{
+    int removed = 0;
+
+    if (CBotTwoOpExpr* expr = dynamic_cast<CBotTwoOpExpr*>(instr))
+    {
+        if (expr->m_constant != nullptr || !IsConstant(expr->m_leftop) || !IsConstant(expr->m_rightop)) return 0;
+
+        expr->m_constant = Evaluate(expr);
+        if (expr->m_constant == nullptr) return 0;
+
+        removed = CountNodes(expr->m_leftop) + CountNodes(expr->m_rightop);
+        delete expr->m_leftop;
+        delete expr->m_rightop;
+        expr->m_leftop = nullptr;
+        expr->m_rightop = nullptr;
+    }
+    else if (CBotExprUnaire* expr = dynamic_cast<CBotExprUnaire*>(instr))
+    {
+        if (expr->m_constant != nullptr || !IsConstant(expr->m_expr)) return 0;
+
+        expr->m_constant = Evaluate(expr);
+        if (expr->m_constant == nullptr) return 0;
+
+        removed = CountNodes(expr->m_expr);
+        delete expr->m_expr;
+        expr->m_expr = nullptr;
+    }
+
+    return removed;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotOptimizer::RemoveDeadBranches(CBotInstr* instr)
+{
+    bool value;
+    CBotInstr** dead = nullptr;
+
+    if (CBotIf* inst = dynamic_cast<CBotIf*>(instr))
+    {
+        if (!GetConstantCondition(inst->m_condition, value)) return 0;
+        dead = value ? &inst->m_blockElse : &inst->m_block;
+    }
+    else if (CBotWhile* inst = dynamic_cast<CBotWhile*>(instr))
+    {
+        if (!GetConstantCondition(inst->m_condition, value) || value) return 0;
+        dead = &inst->m_block;
+    }
+
+    if (dead == nullptr || *dead == nullptr) return 0;
+
+    int removed = CountNodes(*dead);
+    delete *dead;
+    *dead = nullptr;
+    return removed;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotOptimizer::GetConstantCondition(CBotInstr* instr, bool& value)
+{
+    if (!IsConstant(instr)) return false;
+
+    if (dynamic_cast<CBotExprLitBool*>(instr) != nullptr)
+    {
+        value = instr->GetTokenType() == ID_TRUE;
+        return true;
+    }
+
+    CBotVar* constant = GetConstant(instr);
+    if (constant == nullptr || constant->GetType() != CBotTypBoolean) return false;
+
+    value = constant->GetValInt() != 0;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotOptimizer::IsConstant(CBotInstr* instr)
+{
+    if (instr == nullptr) return false;
+    if (instr->m_next != nullptr || instr->m_next3 != nullptr) return false;   // indexes, fields and method calls
+
+    if (dynamic_cast<CBotExprLitNum<int>*>(instr) != nullptr ||
+        dynamic_cast<CBotExprLitNum<long>*>(instr) != nullptr ||
+        dynamic_cast<CBotExprLitNum<float>*>(instr) != nullptr ||
+        dynamic_cast<CBotExprLitNum<double>*>(instr) != nullptr ||
+        dynamic_cast<CBotExprLitBool*>(instr) != nullptr ||
+        dynamic_cast<CBotExprLitString*>(instr) != nullptr) return true;
+    return GetConstant(instr) != nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CBotVar* CBotOptimizer::GetConstant(CBotInstr* instr)
+{
+    if (CBotTwoOpExpr* expr = dynamic_cast<CBotTwoOpExpr*>(instr)) return expr->m_constant;
+    if (CBotExprUnaire* expr = dynamic_cast<CBotExprUnaire*>(instr)) return expr->m_constant;
+    return nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotOptimizer::CountNodes(CBotInstr* root)
+{
+    if (root == nullptr) return 0;
+
+    int count = 0;
+    std::vector<CBotInstr*> pending;
+    pending.push_back(root);
+    while (!pending.empty())
+    {
+        CBotInstr* instr = pending.back();
+        pending.pop_back();
+        count++;
+
+        for (const auto& it : instr->GetDebugLinks())
+        {
+            if (it.second != nullptr) pending.push_back(it.second);
+        }
+    }
+    return count;
+}
+
+} // namespace CBot
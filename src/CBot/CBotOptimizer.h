@@ -0,0 +1,81 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+#pragma once
+
+namespace CBot
+{
+
+class CBotInstr;
+class CBotVar;
+class CBotStack;
+
+/**
+ * \brief Constant folding and dead branch elimination
+ *
+ * Run by CBotProgram::Compile() on every compiled function. Operations of
+ * CBotTwoOpExpr and CBotExprUnaire whose operands are all literals (including
+ * constants defined with CBotProgram::DefineNum()) are evaluated once, and the
+ * instruction keeps the result instead of its operands. The statement blocks of
+ * CBotIf and CBotWhile which can't be reached because of a constant condition
+ * are deleted.
+ *
+ * Operations which fail (for example a division by zero) are left as they are,
+ * so that the error is still reported when the program runs.
+ */
+class CBotOptimizer
+{
+public:
+    /**
+     * \brief Optimize the given instruction tree
+     * \param root Root of the instruction tree, usually a CBotFunction
+     * \return Number of instructions removed from the tree
+     */
+    static int Optimize(CBotInstr* root);
+
+    /**
+     * \brief Execute an operation folded to a constant
+     *
+     * Used by the folded instructions in place of their own Execute().
+     *
+     * \param instr The folded instruction
+     * \param constant Result of the operation
+     * \param pj Stack of the instruction
+     * \return false if interrupted (step by step mode)
+     */
+    static bool ExecuteConstant(CBotInstr* instr, CBotVar* constant, CBotStack* &pj);
+
+private:
+    //! Evaluate an operation with constant operands, nullptr if it fails
+    static CBotVar* Evaluate(CBotInstr* instr);
+    //! Fold an operation if its operands are constants, returns the number of removed instructions
+    static int Fold(CBotInstr* instr);
+    //! Remove the blocks that can't be reached, returns the number of removed instructions
+    static int RemoveDeadBranches(CBotInstr* instr);
+    //! Check if an instruction is a boolean constant
+    static bool GetConstantCondition(CBotInstr* instr, bool& value);
+    //! Check if an instruction always gives the same value
+    static bool IsConstant(CBotInstr* instr);
+    //! Result of an operation folded to a constant, nullptr if not folded
+    static CBotVar* GetConstant(CBotInstr* instr);
+    //! Count the instructions of a tree
+    static int CountNodes(CBotInstr* root);
+};
+
+} // namespace CBot
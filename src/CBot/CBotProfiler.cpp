@@ -0,0 +1,172 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+
+#include "CBot/CBotProfiler.h"
+
+#include "CBot/CBotInstr/CBotFunction.h"
+
+#include <algorithm>
+#include <iomanip>
+
+namespace CBot
+{
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotProfiler::Reset()
+{
+    m_instructions.clear();
+    m_functions.clear();
+    m_totalSteps = 0;
+    m_last = std::chrono::steady_clock::now();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotProfiler::StartSlice()
+{
+    m_last = std::chrono::steady_clock::now();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotProfiler::AddSteps(CBotInstr* instr, CBotInstr* function, int n)
+{
+    // the time since the previous step was spent getting to this one
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed = now - m_last;
+    m_last = now;
+
+    auto it = m_instructions.find(instr);
+    if (it == m_instructions.end())
+    {
+        InstrEntry entry;
+        if (instr != nullptr)
+        {
+            entry.stats.start = instr->GetToken()->GetStart();
+            entry.stats.end = instr->GetToken()->GetEnd();
+        }
+        entry.stats.function = GetFunctionName(function);
+        entry.function = function;
+        it = m_instructions.insert({instr, entry}).first;
+    }
+
+    it->second.stats.steps += n;
+    it->second.stats.time += elapsed.count();
+    m_totalSteps += n;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotProfiler::AddCall(CBotInstr* caller, CBotInstr* callee)
+{
+    FunctionEntry& entry = m_functions[callee];
+    entry.calls++;
+    entry.callers[caller]++;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::vector<CBotProfiler::InstrStats> CBotProfiler::GetInstructions()
+{
+    std::vector<InstrStats> result;
+    for (const auto& it : m_instructions) result.push_back(it.second.stats);
+
+    std::sort(result.begin(), result.end(), [](const InstrStats& a, const InstrStats& b)
+    {
+        if (a.steps != b.steps) return a.steps > b.steps;
+        return a.start < b.start;
+    });
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::vector<CBotProfiler::FunctionStats> CBotProfiler::GetFunctions()
+{
+    std::map<CBotInstr*, FunctionStats> functions;
+
+    for (const auto& it : m_functions)
+    {
+        FunctionStats& stats = functions[it.first];
+        stats.name = GetFunctionName(it.first);
+        stats.calls = it.second.calls;
+        for (const auto& caller : it.second.callers)
+            stats.callers[GetFunctionName(caller.first)] += caller.second;
+    }
+
+    for (const auto& it : m_instructions)
+    {
+        FunctionStats& stats = functions[it.second.function];
+        stats.name = it.second.stats.function;
+        stats.steps += it.second.stats.steps;
+        stats.time += it.second.stats.time;
+    }
+
+    std::vector<FunctionStats> result;
+    for (const auto& it : functions) result.push_back(it.second);
+
+    std::sort(result.begin(), result.end(), [](const FunctionStats& a, const FunctionStats& b)
+    {
+        if (a.steps != b.steps) return a.steps > b.steps;
+        return a.name < b.name;
+    });
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotProfiler::WriteFlatReport(std::ostream& ostr, int maxLines)
+{
+    ostr << "    steps      %    time ms  position     function" << std::endl;
+
+    int line = 0;
+    for (const InstrStats& stats : GetInstructions())
+    {
+        if (maxLines > 0 && line++ >= maxLines) break;
+
+        double percent = m_totalSteps > 0 ? 100.0 * stats.steps / m_totalSteps : 0.0;
+        ostr << std::setw(9) << stats.steps << " "
+             << std::setw(6) << std::fixed << std::setprecision(2) << percent << " "
+             << std::setw(10) << std::setprecision(3) << stats.time * 1000.0 << "  "
+             << std::left << std::setw(12) << (std::to_string(stats.start) + "-" + std::to_string(stats.end))
+             << std::right << " " << stats.function << std::endl;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotProfiler::WriteCallGraph(std::ostream& ostr)
+{
+    for (const FunctionStats& stats : GetFunctions())
+    {
+        double percent = m_totalSteps > 0 ? 100.0 * stats.steps / m_totalSteps : 0.0;
+        ostr << stats.name << ": " << stats.calls << " calls, "
+             << stats.steps << " steps (" << std::fixed << std::setprecision(2) << percent << "%), "
+             << std::setprecision(3) << stats.time * 1000.0 << " ms" << std::endl;
+
+        for (const auto& caller : stats.callers)
+        {
+            ostr << "    called " << caller.second << " times by "
+                 << (caller.first.empty() ? "<start>" : caller.first) << std::endl;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string CBotProfiler::GetFunctionName(CBotInstr* function)
+{
+    if (function == nullptr) return "";
+    return static_cast<CBotFunction*>(function)->GetName();
+}
+
+} // namespace CBot
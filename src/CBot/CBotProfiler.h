@@ -0,0 +1,152 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace CBot
+{
+
+class CBotInstr;
+
+/**
+ * \brief Execution profiler of a CBotProgram
+ *
+ * Counts the steps charged to the execution timer (see CBotProgram::SetTimer())
+ * and the wall time spent between them for every instruction, and the number of
+ * calls between functions. Instructions are identified by the position of their
+ * token in the source code, so the results can be mapped back to the lines of
+ * the program.
+ *
+ * The profiler is attached to a program with CBotProgram::SetProfilerEnabled().
+ */
+class CBotProfiler
+{
+public:
+    //! Statistics of a single instruction
+    struct InstrStats
+    {
+        //! Position of the instruction in the source code
+        int start = 0;
+        int end = 0;
+        //! Name of the function the instruction belongs to
+        std::string function;
+        //! Number of execution steps
+        long steps = 0;
+        //! Wall time in seconds
+        double time = 0.0;
+    };
+
+    //! Statistics of a function
+    struct FunctionStats
+    {
+        std::string name;
+        //! Number of times the function was called
+        long calls = 0;
+        //! Steps and time spent in the function itself, without the functions it called
+        long steps = 0;
+        double time = 0.0;
+        //! Number of calls by each caller, an empty name is used for the entry point
+        std::map<std::string, long> callers;
+    };
+
+    /**
+     * \brief Forget everything measured so far
+     */
+    void Reset();
+
+    /**
+     * \brief Start measuring the time again, called at the beginning of CBotProgram::Run()
+     *
+     * The time between two calls to Run() is not charged to any instruction.
+     */
+    void StartSlice();
+
+    /**
+     * \brief Charge execution steps to an instruction
+     * \param instr Instruction being executed
+     * \param function Function the instruction belongs to, can be nullptr
+     * \param n Number of steps
+     */
+    void AddSteps(CBotInstr* instr, CBotInstr* function, int n);
+
+    /**
+     * \brief Count a function call
+     * \param caller Calling function, nullptr for the entry point of the program
+     * \param callee Called function
+     */
+    void AddCall(CBotInstr* caller, CBotInstr* callee);
+
+    /**
+     * \brief Total number of steps counted
+     */
+    long GetTotalSteps() { return m_totalSteps; }
+
+    /**
+     * \brief Statistics of all executed instructions, most steps first
+     */
+    std::vector<InstrStats> GetInstructions();
+
+    /**
+     * \brief Statistics of all called functions, most steps first
+     */
+    std::vector<FunctionStats> GetFunctions();
+
+    /**
+     * \brief Write the statistics of all instructions, most steps first
+     * \param ostr Output stream
+     * \param maxLines Maximum number of instructions to write, 0 for all
+     */
+    void WriteFlatReport(std::ostream& ostr, int maxLines = 0);
+
+    /**
+     * \brief Write the statistics of all functions along with their callers
+     * \param ostr Output stream
+     */
+    void WriteCallGraph(std::ostream& ostr);
+
+private:
+    static std::string GetFunctionName(CBotInstr* function);
+
+    struct InstrEntry
+    {
+        InstrStats stats;
+        CBotInstr* function = nullptr;
+    };
+
+    struct FunctionEntry
+    {
+        long calls = 0;
+        std::map<CBotInstr*, long> callers;
+    };
+
+    std::unordered_map<CBotInstr*, InstrEntry> m_instructions;
+    std::unordered_map<CBotInstr*, FunctionEntry> m_functions;
+    long m_totalSteps = 0;
+    std::chrono::steady_clock::time_point m_last;
+};
+
+} // namespace CBot
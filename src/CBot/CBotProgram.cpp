@@ -24,6 +24,10 @@
 #include "CBot/CBotCStack.h"
 #include "CBot/CBotClass.h"
 #include "CBot/CBotUtils.h"
+#include "CBot/CBotBytecode.h"
+#include "CBot/CBotOptimizer.h"
+#include "CBot/CBotProfiler.h"
+#include "CBot/CBotProgramCache.h"
 
 #include "CBot/CBotInstr/CBotFunction.h"
 
@@ -47,32 +51,73 @@ CBotProgram::CBotProgram(CBotVar* thisVar)
 
 CBotProgram::~CBotProgram()
 {
-//  delete  m_classes;
-    for (CBotClass* c : m_classes)
-        c->Purge();
-    m_classes.clear();
-
     CBotClass::FreeLock(this);
 
-    for (CBotFunction* f : m_functions) delete f;
-    m_functions.clear();
+    FreeCode();
+
+    delete m_profiler;
 }
 
-bool CBotProgram::Compile(const std::string& program, std::vector<std::string>& externFunctions, void* pUser)
+void CBotProgram::FreeCode()
 {
-    // Cleanup the previously compiled program
-    Stop();
+    // the cached code may depend on the classes and public functions of this program
+    if (DefinesPublic()) CBotProgramCache::Clear();
 
     for (CBotClass* c : m_classes)
         c->Purge();      // purge the old definitions of classes
                          // but without destroying the object
-
     m_classes.clear();
-    for (CBotFunction* f : m_functions) delete f;
+
+    if (m_code == nullptr)
+    {
+        for (CBotFunction* f : m_functions) delete f;
+    }
+    m_code.reset();
     m_functions.clear();
+}
+
+bool CBotProgram::DefinesPublic()
+{
+    if (!m_classes.empty()) return true;
+    return std::any_of(m_functions.begin(), m_functions.end(), [](CBotFunction* f) { return f->IsPublic(); });
+}
+
+bool CBotProgram::Compile(const std::string& program, std::vector<std::string>& externFunctions, void* pUser)
+{
+    // Look for the code before releasing the old one, a program is often recompiled from the same source
+    // The compile checks of the external calls may depend on pUser, unless the context says what they depend on
+    long externalCalls = m_externalCalls->GetRevision();
+    void* compileUser = m_compileContext != 0 ? nullptr : pUser;
+    std::shared_ptr<CBotCompiledCode> code = CBotProgramCache::Find(program, externalCalls, m_bytecodeEnabled,
+                                                                    compileUser, m_compileContext);
+
+    // Cleanup the previously compiled program, but keep the functions which may be reused
+    Stop();
+    std::vector<FunctionSource> previousSources;
+    std::vector<std::unique_ptr<CBotFunction>> previous;
+    if (code == nullptr) previous = TakeReusableFunctions(externalCalls, compileUser, previousSources);
+    FreeCode();
 
     externFunctions.clear();
     m_error = CBotNoErr;
+    m_bytecodeCount = 0;
+    m_eliminatedNodeCount = 0;
+    m_reusedFunctionCount = 0;
+    m_sources.clear();
+    if (m_profiler != nullptr) m_profiler->Reset();
+
+    if (code != nullptr)
+    {
+        m_code = code;
+        m_functions = code->functions;
+        m_bytecodeCount = code->bytecodeCount;
+        m_eliminatedNodeCount = code->eliminatedNodeCount;
+        for (CBotFunction* f : m_functions)
+        {
+            if (f->IsExtern()) externFunctions.push_back(f->GetName());
+        }
+        return true;
+    }
 
     // Step 1. Process the code into tokens
     auto tokens = CBotToken::CompileTokens(program);
@@ -85,6 +130,7 @@ bool CBotProgram::Compile(const std::string& program, std::vector<std::string>&
     m_externalCalls->SetUserPtr(pUser);
 
     // Step 2. Find all function and class definitions
+    std::vector<CBotToken*> functionEnds;
     while ( pStack->IsOk() && p != nullptr && p->GetType() != 0)
     {
         if ( IsOfType(p, ID_SEP) ) continue;                // semicolons lurking
@@ -98,9 +144,14 @@ bool CBotProgram::Compile(const std::string& program, std::vector<std::string>&
         }
         else
         {
+            CBotToken* start = p;
             CBotFunction* newfunc  = CBotFunction::Compile1(p, pStack.get(), nullptr);
             if (newfunc != nullptr)
+            {
                 m_functions.push_back(newfunc);
+                m_sources.push_back(GetFunctionSource(program, start, p));
+                functionEnds.push_back(p);
+            }
         }
     }
 
@@ -112,11 +163,44 @@ bool CBotProgram::Compile(const std::string& program, std::vector<std::string>&
         m_error = pStack->GetError(m_errorStart, m_errorEnd);
         for (CBotFunction* f : m_functions) delete f;
         m_functions.clear();
+        m_sources.clear();
         return false;
     }
 
+    // Reuse the functions which didn't change if the declarations are all the same
+    std::vector<bool> reused(m_functions.size(), false);
+    if (m_classes.empty() && previous.size() == m_functions.size() &&
+        std::equal(m_sources.begin(), m_sources.end(), previousSources.begin(),
+                   [](const FunctionSource& a, const FunctionSource& b) { return a.signature == b.signature; }))
+    {
+        std::size_t i = 0;
+        for (CBotFunction*& f : m_functions)
+        {
+            if (m_sources[i].text == previousSources[i].text)
+            {
+                previous[i]->MovePosition(m_sources[i].start - previousSources[i].start);
+                m_sources[i].bytecodeCount = previousSources[i].bytecodeCount;
+                m_sources[i].eliminatedNodeCount = previousSources[i].eliminatedNodeCount;
+                m_bytecodeCount += m_sources[i].bytecodeCount;
+                m_eliminatedNodeCount += m_sources[i].eliminatedNodeCount;
+                delete f;
+                f = previous[i].release();
+                reused[i] = true;
+                m_reusedFunctionCount++;
+            }
+            else
+            {
+                // the calls in the reused functions still find it by its identifier
+                f->m_nFuncIdent = previous[i]->m_nFuncIdent;
+            }
+            ++i;
+        }
+    }
+    previous.clear();
+
     // Step 3. Real compilation
     std::list<CBotFunction*>::iterator next = m_functions.begin();
+    std::size_t index = 0;
     p  = tokens.get()->GetNext();                             // returns to the beginning
     while ( pStack->IsOk() && p != nullptr && p->GetType() != 0 )
     {
@@ -129,11 +213,15 @@ bool CBotProgram::Compile(const std::string& program, std::vector<std::string>&
         }
         else
         {
-            CBotFunction::Compile(p, pStack.get(), *next);
+            if (reused[index])
+                p = functionEnds[index];                    // already compiled
+            else
+                CBotFunction::Compile(p, pStack.get(), *next);
             if ((*next)->IsExtern()) externFunctions.push_back((*next)->GetName()/* + next->GetParams()*/);
             if ((*next)->IsPublic()) CBotFunction::AddPublic(*next);
             (*next)->m_pProg = this;                           // keeps pointers to the module
             ++next;
+            ++index;
         }
     }
 
@@ -142,11 +230,181 @@ bool CBotProgram::Compile(const std::string& program, std::vector<std::string>&
         m_error = pStack->GetError(m_errorStart, m_errorEnd);
         for (CBotFunction* f : m_functions) delete f;
         m_functions.clear();
+        m_sources.clear();
+    }
+
+    // Step 4. Fold constant expressions and remove unreachable blocks
+    if (!m_functions.empty())
+    {
+        index = 0;
+        for (CBotFunction* f : m_functions)
+        {
+            if (!reused[index])
+            {
+                m_sources[index].eliminatedNodeCount = CBotOptimizer::Optimize(f);
+                m_eliminatedNodeCount += m_sources[index].eliminatedNodeCount;
+            }
+            ++index;
+        }
+
+        for (CBotClass* c : m_classes)
+        {
+            for (CBotFunction* f : c->GetFunctions())
+                m_eliminatedNodeCount += CBotOptimizer::Optimize(f);
+        }
+    }
+
+    // Step 5. Lower expressions to bytecode
+    if (m_bytecodeEnabled && !m_functions.empty())
+    {
+        index = 0;
+        for (CBotFunction* f : m_functions)
+        {
+            if (!reused[index])
+            {
+                m_sources[index].bytecodeCount = CBotBytecode::LowerTree(f);
+                m_bytecodeCount += m_sources[index].bytecodeCount;
+            }
+            ++index;
+        }
+
+        for (CBotClass* c : m_classes)
+        {
+            for (CBotFunction* f : c->GetFunctions())
+                m_bytecodeCount += CBotBytecode::LowerTree(f);
+        }
+    }
+
+    // Step 6. Share the code with the programs compiled from the same source
+    if (DefinesPublic())
+    {
+        CBotProgramCache::Clear();                          // the cached code may use the old definitions
+    }
+    else if (!m_functions.empty())
+    {
+        m_code = std::make_shared<CBotCompiledCode>();
+        m_code->source = program;
+        m_code->externalCalls = externalCalls;
+        m_code->bytecode = m_bytecodeEnabled;
+        m_code->user = compileUser;
+        m_code->context = m_compileContext;
+        m_code->bytecodeCount = m_bytecodeCount;
+        m_code->eliminatedNodeCount = m_eliminatedNodeCount;
+        m_code->functions = m_functions;
+        for (CBotFunction* f : m_functions)
+            f->m_pProg = nullptr;                           // executed in the module of the caller
+        CBotProgramCache::Add(m_code);
+    }
+
+    // Remember what the functions were compiled from for the next compilation
+    if (m_classes.empty())
+    {
+        m_sourcesExternalCalls = externalCalls;
+        m_sourcesPublicRevision = CBotProgramCache::GetRevision();
+        m_sourcesBytecode = m_bytecodeEnabled;
+        m_sourcesUser = compileUser;
+        m_sourcesContext = m_compileContext;
+    }
+    else
+    {
+        m_sources.clear();
     }
 
     return !m_functions.empty();
 }
 
+CBotProgram::FunctionSource CBotProgram::GetFunctionSource(const std::string& program, CBotToken* start, CBotToken* end)
+{
+    FunctionSource source;
+    source.start = start->GetStart();
+
+    int stop = (end != nullptr && end->GetPrev() != nullptr) ? end->GetPrev()->GetEnd() : static_cast<int>(program.size());
+    source.text = program.substr(source.start, stop - source.start);
+
+    for (CBotToken* p = start; p != end && p->GetType() != ID_OPBLK; p = p->GetNext())
+    {
+        source.signature += p->GetString();
+        source.signature += ' ';
+    }
+    return source;
+}
+
+std::vector<std::unique_ptr<CBotFunction>> CBotProgram::TakeReusableFunctions(long externalCalls, void* compileUser,
+                                                                              std::vector<FunctionSource>& sources)
+{
+    std::vector<std::unique_ptr<CBotFunction>> functions;
+
+    // the functions must have been compiled in the same context, and not be used by other programs
+    if (m_functions.empty() || m_sources.size() != m_functions.size() || !m_classes.empty()) return functions;
+    if (m_sourcesExternalCalls != externalCalls || m_sourcesBytecode != m_bytecodeEnabled) return functions;
+    if (m_sourcesUser != compileUser || m_sourcesContext != m_compileContext) return functions;
+    if (m_sourcesPublicRevision != CBotProgramCache::GetRevision()) return functions;
+    if (m_code != nullptr && m_code.use_count() > 1) return functions;
+
+    // the cached code may depend on the public functions of this program
+    if (DefinesPublic()) CBotProgramCache::Clear();
+
+    for (CBotFunction* f : m_functions)
+    {
+        CBotFunction::m_publicFunctions.erase(f);           // not to conflict with the new definitions
+        functions.emplace_back(f);
+    }
+    m_functions.clear();
+    if (m_code != nullptr) m_code->functions.clear();
+
+    sources.swap(m_sources);
+    return functions;
+}
+
+void CBotProgram::SetBytecodeEnabled(bool enabled)
+{
+    m_bytecodeEnabled = enabled;
+}
+
+bool CBotProgram::IsBytecodeEnabled()
+{
+    return m_bytecodeEnabled;
+}
+
+void CBotProgram::SetCompileContext(long context)
+{
+    m_compileContext = context;
+}
+
+int CBotProgram::GetBytecodeCount()
+{
+    return m_bytecodeCount;
+}
+
+int CBotProgram::GetEliminatedNodeCount()
+{
+    return m_eliminatedNodeCount;
+}
+
+int CBotProgram::GetReusedFunctionCount()
+{
+    return m_reusedFunctionCount;
+}
+
+void CBotProgram::SetProfilerEnabled(bool enabled)
+{
+    if (enabled && m_profiler == nullptr)
+    {
+        m_profiler = new CBotProfiler();
+        m_profiler->Reset();
+    }
+    else if (!enabled)
+    {
+        delete m_profiler;
+        m_profiler = nullptr;
+    }
+}
+
+CBotProfiler* CBotProgram::GetProfiler()
+{
+    return m_profiler;
+}
+
 bool CBotProgram::Start(const std::string& name)
 {
     Stop();
@@ -161,6 +419,8 @@ bool CBotProgram::Start(const std::string& name)
 
     m_stack = CBotStack::AllocateStack();
     m_stack->SetProgram(this);
+    m_budget = 0;
+    m_callDeferred = false;
 
     return true; // we are ready for Run()
 }
@@ -184,9 +444,35 @@ bool CBotProgram::Run(void* pUser, int timer)
 
     m_error = CBotNoErr;
 
+    // the slice stopped before a deferred call goes on with the rest of its budget
+    bool resumed = m_callDeferred;
+    m_callDeferred = false;
+
+    if ( timer >= 0 ) m_timer = timer;
+    if ( !resumed )
+    {
+        if (m_profiler != nullptr) m_profiler->StartSlice();
+
+        if ( m_timer > 0 )
+        {
+            // the steps executed over the budget are paid back first
+            m_budget = std::min(m_budget, 0) + m_timer;
+            if ( m_budget <= 0 )
+            {
+                m_stats.skippedSlices++;
+                m_stats.lastSliceSteps = 0;
+                return false;
+            }
+        }
+        else
+        {
+            m_budget = 0;                             // step by step
+        }
+    }
+    int budget = m_budget;
+
     m_stack->SetUserPtr(pUser);
-    if ( timer >= 0 ) m_stack->SetTimer(timer); // TODO: Check if changing order here fixed ipf()
-    m_stack->Reset();                         // reset the possible previous error, and resets the timer
+    m_stack->Reset();                         // reset the possible previous error
 
     m_stack->SetProgram(this);                     // bases for routines
 
@@ -198,6 +484,19 @@ bool CBotProgram::Run(void* pUser, int timer)
         ok = m_entryPoint->Execute(nullptr, m_stack, m_thisVar);
     }
 
+    int steps = budget - m_budget;
+    if ( resumed )
+    {
+        m_stats.lastSliceSteps += steps;
+    }
+    else
+    {
+        m_stats.slices++;
+        m_stats.lastSliceSteps = steps;
+    }
+    m_stats.steps += steps;
+    if ( m_timer <= 0 ) m_budget = 0;             // nothing to pay back after a single step
+
     // completed on a mistake?
     if (ok || !m_stack->IsOk())
     {
@@ -209,9 +508,16 @@ bool CBotProgram::Run(void* pUser, int timer)
         return true;                                // execution is finished!
     }
 
+    m_callDeferred = m_stack->IsCallDeferred();
+    if ( m_budget <= 0 && m_timer > 0 && !m_callDeferred ) m_stats.exhaustedSlices++;
     return ok;
 }
 
+bool CBotProgram::IsCallDeferred()
+{
+    return m_callDeferred;
+}
+
 void CBotProgram::Stop()
 {
     if (m_stack != nullptr)
@@ -220,6 +526,7 @@ void CBotProgram::Stop()
         m_stack = nullptr;
     }
     m_entryPoint = nullptr;
+    m_callDeferred = false;
     CBotClass::FreeLock(this);
 }
 
@@ -246,7 +553,23 @@ CBotVar* CBotProgram::GetStackVars(std::string& functionName, int level)
 ////////////////////////////////////////////////////////////////////////////////
 void CBotProgram::SetTimer(int n)
 {
-    CBotStack::SetTimer( n );
+    m_timer = n;
+}
+
+int CBotProgram::GetTimer()
+{
+    return m_timer;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const CBotRunStats& CBotProgram::GetRunStats()
+{
+    return m_stats;
+}
+
+void CBotProgram::ResetRunStats()
+{
+    m_stats = CBotRunStats();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -319,14 +642,16 @@ static bool rSizeOf( CBotVar* pVar, CBotVar* pResult, int& ex, void* pUser )
 ////////////////////////////////////////////////////////////////////////////////
 bool CBotProgram::AddFunction(const std::string& name,
                               bool rExec(CBotVar* pVar, CBotVar* pResult, int& Exception, void* pUser),
-                              CBotTypResult rCompile(CBotVar*& pVar, void* pUser))
+                              CBotTypResult rCompile(CBotVar*& pVar, void* pUser),
+                              bool threadSafe)
 {
-    return m_externalCalls->AddFunction(name, std::unique_ptr<CBotExternalCall>(new CBotExternalCallDefault(rExec, rCompile)));
+    return m_externalCalls->AddFunction(name, std::unique_ptr<CBotExternalCall>(new CBotExternalCallDefault(rExec, rCompile, threadSafe)));
 }
 
 bool CBotProgram::DefineNum(const std::string& name, long val)
 {
     CBotToken::DefineNum(name, val);
+    CBotProgramCache::Clear();
     return true;
 }
 
@@ -408,7 +733,7 @@ void CBotProgram::Init()
     CBotProgram::DefineNum("CBotErrStackOver",  CBotErrStackOver);   // Stack overflow
     CBotProgram::DefineNum("CBotErrDeletedPtr", CBotErrDeletedPtr);  // Attempted to use deleted object
 
-    CBotProgram::AddFunction("sizeof", rSizeOf, cSizeOf);
+    CBotProgram::AddFunction("sizeof", rSizeOf, cSizeOf, true);
 
     InitStringFunctions();
     InitMathFunctions();
@@ -419,7 +744,9 @@ void CBotProgram::Free()
 {
     CBotToken::ClearDefineNum();
     m_externalCalls->Clear();
+    CBotProgramCache::Clear();
     CBotClass::ClearPublic();
+    CBotStack::ClearPool();
 }
 
 CBotExternalCallList* CBotProgram::GetExternalCalls()
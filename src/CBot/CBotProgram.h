@@ -24,6 +24,8 @@
 
 #include <vector>
 #include <list>
+#include <memory>
+#include <string>
 
 namespace CBot
 {
@@ -33,6 +35,27 @@ class CBotClass;
 class CBotStack;
 class CBotVar;
 class CBotExternalCallList;
+class CBotProfiler;
+class CBotToken;
+struct CBotCompiledCode;
+
+/**
+ * \brief Counters describing how a program used its instruction budget
+ * \see CBotProgram::GetRunStats()
+ */
+struct CBotRunStats
+{
+    //! Number of steps executed
+    long steps = 0;
+    //! Number of calls to Run() which executed the program
+    long slices = 0;
+    //! Number of slices suspended because the budget was used up
+    long exhaustedSlices = 0;
+    //! Number of calls to Run() skipped to pay back steps executed over the budget
+    long skippedSlices = 0;
+    //! Number of steps executed by the last call to Run()
+    int lastSliceSteps = 0;
+};
 
 /**
  * \brief Class that manages a CBot program. This is the main entry point into the CBot engine.
@@ -123,6 +146,17 @@ public:
      * 1. Convert the code into "tokens" - see CBotToken::CompileTokens()
      * 2. First pass - getting declarations of all functions an classes for use later
      * 3. Second pass - compiling definitions of all functions and classes
+     * 4. Folding the operations on constants and removing unreachable blocks - see CBotOptimizer
+     *
+     * If the same source code was already compiled by another program which still exists,
+     * with the same pUser or compile context (see SetCompileContext()), its functions are
+     * reused instead (see CBotProgramCache).
+     *
+     * When a program without classes is compiled again and only the bodies of some of its
+     * functions changed, the functions whose source text is the same are kept as they are and
+     * only the other ones are compiled again (see GetReusedFunctionCount()). Any change to the
+     * declarations of the functions, to the external calls or to the public classes and
+     * functions of other programs requires compiling everything.
      *
      * \param program Code to compile
      * \param[out] externFunctions Returns the names of functions declared as extern
@@ -132,6 +166,78 @@ public:
      */
     bool Compile(const std::string& program, std::vector<std::string>& externFunctions, void* pUser = nullptr);
 
+    /**
+     * \brief Enables or disables lowering of expressions to bytecode (see CBotBytecode)
+     *
+     * When enabled, Compile() adds a last step which converts side-effect free expressions
+     * to register bytecode evaluated without walking the instruction tree. Everything else is still
+     * executed by the instruction tree, which is also used as a fallback when the bytecode can't be used.
+     *
+     * Takes effect on the next call to Compile(). Disabled by default.
+     *
+     * \param enabled true to use the bytecode, false to only walk the instruction tree
+     */
+    void SetBytecodeEnabled(bool enabled);
+
+    /**
+     * \brief Check if expressions are lowered to bytecode
+     * \see SetBytecodeEnabled()
+     */
+    bool IsBytecodeEnabled();
+
+    /**
+     * \brief Sets what the compile checks of the external calls depend on
+     *
+     * The compile checks registered with AddFunction() get the pUser pointer given to Compile(),
+     * so by default the compiled code is only shared with programs compiled with the same pointer.
+     * When the checks only depend on something shared by many users (for example the kind of
+     * object running the program), it can be given here instead, and the code is then shared
+     * with all programs compiled with the same context, whatever their pointer.
+     *
+     * Takes effect on the next call to Compile().
+     *
+     * \param context Non-zero value identifying what the checks depend on, 0 (the default) to use pUser
+     */
+    void SetCompileContext(long context);
+
+    /**
+     * \brief Returns the number of expressions lowered to bytecode by the last Compile()
+     */
+    int GetBytecodeCount();
+
+    /**
+     * \brief Returns the number of instructions removed by the last Compile()
+     *
+     * Compile() folds the operations on constants and removes the statement blocks
+     * which can never be executed, see CBotOptimizer.
+     */
+    int GetEliminatedNodeCount();
+
+    /**
+     * \brief Returns the number of functions the last Compile() reused from the previous compilation
+     *
+     * Those are the functions whose code didn't change, see Compile().
+     */
+    int GetReusedFunctionCount();
+
+    /**
+     * \brief Enables or disables the execution profiler (see CBotProfiler)
+     *
+     * While enabled, every execution step and function call of this program is
+     * recorded by the profiler. Compile() resets the collected statistics.
+     * Disabled by default.
+     *
+     * \param enabled true to record the execution
+     */
+    void SetProfilerEnabled(bool enabled);
+
+    /**
+     * \brief Returns the execution profiler
+     * \return The profiler, or nullptr if it is disabled
+     * \see SetProfilerEnabled()
+     */
+    CBotProfiler* GetProfiler();
+
     /**
      * \brief Returns the last error
      * \return Error code
@@ -175,9 +281,25 @@ public:
      * * timer >= 0 call SetTimer(int timer) before executing
      * \endparblock
      * \return true if the program execution finished, false if the program is suspended (you then have to call Run() again)
+     *
+     * Each call executes about the number of steps set with SetTimer(). Steps executed over the budget
+     * (some instructions are charged several steps at once) are taken from the following calls, so the
+     * program always runs at the same average speed. If the whole budget of a call is still owed,
+     * the call returns false without executing anything.
+     *
+     * If the previous call stopped before a deferred external call (see IsCallDeferred()), this call
+     * makes it and continues with what was left of the previous budget.
      */
     bool Run(void* pUser = nullptr, int timer = -1);
 
+    /**
+     * \brief Returns true if the last Run() stopped before an external call which can't run in a batch of CBotWorkerPool
+     *
+     * The slice isn't over, call Run() again outside of the batch to make the call and finish the slice.
+     * \see CBotExternalCall::IsThreadSafe()
+     */
+    bool IsCallDeferred();
+
     /**
      * \brief Gives the current position in the executing program
      * \param[out] functionName Name of the currently executed function
@@ -202,11 +324,29 @@ public:
 
     /**
      * \brief Sets the number of steps (parts of instructions) to execute in Run() before suspending the program execution
-     * \param n new timer value
      *
-     * FIXME: Seems to be currently kind of broken (see issue #410)
+     * The budget belongs to this program only, other programs and the stacks used outside of Run()
+     * (for example to initialize class fields) don't use it.
+     *
+     * \param n new timer value, 0 for step by step execution
      */
-    static void SetTimer(int n);
+    void SetTimer(int n);
+
+    /**
+     * \brief Returns the number of steps executed in each Run()
+     * \see SetTimer()
+     */
+    int GetTimer();
+
+    /**
+     * \brief Returns the counters of the executed steps, for monitoring
+     */
+    const CBotRunStats& GetRunStats();
+
+    /**
+     * \brief Resets the counters returned by GetRunStats()
+     */
+    void ResetRunStats();
 
     /**
      * \brief Add a function that can be called from CBot
@@ -268,11 +408,13 @@ public:
      * \param name Name of the function
      * \param rExec Execution function
      * \param rCompile Compilation function
+     * \param threadSafe true if the execution function only reads the state of the host application, see CBotExternalCall::IsThreadSafe()
      * \return true
      */
     static bool AddFunction(const std::string& name,
                             bool rExec(CBotVar* pVar, CBotVar* pResult, int& Exception, void* pUser),
-                            CBotTypResult rCompile(CBotVar*& pVar, void* pUser));
+                            CBotTypResult rCompile(CBotVar*& pVar, void* pUser),
+                            bool threadSafe = false);
 
     /**
      * \copydoc CBotToken::DefineNum()
@@ -342,6 +484,8 @@ private:
     static CBotExternalCallList* m_externalCalls;
     //! All user-defined functions
     std::list<CBotFunction*> m_functions{};
+    //! Owner of m_functions if they are shared with other programs, nullptr if they belong to this program
+    std::shared_ptr<CBotCompiledCode> m_code{};
     //! The entry point function
     CBotFunction* m_entryPoint = nullptr;
     //! Classes defined in this program
@@ -352,10 +496,76 @@ private:
     CBotVar* m_thisVar = nullptr;
     friend class CBotFunction;
     friend class CBotDebug;
+    friend class CBotStack;
+
+    //! Delete the compiled functions and classes, or stop sharing them
+    void FreeCode();
+    //! Check if this program defines anything other programs can use
+    bool DefinesPublic();
+
+    /**
+     * \brief Source of a function compiled by Compile()
+     *
+     * Kept to find the functions which didn't change when the program is compiled again.
+     */
+    struct FunctionSource
+    {
+        //! Text of the whole definition
+        std::string text;
+        //! Tokens of the declaration, up to the opening brace
+        std::string signature;
+        //! Position of the definition in the program
+        int start = 0;
+        //! Number of expressions of the function lowered to bytecode
+        int bytecodeCount = 0;
+        //! Number of instructions removed from the function
+        int eliminatedNodeCount = 0;
+    };
+
+    //! Get the source of the function defined from start to the token before end
+    static FunctionSource GetFunctionSource(const std::string& program, CBotToken* start, CBotToken* end);
+    //! Take the functions Compile() may reuse, with their sources, empty if they can't be reused
+    std::vector<std::unique_ptr<CBotFunction>> TakeReusableFunctions(long externalCalls, void* compileUser,
+                                                                     std::vector<FunctionSource>& sources);
 
     CBotError m_error = CBotNoErr;
     int m_errorStart = 0;
     int m_errorEnd = 0;
+
+    //! Lower expressions to bytecode in Compile()
+    bool m_bytecodeEnabled = false;
+    //! What the compile checks of the external calls depend on, 0 if it is pUser, see SetCompileContext()
+    long m_compileContext = 0;
+    //! Number of expressions lowered by the last Compile()
+    int m_bytecodeCount = 0;
+    //! Number of instructions removed by the last Compile()
+    int m_eliminatedNodeCount = 0;
+    //! Number of functions reused by the last Compile()
+    int m_reusedFunctionCount = 0;
+    //! Sources of m_functions in the same order, empty if they can't be reused
+    std::vector<FunctionSource> m_sources{};
+    //! Revision of the external calls m_functions were compiled with
+    long m_sourcesExternalCalls = 0;
+    //! Revision of the public classes and functions m_functions were compiled with, see CBotProgramCache::GetRevision()
+    long m_sourcesPublicRevision = 0;
+    //! Whether m_functions were lowered to bytecode
+    bool m_sourcesBytecode = false;
+    //! User pointer m_functions were compiled with, nullptr if they were compiled with a context
+    void* m_sourcesUser = nullptr;
+    //! Compile context m_functions were compiled with
+    long m_sourcesContext = 0;
+    //! Execution profiler, nullptr if disabled
+    CBotProfiler* m_profiler = nullptr;
+
+    //! Default number of steps executed in each Run()
+    static const int DEFAULT_TIMER = 100;
+    //! Number of steps executed in each Run()
+    int m_timer = DEFAULT_TIMER;
+    //! Steps left in the current slice, negative if more steps were executed than the budget allowed
+    int m_budget = 0;
+    //! The last Run() stopped before a call to make outside of CBotWorkerPool, see IsCallDeferred()
+    bool m_callDeferred = false;
+    CBotRunStats m_stats{};
 };
 
 } // namespace CBot
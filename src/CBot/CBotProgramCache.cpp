@@ -0,0 +1,104 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+#include "CBot/CBotProgramCache.h"
+
+#include "CBot/CBotInstr/CBotFunction.h"
+
+#include <functional>
+
+namespace CBot
+{
+
+std::mutex CBotProgramCache::m_mutex;
+std::unordered_map<std::size_t, std::weak_ptr<CBotCompiledCode>> CBotProgramCache::m_entries;
+long CBotProgramCache::m_revision = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+CBotCompiledCode::~CBotCompiledCode()
+{
+    for (CBotFunction* f : functions) delete f;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t CBotProgramCache::GetKey(const std::string& source, long externalCalls, bool bytecode, void* user, long context)
+{
+    std::size_t key = std::hash<std::string>()(source);
+    key ^= std::hash<long>()(externalCalls) + 0x9e3779b9 + (key << 6) + (key >> 2);
+    key ^= std::hash<void*>()(user) + 0x9e3779b9 + (key << 6) + (key >> 2);
+    key ^= std::hash<long>()(context) + 0x9e3779b9 + (key << 6) + (key >> 2);
+    return bytecode ? ~key : key;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::shared_ptr<CBotCompiledCode> CBotProgramCache::Find(const std::string& source, long externalCalls, bool bytecode,
+                                                         void* user, long context)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_entries.find(GetKey(source, externalCalls, bytecode, user, context));
+    if (it == m_entries.end()) return nullptr;
+
+    std::shared_ptr<CBotCompiledCode> code = it->second.lock();
+    if (code == nullptr)
+    {
+        m_entries.erase(it);
+        return nullptr;
+    }
+
+    // different source with the same hash
+    if (code->externalCalls != externalCalls || code->bytecode != bytecode) return nullptr;
+    if (code->user != user || code->context != context || code->source != source) return nullptr;
+
+    return code;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotProgramCache::Add(const std::shared_ptr<CBotCompiledCode>& code)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // forget the code which isn't used anymore
+    for (auto it = m_entries.begin(); it != m_entries.end(); )
+    {
+        if (it->second.expired())
+            it = m_entries.erase(it);
+        else
+            ++it;
+    }
+
+    m_entries[GetKey(code->source, code->externalCalls, code->bytecode, code->user, code->context)] = code;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotProgramCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_revision++;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+long CBotProgramCache::GetRevision()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_revision;
+}
+
+} // namespace CBot
@@ -0,0 +1,124 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace CBot
+{
+
+class CBotFunction;
+
+/**
+ * \brief Compiled code shared by all the programs compiled from the same source
+ *
+ * The instruction trees are never modified after compilation, each program only
+ * keeps its own execution stack, so the functions can be executed by several
+ * programs at once. In particular the identifiers of the called functions are
+ * only written by the compiler, a call which doesn't find its function by
+ * identifier searches it by name every time (see CBotStack::ExecuteCall()).
+ * They are deleted together with the last program using them.
+ */
+struct CBotCompiledCode
+{
+    ~CBotCompiledCode();
+
+    //! Source code the functions were compiled from
+    std::string source;
+    //! Revision of the external calls the code was compiled with, see CBotExternalCallList::GetRevision()
+    long externalCalls = 0;
+    //! Whether expressions were lowered to bytecode
+    bool bytecode = false;
+    //! User pointer given to the compile checks, nullptr if the code was compiled with a context
+    void* user = nullptr;
+    //! Compile context set by the program, see CBotProgram::SetCompileContext()
+    long context = 0;
+    //! Number of expressions lowered to bytecode
+    int bytecodeCount = 0;
+    //! Number of instructions removed by CBotOptimizer
+    int eliminatedNodeCount = 0;
+    //! The compiled functions, in the order of the source code
+    std::list<CBotFunction*> functions;
+};
+
+/**
+ * \brief Cache of compiled programs
+ *
+ * Many robots run exactly the same program, so CBotProgram::Compile() looks for
+ * code already compiled from the same source (with the same external calls
+ * registered, in the same compile context) before compiling anything.
+ *
+ * Only programs which define neither classes nor public functions are cached,
+ * as those are registered globally and may only exist once. Compiling or
+ * deleting such a program empties the cache, since the cached code may have
+ * been compiled against the classes and functions it defined: code is only
+ * shared by programs compiled with the same set of public functions.
+ *
+ * The cache doesn't keep the code alive, entries are forgotten once the last
+ * program using them is deleted or recompiled.
+ */
+class CBotProgramCache
+{
+public:
+    /**
+     * \brief Find code compiled from the given source
+     * \param source Source code of the program
+     * \param externalCalls Current revision of the external calls
+     * \param bytecode Whether the expressions have to be lowered to bytecode
+     * \param user User pointer given to the compile checks, nullptr if context is set
+     * \param context Compile context, see CBotProgram::SetCompileContext()
+     * \return The compiled code, or nullptr if there is none
+     */
+    static std::shared_ptr<CBotCompiledCode> Find(const std::string& source, long externalCalls, bool bytecode,
+                                                  void* user, long context);
+
+    /**
+     * \brief Add compiled code to the cache
+     */
+    static void Add(const std::shared_ptr<CBotCompiledCode>& code);
+
+    /**
+     * \brief Forget all the cached code
+     *
+     * The code still used by programs isn't deleted, but it won't be shared anymore.
+     */
+    static void Clear();
+
+    /**
+     * \brief Number of times the cache was emptied
+     *
+     * Changes whenever classes or public functions may have been defined or
+     * deleted, see CBotProgram::Compile().
+     */
+    static long GetRevision();
+
+private:
+    static std::size_t GetKey(const std::string& source, long externalCalls, bool bytecode, void* user, long context);
+
+    static std::mutex m_mutex;
+    static std::unordered_map<std::size_t, std::weak_ptr<CBotCompiledCode>> m_entries;
+    static long m_revision;
+};
+
+} // namespace CBot
@@ -0,0 +1,169 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+#include "CBot/CBotSnapshot.h"
+
+#include "CBot/CBotDefines.h"
+#include "CBot/CBotFileUtils.h"
+
+#include <cstring>
+
+namespace CBot
+{
+
+namespace
+{
+
+const char SNAPSHOT_MAGIC[] = "CBOTSNAP";
+const std::size_t SNAPSHOT_MAGIC_SIZE = sizeof(SNAPSHOT_MAGIC) - 1;
+const long SNAPSHOT_VERSION = 1;
+
+} // namespace
+
+/**
+ * \brief Stream buffer reading a part of a string without copying it
+ */
+class CBotSnapshotReader::EntryBuffer : public std::streambuf
+{
+public:
+    void Set(char* begin, char* end)
+    {
+        setg(begin, begin, end);
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+std::ostream& CBotSnapshotWriter::AddEntry(long id)
+{
+    m_entries.emplace_back(id, static_cast<std::streamoff>(m_data.tellp()));
+    return m_data;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotSnapshotWriter::CancelEntry()
+{
+    if (m_entries.empty()) return;
+
+    m_data.clear();
+    m_data.seekp(m_entries.back().second);      // the next entry overwrites it
+    m_entries.pop_back();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t CBotSnapshotWriter::GetEntryCount() const
+{
+    return m_entries.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotSnapshotWriter::Write(std::ostream& ostr)
+{
+    if (!m_data) return false;
+    std::streamoff end = m_data.tellp();
+
+    if (!ostr.write(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE)) return false;
+    if (!WriteLong(ostr, SNAPSHOT_VERSION)) return false;
+    if (!WriteLong(ostr, CBOTVERSION)) return false;
+    if (!WriteLong(ostr, m_entries.size())) return false;
+
+    for (std::size_t i = 0; i < m_entries.size(); i++)
+    {
+        std::streamoff next = (i + 1 < m_entries.size()) ? m_entries[i + 1].second : end;
+        if (!WriteLong(ostr, m_entries[i].first)) return false;
+        if (!WriteLong(ostr, next - m_entries[i].second)) return false;
+    }
+
+    // the buffer may be longer than the data after CancelEntry()
+    const std::string data = m_data.str();
+    return static_cast<bool>(ostr.write(data.data(), end));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CBotSnapshotReader::CBotSnapshotReader()
+: m_buffer(new EntryBuffer())
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CBotSnapshotReader::~CBotSnapshotReader()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotSnapshotReader::Read(std::istream& istr)
+{
+    m_data.clear();
+    m_entries.clear();
+    m_entry.reset();
+
+    char magic[SNAPSHOT_MAGIC_SIZE];
+    if (!istr.read(magic, SNAPSHOT_MAGIC_SIZE)) return false;
+    if (memcmp(magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE) != 0) return false;
+
+    long version;
+    if (!ReadLong(istr, version) || version != SNAPSHOT_VERSION) return false;
+    if (!ReadLong(istr, version) || version != CBOTVERSION) return false;
+
+    long count;
+    if (!ReadLong(istr, count) || count < 0) return false;
+
+    std::size_t offset = 0;
+    for (long i = 0; i < count; i++)
+    {
+        long id, size;
+        if (!ReadLong(istr, id)) return false;
+        if (!ReadLong(istr, size) || size < 0) return false;
+        m_entries[id] = std::make_pair(offset, static_cast<std::size_t>(size));
+        offset += size;
+    }
+
+    m_data.resize(offset);
+    if (offset != 0 && !istr.read(&m_data[0], offset))
+    {
+        m_entries.clear();
+        return false;
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotSnapshotReader::HasEntry(long id) const
+{
+    return m_entries.count(id) != 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::istream* CBotSnapshotReader::GetEntry(long id)
+{
+    auto it = m_entries.find(id);
+    if (it == m_entries.end()) return nullptr;
+
+    char* begin = &m_data[0] + it->second.first;
+    m_buffer->Set(begin, begin + it->second.second);
+    m_entry.reset(new std::istream(m_buffer.get()));
+    return m_entry.get();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t CBotSnapshotReader::GetEntryCount() const
+{
+    return m_entries.size();
+}
+
+} // namespace CBot
@@ -0,0 +1,136 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace CBot
+{
+
+/**
+ * \brief Writes the saved state of many programs at once
+ *
+ * Each state (see CBotProgram::SaveState()) is written to its own entry, identified
+ * by a number such as the id of the object running the program. All the entries
+ * are kept in a single memory buffer, which Write() outputs in one go after a table
+ * of contents:
+ *
+ * \code
+ * "CBOTSNAP"            magic
+ * long                  version of the snapshot format
+ * long                  version of CBot, see CBotProgram::GetVersion()
+ * long                  number of entries
+ * long, long            id and size of each entry
+ * ...                   data of the entries, in the same order
+ * \endcode
+ *
+ * \see CBotSnapshotReader
+ */
+class CBotSnapshotWriter
+{
+public:
+    /**
+     * \brief Start a new entry
+     * \param id Identifier of the entry
+     * \return Stream to write the entry to, until the next entry is added
+     */
+    std::ostream& AddEntry(long id);
+
+    /**
+     * \brief Remove the last entry, when writing it failed
+     */
+    void CancelEntry();
+
+    /**
+     * \brief Returns the number of entries
+     */
+    std::size_t GetEntryCount() const;
+
+    /**
+     * \brief Write the snapshot
+     * \param ostr Output stream
+     * \return true on success
+     */
+    bool Write(std::ostream& ostr);
+
+private:
+    //! Data of all the entries
+    std::stringstream m_data;
+    //! Id and offset in m_data of each entry
+    std::vector<std::pair<long, std::streamoff>> m_entries;
+};
+
+/**
+ * \brief Reads a snapshot written by CBotSnapshotWriter
+ *
+ * Read() loads the whole snapshot with a single read, but only the table of contents
+ * is decoded. Each entry is read from memory when GetEntry() asks for it, so
+ * the entries can be restored in any order and the ones nobody asks for are skipped.
+ */
+class CBotSnapshotReader
+{
+public:
+    CBotSnapshotReader();
+    ~CBotSnapshotReader();
+
+    /**
+     * \brief Read a snapshot
+     * \param istr Input stream
+     * \return false if the stream doesn't contain a snapshot of this version of CBot
+     */
+    bool Read(std::istream& istr);
+
+    /**
+     * \brief Check if the snapshot has an entry
+     * \param id Identifier of the entry
+     */
+    bool HasEntry(long id) const;
+
+    /**
+     * \brief Get an entry of the snapshot
+     * \param id Identifier of the entry
+     * \return Stream to read the entry from, valid until the next call, or nullptr if there is no such entry
+     */
+    std::istream* GetEntry(long id);
+
+    /**
+     * \brief Returns the number of entries
+     */
+    std::size_t GetEntryCount() const;
+
+private:
+    class EntryBuffer;
+
+    //! Data of all the entries
+    std::string m_data;
+    //! Offset in m_data and size of each entry
+    std::unordered_map<long, std::pair<std::size_t, std::size_t>> m_entries;
+    //! Gives access to one entry of m_data without copying it
+    std::unique_ptr<EntryBuffer> m_buffer;
+    std::unique_ptr<std::istream> m_entry;
+};
+
+} // namespace CBot
@@ -28,53 +28,93 @@
 
 #include "CBot/CBotUtils.h"
 #include "CBot/CBotExternalCall.h"
+#include "CBot/CBotProgram.h"
+#include "CBot/CBotProfiler.h"
+#include "CBot/CBotWorkerPool.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
-#include <cstring>
+#include <limits>
+#include <vector>
 
 
 namespace CBot
 {
 
-const int DEFAULT_TIMER = 100;
+//! Number of released stacks kept for reuse by AllocateStack()
+const int MAX_POOLED_STACKS = 16;
 
-int         CBotStack::m_initimer = DEFAULT_TIMER;
-int         CBotStack::m_timer = 0;
-CBotVar*    CBotStack::m_retvar = nullptr;
-CBotError   CBotStack::m_error = CBotNoErr;
-int         CBotStack::m_start = 0;
-int         CBotStack::m_end   = 0;
-std::string  CBotStack::m_labelBreak="";
-void*       CBotStack::m_pUser = nullptr;
+thread_local std::vector<CBotStack*> CBotStack::m_pool;
 
 ////////////////////////////////////////////////////////////////////////////////
 CBotStack* CBotStack::AllocateStack()
 {
     CBotStack*    p;
 
-    long    size = sizeof(CBotStack);
-    size    *= (MAXSTACK+10);
+    if (!m_pool.empty())
+    {
+        // all the levels of a released stack are already free
+        p = m_pool.back();
+        m_pool.pop_back();
+    }
+    else
+    {
+        // request a slice of memory for the stack, completely empty
+        // calloc() leaves the pages untouched until a level is actually used
+        p = static_cast<CBotStack*>(calloc(MAXSTACK+10, sizeof(CBotStack)));
+
+        CBotStack* pp = p;
+        pp += MAXSTACK;
+        int i;
+        for ( i = 0 ; i< 10 ; i++ )
+        {
+            pp->m_bOver = true;
+            pp ++;
+        }
+    }
 
-    // request a slice of memory for the stack
-    p = static_cast<CBotStack*>(malloc(size));
+    // the first level owns the state of the whole stack, kept with the pooled memory
+    if (p->m_run == nullptr) p->m_run = new RunState();
+    else *p->m_run = RunState();
 
-    // completely empty
-    memset(p, 0, size);
+    p->Init(nullptr, nullptr, BlockVisibilityType::BLOCK);
+    p->m_prog  = nullptr;
+    p->m_frame = nullptr;
+    return p;
+}
 
-    p->m_block = BlockVisibilityType::BLOCK;
+////////////////////////////////////////////////////////////////////////////////
+void CBotStack::ClearPool()
+{
+    for (CBotStack* p : m_pool) FreeStack(p);
+    m_pool.clear();
+}
 
-    CBotStack* pp = p;
-    pp += MAXSTACK;
-    int i;
-    for ( i = 0 ; i< 10 ; i++ )
+////////////////////////////////////////////////////////////////////////////////
+void CBotStack::FreeStack(CBotStack* p)
+{
+    for (CBotStack* level = p; !level->m_bOver; level++)
     {
-        pp->m_bOver = true;
-        pp ++;
+        delete[] level->m_slots;
     }
+    delete p->m_run;
+    free(p);
+}
 
-    m_error = CBotNoErr;    // avoids deadlocks because m_error is static
-    return p;
+////////////////////////////////////////////////////////////////////////////////
+void CBotStack::Init(CBotStack* prev, CBotInstr* instr, BlockVisibilityType bBlock)
+{
+    m_block  = bBlock;
+    m_instr  = instr;
+    m_step   = 0;
+    m_prev   = prev;
+    m_root   = (prev != nullptr) ? prev->m_root : this;
+    if (prev != nullptr) m_run = prev->m_run;
+    m_state  = 0;
+    m_call   = nullptr;
+    m_func   = IsFunction::NO;
+    m_callFinished = false;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -93,17 +133,40 @@ void CBotStack::Delete()
     }
 
     delete m_var;
+    if (m_frame != nullptr && m_frame != this)
+    {
+        // the variables of this level are no longer reachable from the frame
+        for (CBotVar* pVar = m_listVar; pVar != nullptr; pVar = pVar->m_next)
+        {
+            int slot = pVar->m_frameSlot;
+            if (slot >= 0 && slot < m_frame->m_slotCount && m_frame->m_slots[slot] == pVar)
+                m_frame->m_slots[slot] = nullptr;
+        }
+    }
     delete m_listVar;
 
     CBotStack*    p = m_prev;
-    bool        bOver = m_bOver;
 
-    // clears the freed block
-    memset(this, 0, sizeof(CBotStack));
-    m_bOver    = bOver;
+    // frees the level, the other fields are set again by AddStack()
+    m_next     = nullptr;
+    m_next2    = nullptr;
+    m_prev     = nullptr;
+    m_var      = nullptr;
+    m_listVar  = nullptr;
+    m_slotCount = 0;                    // m_slots is kept for the next frame on this level
 
     if ( p == nullptr )
-        free( this );
+    {
+        // the whole stack is free again, keep it for the next AllocateStack()
+        if (m_pool.size() < MAX_POOLED_STACKS)
+        {
+            m_pool.push_back(this);
+        }
+        else
+        {
+            FreeStack(this);
+        }
+    }
 }
 
 // routine improved
@@ -123,15 +186,16 @@ CBotStack* CBotStack::AddStack(CBotInstr* instr, BlockVisibilityType bBlock)
     while ( p->m_prev != nullptr );
 
     m_next = p;                                    // chain an element
-    p->m_block  = bBlock;
-    p->m_instr  = instr;
+    p->Init(this, instr, bBlock);
     p->m_prog   = m_prog;
-    p->m_step   = 0;
-    p->m_prev   = this;
-    p->m_state  = 0;
-    p->m_call   = nullptr;
-    p->m_func   = IsFunction::NO;
-    p->m_callFinished = false;
+    p->m_frame  = (bBlock == BlockVisibilityType::FUNCTION) ? nullptr : m_frame;
+
+    if (bBlock == BlockVisibilityType::FUNCTION && m_prog != nullptr && m_prog->GetProfiler() != nullptr)
+    {
+        CBotStack* caller = this;
+        while (caller != nullptr && caller->m_block != BlockVisibilityType::FUNCTION) caller = caller->m_prev;
+        m_prog->GetProfiler()->AddCall(caller != nullptr ? caller->m_instr : nullptr, instr);
+    }
     return p;
 }
 
@@ -166,10 +230,9 @@ CBotStack* CBotStack::AddStack2(BlockVisibilityType bBlock)
     while ( p->m_prev != nullptr );
 
     m_next2 = p;                                // chain an element
-    p->m_prev = this;
-    p->m_block = bBlock;
+    p->Init(this, nullptr, bBlock);
     p->m_prog = m_prog;
-    p->m_step = 0;
+    p->m_frame = m_frame;
     return    p;
 }
 
@@ -220,18 +283,16 @@ bool CBotStack::ReturnKeep(CBotStack* pfils)
 bool CBotStack::StackOver()
 {
     if (!m_bOver) return false;
-    m_error = CBotErrStackOver;
+    m_run->error = CBotErrStackOver;
     return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void CBotStack::Reset()
 {
-    m_timer = m_initimer; // resets the timer
-    m_error    = CBotNoErr;
-//    m_start = 0;
-//    m_end    = 0;
-    m_labelBreak.clear();
+    m_run->error = CBotNoErr;
+    m_run->labelBreak.clear();
+    m_run->callDeferred = false;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -258,35 +319,35 @@ CBotStack* CBotStack::RestoreStackEOX(CBotExternalCall* instr)
 // routine for execution step by step
 bool CBotStack::IfStep()
 {
-    if ( m_initimer > 0 || m_step++ > 0 ) return false;
+    if ( GetTimer() > 0 || m_step++ > 0 ) return false;
     return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 bool CBotStack::BreakReturn(CBotStack* pfils, const std::string& name)
 {
-    if ( m_error>=0 ) return false;                // normal output
-    if ( m_error==CBotError(-3) ) return false;            // normal output (return current)
+    if ( m_run->error>=0 ) return false;                // normal output
+    if ( m_run->error==CBotError(-3) ) return false;    // normal output (return current)
 
-    if (!m_labelBreak.empty() && (name.empty() || m_labelBreak != name))
+    if (!m_run->labelBreak.empty() && (name.empty() || m_run->labelBreak != name))
         return false;                            // it's not for me
 
-    m_error = CBotNoErr;
-    m_labelBreak.clear();
+    m_run->error = CBotNoErr;
+    m_run->labelBreak.clear();
     return Return(pfils);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 bool CBotStack::IfContinue(int state, const std::string& name)
 {
-    if ( m_error != CBotError(-2) ) return false;
+    if ( m_run->error != CBotError(-2) ) return false;
 
-    if (!m_labelBreak.empty() && (name.empty() || m_labelBreak != name))
+    if (!m_run->labelBreak.empty() && (name.empty() || m_run->labelBreak != name))
         return false;                            // it's not for me
 
     m_state = state;                            // where again?
-    m_error = CBotNoErr;
-    m_labelBreak.clear();
+    m_run->error = CBotNoErr;
+    m_run->labelBreak.clear();
     if (m_next != nullptr) m_next->Delete();            // purge above stack
     return true;
 }
@@ -294,11 +355,11 @@ bool CBotStack::IfContinue(int state, const std::string& name)
 ////////////////////////////////////////////////////////////////////////////////
 void CBotStack::SetBreak(int val, const std::string& name)
 {
-    m_error = static_cast<CBotError>(-val);                                // reacts as an Exception
-    m_labelBreak = name;
+    m_run->error = static_cast<CBotError>(-val);        // reacts as an Exception
+    m_run->labelBreak = name;
     if (val == 3)    // for a return
     {
-        m_retvar = m_var;
+        m_run->retvar = m_var;
         m_var = nullptr;
     }
 }
@@ -307,12 +368,12 @@ void CBotStack::SetBreak(int val, const std::string& name)
 ////////////////////////////////////////////////////////////////////////////////
 bool CBotStack::GetRetVar(bool bRet)
 {
-    if (m_error == CBotError(-3))
+    if (m_run->error == CBotError(-3))
     {
         if ( m_var ) delete m_var;
-        m_var        = m_retvar;
-        m_retvar    = nullptr;
-        m_error      = CBotNoErr;
+        m_var         = m_run->retvar;
+        m_run->retvar = nullptr;
+        m_run->error  = CBotNoErr;
         return        true;
     }
     return bRet;                        // interrupted by something other than return
@@ -322,17 +383,17 @@ bool CBotStack::GetRetVar(bool bRet)
 CBotVar* CBotStack::FindVar(CBotToken*& pToken, bool bUpdate)
 {
     CBotStack*    p = this;
-    std::string    name = pToken->GetString();
+    int           nameId = pToken->GetNameId();
 
     while (p != nullptr)
     {
         CBotVar*    pp = p->m_listVar;
         while ( pp != nullptr)
         {
-            if (pp->GetName() == name)
+            if (pp->GetNameId() == nameId)
             {
                 if ( bUpdate )
-                    pp->Update(m_pUser);
+                    pp->Update(m_run->user);
 
                 return pp;
             }
@@ -375,7 +436,7 @@ CBotVar* CBotStack::FindVar(long ident, bool bUpdate)
             if (pp->GetUniqNum() == ident)
             {
                 if ( bUpdate )
-                    pp->Update(m_pUser);
+                    pp->Update(m_run->user);
 
                 return pp;
             }
@@ -386,6 +447,23 @@ CBotVar* CBotStack::FindVar(long ident, bool bUpdate)
     return nullptr;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+CBotVar* CBotStack::FindVar(long ident, int slot, bool bUpdate)
+{
+    if (slot >= 0 && m_frame != nullptr && slot < m_frame->m_slotCount)
+    {
+        CBotVar*    pVar = m_frame->m_slots[slot];
+        if (pVar != nullptr)
+        {
+            if ( bUpdate )
+                pVar->Update(m_run->user);
+
+            return pVar;
+        }
+    }
+    return FindVar(ident, bUpdate);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 CBotVar* CBotStack::FindVar(CBotToken& pToken, bool bUpdate)
 {
@@ -410,8 +488,7 @@ bool CBotStack::SetState(int n, int limite)
 {
     m_state = n;
 
-    m_timer--;                                    // decrement the timer
-    return ( m_timer > limite );                    // interrupted if timer pass
+    return ( SpendTimer(1) > limite );              // interrupted if timer pass
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -419,48 +496,72 @@ bool CBotStack::IncState(int limite)
 {
     m_state++;
 
-    m_timer--;                                    // decrement the timer
-    return ( m_timer > limite );                    // interrupted if timer pass
+    return ( SpendTimer(1) > limite );              // interrupted if timer pass
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void CBotStack::SetError(CBotError n, CBotToken* token)
+int CBotStack::SpendTimer(int n)
 {
-    if (n != CBotNoErr && m_error != CBotNoErr) return;    // does not change existing error
-    m_error = n;
-    if (token != nullptr)
-    {
-        m_start = token->GetStart();
-        m_end   = token->GetEnd();
-    }
+    if (m_prog != nullptr && m_prog->GetProfiler() != nullptr) ProfileSteps(n);
+
+    CBotProgram* prog = m_root->m_prog;
+    if (prog == nullptr) return std::numeric_limits<int>::max(); // not run by a program, no timer
+
+    prog->m_budget -= n;                          // decrement the timer
+    return prog->m_budget;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void CBotStack::ResetError(CBotError n, int start, int end)
+int CBotStack::GetTimer()
 {
-    m_error = n;
-    m_start    = start;
-    m_end    = end;
+    CBotProgram* prog = m_root->m_prog;
+    if (prog == nullptr) return std::numeric_limits<int>::max();
+
+    return prog->m_timer;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void CBotStack::SetPosError(CBotToken* token)
+void CBotStack::ProfileSteps(int n)
+{
+    // levels without an instruction belong to the instruction below them
+    CBotStack* p = this;
+    while (p != nullptr && p->m_instr == nullptr) p = p->m_prev;
+
+    CBotStack* function = p;
+    while (function != nullptr && function->m_block != BlockVisibilityType::FUNCTION) function = function->m_prev;
+
+    m_prog->GetProfiler()->AddSteps(p != nullptr ? p->m_instr : nullptr,
+                                    function != nullptr ? function->m_instr : nullptr, n);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotStack::SetError(CBotError n, CBotToken* token)
 {
-    m_start = token->GetStart();
-    m_end   = token->GetEnd();
+    if (n != CBotNoErr && m_run->error != CBotNoErr) return;    // does not change existing error
+    m_run->error = n;
+    if (token != nullptr)
+    {
+        m_run->start = token->GetStart();
+        m_run->end   = token->GetEnd();
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void CBotStack::SetTimer(int n)
+void CBotStack::ResetError(CBotError n, int start, int end)
 {
-    m_initimer = n;
+    m_run->error = n;
+    m_run->start = start;
+    m_run->end   = end;
 }
 
-int CBotStack::GetTimer()
+////////////////////////////////////////////////////////////////////////////////
+void CBotStack::SetPosError(CBotToken* token)
 {
-    return m_initimer;
+    m_run->start = token->GetStart();
+    m_run->end   = token->GetEnd();
 }
 
+
 ////////////////////////////////////////////////////////////////////////////////
 bool CBotStack::Execute()
 {
@@ -482,7 +583,9 @@ bool CBotStack::Execute()
 
     if ( instr == nullptr ) return true;                // normal execution request
 
-    if (!instr->Run(nullptr, pile)) return false;            // resume interrupted execution
+    if (!instr->IsThreadSafe() && CBotWorkerPool::IsRunningSlice()) return DeferCall();
+
+    if (!instr->Run(nullptr, pile)) return false;        // resume interrupted execution
 
     if (pile->m_next != nullptr) pile->m_next->Delete();
 
@@ -522,7 +625,7 @@ long CBotStack::GetVal()
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void CBotStack::AddVar(CBotVar* pVar)
+void CBotStack::AddVar(CBotVar* pVar, int slot)
 {
     CBotStack*    p = this;
 
@@ -535,6 +638,43 @@ void CBotStack::AddVar(CBotVar* pVar)
     while ( *pp != nullptr ) pp = &(*pp)->m_next;
 
     *pp = pVar;                    // added after
+
+    // the first variable with that identifier is the one FindVar() finds
+    if (slot < 0 || m_frame == nullptr || slot >= m_frame->m_slotCount) return;
+    if (m_frame->m_slots[slot] != nullptr) return;
+
+    m_frame->m_slots[slot] = pVar;
+    pVar->m_frameSlot = slot;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotStack::SetFrame(int slotCount)
+{
+    if (m_frame == this) return;
+
+    m_frame = this;
+    m_slotCount = slotCount;
+    if (slotCount > m_slotCapacity)
+    {
+        // levels are reused by every call at the same depth, so this only happens the first time
+        delete[] m_slots;
+        m_slots = new CBotVar*[slotCount];
+        m_slotCapacity = slotCount;
+    }
+    std::fill(m_slots, m_slots + slotCount, nullptr);
+
+    // levels restored from a saved state are already there and belong to this frame too
+    if (m_next == nullptr && m_next2 == nullptr) return;
+    std::vector<CBotStack*> pending = { m_next, m_next2 };
+    while (!pending.empty())
+    {
+        CBotStack* p = pending.back();
+        pending.pop_back();
+        if (p == nullptr || p->m_block == BlockVisibilityType::FUNCTION) continue;
+        p->m_frame = this;
+        pending.push_back(p->m_next);
+        pending.push_back(p->m_next2);
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -548,24 +688,22 @@ void CBotStack::SetProgram(CBotProgram* p)
 CBotProgram*  CBotStack::GetProgram(bool bFirst)
 {
     if ( ! bFirst )    return m_prog;
-    CBotStack*    p = this;
-    while ( p->m_prev != nullptr ) p = p->m_prev;
-    return p->m_prog;
+    return m_root->m_prog;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void* CBotStack::GetUserPtr()
 {
-    return m_pUser;
+    return m_run->user;
 }
 
 void CBotStack::SetUserPtr(void* user)
 {
-    m_pUser = user;
+    m_run->user = user;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool CBotStack::ExecuteCall(long& nIdent, CBotToken* token, CBotVar** ppVar, const CBotTypResult& rettype)
+bool CBotStack::ExecuteCall(long nIdent, CBotToken* token, CBotVar** ppVar, const CBotTypResult& rettype)
 {
     int res;
 
@@ -591,7 +729,7 @@ bool CBotStack::ExecuteCall(long& nIdent, CBotToken* token, CBotVar** ppVar, con
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void CBotStack::RestoreCall(long& nIdent, CBotToken* token, CBotVar** ppVar)
+void CBotStack::RestoreCall(long nIdent, CBotToken* token, CBotVar** ppVar)
 {
     if (m_next == nullptr) return;
 
@@ -748,7 +886,7 @@ bool CBotStack::RestoreState(std::istream &istr, CBotStack* &pStack)
 
     int state;
     if (!ReadInt(istr, state)) return false;
-    pStack->SetState(state);
+    pStack->m_state = state;                    // not charged to the timer
 
     if (!ReadWord(istr, w)) return false; // backwards compatibility (m_bDontDelete)
 
@@ -986,4 +1124,17 @@ bool CBotStack::IsCallFinished()
     return m_callFinished;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool CBotStack::DeferCall()
+{
+    m_run->callDeferred = true;
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotStack::IsCallDeferred()
+{
+    return m_run->callDeferred;
+}
+
 } // namespace CBot
@@ -26,6 +26,7 @@
 
 #include <cstdio>
 #include <string>
+#include <vector>
 
 namespace CBot
 {
@@ -66,9 +67,19 @@ public:
      */
     static CBotStack* AllocateStack();
 
-    /** \brief Remove the current stack */
+    /**
+     * \brief Remove the current stack
+     *
+     * When called on the bottom level, the whole stack is kept for reuse by
+     * the next AllocateStack(), see ClearPool().
+     */
     void Delete();
 
+    /**
+     * \brief Free the stacks kept for reuse
+     */
+    static void ClearPool();
+
     CBotStack() = delete;
     ~CBotStack() = delete;
 
@@ -83,8 +94,7 @@ public:
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     /** \name Error management
      *
-     * BE CAREFUL - errors are stored in static variables!
-     * \todo Refactor that
+     * The error is shared by all the levels of a stack, but every stack created by AllocateStack() has its own.
      */
     //@{
 
@@ -94,14 +104,14 @@ public:
      * \param[out] end Ending position in code of the error
      * \return Error number
      */
-    CBotError GetError(int& start, int& end) { start = m_start; end = m_end; return m_error; }
+    CBotError GetError(int& start, int& end) { start = m_run->start; end = m_run->end; return m_run->error; }
 
     /**
      * \brief Get last error
      * \return Error number
      * \see GetError(int&, int&) for error position in code
      */
-    CBotError GetError() { return m_error; }
+    CBotError GetError() { return m_run->error; }
 
     /**
      * \brief Check if there was an error
@@ -110,7 +120,7 @@ public:
      */
     bool IsOk()
     {
-        return m_error == CBotNoErr;
+        return m_run->error == CBotNoErr;
     }
 
     /**
@@ -156,8 +166,26 @@ public:
     /**
      * \brief Adds a local variable
      * \param var Variable to be added
+     * \param slot Slot of the variable in the function frame, see SetFrame(), or -1 if it has none
      */
-    void AddVar(CBotVar* var);
+    void AddVar(CBotVar* var, int slot = -1);
+
+    /**
+     * \brief Make this stack level the frame of a function call
+     *
+     * The frame holds a flat table with one slot for every local variable
+     * declared in the function (see CBotFunction::ResolveSlots()), so that
+     * FindVar(long, int, bool) does not have to walk the local variable lists
+     * of all stack levels. Stack levels added above inherit the frame.
+     * The table stays with the stack level when the call returns, so it is
+     * only allocated the first time a function with that many slots is called
+     * at this depth.
+     *
+     * Calling this again on the same level does nothing.
+     *
+     * \param slotCount Number of slots used by the function
+     */
+    void SetFrame(int slotCount);
 
     /**
      * \brief Fetch a variable by its token
@@ -190,6 +218,19 @@ public:
      */
     CBotVar* FindVar(long ident, bool bUpdate);
 
+    /**
+     * \brief Fetch a variable on the stack by its slot in the function frame
+     *
+     * Falls back to FindVar(long, bool) if the variable is not in the slot
+     * table, for example when the stack was restored from a saved state.
+     *
+     * \param ident Unique identifier of a variable
+     * \param slot Slot of the variable in the function frame, or -1 if it has none
+     * \param bUpdate true to automatically call update function for classes, see CBotClass::SetUpdateFunc()
+     * \return Found variable, nullptr if not found
+     */
+    CBotVar* FindVar(long ident, int slot, bool bUpdate);
+
     /**
      * \brief Find variable by its token and returns a copy of it
      *
@@ -293,7 +334,9 @@ public:
      * When CBotInstr::Execute() is called, it continues execution from the point it finished at.
      * See various CBotInstr::Execute() implementations for details.
      *
-     * Each state change causes one tick on the execution timer
+     * Each state change causes one tick on the execution timer. The timer is the instruction budget of the
+     * program which runs the stack (see CBotProgram::SetTimer()), stacks executed outside of CBotProgram::Run()
+     * have no timer and are never interrupted.
      */
     //@{
 
@@ -319,6 +362,16 @@ public:
      */
     bool            IncState(int lim = -10);
 
+    /**
+     * \brief Consume ticks on the timer without changing the execution state
+     *
+     * Used when several steps are executed at once, see CBotBytecode
+     *
+     * \param n Number of ticks to consume
+     * \return Number of ticks left on the timer
+     */
+    int             SpendTimer(int n);
+
     /**
      * \brief Check if we are in step by step execution mode
      * \return true if step by step, false otherwise
@@ -357,7 +410,7 @@ public:
     /**
      * \todo Document
      *
-     * Copies the result value from static m_retvar (m_var at a moment of SetBreak(3)) to this stack result
+     * Copies the result value saved by SetBreak(3) (m_var at that moment) to this stack result
      */
     bool            GetRetVar(bool bRet);
 
@@ -414,19 +467,22 @@ public:
 
     /**
      * \brief Execute a function call, either external or user-defined
-     * \param[in, out] nIdent Unique function identifier, if not found will be updated
+     *
+     * The instruction may be shared by programs running in parallel, so the identifier
+     * found by the compiler is never updated here.
+     * \param nIdent Unique function identifier, if not found the function is searched by name
      * \param token Function name token
      * \param ppVar Array of function arguments
      * \param rettype Expected return type
      */
-    bool            ExecuteCall(long& nIdent, CBotToken* token, CBotVar** ppVar, const CBotTypResult& rettype);
+    bool            ExecuteCall(long nIdent, CBotToken* token, CBotVar** ppVar, const CBotTypResult& rettype);
     /**
      * \brief Restore a function call after the program state has been restored from a file
-     * \param[in, out] nIdent Unique function identifier, if not found will be updated
+     * \param nIdent Unique function identifier, if not found the function is searched by name
      * \param token Function name token
      * \param ppVar Array of function arguments
      */
-    void            RestoreCall(long& nIdent, CBotToken* token, CBotVar** ppVar);
+    void            RestoreCall(long nIdent, CBotToken* token, CBotVar** ppVar);
 
     //@}
 
@@ -440,17 +496,10 @@ public:
     //@}
 
     /**
-     * \brief Set the maximum number of "timer ticks" (parts of instructions) to execute
-     *
-     * This setting gets applied on next call to Reset()
-     *
-     * \todo Full documentation of the timer
-     */
-    static void     SetTimer(int n);
-    /**
-     * \brief Get the current configured maximum number of "timer ticks" (parts of instructions) to execute
+     * \brief Get the configured number of "timer ticks" (parts of instructions) executed by the program running this stack
+     * \return 0 in step by step mode, see CBotProgram::SetTimer()
      */
-    static int GetTimer();
+    int             GetTimer();
 
     /**
      * \brief Get current position in the program
@@ -469,17 +518,61 @@ public:
 
     bool            IsCallFinished();
 
+    /**
+     * \brief Stops the program before an external call which can't run during a batch of CBotWorkerPool
+     *
+     * Nothing is added to the stack, the instruction makes the call again when execution resumes.
+     * \return false, to interrupt execution
+     * \see CBotExternalCall::IsThreadSafe()
+     */
+    bool            DeferCall();
+    /**
+     * \brief Returns true if the last execution stopped because of DeferCall()
+     */
+    bool            IsCallDeferred();
+
 private:
+    /**
+     * \brief Prepare a free level for use
+     * \param prev Level below, nullptr for the bottom level
+     * \param instr Instruction executed at this level
+     * \param bBlock Visibility of the variables of this level
+     */
+    void Init(CBotStack* prev, CBotInstr* instr, BlockVisibilityType bBlock);
+
+    /**
+     * \brief Charge execution steps to the profiler of the program, see CBotProgram::GetProfiler()
+     * \param n Number of steps
+     */
+    void ProfileSteps(int n);
+
+    //! Execution state shared by all the levels of a stack
+    struct RunState
+    {
+        CBotError   error = CBotNoErr;
+        int         start = 0;
+        int         end = 0;
+        //! Result of a return, see SetBreak()
+        CBotVar*    retvar = nullptr;
+        std::string labelBreak;
+        //! User pointer given to CBotProgram::Run()
+        void*       user = nullptr;
+        //! Execution stopped before a call, see DeferCall()
+        bool        callDeferred = false;
+    };
+
+    //! Released stacks of this thread, see Delete()
+    static thread_local std::vector<CBotStack*> m_pool;
+
+    //! Free the memory of a stack created by AllocateStack(), including the slot tables of its levels
+    static void FreeStack(CBotStack* p);
+
     CBotStack*        m_next;
     CBotStack*        m_next2;
     CBotStack*        m_prev;
 
     int               m_state;
     int               m_step;
-    static CBotError  m_error;
-    static int        m_start;
-    static int        m_end;
-    static CBotVar*   m_retvar;                    // result of a return
 
     CBotVar*        m_var;                        // result of the operations
     CBotVar*        m_listVar;                    // variables declared at this level
@@ -488,11 +581,10 @@ private:
     bool            m_bOver;                    // stack limits?
     //! CBotProgram instance the execution is in in this stack level
     CBotProgram*    m_prog;
-
-    static int      m_initimer;
-    static int      m_timer;
-    static std::string m_labelBreak;
-    static void*    m_pUser;
+    //! First level of the stack, its m_prog is the program running the stack and paying for the ticks
+    CBotStack*      m_root;
+    //! State of the whole stack, owned by the first level
+    RunState*       m_run;
 
     //! The corresponding instruction
     CBotInstr* m_instr;
@@ -502,6 +594,15 @@ private:
     CBotExternalCall* m_call;
 
     bool m_callFinished;
+
+    //! Stack level of the function call this level belongs to, see SetFrame()
+    CBotStack* m_frame;
+    //! Local variables by slot (only used on the frame level itself), kept for reuse by Delete()
+    CBotVar** m_slots;
+    //! Number of slots used by the current frame
+    int m_slotCount;
+    //! Allocated size of m_slots
+    int m_slotCapacity;
 };
 
 } // namespace CBot
@@ -19,8 +19,11 @@
 
 #include "CBot/CBotToken.h"
 
+#include <array>
 #include <cstdarg>
 #include <cassert>
+#include <cstdint>
+#include <functional>
 #include <boost/bimap.hpp>
 
 namespace CBot
@@ -132,6 +135,71 @@ static const boost::bimap<TokenId, std::string> KEYWORDS = makeBimap<TokenId, st
     {TX_NAN,        "not a number"}
 });
 
+namespace
+{
+
+/**
+ * \brief Perfect hash table of the keywords
+ *
+ * The table is generated from KEYWORDS the first time it is used, by looking for
+ * a seed of the hash function which gives every keyword its own slot. Looking up
+ * a word then takes a single hash and at most one string comparison.
+ */
+class KeywordTable
+{
+public:
+    KeywordTable()
+    {
+        while (!Generate()) m_seed++;
+    }
+
+    int Find(const std::string& w) const
+    {
+        const Slot& slot = m_slots[Hash(w)];
+        if (slot.word != nullptr && *slot.word == w) return slot.id;
+        return -1;
+    }
+
+private:
+    bool Generate()
+    {
+        m_slots.fill(Slot());
+        for (const auto& keyword : KEYWORDS.left)
+        {
+            Slot& slot = m_slots[Hash(keyword.second)];
+            if (slot.word != nullptr) return false;
+            slot.word = &keyword.second;
+            slot.id = keyword.first;
+        }
+        return true;
+    }
+
+    std::size_t Hash(const std::string& w) const
+    {
+        // FNV-1a
+        std::uint32_t h = 2166136261u ^ m_seed;
+        for (char c : w)
+        {
+            h ^= static_cast<unsigned char>(c);
+            h *= 16777619u;
+        }
+        return (h ^ (h >> 16)) % SIZE;
+    }
+
+    struct Slot
+    {
+        const std::string* word = nullptr;
+        int id = -1;
+    };
+
+    //! Number of slots, about ten times the number of keywords so that a seed is found quickly
+    static const std::size_t SIZE = 1024;
+    std::array<Slot, SIZE> m_slots;
+    std::uint32_t m_seed = 0;
+};
+
+} // namespace
+
 namespace
 {
 static const std::string emptyString = "";
@@ -151,6 +219,9 @@ const std::string& LoadString(TokenId id)
 
 ////////////////////////////////////////////////////////////////////////////////
 std::map<std::string, long> CBotToken::m_defineNum;
+std::atomic<CBotToken::InternedName*> CBotToken::m_names[CBotToken::NAME_BUCKETS];
+int CBotToken::m_nameCount = 0;
+std::mutex CBotToken::m_namesMutex;
 ////////////////////////////////////////////////////////////////////////////////
 CBotToken::CBotToken()
 {
@@ -174,6 +245,7 @@ CBotToken::CBotToken(const CBotToken& pSrc)
 
     m_text      = pSrc.m_text;
     m_sep       = pSrc.m_sep;
+    m_nameId    = pSrc.m_nameId.load(std::memory_order_relaxed);
 
     m_start     = pSrc.m_start;
     m_end       = pSrc.m_end;
@@ -203,6 +275,7 @@ const CBotToken& CBotToken::operator=(const CBotToken& src)
 
     m_text      = src.m_text;
     m_sep       = src.m_sep;
+    m_nameId    = src.m_nameId.load(std::memory_order_relaxed);
 
     m_type      = src.m_type;
     m_keywordId = src.m_keywordId;
@@ -235,6 +308,43 @@ const std::string& CBotToken::GetString()
 void CBotToken::SetString(const std::string& name)
 {
     m_text = name;
+    m_nameId = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotToken::GetNameId()
+{
+    // the token may be shared by programs running on other threads, they would all find the same ID
+    int id = m_nameId.load(std::memory_order_relaxed);
+    if (id == 0)
+    {
+        id = InternName(m_text);
+        m_nameId.store(id, std::memory_order_relaxed);
+    }
+    return id;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotToken::InternName(const std::string& name)
+{
+    std::atomic<InternedName*>& bucket = m_names[std::hash<std::string>()(name) % NAME_BUCKETS];
+
+    // the strings are only ever added at the head of the buckets, so the ones already there can be read without locking
+    for (InternedName* p = bucket.load(std::memory_order_acquire); p != nullptr; p = p->next)
+    {
+        if (p->name == name) return p->id;
+    }
+
+    std::lock_guard<std::mutex> lock(m_namesMutex);
+    InternedName* head = bucket.load(std::memory_order_relaxed);
+    for (InternedName* p = head; p != nullptr; p = p->next)
+    {
+        if (p->name == name) return p->id;          // added by another thread in the meantime
+    }
+
+    InternedName* interned = new InternedName{name, ++m_nameCount, head};
+    bucket.store(interned, std::memory_order_release);
+    return interned->id;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -503,13 +613,8 @@ std::unique_ptr<CBotToken> CBotToken::CompileTokens(const std::string& program)
 ////////////////////////////////////////////////////////////////////////////////
 int CBotToken::GetKeyWord(const std::string& w)
 {
-    auto it = KEYWORDS.right.find(w);
-    if (it != KEYWORDS.right.end())
-    {
-        return it->second;
-    }
-
-    return -1;
+    static const KeywordTable table;
+    return table.Find(w);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -22,10 +22,12 @@
 #include "CBot/CBotEnums.h"
 #include "CBot/CBotUtils.h"
 
+#include <atomic>
 #include <vector>
 #include <string>
 #include <map>
 #include <memory>
+#include <mutex>
 
 namespace CBot
 {
@@ -128,6 +130,17 @@ public:
      */
     void SetString(const std::string& name);
 
+    /**
+     * \brief Return the interned ID of the token string
+     *
+     * Tokens with the same string always have the same ID, so names can be compared
+     * without comparing the strings. The ID is looked up the first time it is needed.
+     *
+     * \return ID of the string, never 0
+     * \see InternName()
+     */
+    int GetNameId();
+
     /**
      * \brief Return the beginning location of this token in the original program string
      */
@@ -163,6 +176,18 @@ public:
      */
     static std::unique_ptr<CBotToken> CompileTokens(const std::string& prog);
 
+    /**
+     * \brief Return the interned ID of a string
+     *
+     * IDs are never released, a string keeps its ID as long as the library is loaded.
+     * Looking up a string which already has an ID never locks.
+     *
+     * \param name The string
+     * \return ID of the string, never 0
+     * \see GetNameId()
+     */
+    static int InternName(const std::string& name);
+
     /**
      * \brief Define a new constant
      * \param name Name of the constant
@@ -197,6 +222,8 @@ private:
 
     //! The token string
     std::string m_text = "";
+    //! Interned ID of m_text, 0 if not looked up yet
+    std::atomic<int> m_nameId{0};
     //! The separator that appeared after this token
     std::string m_sep = "";
 
@@ -208,6 +235,22 @@ private:
     //! Map of all defined constants (see DefineNum())
     static std::map<std::string, long> m_defineNum;
 
+    //! Interned string, never changed nor deleted once added to m_names
+    struct InternedName
+    {
+        std::string name;
+        int id;
+        InternedName* next;
+    };
+    //! Number of buckets of m_names
+    static const std::size_t NAME_BUCKETS = 4096;
+    //! Interned strings by hash (see InternName()), read without locking
+    static std::atomic<InternedName*> m_names[NAME_BUCKETS];
+    //! Number of interned strings
+    static int m_nameCount;
+    //! Held while adding a string to m_names
+    static std::mutex m_namesMutex;
+
     /**
      * \brief Check if the word is a keyword
      * \param w The word to check
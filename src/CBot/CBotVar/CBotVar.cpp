@@ -51,7 +51,7 @@ namespace CBot
 {
 
 ////////////////////////////////////////////////////////////////////////////////
-long CBotVar::m_identcpt = 0;
+std::atomic<long> CBotVar::m_identcpt{9999}; // the first number is 10000
 
 ////////////////////////////////////////////////////////////////////////////////
 CBotVar::CBotVar( ) : m_token(nullptr)
@@ -63,6 +63,7 @@ CBotVar::CBotVar( ) : m_token(nullptr)
     m_type  = -1;
     m_binit = InitType::UNDEF;
     m_ident = 0;
+    m_frameSlot = -1;
     m_bStatic = false;
     m_mPrivate = ProtectionLevel::Public;
 }
@@ -76,6 +77,7 @@ CBotVar::CBotVar(const CBotToken &name) : m_token(new CBotToken(name))
     m_type  = -1;
     m_binit = InitType::UNDEF;
     m_ident = 0;
+    m_frameSlot = -1;
     m_bStatic = false;
     m_mPrivate = ProtectionLevel::Public;
 }
@@ -122,8 +124,7 @@ void CBotVar::SetUniqNum(long n)
 ////////////////////////////////////////////////////////////////////////////////
 long CBotVar::NextUniqNum()
 {
-    if (++m_identcpt < 10000) m_identcpt = 10000;
-    return m_identcpt;
+    return ++m_identcpt;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -414,6 +415,12 @@ const std::string& CBotVar::GetName()
     return    m_token->GetString();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+int CBotVar::GetNameId()
+{
+    return m_token->GetNameId();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void CBotVar::SetName(const std::string& name)
 {
@@ -517,7 +524,10 @@ void CBotVar::SetVal(CBotVar* var)
         SetValDouble(var->GetValDouble());
         break;
     case CBotTypString:
-        SetValString(var->GetValString());
+        if (m_type.Eq(CBotTypString))
+            static_cast<CBotVarString*>(this)->SetValSharedString(static_cast<CBotVarString*>(var)->GetValSharedString());
+        else
+            SetValString(var->GetValString());
         break;
     case CBotTypPointer:
     case CBotTypNullPointer:
@@ -528,6 +538,7 @@ void CBotVar::SetVal(CBotVar* var)
         {
             delete (static_cast<CBotVarClass*>(this))->m_pVar;
             (static_cast<CBotVarClass*>(this))->m_pVar = nullptr;
+            (static_cast<CBotVarClass*>(this))->m_items.clear();
             Copy(var, false);
         }
         break;
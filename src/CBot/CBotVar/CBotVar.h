@@ -24,6 +24,7 @@
 #include "CBot/CBotEnums.h"
 #include "CBot/CBotUtils.h"
 
+#include <atomic>
 #include <string>
 
 namespace CBot
@@ -172,6 +173,11 @@ public:
      */
     const std::string& GetName();
 
+    /**
+     * \brief Returns the interned ID of the name, see CBotToken::GetNameId()
+     */
+    int GetNameId();
+
     /**
      * \brief SetName Changes the name of the variable
      * \param name New name
@@ -708,9 +714,11 @@ protected:
      * \see GetUniqNum()
      */
     long m_ident;
+    //! Slot of the variable in the frame of its function call, -1 if none, see CBotStack::AddVar()
+    int m_frameSlot;
 
-    //! TODO: ?
-    static long m_identcpt;
+    //! Last number given by NextUniqNum()
+    static std::atomic<long> m_identcpt;
 
     friend class CBotStack;
     friend class CBotCStack;
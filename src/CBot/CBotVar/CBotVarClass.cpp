@@ -31,7 +31,10 @@ namespace CBot
 {
 
 ////////////////////////////////////////////////////////////////////////////////
-std::set<CBotVarClass*> CBotVarClass::m_instances{};
+std::unordered_multimap<long, CBotVarClass*> CBotVarClass::m_instances{};
+std::mutex CBotVarClass::m_instancesMutex;
+std::atomic<unsigned long> CBotVarClass::m_parallelBatch{0};
+unsigned long CBotVarClass::m_parallelBatchCount = 0;
 
 ////////////////////////////////////////////////////////////////////////////////
 CBotVarClass::CBotVarClass(const CBotToken& name, const CBotTypResult& type) : CBotVar(name)
@@ -55,15 +58,22 @@ CBotVarClass::CBotVarClass(const CBotToken& name, const CBotTypResult& type) : C
 
     m_pClass    = nullptr;
     m_pParent    = nullptr;
+    m_layout    = 0;
     m_binit        = InitType::UNDEF;
     m_bStatic    = false;
     m_mPrivate    = ProtectionLevel::Public;
     m_bConstructor = false;
     m_CptUse    = 0;
+    m_updateUser = nullptr;
+    m_updateGeneration = 0;
+    m_updateBatch = 0;
     m_ItemIdent = type.Eq(CBotTypIntrinsic) ? 0 : CBotVar::NextUniqNum();
 
     // add to the list
-    m_instances.insert(this);
+    {
+        std::lock_guard<std::mutex> lock(m_instancesMutex);
+        m_instances.emplace(m_ItemIdent, this);
+    }
 
     CBotClass* pClass = type.GetClass();
     if ( pClass != nullptr && pClass->GetParent() != nullptr )
@@ -86,7 +96,7 @@ CBotVarClass::~CBotVarClass( )
     m_pParent = nullptr;
 
     // removes the class list
-    m_instances.erase(this);
+    RemoveInstance();
 
     delete    m_pVar;
 }
@@ -106,6 +116,7 @@ void CBotVarClass::Copy(CBotVar* pSrc, bool bName)
         assert(0);
 
     CBotVarClass*    p = static_cast<CBotVarClass*>(pSrc);
+    p->UpdateItems();
 
     if (bName)    *m_token    = *p->m_token;
 
@@ -113,6 +124,7 @@ void CBotVarClass::Copy(CBotVar* pSrc, bool bName)
     m_binit        = p->m_binit;
 //-    m_bStatic    = p->m_bStatic;
     m_pClass    = p->m_pClass;
+    m_layout    = p->m_layout;
     if ( p->m_pParent )
     {
         assert(0);       // "que faire du pParent";
@@ -121,13 +133,16 @@ void CBotVarClass::Copy(CBotVar* pSrc, bool bName)
 //    m_next        = nullptr;
     m_pUserPtr    = p->m_pUserPtr;
     m_pMyThis    = nullptr;//p->m_pMyThis;
-    m_ItemIdent = p->m_ItemIdent;
+    SetItemIdent(p->m_ItemIdent);
+    m_updateGeneration = 0;                     // the copied elements are up to date
 
     // keeps indentificator the same (by default)
     if (m_ident == 0 ) m_ident     = p->m_ident;
 
     delete        m_pVar;
     m_pVar        = nullptr;
+    m_items.clear();
+    m_itemGeneration.clear();
 
     CBotVar*    pv = p->m_pVar;
     while( pv != nullptr )
@@ -144,7 +159,41 @@ void CBotVarClass::Copy(CBotVar* pSrc, bool bName)
 ////////////////////////////////////////////////////////////////////////////////
 void CBotVarClass::SetIdent(long n)
 {
+    SetItemIdent(n);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotVarClass::SetItemIdent(long n)
+{
+    if ( m_ItemIdent == n ) return;
+
+    std::lock_guard<std::mutex> lock(m_instancesMutex);
+    auto range = m_instances.equal_range(m_ItemIdent);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (it->second == this)
+        {
+            m_instances.erase(it);
+            break;
+        }
+    }
     m_ItemIdent = n;
+    m_instances.emplace(m_ItemIdent, this);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotVarClass::RemoveInstance()
+{
+    std::lock_guard<std::mutex> lock(m_instancesMutex);
+    auto range = m_instances.equal_range(m_ItemIdent);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (it->second == this)
+        {
+            m_instances.erase(it);
+            return;
+        }
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -155,10 +204,13 @@ void CBotVarClass::SetClass(CBotClass* pClass)//, int &nIdent)
     if ( m_pClass == pClass ) return;
 
     m_pClass = pClass;
+    m_layout = pClass == nullptr ? 0 : pClass->GetLayout();
 
     // initializes the variables associated with this class
     delete m_pVar;
     m_pVar = nullptr;
+    m_items.clear();
+    m_itemGeneration.clear();
 
     if (pClass == nullptr) return;
 
@@ -232,17 +284,100 @@ void CBotVarClass::Update(void* pUser)
     if ( m_pUserPtr != nullptr) pUser = m_pUserPtr;
     if ( pUser == OBJECTDELETED ||
          pUser == OBJECTCREATED ) return;
+
+    std::unique_lock<std::recursive_mutex> lock = LockUpdate();
+
+    // other programs of the batch may be reading the elements refreshed earlier
+    unsigned long batch = m_parallelBatch.load(std::memory_order_relaxed);
+    if ( batch != 0 && m_updateBatch == batch ) return;
+    m_updateBatch = batch;
+
+    if ( m_pClass->IsUpdatedByItem() )
+    {
+        // elements are refreshed when they are read, see UpdateItem()
+        m_updateUser = pUser;
+        m_updateGeneration++;
+        return;
+    }
+
     m_pClass->Update(this, pUser);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void CBotVarClass::UpdateItem(CBotVar* item)
+{
+    if ( m_updateGeneration == 0 ) return;            // never updated
+
+    std::unique_lock<std::recursive_mutex> lock = LockUpdate();
+
+    void* pUser = GetUpdateUser();
+    if ( pUser == nullptr ) return;
+
+    std::size_t i = 0;
+    for ( CBotVar* p = m_pVar; p != nullptr; p = p->m_next, i++ )
+    {
+        if ( p != item ) continue;
+
+        if ( m_itemGeneration.size() <= i ) m_itemGeneration.resize(i + 1, 0);
+        if ( m_itemGeneration[i] == m_updateGeneration ) return;    // still up to date
+
+        m_itemGeneration[i] = m_updateGeneration;
+        m_pClass->UpdateItem(this, item, pUser);
+        return;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotVarClass::UpdateItems()
+{
+    if ( m_updateGeneration == 0 ) return;            // never updated
+
+    std::unique_lock<std::recursive_mutex> lock = LockUpdate();
+
+    void* pUser = GetUpdateUser();
+    if ( pUser == nullptr ) return;
+
+    std::size_t i = 0;
+    for ( CBotVar* p = m_pVar; p != nullptr; p = p->m_next, i++ )
+    {
+        if ( m_itemGeneration.size() <= i ) m_itemGeneration.resize(i + 1, 0);
+        if ( m_itemGeneration[i] == m_updateGeneration ) continue;
+
+        m_itemGeneration[i] = m_updateGeneration;
+        m_pClass->UpdateItem(this, p, pUser);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::unique_lock<std::recursive_mutex> CBotVarClass::LockUpdate()
+{
+    std::unique_lock<std::recursive_mutex> lock(m_updateMutex, std::defer_lock);
+    if ( m_parallelBatch.load(std::memory_order_relaxed) != 0 ) lock.lock();
+    return lock;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void* CBotVarClass::GetUpdateUser()
+{
+    if ( m_pUserPtr == nullptr ) return m_updateUser;
+    if ( m_pUserPtr == OBJECTDELETED ||
+         m_pUserPtr == OBJECTCREATED ) return nullptr;
+    return m_pUserPtr;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 CBotVar* CBotVarClass::GetItem(const std::string& name)
 {
     CBotVar*    p = m_pVar;
+    int         nameId = CBotToken::InternName(name);
 
     while ( p != nullptr )
     {
-        if ( p->GetName() == name ) return p;
+        if ( p->GetNameId() == nameId )
+        {
+            UpdateItem(p);
+            return p;
+        }
         p = p->GetNext();
     }
 
@@ -266,39 +401,72 @@ CBotVar* CBotVarClass::GetItemRef(int nIdent)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-CBotVar* CBotVarClass::GetItem(int n, bool bExtend)
+CBotVar* CBotVarClass::GetItemRef(int nIdent, CBotInlineCache<int>& cache)
 {
-    CBotVar*    p = m_pVar;
+    // the position is the depth in the parent instances and the index in m_pVar
+    int position;
+    if ( cache.Find(m_layout, position) )
+    {
+        CBotVarClass* instance = this;
+        for ( int depth = position >> 16; depth > 0 && instance != nullptr; depth-- )
+            instance = instance->m_pParent;
+
+        if ( instance != nullptr )
+        {
+            CBotVar* p = instance->GetItem(position & 0xFFFF, false);
+            if ( p != nullptr && p->GetUniqNum() == nIdent ) return p;
+        }
+    }
 
+    int depth = 0;
+    for ( CBotVarClass* instance = this; instance != nullptr; instance = instance->m_pParent, depth++ )
+    {
+        int index = 0;
+        for ( CBotVar* p = instance->m_pVar; p != nullptr; p = p->GetNext(), index++ )
+        {
+            if ( p->GetUniqNum() == nIdent )
+            {
+                cache.Store(m_layout, (depth << 16) | index);
+                return p;
+            }
+        }
+    }
+    return nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CBotVar* CBotVarClass::GetItem(int n, bool bExtend)
+{
     if ( n < 0 ) return nullptr;
     if ( n > MAXARRAYSIZE ) return nullptr;
 
     if ( m_type.GetLimite() >= 0 && n >= m_type.GetLimite() ) return nullptr;
 
-    if ( p == nullptr && bExtend )
+    // elements restored by CBotVar::RestoreState() are not indexed yet
+    if ( m_items.empty() && m_pVar != nullptr )
     {
-        p = CBotVar::Create("", m_type.GetTypElem());
-        m_pVar = p;
+        for ( CBotVar* p = m_pVar; p != nullptr; p = p->m_next ) m_items.push_back(p);
     }
 
-    if ( n == 0 ) return p;
+    if ( n < static_cast<int>(m_items.size()) ) return m_items[n];
+    if ( !bExtend ) return nullptr;
 
-    while ( n-- > 0 )
+    // the elements stay chained in m_pVar for GetItemList() and SaveState()
+    while ( static_cast<int>(m_items.size()) <= n )
     {
-        if ( p->m_next == nullptr )
-        {
-            if ( bExtend ) p->m_next = CBotVar::Create("", m_type.GetTypElem());
-            if ( p->m_next == nullptr ) return nullptr;
-        }
-        p = p->m_next;
+        CBotVar*    p = CBotVar::Create("", m_type.GetTypElem());
+        if ( m_items.empty() ) m_pVar = p;
+        else m_items.back()->m_next = p;
+        m_items.push_back(p);
     }
 
-    return p;
+    return m_items[n];
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 CBotVar* CBotVarClass::GetItemList()
 {
+    UpdateItems();
     return m_pVar;
 }
 
@@ -307,6 +475,8 @@ std::string CBotVarClass::GetValString()
 {
     std::string    res;
 
+    UpdateItems();
+
     if ( m_pClass != nullptr )                        // not used for an array
     {
         res = m_pClass->GetName() + std::string("( ");
@@ -369,8 +539,7 @@ void CBotVarClass::IncrementUse()
 ////////////////////////////////////////////////////////////////////////////////
 void CBotVarClass::DecrementUse()
 {
-    m_CptUse--;
-    if ( m_CptUse == 0 )
+    if ( --m_CptUse == 0 )
     {
         // if there is one, call the destructor
         // but only if a constructor had been called.
@@ -378,14 +547,7 @@ void CBotVarClass::DecrementUse()
         {
             m_CptUse++;    // does not return to the destructor
 
-            // m_error is static in the stack
-            // saves the value for return
-            CBotError err;
-            int start, end;
-            CBotStack*    pile = nullptr;
-            err = pile->GetError(start,end);    // stack == nullptr it does not bother!
-
-            pile = CBotStack::AllocateStack();        // clears the error
+            CBotStack*    pile = CBotStack::AllocateStack();    // an independent stack, with its own error
             CBotVar*    ppVars[1];
             ppVars[0] = nullptr;
 
@@ -399,8 +561,6 @@ void CBotVarClass::DecrementUse()
 
             while ( pile->IsOk() && !m_pClass->ExecuteMethode(ident, pThis, ppVars, CBotTypResult(CBotTypVoid), pile, &token)) ;    // waits for the end
 
-            pile->ResetError(err, start,end);
-
             pile->Delete();
             delete pThis;
             m_CptUse--;
@@ -419,12 +579,24 @@ CBotVarClass* CBotVarClass::GetPointer()
 ////////////////////////////////////////////////////////////////////////////////
 CBotVarClass* CBotVarClass::Find(long id)
 {
-    for (CBotVarClass* p : m_instances)
-    {
-        if (p->m_ItemIdent == id) return p;
-    }
+    std::lock_guard<std::mutex> lock(m_instancesMutex);
+    auto it = m_instances.find(id);
+    if (it == m_instances.end()) return nullptr;
+    return it->second;
+}
 
-    return nullptr;
+////////////////////////////////////////////////////////////////////////////////
+std::size_t CBotVarClass::GetInstanceCount()
+{
+    std::lock_guard<std::mutex> lock(m_instancesMutex);
+    return m_instances.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotVarClass::SetRunningInParallel(bool running)
+{
+    // called between two batches, while no program runs
+    m_parallelBatch = running ? ++m_parallelBatchCount : 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -467,6 +639,7 @@ bool CBotVarClass::Save1State(std::ostream &ostr)
     if (!WriteType(ostr, m_type)) return false;
     if (!WriteLong(ostr, m_ItemIdent)) return false;
 
+    UpdateItems();
     return SaveVars(ostr, m_pVar);                              // content of the object
 }
 
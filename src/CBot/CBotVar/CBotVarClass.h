@@ -20,8 +20,12 @@
 #pragma once
 
 #include "CBot/CBotVar/CBotVar.h"
+#include "CBot/CBotInlineCache.h"
 
-#include <set>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace CBot
 {
@@ -51,6 +55,17 @@ public:
     CBotVar* GetItem(const std::string& name) override;
     CBotVar* GetItemRef(int nIdent) override;
     CBotVar* GetItem(int n, bool bExtend) override;
+
+    /**
+     * \brief Finds a member by its unique identifier, remembering where it was found
+     *
+     * Same as GetItemRef(int), but skips the search when this instance has the same
+     * layout as one the instruction has already seen (see CBotClass::GetLayout()).
+     * \param nIdent Unique identifier of the member
+     * \param cache Inline cache of the instruction, stores the position of the member
+     * \return The member, or nullptr if not found
+     */
+    CBotVar* GetItemRef(int nIdent, CBotInlineCache<int>& cache);
     CBotVar* GetItemList() override;
     std::string GetValString() override;
 
@@ -58,6 +73,15 @@ public:
 
     void Update(void* pUser) override;
 
+    /**
+     * \brief Refreshes a single element if it is out of date
+     *
+     * Only does something for classes which update their elements one by one,
+     * see CBotClass::SetUpdateItemFunc()
+     * \param item Element of this instance
+     */
+    void UpdateItem(CBotVar* item);
+
     //! \name Reference counter
     //@{
 
@@ -87,6 +111,23 @@ public:
      */
     static CBotVarClass* Find(long id);
 
+    /*!
+     * \brief Number of class instances currently alive
+     */
+    static std::size_t GetInstanceCount();
+
+    /**
+     * \brief Marks the start or the end of a batch of programs running in parallel
+     *
+     * During a batch, Update() refreshes an instance at most once, so the elements of an
+     * instance of the host application read by several programs are never written while
+     * another program may be reading them. The refresh of an instance is guarded by its own
+     * lock, which is only taken during a batch. Called by CBotWorkerPool::Run().
+     *
+     * \param running true when the batch starts, false when all its programs stopped
+     */
+    static void SetRunningInParallel(bool running);
+
     //@}
 
     bool Eq(CBotVar* left, CBotVar* right) override;
@@ -95,20 +136,69 @@ public:
     void ConstructorSet() override;
 
 private:
-    //! List of all class instances - first
-    static std::set<CBotVarClass*> m_instances;
+    //! All class instances, by unique identifier
+    static std::unordered_multimap<long, CBotVarClass*> m_instances;
+    //! Guards m_instances, instances are created by programs running in parallel
+    static std::mutex m_instancesMutex;
     //! Class definition
     CBotClass* m_pClass;
     //! Parent class instance
     CBotVarClass* m_pParent;
     //! Class members
     CBotVar* m_pVar;
-    //! Reference counter
-    int m_CptUse;
+    //! Array elements or class members by index, same order as m_pVar
+    std::vector<CBotVar*> m_items;
+    //! Layout of m_pClass the members were created from, see CBotClass::GetLayout()
+    uint32_t m_layout;
+    //! Reference counter, instances of the host application are used by programs running in parallel
+    std::atomic<int> m_CptUse;
     //! Identifier (unique) of an instance
     long m_ItemIdent;
     //! Set after constructor is called, allows destructor to be called
     bool m_bConstructor;
+    //! User pointer given to the last Update(), used to refresh the elements
+    void* m_updateUser;
+    //! Incremented by Update(), elements refreshed in an older generation are out of date
+    std::atomic<unsigned long> m_updateGeneration;
+    //! Batch of programs running in parallel during the last Update(), see SetRunningInParallel()
+    unsigned long m_updateBatch;
+    //! Current batch of programs running in parallel, 0 if none
+    static std::atomic<unsigned long> m_parallelBatch;
+    //! Number of batches started so far
+    static unsigned long m_parallelBatchCount;
+    //! Generation in which each element was last refreshed, same order as m_pVar
+    std::vector<unsigned long> m_itemGeneration;
+    //! Guards the refresh of the elements while programs run in parallel, see LockUpdate()
+    std::recursive_mutex m_updateMutex;
+
+    /**
+     * \brief Locks m_updateMutex if a batch of programs running in parallel is in progress
+     */
+    std::unique_lock<std::recursive_mutex> LockUpdate();
+
+    /**
+     * \brief Refreshes all elements which are out of date
+     */
+    void UpdateItems();
+
+    /**
+     * \brief Returns the user pointer to refresh the elements with
+     *
+     * The user pointer of the instance is checked again, as the object may
+     * have been deleted since the last Update()
+     * \return nullptr if the elements must not be refreshed
+     */
+    void* GetUpdateUser();
+
+    /**
+     * \brief Changes the unique identifier, keeping m_instances up to date
+     */
+    void SetItemIdent(long n);
+
+    /**
+     * \brief Removes this instance from m_instances
+     */
+    void RemoveInstance();
 
     friend class CBotVar;
     friend class CBotVarPointer;
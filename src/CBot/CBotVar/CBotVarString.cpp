@@ -19,27 +19,106 @@
 
 #include "CBot/CBotVar/CBotVarString.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace CBot
 {
 
+////////////////////////////////////////////////////////////////////////////////
+CBotSharedString::CBotSharedString(std::string str)
+    : m_data(std::make_shared<std::string>(std::move(str)))
+    , m_start(0)
+    , m_length(m_data->length())
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CBotSharedString CBotSharedString::Substr(std::size_t start, std::size_t length) const
+{
+    CBotSharedString res = *this;
+    start = std::min(start, m_length);
+    res.m_start = m_start + start;
+    res.m_length = std::min(length, m_length - start);
+    return res;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t CBotSharedString::Find(const CBotSharedString& str) const
+{
+    const char* begin = Data();
+    const char* end = begin + m_length;
+    const char* it = std::search(begin, end, str.Data(), str.Data() + str.m_length);
+    if (it == end && str.m_length > 0) return std::string::npos;
+    return it - begin;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotSharedString::operator==(const CBotSharedString& other) const
+{
+    if (m_length != other.m_length) return false;
+    if (m_data == other.m_data && m_start == other.m_start) return true;
+    return memcmp(Data(), other.Data(), m_length) == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotVarString::Copy(CBotVar* pSrc, bool bName)
+{
+    CBotVar::Copy(pSrc, bName);
+
+    CBotVarString* p = static_cast<CBotVarString*>(pSrc);
+    m_val = p->m_val;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CBotSharedString CBotVarString::GetValSharedString()
+{
+    if (m_binit == CBotVar::InitType::UNDEF)
+        return CBotSharedString(LoadString(TX_UNDEF));
+    if (m_binit == CBotVar::InitType::IS_NAN)
+        return CBotSharedString(LoadString(TX_NAN));
+
+    return m_val;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CBotSharedString CBotVarString::GetSharedString(CBotVar* var)
+{
+    if (var->GetType() == CBotTypString)
+        return static_cast<CBotVarString*>(var)->GetValSharedString();
+
+    return CBotSharedString(var->GetValString());
+}
+
+////////////////////////////////////////////////////////////////////////////////
 void CBotVarString::Add(CBotVar* left, CBotVar* right)
 {
-    SetValString(left->GetValString() + right->GetValString());
+    CBotSharedString l = GetSharedString(left);
+    CBotSharedString r = GetSharedString(right);
+
+    std::string res;
+    res.reserve(l.Length() + r.Length());
+    res.append(l.Data(), l.Length());
+    res.append(r.Data(), r.Length());
+    SetValString(std::move(res));
 }
 
+////////////////////////////////////////////////////////////////////////////////
 bool CBotVarString::Eq(CBotVar* left, CBotVar* right)
 {
-    return left->GetValString() == right->GetValString();
+    return GetSharedString(left) == GetSharedString(right);
 }
 
+////////////////////////////////////////////////////////////////////////////////
 bool CBotVarString::Ne(CBotVar* left, CBotVar* right)
 {
-    return left->GetValString() != right->GetValString();
+    return GetSharedString(left) != GetSharedString(right);
 }
 
+////////////////////////////////////////////////////////////////////////////////
 bool CBotVarString::Save1State(std::ostream &ostr)
 {
-    return WriteString(ostr, m_val);
+    return WriteString(ostr, m_val.ToString());
 }
 
 } // namespace CBot
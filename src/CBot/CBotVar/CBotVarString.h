@@ -21,23 +21,99 @@
 
 #include "CBot/CBotVar/CBotVarValue.h"
 
+#include <memory>
+
 namespace CBot
 {
 
+/**
+ * \brief Immutable string which can be shared by many variables
+ *
+ * Copying a CBotSharedString only copies a reference to the characters, and
+ * Substr() returns a view on the same characters, so passing strings around
+ * and cutting them with strleft(), strmid() and strright() doesn't allocate.
+ * The characters are never modified, a new string is made instead.
+ */
+class CBotSharedString
+{
+public:
+    CBotSharedString() = default;
+
+    /**
+     * \brief Constructor, takes the characters of the given string
+     */
+    explicit CBotSharedString(std::string str);
+
+    /**
+     * \brief Part of this string, sharing its characters
+     * \param start Index of the first character, must not be greater than Length()
+     * \param length Maximum number of characters
+     */
+    CBotSharedString Substr(std::size_t start, std::size_t length = std::string::npos) const;
+
+    /**
+     * \brief Index of the first occurrence of the given string, or std::string::npos
+     */
+    std::size_t Find(const CBotSharedString& str) const;
+
+    std::size_t Length() const { return m_length; }
+    const char* Data() const { return m_data == nullptr ? "" : m_data->data() + m_start; }
+
+    /**
+     * \brief Copies the characters into a std::string
+     */
+    std::string ToString() const { return std::string(Data(), m_length); }
+
+    bool operator==(const CBotSharedString& other) const;
+    bool operator!=(const CBotSharedString& other) const { return !(*this == other); }
+
+private:
+    std::shared_ptr<const std::string> m_data;
+    std::size_t m_start = 0;
+    std::size_t m_length = 0;
+};
+
 /**
  * \brief CBotVar subclass for managing string values (::CBotTypString)
+ *
+ * The value is a CBotSharedString, copying a string variable doesn't copy its characters.
  */
-class CBotVarString : public CBotVarValue<std::string, CBotTypString>
+class CBotVarString : public CBotVar
 {
 public:
-    CBotVarString(const CBotToken &name) : CBotVarValue(name) {}
+    CBotVarString(const CBotToken &name) : CBotVar(name)
+    {
+        m_type = CBotTypString;
+    }
+
+    void Copy(CBotVar* pSrc, bool bName = true) override;
 
     void SetValString(const std::string& val) override
+    {
+        SetValSharedString(CBotSharedString(val));
+    }
+
+    /**
+     * \brief Sets the value without copying the characters
+     */
+    void SetValSharedString(const CBotSharedString& val)
     {
         m_val = val;
         m_binit = CBotVar::InitType::DEF;
     }
 
+    std::string GetValString() override
+    {
+        return GetValSharedString().ToString();
+    }
+
+    /**
+     * \brief Gets the value without copying the characters
+     *
+     * Like GetValString(), gives a text for undefined and NaN values.
+     */
+    CBotSharedString GetValSharedString();
+
     void SetValInt(int val, const std::string& s = "") override
     {
         SetValString(ToString(val));
@@ -65,6 +141,11 @@ public:
 
     bool Save1State(std::ostream &ostr) override;
 
+    /**
+     * \brief Gets the value of any variable as a shared string, without copying the characters of string variables
+     */
+    static CBotSharedString GetSharedString(CBotVar* var);
+
 private:
     template<typename T>
     static std::string ToString(T val)
@@ -82,6 +163,10 @@ private:
         ss >> v;
         return v;
     }
+
+private:
+    //! The value
+    CBotSharedString m_val;
 };
 
 } // namespace CBot
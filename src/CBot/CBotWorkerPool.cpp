@@ -0,0 +1,132 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+
+#include "CBot/CBotWorkerPool.h"
+
+#include "CBot/CBotProgram.h"
+#include "CBot/CBotStack.h"
+#include "CBot/CBotVar/CBotVarClass.h"
+
+namespace CBot
+{
+
+thread_local bool CBotWorkerPool::m_runningSlice = false;
+
+CBotWorkerPool::CBotWorkerPool(int threadCount)
+{
+    if (threadCount <= 0)
+    {
+        // hardware_concurrency() may return 0 if unknown
+        threadCount = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+        if (threadCount < 1) threadCount = 1;
+    }
+
+    for (int i = 0; i < threadCount; i++)
+        m_threads.emplace_back(&CBotWorkerPool::WorkerLoop, this);
+}
+
+CBotWorkerPool::~CBotWorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (std::thread& thread : m_threads)
+        thread.join();
+}
+
+int CBotWorkerPool::GetThreadCount()
+{
+    return static_cast<int>(m_threads.size());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotWorkerPool::Run(std::vector<Slice>& slices)
+{
+    if (slices.empty()) return;
+
+    CBotVarClass::SetRunningInParallel(true);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_slices = &slices;
+        m_next = 0;
+        m_batch++;
+    }
+    m_wake.notify_all();
+
+    RunSlices(slices);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_busy == 0; });
+    m_slices = nullptr;                 // threads waking up late don't join anymore
+    lock.unlock();
+
+    CBotVarClass::SetRunningInParallel(false);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotWorkerPool::WorkerLoop()
+{
+    unsigned int batch = 0;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_wake.wait(lock, [&] { return m_stop || (m_slices != nullptr && m_batch != batch); });
+        if (m_stop) break;
+
+        batch = m_batch;
+        std::vector<Slice>& slices = *m_slices;
+        m_busy++;
+        lock.unlock();
+
+        RunSlices(slices);
+
+        lock.lock();
+        if (--m_busy == 0) m_done.notify_all();
+    }
+    lock.unlock();
+
+    // the stacks kept for reuse belong to this thread
+    CBotStack::ClearPool();
+}
+
+bool CBotWorkerPool::IsRunningSlice()
+{
+    return m_runningSlice;
+}
+
+void CBotWorkerPool::RunSlices(std::vector<Slice>& slices)
+{
+    m_runningSlice = true;
+
+    std::size_t i;
+    while ((i = m_next++) < slices.size())
+    {
+        Slice& slice = slices[i];
+        slice.finished = slice.program->Run(slice.user, slice.timer);
+    }
+
+    m_runningSlice = false;
+}
+
+} // namespace CBot
@@ -0,0 +1,128 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace CBot
+{
+
+class CBotProgram;
+
+/**
+ * \brief Threads running CBotProgram::Run() of several programs at the same time
+ *
+ * Each program has its own stack, error state and instruction budget, so independent programs can
+ * execute in parallel. Only the thread safe calls to the host application run during a batch, a program
+ * reaching any other call stops there and makes it on its next call to CBotProgram::Run(), after the batch
+ * (see CBotExternalCall::IsThreadSafe()). The instances updated by the host application may be shared, they
+ * are refreshed at most once per batch (see CBotVarClass::SetRunningInParallel()). Everything else a program
+ * does must not be shared with the other programs of the same batch (for example instances of a public class
+ * used by several programs).
+ *
+ * \code
+ * CBotWorkerPool pool;
+ * std::vector<CBotWorkerPool::Slice> slices;
+ * for (CBotProgram* program : programs)
+ *     slices.push_back({program, user, 100, false});
+ * pool.Run(slices);
+ * \endcode
+ */
+class CBotWorkerPool
+{
+public:
+    /**
+     * \brief One call to CBotProgram::Run()
+     */
+    struct Slice
+    {
+        CBotProgram* program;
+        //! User pointer for the external functions
+        void* user;
+        //! Number of steps to execute, see CBotProgram::SetTimer()
+        int timer;
+        //! Result of the call, true if the program finished
+        bool finished;
+    };
+
+    /**
+     * \brief Returns true if the calling thread is running a slice of a batch
+     */
+    static bool IsRunningSlice();
+
+    /**
+     * \brief Constructor
+     * \param threadCount Number of threads besides the calling one, 0 to use all processors
+     */
+    CBotWorkerPool(int threadCount = 0);
+
+    /**
+     * \brief Destructor, waits for the threads to finish
+     */
+    ~CBotWorkerPool();
+
+    CBotWorkerPool(const CBotWorkerPool&) = delete;
+    CBotWorkerPool& operator=(const CBotWorkerPool&) = delete;
+
+    /**
+     * \brief Returns the number of threads besides the calling one
+     */
+    int GetThreadCount();
+
+    /**
+     * \brief Runs all the slices and waits until they are done
+     *
+     * The calling thread runs slices as well. A program may appear only once in the list.
+     *
+     * \param slices Slices to run, Slice::finished is set on return
+     */
+    void Run(std::vector<Slice>& slices);
+
+private:
+    void WorkerLoop();
+    void RunSlices(std::vector<Slice>& slices);
+
+private:
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    //! Signals a new batch or the end of the pool
+    std::condition_variable m_wake;
+    //! Signals that the last busy thread finished its part of the batch
+    std::condition_variable m_done;
+    //! Current batch, nullptr between calls to Run()
+    std::vector<Slice>* m_slices = nullptr;
+    //! Incremented for every batch, so a thread never joins the same batch twice
+    unsigned int m_batch = 0;
+    //! Number of worker threads running slices of the current batch
+    int m_busy = 0;
+    //! Next slice to run
+    std::atomic<std::size_t> m_next{0};
+    bool m_stop = false;
+
+    //! Set while this thread runs slices, see IsRunningSlice()
+    static thread_local bool m_runningSlice;
+};
+
+} // namespace CBot
@@ -21,6 +21,9 @@
 
 #include "CBot/CBot.h"
 
+#include "CBot/CBotVar/CBotVarString.h"
+
+#include <algorithm>
 #include <memory>
 #include <unordered_map>
 #include <cassert>
@@ -179,6 +182,23 @@ CBotTypResult cfopen (CBotVar* pThis, CBotVar* &pVar)
 }
 
 
+// finds the file opened by the object
+CBotFile* GetOpenedFile(CBotVar* pThis, int& Exception)
+{
+    CBotVar* pVar = pThis->GetItem("handle");
+
+    if ( !pVar->IsDefined()) { Exception = CBotErrNotOpen; return nullptr; }
+
+    const auto handleIter = g_files.find(pVar->GetValInt());
+    if (handleIter == g_files.end())
+    {
+        Exception = CBotErrNotOpen;
+        return nullptr;
+    }
+
+    return handleIter->second.get();
+}
+
 // process FILE :: close
 
 // execution
@@ -187,21 +207,11 @@ bool rfclose (CBotVar* pThis, CBotVar* pVar, CBotVar* pResult, int& Exception, v
     // it shouldn't be any parameters
     if (pVar != nullptr) { Exception = CBotErrOverParam; return false; }
 
+    if (GetOpenedFile(pThis, Exception) == nullptr) return false;
+
     // retrieve the item "handle"
     pVar = pThis->GetItem("handle");
-
-    if (!pVar->IsDefined()) { Exception = CBotErrNotOpen; return false; }
-
-    int fileHandle = pVar->GetValInt();
-
-    const auto handleIter = g_files.find(fileHandle);
-    if (handleIter == g_files.end())
-    {
-        Exception = CBotErrNotOpen;
-        return false;
-    }
-
-    g_files.erase(handleIter);
+    g_files.erase(pVar->GetValInt());
 
     pVar->SetInit(CBotVar::InitType::IS_NAN);
     return true;
@@ -230,24 +240,14 @@ bool rfwrite (CBotVar* pThis, CBotVar* pVar, CBotVar* pResult, int& Exception, v
 
     std::string param = pVar->GetValString();
 
-    // retrieve the item "handle"
-    pVar = pThis->GetItem("handle");
-
-    if ( !pVar->IsDefined()) { Exception = CBotErrNotOpen; return false; }
+    CBotFile* file = GetOpenedFile(pThis, Exception);
+    if (file == nullptr) return false;
 
-    int fileHandle = pVar->GetValInt();
-
-    const auto handleIter = g_files.find(fileHandle);
-    if (handleIter == g_files.end())
-    {
-        Exception = CBotErrNotOpen;
-        return false;
-    }
-
-    handleIter->second->Write(param + "\n");
+    file->Write(param);
+    file->Write("\n");
 
     // if an error occurs generate an exception
-    if ( handleIter->second->Errored() ) { Exception = CBotErrWrite; return false; }
+    if ( file->Errored() ) { Exception = CBotErrWrite; return false; }
 
     return true;
 }
@@ -276,24 +276,13 @@ bool rfread(CBotVar* pThis, CBotVar* pVar, CBotVar* pResult, int& Exception, voi
     // it shouldn't be any parameters
     if (pVar != nullptr) { Exception = CBotErrOverParam; return false; }
 
-    // retrieve the item "handle"
-    pVar = pThis->GetItem("handle");
+    CBotFile* file = GetOpenedFile(pThis, Exception);
+    if (file == nullptr) return false;
 
-    if (!pVar->IsDefined()) { Exception = CBotErrNotOpen; return false; }
-
-    int fileHandle = pVar->GetValInt();
-
-    const auto handleIter = g_files.find(fileHandle);
-    if (handleIter == g_files.end())
-    {
-        Exception = CBotErrNotOpen;
-        return false;
-    }
-
-    std::string line = handleIter->second->ReadLine();
+    std::string line = file->ReadLine();
 
     // if an error occurs generate an exception
-    if ( handleIter->second->Errored() ) { Exception = CBotErrRead; return false; }
+    if ( file->Errored() ) { Exception = CBotErrRead; return false; }
 
     pResult->SetValString( line.c_str() );
 
@@ -318,33 +307,151 @@ bool rfeof (CBotVar* pThis, CBotVar* pVar, CBotVar* pResult, int& Exception, voi
     // it should not be any parameter
     if ( pVar != nullptr ) { Exception = CBotErrOverParam; return false; }
 
-    // retrieve the item "handle"
-    pVar = pThis->GetItem("handle");
+    CBotFile* file = GetOpenedFile(pThis, Exception);
+    if (file == nullptr) return false;
 
-    if ( !pVar->IsDefined()) { Exception = CBotErrNotOpen; return false; }
+    pResult->SetValInt( file->IsEOF() );
 
-    int fileHandle = pVar->GetValInt();
+    return true;
+}
 
-    const auto handleIter = g_files.find(fileHandle);
-    if (handleIter == g_files.end())
+// compilation
+CBotTypResult cfeof (CBotVar* pThis, CBotVar* &pVar)
+{
+    // it shouldn't be any parameter
+    if ( pVar != nullptr ) return CBotTypResult( CBotErrOverParam );
+
+    // the function returns a boolean result
+    return CBotTypResult( CBotTypBoolean );
+}
+
+// process FILE :: flush
+
+// execution
+bool rfflush (CBotVar* pThis, CBotVar* pVar, CBotVar* pResult, int& Exception, void* user)
+{
+    // it shouldn't be any parameters
+    if (pVar != nullptr) { Exception = CBotErrOverParam; return false; }
+
+    CBotFile* file = GetOpenedFile(pThis, Exception);
+    if (file == nullptr) return false;
+
+    file->Flush();
+
+    // if an error occurs generate an exception
+    if ( file->Errored() ) { Exception = CBotErrWrite; return false; }
+
+    return true;
+}
+
+// process FILE :: writelines
+
+// execution
+bool rfwritelines (CBotVar* pThis, CBotVar* pVar, CBotVar* pResult, int& Exception, void* user)
+{
+    // there must be a parameter
+    if ( pVar == nullptr ) { Exception = CBotErrLowParam; return false; }
+
+    CBotFile* file = GetOpenedFile(pThis, Exception);
+    if (file == nullptr) return false;
+
+    // all the lines are written in a single call
+    std::string lines;
+    for ( CBotVar* pLine = pVar->GetItemList(); pLine != nullptr; pLine = pLine->GetNext() )
     {
-        Exception = CBotErrNotOpen;
-        return false;
+        CBotSharedString line = CBotVarString::GetSharedString(pLine);
+        lines.append(line.Data(), line.Length());
+        lines += '\n';
     }
+    file->Write(lines);
 
-    pResult->SetValInt( handleIter->second->IsEOF() );
+    // if an error occurs generate an exception
+    if ( file->Errored() ) { Exception = CBotErrWrite; return false; }
 
     return true;
 }
 
 // compilation
-CBotTypResult cfeof (CBotVar* pThis, CBotVar* &pVar)
+CBotTypResult cfwritelines (CBotVar* pThis, CBotVar* &pVar)
 {
-    // it shouldn't be any parameter
+    // there must be a parameter
+    if ( pVar == nullptr ) return CBotTypResult( CBotErrLowParam );
+
+    // which must be an array of strings
+    if ( pVar->GetType() != CBotTypArrayPointer ||
+         pVar->GetTypResult().GetTypElem().GetType() != CBotTypString ) return CBotTypResult( CBotErrBadParam );
+
+    // no other parameter
+    if ( pVar->GetNext() != nullptr ) return CBotTypResult( CBotErrOverParam );
+
+    // the function returns a void result
+    return CBotTypResult( 0 );
+}
+
+// process FILE :: readall
+
+// execution
+bool rfreadall (CBotVar* pThis, CBotVar* pVar, CBotVar* pResult, int& Exception, void* user)
+{
+    // it shouldn't be any parameters
+    if (pVar != nullptr) { Exception = CBotErrOverParam; return false; }
+
+    CBotFile* file = GetOpenedFile(pThis, Exception);
+    if (file == nullptr) return false;
+
+    std::string text = file->ReadAll();
+
+    // if an error occurs generate an exception
+    if ( file->Errored() ) { Exception = CBotErrRead; return false; }
+
+    static_cast<CBotVarString*>(pResult)->SetValSharedString(CBotSharedString(std::move(text)));
+
+    return true;
+}
+
+// process FILE :: readlines
+
+// execution
+bool rfreadlines (CBotVar* pThis, CBotVar* pVar, CBotVar* pResult, int& Exception, void* user)
+{
+    // it shouldn't be any parameters
+    if (pVar != nullptr) { Exception = CBotErrOverParam; return false; }
+
+    CBotFile* file = GetOpenedFile(pThis, Exception);
+    if (file == nullptr) return false;
+
+    CBotSharedString text(file->ReadAll());
+
+    // if an error occurs generate an exception
+    if ( file->Errored() ) { Exception = CBotErrRead; return false; }
+
+    // each line shares the characters of the whole text
+    pResult->SetInit(CBotVar::InitType::DEF);
+    const char* data = text.Data();
+    std::size_t start = 0;
+    int i = 0;
+    while ( start < text.Length() )
+    {
+        const char* end = std::find(data + start, data + text.Length(), '\n');
+        std::size_t length = end - (data + start);
+
+        CBotVar* pLine = pResult->GetItem(i++, true);
+        static_cast<CBotVarString*>(pLine)->SetValSharedString(text.Substr(start, length));
+
+        start += length + 1;
+    }
+
+    return true;
+}
+
+// compilation
+CBotTypResult cfreadlines (CBotVar* pThis, CBotVar* &pVar)
+{
+    // it should not be any parameter
     if ( pVar != nullptr ) return CBotTypResult( CBotErrOverParam );
 
-    // the function returns a boolean result
-    return CBotTypResult( CBotTypBoolean );
+    // function returns an array of strings
+    return CBotTypResult( CBotTypArrayPointer, CBotTypResult( CBotTypString ) );
 }
 
 // Instruction "deletefile(filename)".
@@ -366,6 +473,10 @@ void InitFileFunctions()
     // canal.open( "r" );   // open for read
     // s = canal.readln( ); // reads a line
     // canal.close();   // close the file
+    //
+    // canal.readall() and canal.readlines() read the rest of the file at once,
+    // canal.writelines(lines) writes an array of lines at once; writes are
+    // buffered until canal.flush() or canal.close()
 
     // create the class FILE
     CBotClass* bc = CBotClass::Create("file", nullptr);
@@ -384,6 +495,10 @@ void InitFileFunctions()
     bc->AddFunction("writeln", rfwrite, cfwrite);
     bc->AddFunction("readln", rfread, cfread);
     bc->AddFunction("eof", rfeof, cfeof );
+    bc->AddFunction("flush", rfflush, cfclose);
+    bc->AddFunction("readall", rfreadall, cfread);
+    bc->AddFunction("readlines", rfreadlines, cfreadlines);
+    bc->AddFunction("writelines", rfwritelines, cfwritelines);
 
     CBotProgram::AddFunction("deletefile", rDeleteFile, cString);
 
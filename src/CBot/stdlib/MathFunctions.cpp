@@ -199,21 +199,21 @@ bool rTrunc(CBotVar* var, CBotVar* result, int& exception, void* user)
 
 void InitMathFunctions()
 {
-    CBotProgram::AddFunction("sin",   rSin,   cOneFloat);
-    CBotProgram::AddFunction("cos",   rCos,   cOneFloat);
-    CBotProgram::AddFunction("tan",   rTan,   cOneFloat);
-    CBotProgram::AddFunction("asin",  raSin,  cOneFloat);
-    CBotProgram::AddFunction("acos",  raCos,  cOneFloat);
-    CBotProgram::AddFunction("atan",  raTan,  cOneFloat);
-    CBotProgram::AddFunction("atan2", raTan2, cTwoFloat);
-    CBotProgram::AddFunction("sqrt",  rSqrt,  cOneFloat);
-    CBotProgram::AddFunction("pow",   rPow,   cTwoFloat);
+    CBotProgram::AddFunction("sin",   rSin,   cOneFloat, true);
+    CBotProgram::AddFunction("cos",   rCos,   cOneFloat, true);
+    CBotProgram::AddFunction("tan",   rTan,   cOneFloat, true);
+    CBotProgram::AddFunction("asin",  raSin,  cOneFloat, true);
+    CBotProgram::AddFunction("acos",  raCos,  cOneFloat, true);
+    CBotProgram::AddFunction("atan",  raTan,  cOneFloat, true);
+    CBotProgram::AddFunction("atan2", raTan2, cTwoFloat, true);
+    CBotProgram::AddFunction("sqrt",  rSqrt,  cOneFloat, true);
+    CBotProgram::AddFunction("pow",   rPow,   cTwoFloat, true);
     CBotProgram::AddFunction("rand",  rRand,  cNull);
-    CBotProgram::AddFunction("abs",   rAbs,   cOneFloat);
-    CBotProgram::AddFunction("floor", rFloor, cOneFloat);
-    CBotProgram::AddFunction("ceil",  rCeil,  cOneFloat);
-    CBotProgram::AddFunction("round", rRound, cOneFloat);
-    CBotProgram::AddFunction("trunc", rTrunc, cOneFloat);
+    CBotProgram::AddFunction("abs",   rAbs,   cOneFloat, true);
+    CBotProgram::AddFunction("floor", rFloor, cOneFloat, true);
+    CBotProgram::AddFunction("ceil",  rCeil,  cOneFloat, true);
+    CBotProgram::AddFunction("round", rRound, cOneFloat, true);
+    CBotProgram::AddFunction("trunc", rTrunc, cOneFloat, true);
 }
 
 } // namespace CBot
@@ -23,6 +23,8 @@
 
 #include "CBot/CBotUtils.h"
 
+#include "CBot/CBotVar/CBotVarString.h"
+
 #include <boost/algorithm/string.hpp>
 
 namespace CBot
@@ -42,11 +44,11 @@ bool rStrLen( CBotVar* pVar, CBotVar* pResult, int& ex, void* pUser )
     // no second parameter
     if ( pVar->GetNext() != nullptr ) { ex = CBotErrOverParam ; return true; }
 
-    // get the contents of the string
-    std::string  s = pVar->GetValString();
+    // get the contents of the string, without copying it
+    CBotSharedString s = CBotVarString::GetSharedString(pVar);
 
     // puts the length of the stack
-    pResult->SetValInt( s.length() );
+    pResult->SetValInt( s.Length() );
     return true;
 }
 
@@ -59,8 +61,8 @@ bool rStrLeft( CBotVar* pVar, CBotVar* pResult, int& ex, void* pUser )
     // to be a string
     if ( pVar->GetType() != CBotTypString ) { ex = CBotErrBadString ; return true; }
 
-    // get the contents of the string
-    std::string  s = pVar->GetValString();
+    // get the contents of the string, the result shares its characters
+    CBotSharedString s = CBotVarString::GetSharedString(pVar);
 
     // it takes a second parameter
     pVar = pVar->GetNext();
@@ -72,17 +74,17 @@ bool rStrLeft( CBotVar* pVar, CBotVar* pResult, int& ex, void* pUser )
     // retrieves this number
     int n = pVar->GetValInt();
 
-    if (n > static_cast<int>(s.length())) n = s.length();
+    if (n > static_cast<int>(s.Length())) n = s.Length();
     if (n < 0) n = 0;
 
     // no third parameter
     if ( pVar->GetNext() != nullptr ) { ex = CBotErrOverParam ; return true; }
 
     // takes the interesting part
-    s = s.substr(0, n);
+    s = s.Substr(0, n);
 
     // puts on the stack
-    pResult->SetValString( s );
+    static_cast<CBotVarString*>(pResult)->SetValSharedString( s );
     return true;
 }
 
@@ -95,8 +97,8 @@ bool rStrRight( CBotVar* pVar, CBotVar* pResult, int& ex, void* pUser )
     // to be a string
     if ( pVar->GetType() != CBotTypString ) { ex = CBotErrBadString ; return true; }
 
-    // get the contents of the string
-    std::string  s = pVar->GetValString();
+    // get the contents of the string, the result shares its characters
+    CBotSharedString s = CBotVarString::GetSharedString(pVar);
 
     // it takes a second parameter
     pVar = pVar->GetNext();
@@ -108,17 +110,17 @@ bool rStrRight( CBotVar* pVar, CBotVar* pResult, int& ex, void* pUser )
     // retrieves this number
     int n = pVar->GetValInt();
 
-    if (n > static_cast<int>(s.length())) n = s.length();
+    if (n > static_cast<int>(s.Length())) n = s.Length();
     if (n < 0) n = 0;
 
     // no third parameter
     if ( pVar->GetNext() != nullptr ) { ex = CBotErrOverParam ; return true; }
 
     // takes the interesting part
-    s = s.substr(s.length()-n, std::string::npos);
+    s = s.Substr(s.Length()-n);
 
     // puts on the stack
-    pResult->SetValString( s );
+    static_cast<CBotVarString*>(pResult)->SetValSharedString( s );
     return true;
 }
 
@@ -131,8 +133,8 @@ bool rStrMid( CBotVar* pVar, CBotVar* pResult, int& ex, void* pUser )
     // to be a string
     if ( pVar->GetType() != CBotTypString ) { ex = CBotErrBadString ; return true; }
 
-    // get the contents of the string
-    std::string  s = pVar->GetValString();
+    // get the contents of the string, the result shares its characters
+    CBotSharedString s = CBotVarString::GetSharedString(pVar);
 
     // it takes a second parameter
     pVar = pVar->GetNext();
@@ -144,7 +146,7 @@ bool rStrMid( CBotVar* pVar, CBotVar* pResult, int& ex, void* pUser )
     // retrieves this number
     int n = pVar->GetValInt();
 
-    if (n > static_cast<int>(s.length())) n = s.length();
+    if (n > static_cast<int>(s.Length())) n = s.Length();
     if (n < 0) n = 0;
 
     // third parameter optional
@@ -158,23 +160,23 @@ bool rStrMid( CBotVar* pVar, CBotVar* pResult, int& ex, void* pUser )
         // retrieves this number
         int l = pVar->GetValInt();
 
-        if (l > static_cast<int>(s.length())) l = s.length();
+        if (l > static_cast<int>(s.Length())) l = s.Length();
         if (l < 0) l = 0;
 
         // but no fourth parameter
         if ( pVar->GetNext() != nullptr ){ ex = CBotErrOverParam ; return true; }
 
         // takes the interesting part
-        s = s.substr(n, l);
+        s = s.Substr(n, l);
     }
     else
     {
         // takes the interesting part
-        s = s.substr(n);
+        s = s.Substr(n);
     }
 
     // puts on the stack
-    pResult->SetValString( s );
+    static_cast<CBotVarString*>(pResult)->SetValSharedString( s );
     return true;
 }
 
@@ -210,7 +212,7 @@ bool rStrFind( CBotVar* pVar, CBotVar* pResult, int& ex, void* pUser )
     if ( pVar->GetType() != CBotTypString ) { ex = CBotErrBadString ; return true; }
 
     // get the contents of the string
-    std::string  s = pVar->GetValString();
+    CBotSharedString s = CBotVarString::GetSharedString(pVar);
 
     // it takes a second parameter
     pVar = pVar->GetNext();
@@ -220,13 +222,13 @@ bool rStrFind( CBotVar* pVar, CBotVar* pResult, int& ex, void* pUser )
     if ( pVar->GetType() != CBotTypString ) { ex = CBotErrBadString ; return true; }
 
     // retrieves this number
-    std::string s2 = pVar->GetValString();
+    CBotSharedString s2 = CBotVarString::GetSharedString(pVar);
 
     // no third parameter
     if ( pVar->GetNext() != nullptr ) { ex = CBotErrOverParam ; return true; }
 
     // puts the result on the stack
-    std::size_t res = s.find(s2);
+    std::size_t res = s.Find(s2);
     if (res != std::string::npos)
     {
         pResult->SetValInt(res);
@@ -289,16 +291,16 @@ bool rStrLower( CBotVar* pVar, CBotVar* pResult, int& ex, void* pUser )
 ////////////////////////////////////////////////////////////////////////////////
 void InitStringFunctions()
 {
-    CBotProgram::AddFunction("strlen",   rStrLen,   cIntStr );
-    CBotProgram::AddFunction("strleft",  rStrLeft,  cStrStrInt );
-    CBotProgram::AddFunction("strright", rStrRight, cStrStrInt );
-    CBotProgram::AddFunction("strmid",   rStrMid,   cStrStrIntInt );
+    CBotProgram::AddFunction("strlen",   rStrLen,   cIntStr , true);
+    CBotProgram::AddFunction("strleft",  rStrLeft,  cStrStrInt , true);
+    CBotProgram::AddFunction("strright", rStrRight, cStrStrInt , true);
+    CBotProgram::AddFunction("strmid",   rStrMid,   cStrStrIntInt , true);
 
-    CBotProgram::AddFunction("strval",   rStrVal,   cFloatStr );
-    CBotProgram::AddFunction("strfind",  rStrFind,  cIntStrStr );
+    CBotProgram::AddFunction("strval",   rStrVal,   cFloatStr , true);
+    CBotProgram::AddFunction("strfind",  rStrFind,  cIntStrStr , true);
 
-    CBotProgram::AddFunction("strupper", rStrUpper, cStrStr );
-    CBotProgram::AddFunction("strlower", rStrLower, cStrStr );
+    CBotProgram::AddFunction("strupper", rStrUpper, cStrStr , true);
+    CBotProgram::AddFunction("strlower", rStrLower, cStrStr , true);
 }
 
 } // namespace CBot
@@ -36,7 +36,11 @@ public:
     virtual bool IsEOF() = 0;
 
     virtual std::string ReadLine() = 0;
+    //! Reads everything from the current position up to the end of the file
+    virtual std::string ReadAll() = 0;
+    //! Writes are buffered, the data is guaranteed to be in the file only after Flush() or closing it
     virtual void Write(const std::string& s) = 0;
+    virtual void Flush() = 0;
 };
 
 class CBotFileAccessHandler
@@ -600,6 +600,7 @@ enum EventType
     EVENT_STUDIO_RUN        = 2051,
     EVENT_STUDIO_REALTIME   = 2052,
     EVENT_STUDIO_STEP       = 2053,
+    EVENT_STUDIO_PROFILE    = 2054,
 
     EVENT_WRITE_SCENE_FINISHED = 2100, //!< indicates end of writing scene (writing screenshot image)
 
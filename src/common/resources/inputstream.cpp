@@ -28,8 +28,8 @@ CInputStream::CInputStream()
 {
 }
 
-CInputStream::CInputStream(const std::string& filename)
-    : CInputStreamBufferContainer(),
+CInputStream::CInputStream(const std::string& filename, std::size_t bufferSize)
+    : CInputStreamBufferContainer(bufferSize),
       std::istream(&m_buffer)
 {
     open(filename);
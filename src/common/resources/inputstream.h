@@ -29,6 +29,10 @@
 class CInputStreamBufferContainer
 {
 protected:
+    explicit CInputStreamBufferContainer(std::size_t bufferSize = 512)
+        : m_buffer(bufferSize)
+    {}
+
     CInputStreamBuffer m_buffer;
 };
 
@@ -37,7 +41,7 @@ class CInputStream : public CInputStreamBufferContainer, public std::istream
 {
 public:
     CInputStream();
-    CInputStream(const std::string& filename);
+    CInputStream(const std::string& filename, std::size_t bufferSize = 512);
     virtual ~CInputStream();
 
     void open(const std::string& filename);
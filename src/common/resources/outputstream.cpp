@@ -28,8 +28,8 @@ COutputStream::COutputStream()
 {
 }
 
-COutputStream::COutputStream(const std::string& filename, std::ios_base::openmode mode)
-    : COutputStreamBufferContainer(),
+COutputStream::COutputStream(const std::string& filename, std::ios_base::openmode mode, std::size_t bufferSize)
+    : COutputStreamBufferContainer(bufferSize),
       std::ostream(&m_buffer)
 {
     open(filename, mode);
@@ -21,6 +21,7 @@
 
 #include "common/resources/outputstreambuffer.h"
 
+#include <cstddef>
 #include <ostream>
 #include <string>
 
@@ -28,6 +29,10 @@
 class COutputStreamBufferContainer
 {
 protected:
+    explicit COutputStreamBufferContainer(std::size_t bufferSize = 512)
+        : m_buffer(bufferSize)
+    {}
+
     COutputStreamBuffer m_buffer;
 };
 
@@ -40,9 +45,10 @@ public:
      *
      * \param filename
      * \param mode one of: std::ios_base::out - Open for writing, std::ios_base::app - Append to file
+     * \param bufferSize size of the buffer, data is written to the file when it is full or on flush()
      *
      */
-    COutputStream(const std::string& filename, std::ios_base::openmode mode = std::ios_base::out);
+    COutputStream(const std::string& filename, std::ios_base::openmode mode = std::ios_base::out, std::size_t bufferSize = 512);
     virtual ~COutputStream();
 
     /** Open Stream for writing
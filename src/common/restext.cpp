@@ -112,6 +112,7 @@ void InitializeRestext()
     stringsText[RT_STUDIO_LISTTT]    = TR("Keyword help(\\key cbot;)");
     stringsText[RT_STUDIO_COMPOK]    = TR("Compilation ok (0 errors)");
     stringsText[RT_STUDIO_PROGSTOP]  = TR("Program finished");
+    stringsText[RT_STUDIO_PROFILE]   = TR("Program finished, most executed lines: %s");
     stringsText[RT_STUDIO_CLONED]    = TR("Program cloned");
 
     stringsText[RT_PROGRAM_READONLY] = TR("This program is read-only, clone it to edit");
@@ -473,6 +474,7 @@ void InitializeRestext()
     stringsEvent[EVENT_STUDIO_RUN]          = TR("Execute/stop");
     stringsEvent[EVENT_STUDIO_REALTIME]     = TR("Pause/continue");
     stringsEvent[EVENT_STUDIO_STEP]         = TR("One step");
+    stringsEvent[EVENT_STUDIO_PROFILE]      = TR("Find the most executed lines");
 
 
 
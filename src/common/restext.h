@@ -107,6 +107,7 @@ enum ResTextType
     RT_STUDIO_COMPOK        = 121,
     RT_STUDIO_PROGSTOP      = 122,
     RT_STUDIO_CLONED        = 123,
+    RT_STUDIO_PROFILE       = 124,
 
     RT_PROGRAM_READONLY     = 130,
     RT_PROGRAM_EXAMPLE      = 131,
@@ -604,7 +604,7 @@ public:
     //! Returns the terrain manager
     CTerrain*       GetTerrain();
     //! Returns the water manager
-    CWater*         GetWater();
+    TEST_VIRTUAL CWater* GetWater();
     //! Returns the lighting manager
     CLightning*     GetLightning();
     //! Returns the planet manager
@@ -918,7 +918,7 @@ public:
     void            FlushTextureCache();
 
     //! Defines of the distance field of vision
-    void            SetTerrainVision(float vision);
+    TEST_VIRTUAL void SetTerrainVision(float vision);
 
     //@{
     //! Management of camera vertical field-of-view angle.
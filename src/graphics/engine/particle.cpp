@@ -615,17 +615,12 @@ void CParticle::CreateWheelTrace(const Math::Vector &p1, const Math::Vector &p2,
     if (m_terrain == nullptr)
         m_terrain = m_main->GetTerrain();
 
-    m_terrain->AdjustToFloor(m_wheelTrace[i].pos[0]);
-    m_wheelTrace[i].pos[0].y += 0.2f;  // just above the ground
-
-    m_terrain->AdjustToFloor(m_wheelTrace[i].pos[1]);
-    m_wheelTrace[i].pos[1].y += 0.2f;  // just above the ground
-
-    m_terrain->AdjustToFloor(m_wheelTrace[i].pos[2]);
-    m_wheelTrace[i].pos[2].y += 0.2f;  // just above the ground
-
-    m_terrain->AdjustToFloor(m_wheelTrace[i].pos[3]);
-    m_wheelTrace[i].pos[3].y += 0.2f;  // just above the ground
+    float level[4];
+    m_terrain->GetFloorLevels(m_wheelTrace[i].pos, level, 4);
+    for (int j = 0; j < 4; j++)
+    {
+        m_wheelTrace[i].pos[j].y = level[j] + 0.2f;  // just above the ground
+    }
 
     if (m_wheelTraceTotal < max)
         m_wheelTraceTotal++;
@@ -39,6 +39,14 @@
 namespace Gfx
 {
 
+namespace
+{
+
+//! Size of a cell of the grids indexing the building levels and flying limits
+const float ZONE_CELL_SIZE = 40.0f;
+
+} // anonymous namespace
+
 
 CTerrain::CTerrain()
 {
@@ -59,6 +67,7 @@ CTerrain::CTerrain()
     m_useMaterials    = false;
 
     m_flyingMaxHeight = 0.0f;
+    m_revision = 0;
     m_maxMaterialID = 0;
     m_materialAutoID = 0;
     m_materialPointCount = 0;
@@ -75,6 +84,7 @@ CTerrain::~CTerrain()
 bool CTerrain::Generate(int mosaicCount, int brickCountPow2, float brickSize,
                         float vision, int depth, float hardness)
 {
+    m_revision++;
     m_mosaicCount   = mosaicCount;
     m_brickCount    = 1 << brickCountPow2;
     m_brickSize     = brickSize;
@@ -82,6 +92,10 @@ bool CTerrain::Generate(int mosaicCount, int brickCountPow2, float brickSize,
     m_depth         = depth;
     m_defaultHardness   = hardness;
 
+    // The size of the terrain bounds the zone grids
+    UpdateBuildingLevelGrid();
+    UpdateFlyingLimitGrid();
+
     m_engine->SetTerrainVision(vision);
 
     m_textureScale  = 1.0f / (m_brickCount*m_brickSize);
@@ -272,6 +286,7 @@ TerrainRes CTerrain::GetResource(const Math::Vector &pos)
 
 void CTerrain::FlushRelief()
 {
+    m_revision++;
     m_relief.clear();
     m_resources.clear();
     m_textures.clear();
@@ -298,6 +313,7 @@ void CTerrain::FlushRelief()
 bool CTerrain::LoadRelief(const std::string &fileName, float scaleRelief,
                           bool adjustBorder)
 {
+    m_revision++;
     m_scaleRelief = scaleRelief;
 
     CImage img;
@@ -349,6 +365,7 @@ bool CTerrain::LoadRelief(const std::string &fileName, float scaleRelief,
 
 bool CTerrain::RandomizeRelief()
 {
+    m_revision++;
     // Perlin noise
     // Based on Python implementation by Marek Rogalski (mafik)
     // http://amt2014.pl/archiwum/perlin.py
@@ -403,6 +420,7 @@ bool CTerrain::RandomizeRelief()
 
 bool CTerrain::AddReliefPoint(Math::Vector pos, float scaleRelief)
 {
+    m_revision++;
     float dim = (m_mosaicCount*m_brickCount*m_brickSize)/2.0f;
     int size = (m_mosaicCount*m_brickCount)+1;
 
@@ -423,6 +441,7 @@ bool CTerrain::AddReliefPoint(Math::Vector pos, float scaleRelief)
 
 void CTerrain::AdjustRelief()
 {
+    m_revision++;
     if (m_depth == 1) return;
 
     int ii = m_mosaicCount*m_brickCount+1;
@@ -1283,6 +1302,7 @@ bool CTerrain::CreateObjects()
 /** ATTENTION: ok only with m_depth = 2! */
 bool CTerrain::Terraform(const Math::Vector &p1, const Math::Vector &p2, float height)
 {
+    m_revision++;
     float dim = (m_mosaicCount*m_brickCount*m_brickSize)/2.0f;
 
     Math::IntPoint tp1, tp2;
@@ -1369,6 +1389,11 @@ bool CTerrain::Terraform(const Math::Vector &p1, const Math::Vector &p2, float h
     return true;
 }
 
+int CTerrain::GetRevision()
+{
+    return m_revision;
+}
+
 void CTerrain::SetWind(Math::Vector speed)
 {
     m_wind = speed;
@@ -1435,12 +1460,12 @@ bool CTerrain::GetNormal(Math::Vector &n, const Math::Vector &p)
     return true;
 }
 
-float CTerrain::GetFloorLevel(const Math::Vector &pos, bool brut, bool water)
+bool CTerrain::IntersectRelief(Math::Vector& p)
 {
     float dim = (m_mosaicCount*m_brickCount*m_brickSize)/2.0f;
 
-    int x = static_cast<int>((pos.x+dim)/m_brickSize);
-    int y = static_cast<int>((pos.z+dim)/m_brickSize);
+    int x = static_cast<int>((p.x+dim)/m_brickSize);
+    int y = static_cast<int>((p.z+dim)/m_brickSize);
 
     if ( x < 0 || x > m_mosaicCount*m_brickCount ||
          y < 0 || y > m_mosaicCount*m_brickCount )  return false;
@@ -1450,15 +1475,16 @@ float CTerrain::GetFloorLevel(const Math::Vector &pos, bool brut, bool water)
     Math::Vector p3 = GetVector(x+0, y+1);
     Math::Vector p4 = GetVector(x+1, y+1);
 
-    Math::Vector ps = pos;
-    if ( fabs(pos.z-p2.z) < fabs(pos.x-p2.x) )
-    {
-        if ( !IntersectY(p1, p2, p3, ps) )  return 0.0f;
-    }
+    if ( fabs(p.z-p2.z) < fabs(p.x-p2.x) )
+        return IntersectY(p1, p2, p3, p);
     else
-    {
-        if ( !IntersectY(p2, p4, p3, ps) )  return 0.0f;
-    }
+        return IntersectY(p2, p4, p3, p);
+}
+
+float CTerrain::GetFloorLevel(const Math::Vector &pos, bool brut, bool water)
+{
+    Math::Vector ps = pos;
+    if (! IntersectRelief(ps))  return 0.0f;
 
     if (! brut) AdjustBuildingLevel(ps);
 
@@ -1471,6 +1497,41 @@ float CTerrain::GetFloorLevel(const Math::Vector &pos, bool brut, bool water)
     return ps.y;
 }
 
+void CTerrain::GetFloorLevels(const Math::Vector* positions, float* levels, int count, bool brut, bool water)
+{
+    float waterLevel = m_water->GetLevel();
+
+    // Nearby positions usually share the same cell of the zone grid
+    int lastCell = -1;
+    const std::vector<int>* zones = nullptr;
+
+    for (int i = 0; i < count; i++)
+    {
+        Math::Vector ps = positions[i];
+        if (! IntersectRelief(ps))
+        {
+            levels[i] = positions[i].y;  // outside the terrain, like AdjustToFloor()
+            continue;
+        }
+
+        if (! brut)
+        {
+            int cell = GetZoneCell(GetZoneCellCoord(ps.x), GetZoneCellCoord(ps.z));
+            if (cell != lastCell)
+            {
+                auto it = m_buildingLevelGrid.find(cell);
+                zones = it == m_buildingLevelGrid.end() ? nullptr : &it->second;
+                lastCell = cell;
+            }
+            if (zones != nullptr) AdjustBuildingLevel(ps, *zones);
+        }
+
+        if (water && ps.y < waterLevel) ps.y = waterLevel;  // not under water
+
+        levels[i] = ps.y;
+    }
+}
+
 float CTerrain::GetHeightToFloor(const Math::Vector &pos, bool brut, bool water)
 {
     float dim = (m_mosaicCount*m_brickCount*m_brickSize)/2.0f;
@@ -1619,12 +1680,15 @@ bool CTerrain::AdjustToBounds(Math::Vector& pos, float margin)
 
 void CTerrain::FlushBuildingLevel()
 {
+    m_revision++;
     m_buildingLevels.clear();
+    m_buildingLevelGrid.clear();
 }
 
 bool CTerrain::AddBuildingLevel(Math::Vector center, float min, float max,
                                      float height, float factor)
 {
+    m_revision++;
     int i = 0;
     for ( ; i < static_cast<int>( m_buildingLevels.size() ); i++)
     {
@@ -1649,11 +1713,13 @@ bool CTerrain::AddBuildingLevel(Math::Vector center, float min, float max,
     m_buildingLevels[i].bboxMinZ = center.z-max;
     m_buildingLevels[i].bboxMaxZ = center.z+max;
 
+    UpdateBuildingLevelGrid();
     return true;
 }
 
 bool CTerrain::UpdateBuildingLevel(Math::Vector center)
 {
+    m_revision++;
     for (int i = 0; i < static_cast<int>( m_buildingLevels.size() ); i++)
     {
         if ( center.x == m_buildingLevels[i].center.x &&
@@ -1669,6 +1735,7 @@ bool CTerrain::UpdateBuildingLevel(Math::Vector center)
 
 bool CTerrain::DeleteBuildingLevel(Math::Vector center)
 {
+    m_revision++;
     for (int i = 0; i < static_cast<int>( m_buildingLevels.size() ); i++)
     {
         if ( center.x == m_buildingLevels[i].center.x &&
@@ -1678,6 +1745,7 @@ bool CTerrain::DeleteBuildingLevel(Math::Vector center)
                 m_buildingLevels[j-1] = m_buildingLevels[j];
 
             m_buildingLevels.pop_back();
+            UpdateBuildingLevelGrid();
             return true;
         }
     }
@@ -1686,7 +1754,10 @@ bool CTerrain::DeleteBuildingLevel(Math::Vector center)
 
 float CTerrain::GetBuildingFactor(const Math::Vector &pos)
 {
-    for (int i = 0; i < static_cast<int>( m_buildingLevels.size() ); i++)
+    const std::vector<int>* zones = FindZones(m_buildingLevelGrid, pos);
+    if (zones == nullptr) return 1.0f;
+
+    for (int i : *zones)
     {
         if ( pos.x < m_buildingLevels[i].bboxMinX ||
              pos.x > m_buildingLevels[i].bboxMaxX ||
@@ -1703,7 +1774,13 @@ float CTerrain::GetBuildingFactor(const Math::Vector &pos)
 
 void CTerrain::AdjustBuildingLevel(Math::Vector &p)
 {
-    for (int i = 0; i < static_cast<int>( m_buildingLevels.size() ); i++)
+    const std::vector<int>* zones = FindZones(m_buildingLevelGrid, p);
+    if (zones != nullptr) AdjustBuildingLevel(p, *zones);
+}
+
+void CTerrain::AdjustBuildingLevel(Math::Vector &p, const std::vector<int>& zones)
+{
+    for (int i : zones)
     {
         if ( p.x < m_buildingLevels[i].bboxMinX ||
              p.x > m_buildingLevels[i].bboxMaxX ||
@@ -1847,6 +1924,7 @@ void CTerrain::FlushFlyingLimit()
 {
     m_flyingMaxHeight = 280.0f;
     m_flyingLimits.clear();
+    m_flyingLimitGrid.clear();
 }
 
 void CTerrain::AddFlyingLimit(Math::Vector center,
@@ -1859,6 +1937,8 @@ void CTerrain::AddFlyingLimit(Math::Vector center,
     fl.intRadius = intRadius;
     fl.maxHeight = maxHeight;
     m_flyingLimits.push_back(fl);
+
+    UpdateFlyingLimitGrid();
 }
 
 float CTerrain::GetFlyingLimit(Math::Vector pos, bool noLimit)
@@ -1866,10 +1946,11 @@ float CTerrain::GetFlyingLimit(Math::Vector pos, bool noLimit)
     if (noLimit)
         return 280.0f;
 
-    if (m_flyingLimits.empty())
+    const std::vector<int>* zones = FindZones(m_flyingLimitGrid, pos);
+    if (zones == nullptr)
         return m_flyingMaxHeight;
 
-    for (int i = 0; i < static_cast<int>( m_flyingLimits.size() ); i++)
+    for (int i : *zones)
     {
         float dist = Math::DistanceProjected(pos, m_flyingLimits[i].center);
 
@@ -1890,5 +1971,70 @@ float CTerrain::GetFlyingLimit(Math::Vector pos, bool noLimit)
     return m_flyingMaxHeight;
 }
 
+int CTerrain::GetZoneCellCoord(float coord)
+{
+    // Everything outside the terrain falls in its border cells
+    float limit = (m_mosaicCount*m_brickCount*m_brickSize)/2.0f/ZONE_CELL_SIZE + 1.0f;
+    float cell = floorf(coord/ZONE_CELL_SIZE);
+    if (!(cell >= -limit)) cell = -limit;  // also if not a number
+    if (cell > limit) cell = limit;
+    return static_cast<int>(cell);
+}
+
+int CTerrain::GetZoneCell(int x, int z)
+{
+    return static_cast<int>((static_cast<unsigned int>(x + 0x8000) << 16) | static_cast<unsigned int>(z + 0x8000));
+}
+
+const std::vector<int>* CTerrain::FindZones(const std::unordered_map<int, std::vector<int>>& grid, const Math::Vector& pos)
+{
+    if (grid.empty()) return nullptr;
+
+    auto it = grid.find(GetZoneCell(GetZoneCellCoord(pos.x), GetZoneCellCoord(pos.z)));
+    if (it == grid.end()) return nullptr;
+    return &it->second;
+}
+
+void CTerrain::AddToZoneGrid(std::unordered_map<int, std::vector<int>>& grid, int index,
+                             float minX, float maxX, float minZ, float maxZ)
+{
+    int x1 = GetZoneCellCoord(minX), x2 = GetZoneCellCoord(maxX);
+    int z1 = GetZoneCellCoord(minZ), z2 = GetZoneCellCoord(maxZ);
+
+    for (int x = x1; x <= x2; x++)
+    {
+        for (int z = z1; z <= z2; z++)
+        {
+            grid[GetZoneCell(x, z)].push_back(index);
+        }
+    }
+}
+
+// The lists of each cell are sorted by index, so that the first zone found
+// is the same as when scanning the whole table.
+
+void CTerrain::UpdateBuildingLevelGrid()
+{
+    m_buildingLevelGrid.clear();
+    for (int i = 0; i < static_cast<int>( m_buildingLevels.size() ); i++)
+    {
+        AddToZoneGrid(m_buildingLevelGrid, i,
+                      m_buildingLevels[i].bboxMinX, m_buildingLevels[i].bboxMaxX,
+                      m_buildingLevels[i].bboxMinZ, m_buildingLevels[i].bboxMaxZ);
+    }
+}
+
+void CTerrain::UpdateFlyingLimitGrid()
+{
+    m_flyingLimitGrid.clear();
+    for (int i = 0; i < static_cast<int>( m_flyingLimits.size() ); i++)
+    {
+        const FlyingLimit& limit = m_flyingLimits[i];
+        AddToZoneGrid(m_flyingLimitGrid, i,
+                      limit.center.x-limit.extRadius, limit.center.x+limit.extRadius,
+                      limit.center.z-limit.extRadius, limit.center.z+limit.extRadius);
+    }
+}
+
 
 } // namespace Gfx
@@ -31,6 +31,7 @@
 #include "math/vector.h"
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 
@@ -181,6 +182,8 @@ public:
 
     //! Modifies the terrain's relief
     bool        Terraform(const Math::Vector& p1, const Math::Vector& p2, float height);
+    //! Returns a counter incremented on every change of the relief or building levels
+    int         GetRevision();
 
     //@{
     //! Management of the wind
@@ -196,6 +199,9 @@ public:
     bool        GetNormal(Math::Vector& n, const Math::Vector &p);
     //! Returns the height of the ground level at 2D (XZ) position
     float       GetFloorLevel(const Math::Vector& pos, bool brut=false, bool water=false);
+    //! Returns the heights of the ground level at several 2D (XZ) positions
+    //! Positions outside the terrain keep their own height
+    void        GetFloorLevels(const Math::Vector* positions, float* levels, int count, bool brut=false, bool water=false);
     //! Returns the distance to the ground level from 3D position
     float       GetHeightToFloor(const Math::Vector& pos, bool brut=false, bool water=false);
     //! Modifies the Y coordinate of 3D position to rest on the ground floor
@@ -284,6 +290,24 @@ protected:
 
     //! Adjusts a position according to a possible rise
     void        AdjustBuildingLevel(Math::Vector &p);
+    //! Adjusts a position according to a possible rise among the given ones
+    void        AdjustBuildingLevel(Math::Vector &p, const std::vector<int>& zones);
+    //! Computes the height of the relief at 2D (XZ) position, without rises
+    bool        IntersectRelief(Math::Vector& p);
+
+    //! Returns the row or column of the zone grids containing the given coordinate
+    int         GetZoneCellCoord(float coord);
+    //! Returns the key of a cell of the zone grids
+    int         GetZoneCell(int x, int z);
+    //! Returns the zones of a grid that may contain the 2D (XZ) position, or nullptr
+    const std::vector<int>* FindZones(const std::unordered_map<int, std::vector<int>>& grid, const Math::Vector& pos);
+    //! Adds a zone covering the given rectangle to a zone grid
+    void        AddToZoneGrid(std::unordered_map<int, std::vector<int>>& grid, int index,
+                              float minX, float maxX, float minZ, float maxZ);
+    //! Recomputes the grid of the building levels
+    void        UpdateBuildingLevelGrid();
+    //! Recomputes the grid of the flying limits
+    void        UpdateFlyingLimitGrid();
 
 protected:
     CEngine*        m_engine;
@@ -384,12 +408,16 @@ protected:
         float        bboxMaxZ = 0.0f;
     };
     std::vector<BuildingLevel> m_buildingLevels;
+    //! Indexes of the building levels whose bounding box touches each cell
+    std::unordered_map<int, std::vector<int>> m_buildingLevelGrid;
 
     //! Wind speed
     Math::Vector    m_wind;
 
     //! Global flying height limit
     float           m_flyingMaxHeight;
+    //! Number of changes of the relief or building levels
+    int             m_revision;
 
     /**
      * \struct FlyingLimit
@@ -404,6 +432,8 @@ protected:
     };
     //! List of local flight limits
     std::vector<FlyingLimit> m_flyingLimits;
+    //! Indexes of the flying limits whose external radius touches each cell
+    std::unordered_map<int, std::vector<int>> m_flyingLimitGrid;
 };
 
 
@@ -89,7 +89,7 @@ public:
     //! Changes the level of the water
     void        SetLevel(float level);
     //! Returns the current level of water
-    float       GetLevel();
+    TEST_VIRTUAL float GetLevel();
     //! Returns the current level of water for a given object
     float       GetLevel(CObject* object);
 
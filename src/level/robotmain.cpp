@@ -20,6 +20,8 @@
 #include "level/robotmain.h"
 
 #include "CBot/CBot.h"
+#include "CBot/CBotExternalCall.h"
+#include "CBot/CBotSnapshot.h"
 
 #include "app/app.h"
 #include "app/input.h"
@@ -29,6 +31,7 @@
 #include "common/event.h"
 #include "common/logger.h"
 #include "common/make_unique.h"
+#include "common/profiler.h"
 #include "common/restext.h"
 #include "common/settings.h"
 #include "common/stringutils.h"
@@ -63,9 +66,11 @@
 #include "math/func.h"
 #include "math/geometry.h"
 
+#include "object/navigation_grid.h"
 #include "object/object.h"
 #include "object/object_create_exception.h"
 #include "object/object_manager.h"
+#include "object/path_request_queue.h"
 
 #include "object/auto/auto.h"
 
@@ -167,6 +172,9 @@ CRobotMain::CRobotMain()
         m_modelManager.get(),
         m_particle);
 
+    m_navigationGrid = MakeUnique<CNavigationGrid>(m_terrain.get(), m_water);
+    m_pathQueue = MakeUnique<CPathRequestQueue>();
+
     m_debugMenu   = MakeUnique<Ui::CDebugMenu>(this, m_engine, m_objMan.get(), m_sound);
 
     m_time = 0.0f;
@@ -2378,6 +2386,12 @@ bool CRobotMain::EventFrame(const Event &event)
     CObject* toto = nullptr;
     if (!m_pause->IsPauseType(PAUSE_OBJECT_UPDATES))
     {
+        m_navigationGrid->NewFrame();
+        m_pathQueue->NewFrame();
+
+        if (m_scriptThreads > 0)
+            RunScriptsInParallel();
+
         // Advances all the robots, but not toto.
         for (CObject* obj : m_objMan->GetAllObjects())
         {
@@ -4492,7 +4506,7 @@ void CRobotMain::SaveOneScript(CObject *obj)
 }
 
 //! Saves the stack of the program in execution of a robot
-bool CRobotMain::SaveFileStack(CObject *obj, std::ostream &ostr)
+bool CRobotMain::SaveFileStack(CObject *obj, CBot::CBotSnapshotWriter &snapshot)
 {
     if (! obj->Implements(ObjectInterfaceType::Programmable)) return true;
 
@@ -4501,22 +4515,36 @@ bool CRobotMain::SaveFileStack(CObject *obj, std::ostream &ostr)
     ObjectType type = obj->GetType();
     if (type == OBJECT_HUMAN) return true;
 
-    long status = 1;
-    std::stringstream sstr("");
-
-    if (!programmable->WriteStack(sstr))
+    if (!programmable->WriteStack(snapshot.AddEntry(obj->GetID())))
     {
         GetLogger()->Error("WriteStack failed at object id = %i\n", obj->GetID());
-        status = 100; // marked bad
+        snapshot.CancelEntry(); // the program won't be resumed
     }
 
-    if (!CBot::WriteLong(ostr, status)) return false;
-    if (!CBot::WriteStream(ostr, sstr)) return false;
-
     return true;
 }
 
 //! Resumes the execution stack of the program in a robot
+bool CRobotMain::ReadFileStack(CObject *obj, CBot::CBotSnapshotReader &snapshot)
+{
+    if (! obj->Implements(ObjectInterfaceType::Programmable)) return true;
+
+    CProgrammableObject* programmable = dynamic_cast<CProgrammableObject*>(obj);
+
+    ObjectType type = obj->GetType();
+    if (type == OBJECT_HUMAN) return true;
+
+    std::istream* istr = snapshot.GetEntry(obj->GetID());
+    if (istr == nullptr) return true; // not saved, or saving failed
+
+    if (!programmable->ReadStack(*istr))
+    {
+        GetLogger()->Error("ReadStack failed at object id = %i\n", obj->GetID());
+    }
+    return true;
+}
+
+//! Resumes the execution stack of the program in a robot, from a file of version 1
 bool CRobotMain::ReadFileStack(CObject *obj, std::istream &istr)
 {
     if (! obj->Implements(ObjectInterfaceType::Programmable)) return true;
@@ -4747,19 +4775,18 @@ bool CRobotMain::IOWriteScene(std::string filename, std::string filecbot, std::s
     if (!ostr.is_open()) return false;
 
     bool bError = false;
-    long version = 1;
+    long version = 2;
     CBot::WriteLong(ostr, version);                 // version of COLOBOT
-    version = CBot::CBotProgram::GetVersion();
-    CBot::WriteLong(ostr, version);                 // version of CBOT
-    CBot::WriteWord(ostr, 0); // TODO
 
+    // the stacks are collected in memory and written at once
+    CBot::CBotSnapshotWriter snapshot;
     for (CObject* obj : m_objMan->GetAllObjects())
     {
         if (obj->GetType() == OBJECT_TOTO) continue;
         if (IsObjectBeingTransported(obj)) continue;
         if (obj->Implements(ObjectInterfaceType::Destroyable) && dynamic_cast<CDestroyableObject*>(obj)->IsDying()) continue;
 
-        if (!SaveFileStack(obj, ostr))
+        if (!SaveFileStack(obj, snapshot))
         {
             GetLogger()->Error("SaveFileStack failed at object id = %i\n", obj->GetID());
             bError = true;
@@ -4767,6 +4794,12 @@ bool CRobotMain::IOWriteScene(std::string filename, std::string filecbot, std::s
         }
     }
 
+    if (!bError && !snapshot.Write(ostr))
+    {
+        GetLogger()->Error("Writing CBOT snapshot failed\n");
+        bError = true;
+    }
+
     if (!bError && !CBot::CBotClass::SaveStaticState(ostr))
     {
         GetLogger()->Error("CBotClass save static state failed\n");
@@ -4937,7 +4970,30 @@ CObject* CRobotMain::IOReadScene(std::string filename, std::string filecbot)
         bool bError = false;
         long version = 0;
         CBot::ReadLong(istr, version);             // version of COLOBOT
-        if (version == 1)
+        if (version == 2)
+        {
+            CBot::CBotSnapshotReader snapshot;
+            if (snapshot.Read(istr))
+            {
+                for (CObject* obj : m_objMan->GetAllObjects())
+                {
+                    if (obj->GetType() == OBJECT_TOTO) continue;
+                    if (IsObjectBeingTransported(obj)) continue;
+                    if (obj->Implements(ObjectInterfaceType::Destroyable) && dynamic_cast<CDestroyableObject*>(obj)->IsDying()) continue;
+
+                    ReadFileStack(obj, snapshot);
+                }
+
+                if (!CBot::CBotClass::RestoreStaticState(istr))
+                {
+                    GetLogger()->Error("CBotClass restore static state failed\n");
+                    bError = true;
+                }
+            }
+            else
+                GetLogger()->Error("cbot.run file has a wrong CBOT snapshot\n");
+        }
+        else if (version == 1)
         {
             CBot::ReadLong(istr, version);         // version of CBOT
             if (version == CBot::CBotProgram::GetVersion())
@@ -5727,6 +5783,55 @@ int CRobotMain::GetAutosaveSlots()
     return m_autosaveSlots;
 }
 
+void CRobotMain::SetScriptThreads(int threads)
+{
+    if (threads < 0) threads = 0;
+    if (m_scriptThreads == threads) return;
+
+    m_scriptThreads = threads;
+    m_scriptPool.reset();  // created again with the new size when needed
+}
+
+int CRobotMain::GetScriptThreads()
+{
+    return m_scriptThreads;
+}
+
+void CRobotMain::RunScriptsInParallel()
+{
+    std::vector<CScript*> scripts;
+    std::vector<CBot::CBotWorkerPool::Slice> slices;
+    for (CObject* obj : m_objMan->GetAllObjects())
+    {
+        if (!obj->Implements(ObjectInterfaceType::Programmable)) continue;
+        if (obj->Implements(ObjectInterfaceType::Destroyable) && dynamic_cast<CDestroyableObject*>(obj)->IsDying()) continue;
+
+        CProgrammableObject* programmable = dynamic_cast<CProgrammableObject*>(obj);
+        if (!programmable->GetActivity() || !programmable->IsProgram()) continue;
+
+        CScript* script = programmable->GetCurrentProgram()->script.get();
+        CBot::CBotWorkerPool::Slice slice;
+        if (!script->PrepareSlice(slice)) continue;
+
+        scripts.push_back(script);
+        slices.push_back(slice);
+    }
+    if (slices.size() < 2) return;  // the only program runs as usual
+
+    if (m_scriptPool == nullptr)
+        m_scriptPool = MakeUnique<CBot::CBotWorkerPool>(m_scriptThreads);
+
+    CProfiler::StartPerformanceCounter(PCNT_UPDATE_CBOT);
+    m_scriptPool->Run(slices);
+    CProfiler::StopPerformanceCounter(PCNT_UPDATE_CBOT);
+
+    // the programs stopped before a call to the game finish their slice in CScript::Continue()
+    for (std::size_t i = 0; i < scripts.size(); i++)
+    {
+        scripts[i]->SetSliceResult(slices[i].finished);
+    }
+}
+
 // Remove oldest saves with autosave prefix
 void CRobotMain::AutosaveRotate()
 {
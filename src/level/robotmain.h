@@ -44,7 +44,9 @@
 #include "object/tool_type.h"
 
 #include <deque>
+#include <memory>
 #include <stdexcept>
+#include <vector>
 
 enum Phase
 {
@@ -85,6 +87,8 @@ class CSoundInterface;
 class CLevelParserLine;
 class CInput;
 class CObjectManager;
+class CNavigationGrid;
+class CPathRequestQueue;
 class CSceneEndCondition;
 class CAudioChangeCondition;
 class CScoreboard;
@@ -117,6 +121,13 @@ class CDisplayInfo;
 class CDebugMenu;
 }
 
+namespace CBot
+{
+class CBotWorkerPool;
+class CBotSnapshotWriter;
+class CBotSnapshotReader;
+}
+
 struct NewScriptName
 {
     ObjectType  type = OBJECT_NULL;
@@ -308,7 +319,8 @@ public:
 
     void        SaveAllScript();
     void        SaveOneScript(CObject *obj);
-    bool        SaveFileStack(CObject *obj, std::ostream &ostr);
+    bool        SaveFileStack(CObject *obj, CBot::CBotSnapshotWriter &snapshot);
+    bool        ReadFileStack(CObject *obj, CBot::CBotSnapshotReader &snapshot);
     bool        ReadFileStack(CObject *obj, std::istream &istr);
 
     //! Return list of scripts to load to robot created in BotFactory
@@ -362,6 +374,18 @@ public:
     int         GetAutosaveSlots();
     //@}
 
+    /**
+     * \name Parallel execution of programs
+     *
+     * With more than 0 threads, the programs of all robots run their slice of the frame at the same
+     * time, before the objects are updated. Only the functions reading the state of the game run in
+     * parallel, a program calling any other function finishes its slice when the object is updated.
+     */
+    //@{
+    void        SetScriptThreads(int threads);
+    int         GetScriptThreads();
+    //@}
+
     //! Enable mode where completing mission closes the game
     void        SetExitAfterMission(bool exit);
 
@@ -533,6 +557,9 @@ protected:
 
     void        UpdateDebugCrashSpheres();
 
+    //! Runs the programs of all robots at once, see SetScriptThreads()
+    void        RunScriptsInParallel();
+
     //! Adds element to the beginning of command history
     void        PushToCommandHistory(std::string cmd);
     //! Returns next/previous element from command history and updates index
@@ -555,6 +582,8 @@ protected:
     CSoundInterface*    m_sound = nullptr;
     CInput*             m_input = nullptr;
     std::unique_ptr<CObjectManager> m_objMan;
+    std::unique_ptr<CNavigationGrid> m_navigationGrid;
+    std::unique_ptr<CPathRequestQueue> m_pathQueue;
     std::unique_ptr<CMainMovie> m_movie;
     std::unique_ptr<CPauseManager> m_pause;
     std::unique_ptr<Gfx::CModelManager> m_modelManager;
@@ -716,6 +745,9 @@ protected:
     int             m_autosaveSlots = 0;
     float           m_autosaveLast = 0.0f;
 
+    int             m_scriptThreads = 0;
+    std::unique_ptr<CBot::CBotWorkerPool> m_scriptPool;
+
     int             m_shotSaving = 0;
 
     std::deque<CObject*> m_selectionHistory;
@@ -38,5 +38,7 @@ public:
     {}
 
     virtual Math::Sphere GetJostlingSphere() const = 0;
+    //! Returns the distance from the object's position within which the jostling sphere lies, whatever the rotation
+    virtual float GetJostlingExtent() const = 0;
     virtual bool JostleObject(float force) = 0;
 };
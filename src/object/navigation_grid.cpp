@@ -0,0 +1,286 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+#include "object/navigation_grid.h"
+
+#include "graphics/engine/terrain.h"
+#include "graphics/engine/water.h"
+
+#include "math/func.h"
+
+#include "object/object.h"
+#include "object/object_manager.h"
+
+#include "object/interface/transportable_object.h"
+
+#include <algorithm>
+
+namespace
+{
+
+//! Width or height of the blocks in which the terrain layers are computed, in cells
+const int TERRAIN_BLOCK_SIZE = 16;
+//! Number of terrain blocks computed in one frame for the goto() searches
+const int TERRAIN_BLOCKS_PER_FRAME = 64;
+//! Smallest number of cached obstacles above which the deleted objects are looked for
+const std::size_t OBSTACLE_PRUNE_SIZE = 256;
+
+//! The slope or the flying height limit makes the cell impassable
+const unsigned char TERRAIN_STEEP      = 1 << 0;
+//! The cell is under water
+const unsigned char TERRAIN_UNDERWATER = 1 << 1;
+
+} // anonymous namespace
+
+
+bool NavigationTerrainLayer::IsBlocked(int x, int y) const
+{
+    if ( x < 0 || x >= size ||
+         y < 0 || y >= size )  return false;
+
+    if ( cells[x+y*size] & TERRAIN_STEEP )  return true;
+
+    if ( !terrainClass.fly && !terrainClass.acceptWater )
+    {
+        // A cell under water also blocks its four neighbours
+        if ( cells[x+y*size] & TERRAIN_UNDERWATER )  return true;
+        if ( x > 0      && (cells[(x-1)+y*size] & TERRAIN_UNDERWATER) )  return true;
+        if ( x < size-1 && (cells[(x+1)+y*size] & TERRAIN_UNDERWATER) )  return true;
+        if ( y > 0      && (cells[x+(y-1)*size] & TERRAIN_UNDERWATER) )  return true;
+        if ( y < size-1 && (cells[x+(y+1)*size] & TERRAIN_UNDERWATER) )  return true;
+    }
+
+    return false;
+}
+
+
+CNavigationGrid::CNavigationGrid(Gfx::CTerrain* terrain, Gfx::CWater* water)
+    : m_terrain(terrain),
+      m_water(water)
+{
+    m_size = static_cast<int>(3200.0f/BM_DIM_STEP);
+    m_blockCount = (m_size+TERRAIN_BLOCK_SIZE-1)/TERRAIN_BLOCK_SIZE;
+    m_blockBudget = TERRAIN_BLOCKS_PER_FRAME;
+}
+
+CNavigationGrid::~CNavigationGrid()
+{
+}
+
+int CNavigationGrid::GetSize()
+{
+    return m_size;
+}
+
+bool CNavigationGrid::IsTerrainBlocked(const NavigationTerrainClass& terrainClass, int x, int y)
+{
+    if ( x < 0 || x >= m_size ||
+         y < 0 || y >= m_size )  return false;
+
+    NavigationTerrainLayer& layer = *FindTerrainLayer(terrainClass);
+
+    PrepareTerrainCell(layer, x, y);
+    PrepareTerrainCell(layer, x-1, y);
+    PrepareTerrainCell(layer, x+1, y);
+    PrepareTerrainCell(layer, x, y-1);
+    PrepareTerrainCell(layer, x, y+1);
+
+    return layer.IsBlocked(x, y);
+}
+
+std::shared_ptr<const NavigationTerrainLayer> CNavigationGrid::GetTerrainLayer(const NavigationTerrainClass& terrainClass,
+                                                                               Math::IntPoint min, Math::IntPoint max)
+{
+    const std::shared_ptr<NavigationTerrainLayer>& layer = FindTerrainLayer(terrainClass);
+
+    // IsBlocked() also reads the four neighbours of a cell
+    int minBlockX = Math::Clamp(min.x-1, 0, m_size-1)/TERRAIN_BLOCK_SIZE;
+    int minBlockY = Math::Clamp(min.y-1, 0, m_size-1)/TERRAIN_BLOCK_SIZE;
+    int maxBlockX = Math::Clamp(max.x+1, 0, m_size-1)/TERRAIN_BLOCK_SIZE;
+    int maxBlockY = Math::Clamp(max.y+1, 0, m_size-1)/TERRAIN_BLOCK_SIZE;
+
+    for (int blockY = minBlockY; blockY <= maxBlockY; blockY++)
+    {
+        for (int blockX = minBlockX; blockX <= maxBlockX; blockX++)
+        {
+            if ( layer->computedBlocks[blockX+blockY*m_blockCount] )  continue;
+            if ( m_blockBudget <= 0 )  return nullptr;  // continues during the next frame
+
+            ComputeTerrainBlock(*layer, blockX, blockY);
+            m_blockBudget --;
+        }
+    }
+
+    return layer;
+}
+
+void CNavigationGrid::NewFrame()
+{
+    m_blockBudget = TERRAIN_BLOCKS_PER_FRAME;
+}
+
+const std::vector<const NavigationObstacle*>& CNavigationGrid::GetObstacles(Math::Vector min, Math::Vector max)
+{
+    CObjectManager* objectManager = CObjectManager::GetInstancePointer();
+
+    // Forgets the deleted objects, from time to time
+    if ( m_obstacles.size() > m_obstaclePruneSize )
+    {
+        for (auto it = m_obstacles.begin(); it != m_obstacles.end(); )
+        {
+            if ( objectManager->GetObjectById(it->first) != it->second.object )  it = m_obstacles.erase(it);
+            else  ++it;
+        }
+        m_obstaclePruneSize = std::max(2*m_obstacles.size(), OBSTACLE_PRUNE_SIZE);
+    }
+
+    m_nearObstacles.clear();
+    for (int id : objectManager->GetCollisionCandidates(min, max))
+    {
+        CObject* obj = objectManager->GetObjectById(id);
+        if (IsObjectBeingTransported(obj))  continue;
+
+        NavigationObstacle& obstacle = m_obstacles[id];
+        if ( !IsObstacleCurrent(obstacle, obj) )
+        {
+            obstacle = CreateObstacle(obj);
+        }
+        m_nearObstacles.push_back(&obstacle);
+    }
+
+    return m_nearObstacles;
+}
+
+// Returns the terrain layer of a kind of robot, after dropping
+// all layers if the world changed since they were computed.
+
+const std::shared_ptr<NavigationTerrainLayer>& CNavigationGrid::FindTerrainLayer(const NavigationTerrainClass& terrainClass)
+{
+    if ( m_terrainRevision != m_terrain->GetRevision() ||
+         m_waterLevel != m_water->GetLevel() ||
+         m_flyingMaxHeight != m_terrain->GetFlyingMaxHeight() )
+    {
+        m_terrainLayers.clear();
+        m_terrainRevision = m_terrain->GetRevision();
+        m_waterLevel = m_water->GetLevel();
+        m_flyingMaxHeight = m_terrain->GetFlyingMaxHeight();
+    }
+
+    for (const auto& layer : m_terrainLayers)
+    {
+        if (layer->terrainClass == terrainClass)  return layer;
+    }
+
+    auto layer = std::make_shared<NavigationTerrainLayer>();
+    layer->terrainClass = terrainClass;
+    layer->size = m_size;
+    layer->computedBlocks.resize(m_blockCount*m_blockCount, false);
+    layer->cells.resize(m_size*m_size, 0);
+    m_terrainLayers.push_back(layer);
+    return m_terrainLayers.back();
+}
+
+// Makes sure the block containing the cell x:y is computed.
+
+void CNavigationGrid::PrepareTerrainCell(NavigationTerrainLayer& layer, int x, int y)
+{
+    if ( x < 0 || x >= m_size ||
+         y < 0 || y >= m_size )  return;
+
+    int blockX = x/TERRAIN_BLOCK_SIZE;
+    int blockY = y/TERRAIN_BLOCK_SIZE;
+    if ( !layer.computedBlocks[blockX+blockY*m_blockCount] )
+    {
+        ComputeTerrainBlock(layer, blockX, blockY);
+    }
+}
+
+void CNavigationGrid::ComputeTerrainBlock(NavigationTerrainLayer& layer, int blockX, int blockY)
+{
+    const NavigationTerrainClass& terrainClass = layer.terrainClass;
+
+    int minx = blockX*TERRAIN_BLOCK_SIZE;
+    int miny = blockY*TERRAIN_BLOCK_SIZE;
+    int maxx = std::min(minx+TERRAIN_BLOCK_SIZE, m_size);
+    int maxy = std::min(miny+TERRAIN_BLOCK_SIZE, m_size);
+
+    for (int y = miny; y < maxy; y++)
+    {
+        for (int x = minx; x < maxx; x++)
+        {
+            Math::Vector p;
+            p.x = x*BM_DIM_STEP-1600.0f;
+            p.z = y*BM_DIM_STEP-1600.0f;
+
+            unsigned char& cell = layer.cells[x+y*m_size];
+            cell = 0;
+
+            if ( terrainClass.fly )  // flying robot?
+            {
+                float h = m_terrain->GetFloorLevel(p, true);
+                if ( h >= m_flyingMaxHeight-5.0f )  cell |= TERRAIN_STEEP;
+                continue;
+            }
+
+            if ( !terrainClass.acceptWater )  // not going underwater?
+            {
+                float h = m_terrain->GetFloorLevel(p, true);
+                if ( h < m_waterLevel-2.0f )  // under water (*)?
+                {
+                    cell |= TERRAIN_UNDERWATER;
+                    continue;
+                }
+            }
+
+            if ( m_terrain->GetFineSlope(p) > terrainClass.slopeLimit )  cell |= TERRAIN_STEEP;
+        }
+    }
+
+    layer.computedBlocks[blockX+blockY*m_blockCount] = true;
+}
+
+// (*)  Accepts that a robot is 50cm under water, for example Tropica 3!
+
+bool CNavigationGrid::IsObstacleCurrent(const NavigationObstacle& obstacle, CObject* object)
+{
+    return obstacle.object == object &&
+           obstacle.terrainRevision == m_terrain->GetRevision() &&
+           obstacle.crashSphereRevision == object->GetCrashSphereRevision() &&
+           Math::VectorsEqual(obstacle.position, object->GetPosition()) &&
+           Math::VectorsEqual(obstacle.rotation, object->GetRotation());
+}
+
+NavigationObstacle CNavigationGrid::CreateObstacle(CObject* object)
+{
+    NavigationObstacle obstacle;
+    obstacle.object = object;
+    obstacle.type = object->GetType();
+    obstacle.position = object->GetPosition();
+    obstacle.rotation = object->GetRotation();
+    obstacle.crashSphereRevision = object->GetCrashSphereRevision();
+    obstacle.terrainRevision = m_terrain->GetRevision();
+    obstacle.floorLevel = m_terrain->GetFloorLevel(obstacle.position, false);
+
+    for (const auto& crashSphere : object->GetAllCrashSpheres())
+    {
+        obstacle.spheres.push_back(crashSphere.sphere);
+    }
+
+    return obstacle;
+}
@@ -0,0 +1,173 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+/**
+ * \file object/navigation_grid.h
+ * \brief Shared navigation grid used by goto()
+ */
+
+#pragma once
+
+#include "common/singleton.h"
+
+#include "math/intpoint.h"
+#include "math/sphere.h"
+#include "math/vector.h"
+
+#include "object/object_type.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace Gfx
+{
+class CTerrain;
+class CWater;
+} // namespace Gfx
+
+class CObject;
+
+//! Size of one cell of the navigation grid. Setting 5 means that 5x5 square (in game units) will be represented by 1 px on the bitmap. Decreasing this value will make a bigger bitmap, and may increase accuracy. TODO: Check how it actually impacts goto() accuracy
+const float BM_DIM_STEP = 5.0f;
+
+/**
+ * \struct NavigationTerrainClass
+ * \brief Terrain restrictions shared by all robots of the same kind
+ */
+struct NavigationTerrainClass
+{
+    //! Steepest slope the robot can climb, in radians
+    float slopeLimit = 0.0f;
+    //! Whether the robot can drive under water
+    bool  acceptWater = false;
+    //! Whether the robot flies (only the flying height limit matters)
+    bool  fly = false;
+
+    bool operator==(const NavigationTerrainClass& other) const
+    {
+        return slopeLimit == other.slopeLimit &&
+               acceptWater == other.acceptWater &&
+               fly == other.fly;
+    }
+};
+
+/**
+ * \struct NavigationTerrainLayer
+ * \brief Passability of the terrain for one kind of robot
+ *
+ * The cells are computed by blocks, only where goto() searches. A computed
+ * block is never modified again, so its cells can be read from any thread
+ * while other blocks of the layer are computed.
+ */
+struct NavigationTerrainLayer
+{
+    NavigationTerrainClass     terrainClass;
+    int                        size = 0;
+    std::vector<bool>          computedBlocks;
+    std::vector<unsigned char> cells;
+
+    //! Tests if the terrain blocks the cell x:y
+    //! The blocks of the cell and its four neighbours must be computed
+    bool IsBlocked(int x, int y) const;
+};
+
+/**
+ * \struct NavigationObstacle
+ * \brief Crash spheres of an object, as seen by goto()
+ */
+struct NavigationObstacle
+{
+    CObject*     object = nullptr;
+    ObjectType   type = OBJECT_NULL;
+    //! Ground level below the object
+    float        floorLevel = 0.0f;
+    //! Crash spheres in world coordinates
+    std::vector<Math::Sphere> spheres;
+
+    // State of the object when the spheres were computed
+    Math::Vector position;
+    Math::Vector rotation;
+    int          crashSphereRevision = 0;
+    int          terrainRevision = 0;
+};
+
+/**
+ * \class CNavigationGrid
+ * \brief World-level cache of the data needed to build goto() bitmaps
+ *
+ * The terrain layer of each NavigationTerrainClass is computed lazily by blocks
+ * and kept until the relief, the building levels, the water level or the flying
+ * height limit change. The obstacles are found with the collision grid of
+ * CObjectManager, and only the objects that moved or changed since they were
+ * last seen are recomputed. The number of terrain blocks computed in one frame
+ * is limited, however many robots are waiting for them.
+ */
+class CNavigationGrid : public CSingleton<CNavigationGrid>
+{
+public:
+    CNavigationGrid(Gfx::CTerrain* terrain, Gfx::CWater* water);
+    ~CNavigationGrid();
+
+    //! Returns the width or height of the grid, in cells
+    int         GetSize();
+
+    //! Tests if the terrain blocks the given cell for the given kind of robot
+    //! x:y: 0..GetSize()-1
+    bool        IsTerrainBlocked(const NavigationTerrainClass& terrainClass, int x, int y);
+    //! Computes the blocks of the terrain layer for the given kind of robot covering the cells min..max, within the budget of the frame
+    //! Returns the layer once IsBlocked() can be called for all these cells, nullptr before
+    std::shared_ptr<const NavigationTerrainLayer> GetTerrainLayer(const NavigationTerrainClass& terrainClass,
+                                                                  Math::IntPoint min, Math::IntPoint max);
+    //! Starts a new frame, allowing more terrain blocks to be computed
+    void        NewFrame();
+
+    //! Returns the crash spheres of the objects standing in the world which may touch the area from min to max (only x and z are used)
+    //! The obstacles are valid until the next call
+    const std::vector<const NavigationObstacle*>& GetObstacles(Math::Vector min, Math::Vector max);
+
+protected:
+    const std::shared_ptr<NavigationTerrainLayer>& FindTerrainLayer(const NavigationTerrainClass& terrainClass);
+    void        PrepareTerrainCell(NavigationTerrainLayer& layer, int x, int y);
+    void        ComputeTerrainBlock(NavigationTerrainLayer& layer, int blockX, int blockY);
+    bool        IsObstacleCurrent(const NavigationObstacle& obstacle, CObject* object);
+    NavigationObstacle CreateObstacle(CObject* object);
+
+protected:
+    Gfx::CTerrain*  m_terrain = nullptr;
+    Gfx::CWater*    m_water = nullptr;
+
+    int             m_size = 0;
+    int             m_blockCount = 0;
+    //! Terrain blocks that can still be computed during the current frame
+    int             m_blockBudget = 0;
+
+    // State of the world the terrain layers were computed for
+    int             m_terrainRevision = -1;
+    float           m_waterLevel = 0.0f;
+    float           m_flyingMaxHeight = 0.0f;
+    std::vector<std::shared_ptr<NavigationTerrainLayer>> m_terrainLayers;
+
+    //! Obstacles by object id, kept between the calls
+    std::unordered_map<int, NavigationObstacle> m_obstacles;
+    //! Size of m_obstacles above which the deleted objects are removed from it
+    std::size_t     m_obstaclePruneSize = 0;
+    //! Result of the last GetObstacles()
+    std::vector<const NavigationObstacle*> m_nearObstacles;
+};
@@ -30,6 +30,8 @@
 #include "level/parser/parserline.h"
 #include "level/parser/parserparam.h"
 
+#include "object/object_manager.h"
+
 #include "script/scriptfunc.h"
 
 #include <stdexcept>
@@ -41,6 +43,7 @@ CObject::CObject(int id, ObjectType type)
     , m_position(0.0f, 0.0f, 0.0f)
     , m_rotation(0.0f, 0.0f, 0.0f)
     , m_scale(1.0f, 1.0f, 1.0f)
+    , m_crashSphereRevision(0)
     , m_animateOnReset(false)
     , m_collisions(true)
     , m_team(0)
@@ -86,6 +89,10 @@ void CObject::SetCrashSpheres(const std::vector<Gfx::ModelCrashSphere>& crashSph
 void CObject::AddCrashSphere(const CrashSphere& crashSphere)
 {
     m_crashSpheres.push_back(crashSphere);
+    m_crashSphereRevision++;
+
+    if (CObjectManager::IsCreated())
+        CObjectManager::GetInstancePointer()->UpdateObjectPosition(this);
 }
 
 CrashSphere CObject::GetFirstCrashSphere()
@@ -259,6 +266,29 @@ int CObject::GetCrashSphereCount()
 void CObject::DeleteAllCrashSpheres()
 {
     m_crashSpheres.clear();
+    m_crashSphereRevision++;
+
+    if (CObjectManager::IsCreated())
+        CObjectManager::GetInstancePointer()->UpdateObjectPosition(this);
+}
+
+float CObject::GetCrashSphereExtent()
+{
+    // the spheres are scaled with the object, except the single ones centered on it
+    Math::Vector scale = GetScale();
+    float factor = Math::Max(1.0f, fabs(scale.x), fabs(scale.y), fabs(scale.z));
+
+    float extent = 0.0f;
+    for (const auto& crashSphere : m_crashSpheres)
+    {
+        extent = Math::Max(extent, (crashSphere.sphere.pos.Length() + crashSphere.sphere.radius)*factor);
+    }
+    return extent;
+}
+
+int CObject::GetCrashSphereRevision()
+{
+    return m_crashSphereRevision;
 }
 
 void CObject::SetCameraCollisionSphere(const Math::Sphere& sphere)
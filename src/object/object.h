@@ -153,6 +153,10 @@ public:
     std::vector<CrashSphere> GetAllCrashSpheres();
     //! Removes all crash spheres
     void DeleteAllCrashSpheres();
+    //! Returns the distance from the object's position within which all crash spheres lie, whatever the rotation
+    float GetCrashSphereExtent();
+    //! Returns a number which changes whenever the crash spheres, the jostling sphere or the scale of the object change
+    int GetCrashSphereRevision();
     //! Returns true if this object can collide with the other one
     bool CanCollideWith(CObject* other);
 
@@ -225,6 +229,7 @@ protected:
     Math::Vector m_rotation;
     Math::Vector m_scale;
     std::vector<CrashSphere> m_crashSpheres; //!< crash spheres
+    int m_crashSphereRevision; //!< see GetCrashSphereRevision()
     Math::Sphere m_cameraCollisionSphere;
     bool m_animateOnReset;
     bool m_collisions;
@@ -53,8 +53,9 @@ public:
                    Gfx::COldModelManager* oldModelManager,
                    Gfx::CModelManager* modelManager,
                    Gfx::CParticle* particle);
+    TEST_VIRTUAL ~CObjectFactory() = default;
 
-    CObjectUPtr CreateObject(const ObjectCreateParams& params);
+    TEST_VIRTUAL CObjectUPtr CreateObject(const ObjectCreateParams& params);
 
 private:
     CObjectUPtr CreateResource(const ObjectCreateParams& params);
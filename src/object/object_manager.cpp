@@ -32,10 +32,61 @@
 
 #include "object/auto/auto.h"
 
+#include "object/interface/jostleable_object.h"
+
 #include "physics/physics.h"
 
 #include <algorithm>
 
+namespace
+{
+
+//! Size of a cell of the radar grid
+const float RADAR_CELL_SIZE = 40.0f;
+
+//! Returns the radar grid row or column containing the given coordinate
+int GetRadarCellCoord(float coord)
+{
+    return static_cast<int>(floorf(coord / RADAR_CELL_SIZE));
+}
+
+//! Size of a cell of the collision grid
+const float COLLISION_CELL_SIZE = 16.0f;
+
+//! Returns the collision grid row or column containing the given coordinate
+int GetCollisionCellCoord(float coord)
+{
+    return static_cast<int>(floorf(coord / COLLISION_CELL_SIZE));
+}
+
+//! Returns the distance from the position of an object within which CPhysics::ObjectAdapt() may touch it
+float GetCollisionExtent(CObject* object)
+{
+    float extent = object->GetCrashSphereExtent();
+
+    if (object->Implements(ObjectInterfaceType::Jostleable))
+    {
+        extent = Math::Max(extent, dynamic_cast<CJostleableObject*>(object)->GetJostlingExtent());
+    }
+
+    // checkpoints are passed at some distance, whatever their crash spheres
+    if (object->GetType() == OBJECT_WAYPOINT) extent = Math::Max(extent, 4.0f);
+    if (object->GetType() == OBJECT_TARGET2)  extent = Math::Max(extent, 10.0f*1.5f);
+
+    return extent;
+}
+
+//! Removes a single object from an unsorted list
+void RemoveObjectFromList(std::vector<CObject*>& list, CObject* object)
+{
+    auto it = std::find(list.begin(), list.end(), object);
+    if (it == list.end()) return;
+    *it = list.back();
+    list.pop_back();
+}
+
+} // namespace
+
 CObjectManager::CObjectManager(Gfx::CEngine* engine,
                                Gfx::CTerrain* terrain,
                                Gfx::COldModelManager* oldModelManager,
@@ -52,6 +103,14 @@ CObjectManager::CObjectManager(Gfx::CEngine* engine,
 {
 }
 
+CObjectManager::CObjectManager(std::unique_ptr<CObjectFactory> objectFactory)
+  : m_objectFactory(std::move(objectFactory)),
+    m_nextId(0),
+    m_activeObjectIterators(0),
+    m_shouldCleanRemovedObjects(false)
+{
+}
+
 CObjectManager::~CObjectManager()
 {
 }
@@ -60,6 +119,9 @@ bool CObjectManager::DeleteObject(CObject* instance)
 {
     assert(instance != nullptr);
 
+    // Leave the indexes while the object still has its type and position
+    RemoveFromRadarIndex(instance);
+
     // TODO: temporarily...
     auto oldObj = dynamic_cast<COldObject*>(instance);
     if (oldObj != nullptr)
@@ -108,6 +170,12 @@ void CObjectManager::DeleteAllObjects()
     }
 
     m_objects.clear();
+    m_radarTypes.clear();
+    m_radarGrid.clear();
+    m_radarCells.clear();
+    m_radarObjectTypes.clear();
+    m_collisionGrid.clear();
+    m_collisionCells.clear();
 
     m_nextId = 0;
 }
@@ -154,6 +222,7 @@ CObject* CObjectManager::CreateObject(ObjectCreateParams params)
     CObject* objectPtr = objectUPtr.get();
 
     m_objects[params.id] = std::move(objectUPtr);
+    AddToRadarIndex(objectPtr);
 
     return objectPtr;
 }
@@ -179,6 +248,227 @@ float CObjectManager::ClampPower(ObjectType type, float power)
     return Math::Clamp(power, min, max);
 }
 
+int CObjectManager::GetRadarCell(int x, int z)
+{
+    x = Math::Clamp(x, -0x7FFF, 0x7FFF) + 0x8000;
+    z = Math::Clamp(z, -0x7FFF, 0x7FFF) + 0x8000;
+    return static_cast<int>((static_cast<unsigned int>(x) << 16) | static_cast<unsigned int>(z));
+}
+
+void CObjectManager::AddToRadarIndex(CObject* object)
+{
+    Math::Vector pos = object->GetPosition();
+    int cell = GetRadarCell(GetRadarCellCoord(pos.x), GetRadarCellCoord(pos.z));
+
+    m_radarTypes[object->GetType()].push_back(object);
+    m_radarGrid[cell].push_back(object);
+    m_radarCells[object] = cell;
+    m_radarObjectTypes[object] = object->GetType();
+
+    CollisionCells cells = GetCollisionCells(object);
+    AddToCollisionGrid(object, cells);
+    m_collisionCells[object] = cells;
+}
+
+void CObjectManager::RemoveFromRadarIndex(CObject* object)
+{
+    auto it = m_radarCells.find(object);
+    if (it == m_radarCells.end()) return;
+
+    RemoveObjectFromList(m_radarGrid[it->second], object);
+    auto typeIt = m_radarObjectTypes.find(object);
+    RemoveObjectFromList(m_radarTypes[typeIt->second], object);
+    m_radarObjectTypes.erase(typeIt);
+    m_radarCells.erase(it);
+
+    auto cellsIt = m_collisionCells.find(object);
+    if (cellsIt == m_collisionCells.end()) return;
+
+    RemoveFromCollisionGrid(object, cellsIt->second);
+    m_collisionCells.erase(cellsIt);
+}
+
+void CObjectManager::UpdateObjectPosition(CObject* object)
+{
+    auto it = m_radarCells.find(object);
+    if (it == m_radarCells.end()) return;  // not created yet, or already deleted
+
+    Math::Vector pos = object->GetPosition();
+    int cell = GetRadarCell(GetRadarCellCoord(pos.x), GetRadarCellCoord(pos.z));
+    if (cell != it->second)
+    {
+        RemoveObjectFromList(m_radarGrid[it->second], object);
+        m_radarGrid[cell].push_back(object);
+        it->second = cell;
+    }
+
+    CollisionCells& oldCells = m_collisionCells[object];
+    CollisionCells newCells = GetCollisionCells(object);
+    if (newCells == oldCells) return;
+
+    RemoveFromCollisionGrid(object, oldCells);
+    AddToCollisionGrid(object, newCells);
+    oldCells = newCells;
+}
+
+CObjectManager::CollisionCells CObjectManager::GetCollisionCells(CObject* object)
+{
+    Math::Vector pos = object->GetPosition();
+    float extent = GetCollisionExtent(object);
+
+    CollisionCells cells;
+    cells.minX = GetCollisionCellCoord(pos.x - extent);
+    cells.maxX = GetCollisionCellCoord(pos.x + extent);
+    cells.minZ = GetCollisionCellCoord(pos.z - extent);
+    cells.maxZ = GetCollisionCellCoord(pos.z + extent);
+    return cells;
+}
+
+void CObjectManager::AddToCollisionGrid(CObject* object, const CollisionCells& cells)
+{
+    for (int x = cells.minX; x <= cells.maxX; x++)
+    {
+        for (int z = cells.minZ; z <= cells.maxZ; z++)
+        {
+            m_collisionGrid[GetRadarCell(x, z)].push_back(object);
+        }
+    }
+}
+
+void CObjectManager::RemoveFromCollisionGrid(CObject* object, const CollisionCells& cells)
+{
+    for (int x = cells.minX; x <= cells.maxX; x++)
+    {
+        for (int z = cells.minZ; z <= cells.maxZ; z++)
+        {
+            auto it = m_collisionGrid.find(GetRadarCell(x, z));
+            if (it == m_collisionGrid.end()) continue;
+
+            RemoveObjectFromList(it->second, object);
+            if (it->second.empty()) m_collisionGrid.erase(it);
+        }
+    }
+}
+
+std::vector<int> CObjectManager::GetCollisionCandidates(Math::Vector center, float radius)
+{
+    return GetCollisionCandidates(Math::Vector(center.x - radius, 0.0f, center.z - radius),
+                                  Math::Vector(center.x + radius, 0.0f, center.z + radius));
+}
+
+std::vector<int> CObjectManager::GetCollisionCandidates(Math::Vector min, Math::Vector max)
+{
+    std::vector<CObject*> candidates;
+
+    CollisionCells area;
+    area.minX = GetCollisionCellCoord(min.x);
+    area.maxX = GetCollisionCellCoord(max.x);
+    area.minZ = GetCollisionCellCoord(min.z);
+    area.maxZ = GetCollisionCellCoord(max.z);
+
+    long long cellCount = static_cast<long long>(area.maxX - area.minX + 1) * (area.maxZ - area.minZ + 1);
+    if (cellCount > static_cast<long long>(m_collisionCells.size()))
+    {
+        // a large area, testing every object is faster than every cell
+        for (const auto& it : m_collisionCells)
+        {
+            const CollisionCells& cells = it.second;
+            if (cells.maxX < area.minX || cells.minX > area.maxX ||
+                cells.maxZ < area.minZ || cells.minZ > area.maxZ) continue;
+            candidates.push_back(it.first);
+        }
+    }
+    else
+    {
+        for (int x = area.minX; x <= area.maxX; x++)
+        {
+            for (int z = area.minZ; z <= area.maxZ; z++)
+            {
+                auto it = m_collisionGrid.find(GetRadarCell(x, z));
+                if (it == m_collisionGrid.end()) continue;
+                candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+            }
+        }
+    }
+
+    // large objects are in several cells
+    std::sort(candidates.begin(), candidates.end(), [](CObject* a, CObject* b) { return a->GetID() < b->GetID(); });
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    std::vector<int> ids;
+    ids.reserve(candidates.size());
+    for (CObject* object : candidates)
+    {
+        ids.push_back(object->GetID());
+    }
+    return ids;
+}
+
+std::vector<CObject*> CObjectManager::GetRadarCandidates(Math::Vector center, float maxDist,
+                                                         const std::vector<ObjectType>& type, bool cbotTypes)
+{
+    std::vector<CObject*> candidates;
+
+    if (type.size() > 0)
+    {
+        // only the objects of the requested types, including the ones merged by cbotTypes
+        std::vector<ObjectType> types = type;
+        if (cbotTypes)
+        {
+            if (std::find(type.begin(), type.end(), OBJECT_RUINmobilew1) != type.end())
+            {
+                types.insert(types.end(), { OBJECT_RUINmobilew2, OBJECT_RUINmobilet1, OBJECT_RUINmobilet2,
+                                            OBJECT_RUINmobiler1, OBJECT_RUINmobiler2 });
+            }
+            if (std::find(type.begin(), type.end(), OBJECT_BARRIER1) != type.end())
+            {
+                types.insert(types.end(), { OBJECT_BARRIER2, OBJECT_BARRIER3, OBJECT_BARRICADE0, OBJECT_BARRICADE1 });
+            }
+        }
+        std::sort(types.begin(), types.end());
+        types.erase(std::unique(types.begin(), types.end()), types.end());
+
+        for (ObjectType t : types)
+        {
+            auto it = m_radarTypes.find(t);
+            if (it == m_radarTypes.end()) continue;
+            candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+        }
+    }
+    else
+    {
+        int minX = GetRadarCellCoord(center.x - maxDist);
+        int maxX = GetRadarCellCoord(center.x + maxDist);
+        int minZ = GetRadarCellCoord(center.z - maxDist);
+        int maxZ = GetRadarCellCoord(center.z + maxDist);
+
+        float cellCount = static_cast<float>(maxX - minX + 1) * static_cast<float>(maxZ - minZ + 1);
+        if (cellCount > static_cast<float>(m_radarGrid.size()))
+        {
+            // the search area covers most of the map, faster to look at everything
+            for (auto& it : m_objects)
+            {
+                if (it.second != nullptr) candidates.push_back(it.second.get());
+            }
+            return candidates;
+        }
+
+        for (int x = minX; x <= maxX; x++)
+        {
+            for (int z = minZ; z <= maxZ; z++)
+            {
+                auto it = m_radarGrid.find(GetRadarCell(x, z));
+                if (it == m_radarGrid.end()) continue;
+                candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+            }
+        }
+    }
+
+    // same order as m_objects, so that objects at the same distance are found in the same order
+    std::sort(candidates.begin(), candidates.end(), [](CObject* a, CObject* b) { return a->GetID() < b->GetID(); });
+    return candidates;
+}
+
 std::vector<CObject*> CObjectManager::GetObjectsOfTeam(int team)
 {
     std::vector<CObject*> result;
@@ -294,12 +584,11 @@ std::vector<CObject*> CObjectManager::RadarAll(CObject* pThis, Math::Vector this
     // from the origin to be returned.
     std::multimap<float, CObject*> best;
 
-    for ( auto it = m_objects.begin() ; it != m_objects.end() ; ++it )
+    for (CObject* candidate : GetRadarCandidates(iPos, maxDist, type, cbotTypes))
     {
-        pObj = it->second.get();
+        pObj = candidate;
         if ( pObj == pThis )  continue; // pThis may be nullptr but it doesn't matter
 
-        if (pObj == nullptr) continue;
         if (IsObjectBeingTransported(pObj))  continue;
         if ( !pObj->GetDetectable() )  continue;
         if ( pObj->GetProxyActivate() )  continue;
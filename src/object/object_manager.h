@@ -36,6 +36,7 @@
 #include "object/interface/destroyable_object.h"
 
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include <memory>
 
@@ -155,6 +156,8 @@ public:
                    Gfx::COldModelManager* oldModelManager,
                    Gfx::CModelManager* modelManager,
                    Gfx::CParticle* particle);
+    //! Creates the manager with the given factory, used by the tests
+    explicit CObjectManager(std::unique_ptr<CObjectFactory> objectFactory);
     virtual ~CObjectManager();
 
     //! Creates an object
@@ -187,6 +190,16 @@ public:
     //! Counts all objects implementing given interface
     int CountObjectsImplementing(ObjectInterfaceType interface);
 
+    //! Must be called whenever the position, the scale or the crash spheres of an object change, keeps the radar and collision grids up to date
+    void      UpdateObjectPosition(CObject* object);
+
+    //! Returns the ids of the objects which may touch the given sphere, for the collisions in CPhysics
+    /** Ids rather than pointers, as a collision may delete the objects which follow it;
+     *  they are sorted like GetAllObjects() */
+    std::vector<int> GetCollisionCandidates(Math::Vector center, float radius);
+    //! Returns the ids of the objects which may touch the area from min to max (only x and z are used), sorted like GetAllObjects()
+    std::vector<int> GetCollisionCandidates(Math::Vector min, Math::Vector max);
+
     //! Returns all objects
     CObjectContainerProxy GetAllObjects()
     {
@@ -307,8 +320,47 @@ private:
     float ClampPower(ObjectType type, float power);
     void CleanRemovedObjectsIfNeeded();
 
+    //! Adds the object to the indexes used by RadarAll()
+    void AddToRadarIndex(CObject* object);
+    //! Removes the object from the indexes used by RadarAll()
+    void RemoveFromRadarIndex(CObject* object);
+    //! Returns the objects which may be found by RadarAll(), in the order of their ids
+    std::vector<CObject*> GetRadarCandidates(Math::Vector center, float maxDist,
+                                             const std::vector<ObjectType>& type, bool cbotTypes);
+    //! Returns the key of the radar grid cell containing the given position
+    static int GetRadarCell(int x, int z);
+
+    //! Range of collision grid cells covered by an object
+    struct CollisionCells
+    {
+        int minX, maxX, minZ, maxZ;
+
+        bool operator==(const CollisionCells& other) const
+        {
+            return minX == other.minX && maxX == other.maxX && minZ == other.minZ && maxZ == other.maxZ;
+        }
+    };
+    //! Returns the collision grid cells the crash spheres of the object may touch
+    static CollisionCells GetCollisionCells(CObject* object);
+    //! Adds the object to the given cells of the collision grid
+    void AddToCollisionGrid(CObject* object, const CollisionCells& cells);
+    //! Removes the object from the given cells of the collision grid
+    void RemoveFromCollisionGrid(CObject* object, const CollisionCells& cells);
+
 private:
     CObjectMap m_objects;
+    //! Objects by type
+    std::map<ObjectType, std::vector<CObject*>> m_radarTypes;
+    //! Objects by radar grid cell, see GetRadarCell()
+    std::unordered_map<int, std::vector<CObject*>> m_radarGrid;
+    //! Radar grid cell of each object
+    std::unordered_map<CObject*, int> m_radarCells;
+    //! Type each object was indexed under in m_radarTypes
+    std::unordered_map<CObject*, ObjectType> m_radarObjectTypes;
+    //! Objects by collision grid cell, an object is in every cell its crash spheres may touch
+    std::unordered_map<int, std::vector<CObject*>> m_collisionGrid;
+    //! Collision grid cells of each object
+    std::unordered_map<CObject*, CollisionCells> m_collisionCells;
     std::unique_ptr<CObjectFactory> m_objectFactory;
     int m_nextId;
     int m_activeObjectIterators;
@@ -1332,6 +1332,12 @@ void COldObject::SetJostlingSphere(const Math::Sphere& jostlingSphere)
 {
     m_jostlingSphere = jostlingSphere;
     m_implementedInterfaces[static_cast<int>(ObjectInterfaceType::Jostleable)] = true;
+    m_crashSphereRevision ++;
+
+    if ( CObjectManager::IsCreated() )
+    {
+        CObjectManager::GetInstancePointer()->UpdateObjectPosition(this);
+    }
 }
 
 // Specifies the sphere of jostling, in the world.
@@ -1343,6 +1349,13 @@ Math::Sphere COldObject::GetJostlingSphere() const
     return transformedJostlingSphere;
 }
 
+float COldObject::GetJostlingExtent() const
+{
+    Math::Vector zoom = m_objectPart[0].zoom;
+    float scale = Math::Max(1.0f, fabs(zoom.x), fabs(zoom.y), fabs(zoom.z));
+    return m_jostlingSphere.pos.Length()*scale + m_jostlingSphere.radius;
+}
+
 
 // Positioning an object on a certain height, above the ground.
 
@@ -1468,6 +1481,11 @@ void COldObject::SetPartPosition(int part, const Math::Vector &pos)
             m_lightMan->SetLightPos(m_shadowLight, lightPos);
         }
     }
+
+    if ( part == 0 && CObjectManager::IsCreated() )
+    {
+        CObjectManager::GetInstancePointer()->UpdateObjectPosition(this);
+    }
 }
 
 Math::Vector COldObject::GetPartPosition(int part) const
@@ -1550,6 +1568,15 @@ void COldObject::SetPartScale(int part, float zoom)
     m_objectPart[part].bZoom = ( m_objectPart[part].zoom.x != 1.0f ||
                                  m_objectPart[part].zoom.y != 1.0f ||
                                  m_objectPart[part].zoom.z != 1.0f );
+
+    if ( part == 0 )
+    {
+        m_crashSphereRevision ++;  // the crash spheres are scaled with the object
+        if ( CObjectManager::IsCreated() )
+        {
+            CObjectManager::GetInstancePointer()->UpdateObjectPosition(this);
+        }
+    }
 }
 
 void COldObject::SetPartScale(int part, Math::Vector zoom)
@@ -1560,6 +1587,15 @@ void COldObject::SetPartScale(int part, Math::Vector zoom)
     m_objectPart[part].bZoom = ( m_objectPart[part].zoom.x != 1.0f ||
                                  m_objectPart[part].zoom.y != 1.0f ||
                                  m_objectPart[part].zoom.z != 1.0f );
+
+    if ( part == 0 )
+    {
+        m_crashSphereRevision ++;  // the crash spheres are scaled with the object
+        if ( CObjectManager::IsCreated() )
+        {
+            CObjectManager::GetInstancePointer()->UpdateObjectPosition(this);
+        }
+    }
 }
 
 Math::Vector COldObject::GetPartScale(int part) const
@@ -211,6 +211,7 @@ public:
     void        SetTransparency(float value) override;
 
     Math::Sphere GetJostlingSphere() const override;
+    float       GetJostlingExtent() const override;
     bool        JostleObject(float force) override;
 
     void        SetVirusMode(bool bEnable) override;
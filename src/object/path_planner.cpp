@@ -0,0 +1,184 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+#include "object/path_planner.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+
+//! Cost of a diagonal move
+const float DIAGONAL_COST = 1.41421356f;
+
+//! The 8 directions, the 4 straight ones first
+const int DIRECTIONS[8][2] =
+{
+    { 1,  0}, {-1,  0}, { 0,  1}, { 0, -1},
+    { 1,  1}, {-1,  1}, { 1, -1}, {-1, -1},
+};
+
+} // anonymous namespace
+
+
+CPathPlanner::CPathPlanner()
+{
+}
+
+CPathPlanner::~CPathPlanner()
+{
+}
+
+void CPathPlanner::Start(int size, Math::IntPoint start, Math::IntPoint goal, float goalRadius, int maxNodes)
+{
+    m_size = size;
+    m_goal = goal;
+    m_goalRadius = goalRadius;
+    m_maxNodes = maxNodes;
+
+    m_nodes.clear();
+    m_open.clear();
+    m_path.clear();
+
+    start.x = std::min(std::max(start.x, 0), m_size-1);
+    start.y = std::min(std::max(start.y, 0), m_size-1);
+    Open(start.x+start.y*m_size, -1, 0.0f);
+}
+
+Error CPathPlanner::Search(const BlockedFunc& isBlocked, int maxExpansions)
+{
+    for (int i = 0; i < maxExpansions; i++)
+    {
+        if (m_open.empty())  return ERR_GOTO_IMPOSSIBLE;
+
+        std::pop_heap(m_open.begin(), m_open.end(), IsWorse);
+        OpenNode current = m_open.back();
+        m_open.pop_back();
+
+        Node& node = m_nodes[current.cell];
+        if (node.closed || current.cost > node.cost)  continue;  // outdated entry
+        node.closed = true;
+
+        int x = current.cell%m_size;
+        int y = current.cell/m_size;
+
+        if (IsGoal(x, y))
+        {
+            BuildPath(current.cell);
+            return ERR_OK;
+        }
+
+        for (int dir = 0; dir < 8; dir++)
+        {
+            int dx = DIRECTIONS[dir][0];
+            int dy = DIRECTIONS[dir][1];
+            int nx = x+dx;
+            int ny = y+dy;
+
+            if (nx < 0 || nx >= m_size ||
+                ny < 0 || ny >= m_size)  continue;
+
+            int cell = nx+ny*m_size;
+            bool diagonal = dx != 0 && dy != 0;
+            float cost = current.cost + (diagonal ? DIAGONAL_COST : 1.0f);
+
+            auto it = m_nodes.find(cell);
+            if (it != m_nodes.end())
+            {
+                if (it->second.closed || cost >= it->second.cost)  continue;
+            }
+
+            if (isBlocked(nx, ny))  continue;
+            if (diagonal && (isBlocked(x+dx, y) || isBlocked(x, y+dy)))  continue;  // no corner cutting
+
+            if (it == m_nodes.end() && static_cast<int>(m_nodes.size()) >= m_maxNodes)
+            {
+                return ERR_GOTO_ITER;
+            }
+
+            Open(cell, current.cell, cost);
+        }
+    }
+
+    return ERR_CONTINUE;
+}
+
+const std::vector<Math::IntPoint>& CPathPlanner::GetPath() const
+{
+    return m_path;
+}
+
+// Orders the heap: smallest estimate first, and on equal estimates
+// the cell furthest from the start, to go straight to the goal.
+
+bool CPathPlanner::IsWorse(const OpenNode& a, const OpenNode& b)
+{
+    if (a.estimate != b.estimate)  return a.estimate > b.estimate;
+    return a.cost < b.cost;
+}
+
+// Never overestimates the remaining cost, so that the path found is the shortest.
+
+float CPathPlanner::Heuristic(int x, int y) const
+{
+    float dx = static_cast<float>(abs(x-m_goal.x));
+    float dy = static_cast<float>(abs(y-m_goal.y));
+
+    if (m_goalRadius == 0.0f)  // octile distance
+    {
+        return std::max(dx, dy) + (DIAGONAL_COST-1.0f)*std::min(dx, dy);
+    }
+
+    return std::max(sqrtf(dx*dx+dy*dy)-m_goalRadius, 0.0f);
+}
+
+bool CPathPlanner::IsGoal(int x, int y) const
+{
+    if (m_goalRadius == 0.0f)  return x == m_goal.x && y == m_goal.y;
+
+    float dx = static_cast<float>(x-m_goal.x);
+    float dy = static_cast<float>(y-m_goal.y);
+    return dx*dx+dy*dy <= m_goalRadius*m_goalRadius;
+}
+
+void CPathPlanner::Open(int cell, int parent, float cost)
+{
+    Node& node = m_nodes[cell];
+    node.cost = cost;
+    node.parent = parent;
+
+    OpenNode open;
+    open.estimate = cost + Heuristic(cell%m_size, cell/m_size);
+    open.cost = cost;
+    open.cell = cell;
+    m_open.push_back(open);
+    std::push_heap(m_open.begin(), m_open.end(), IsWorse);
+}
+
+void CPathPlanner::BuildPath(int cell)
+{
+    m_path.clear();
+    for ( ; cell != -1; cell = m_nodes[cell].parent)
+    {
+        m_path.push_back(Math::IntPoint(cell%m_size, cell/m_size));
+    }
+    std::reverse(m_path.begin(), m_path.end());
+}
@@ -0,0 +1,95 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+/**
+ * \file object/path_planner.h
+ * \brief A* search over the goto() bitmap
+ */
+
+#pragma once
+
+#include "common/error.h"
+
+#include "math/intpoint.h"
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * \class CPathPlanner
+ * \brief Incremental A* search on a square grid of cells
+ *
+ * The search moves in 8 directions without cutting the corners of blocked
+ * cells. It can be interrupted after a given number of expanded cells and
+ * resumed later, so that a long search is spread over several frames.
+ * The number of cells visited by one search is limited, and the containers
+ * keep their memory from one search to the next.
+ */
+class CPathPlanner
+{
+public:
+    //! Returns true if the cell x:y cannot be crossed
+    using BlockedFunc = std::function<bool(int x, int y)>;
+
+    CPathPlanner();
+    ~CPathPlanner();
+
+    //! Starts a new search on a grid of size x size cells
+    //! goalRadius: distance in cells at which the goal is considered reached
+    //! maxNodes: maximum number of cells visited before giving up
+    void        Start(int size, Math::IntPoint start, Math::IntPoint goal, float goalRadius, int maxNodes);
+    //! Continues the search, expanding at most maxExpansions cells
+    //! Returns ERR_OK if a path was found, ERR_CONTINUE if not done yet,
+    //! ERR_GOTO_IMPOSSIBLE if there is no path and ERR_GOTO_ITER if too many cells were visited
+    Error       Search(const BlockedFunc& isBlocked, int maxExpansions);
+    //! Returns the cells of the path found, from the start to the goal
+    const std::vector<Math::IntPoint>& GetPath() const;
+
+protected:
+    struct Node
+    {
+        float   cost = 0.0f;    // cost from the start
+        int     parent = -1;    // previous cell on the best path
+        bool    closed = false;
+    };
+
+    struct OpenNode
+    {
+        float   estimate;       // cost from the start + heuristic
+        float   cost;
+        int     cell;
+    };
+
+    static bool IsWorse(const OpenNode& a, const OpenNode& b);
+    float       Heuristic(int x, int y) const;
+    bool        IsGoal(int x, int y) const;
+    void        Open(int cell, int parent, float cost);
+    void        BuildPath(int cell);
+
+protected:
+    int         m_size = 0;
+    Math::IntPoint m_goal;
+    float       m_goalRadius = 0.0f;
+    int         m_maxNodes = 0;
+
+    std::unordered_map<int, Node> m_nodes;
+    std::vector<OpenNode> m_open;   // binary heap, smallest estimate first
+    std::vector<Math::IntPoint> m_path;
+};
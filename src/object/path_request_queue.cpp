@@ -0,0 +1,110 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+#include "object/path_request_queue.h"
+
+#include "object/navigation_grid.h"
+
+namespace
+{
+
+//! Number of cells a search may visit before giving up
+const int PATH_MAX_NODES = 100000;
+//! Number of cells expanded between two checks for cancellation
+const int PATH_SEARCH_CHUNK = 1000;
+//! Number of results the tasks can apply in one frame
+const int PATH_RESULTS_PER_FRAME = 4;
+
+} // anonymous namespace
+
+
+bool PathRequest::IsBlocked(int x, int y) const
+{
+    if ( x < min.x || x > max.x ||
+         y < min.y || y > max.y )  return true;
+
+    int line = size/8;
+    if ( objects[line*y + x/8] & (1<<x%8) )  return true;
+    if ( cleared[line*y + x/8] & (1<<x%8) )  return false;
+    return terrain->IsBlocked(x, y);
+}
+
+
+CPathRequestQueue::CPathRequestQueue()
+    : m_thread("Path planning thread")
+{
+}
+
+CPathRequestQueue::~CPathRequestQueue()
+{
+}
+
+void CPathRequestQueue::Submit(const std::shared_ptr<PathRequest>& request)
+{
+    // The function keeps the request alive until the search is over
+    std::shared_ptr<PathRequest> queued = request;
+    m_thread.Start([this, queued]()
+    {
+        Search(*queued);
+    });
+}
+
+bool CPathRequestQueue::TakeResult(const std::shared_ptr<PathRequest>& request)
+{
+    if ( !request->done.load(std::memory_order_acquire) )  return false;
+    if ( m_resultCount >= PATH_RESULTS_PER_FRAME )  return false;
+
+    m_resultCount ++;
+    return true;
+}
+
+void CPathRequestQueue::NewFrame()
+{
+    m_resultCount = 0;
+}
+
+// Called by the worker thread.
+
+void CPathRequestQueue::Search(PathRequest& request)
+{
+    if ( !request.cancelled.load(std::memory_order_relaxed) )
+    {
+        m_planner.Start(request.size, request.start, request.goal, request.goalRadius, PATH_MAX_NODES);
+        auto isBlocked = [&request](int x, int y) { return request.IsBlocked(x, y); };
+        Error result = ERR_CONTINUE;
+        while ( result == ERR_CONTINUE )
+        {
+            // Stops early if the robot gave up waiting, so the next request isn't delayed
+            if ( request.cancelled.load(std::memory_order_relaxed) )  break;
+            result = m_planner.Search(isBlocked, PATH_SEARCH_CHUNK);
+        }
+
+        if ( result == ERR_OK )
+        {
+            request.path = m_planner.GetPath();
+        }
+        else if ( result != ERR_GOTO_IMPOSSIBLE )
+        {
+            result = ERR_GOTO_ITER;  // too many cells or cancelled, the request is never resumed
+        }
+        request.result = result;
+    }
+
+    request.done.store(true, std::memory_order_release);
+}
@@ -0,0 +1,113 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+/**
+ * \file object/path_request_queue.h
+ * \brief Path searches for goto() running on a worker thread
+ */
+
+#pragma once
+
+#include "common/error.h"
+#include "common/singleton.h"
+
+#include "common/thread/worker_thread.h"
+
+#include "math/intpoint.h"
+
+#include "object/path_planner.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+struct NavigationTerrainLayer;
+
+/**
+ * \struct PathRequest
+ * \brief Path search queued by goto()
+ *
+ * The request contains a copy of everything the search needs, so it can run
+ * while the world changes. Its input must not be modified once queued, and its
+ * output can only be read once IsDone() returns true.
+ */
+struct PathRequest
+{
+    //! Width or height of the grid, in cells
+    int             size = 0;
+    Math::IntPoint  start;
+    Math::IntPoint  goal;
+    //! Distance in cells at which the goal is considered reached
+    float           goalRadius = 0.0f;
+    //! Cells the path can go through, the others are blocked
+    Math::IntPoint  min;
+    Math::IntPoint  max;
+    //! Bitmap of the cells blocked by objects (size/8 bytes per line)
+    std::vector<unsigned char> objects;
+    //! Bitmap of the cells where the terrain is ignored (size/8 bytes per line)
+    std::vector<unsigned char> cleared;
+    //! Terrain of the kind of robot, computed at least from min to max
+    std::shared_ptr<const NavigationTerrainLayer> terrain;
+
+    //! Result of the search, see CPathPlanner::Search()
+    Error           result = ERR_CONTINUE;
+    //! Cells of the path found, from the start to the goal
+    std::vector<Math::IntPoint> path;
+
+    //! Set by the worker thread when the result is available
+    std::atomic<bool> done{false};
+    //! Set by the requester when it no longer waits for the result
+    std::atomic<bool> cancelled{false};
+
+    //! Tests if the cell x:y cannot be crossed
+    bool        IsBlocked(int x, int y) const;
+};
+
+/**
+ * \class CPathRequestQueue
+ * \brief Runs the path searches of goto() on a worker thread
+ *
+ * Requests are searched one at a time, in the order they were queued.
+ * The number of results applied by the tasks in one frame is limited,
+ * so that many robots starting a goto() at once do not freeze the game.
+ */
+class CPathRequestQueue : public CSingleton<CPathRequestQueue>
+{
+public:
+    CPathRequestQueue();
+    ~CPathRequestQueue();
+
+    //! Queues a request, searched later by the worker thread
+    void        Submit(const std::shared_ptr<PathRequest>& request);
+    //! Tests if the result of a request is available and can still be applied during this frame
+    bool        TakeResult(const std::shared_ptr<PathRequest>& request);
+    //! Starts a new frame, allowing new results to be applied
+    void        NewFrame();
+
+protected:
+    void        Search(PathRequest& request);
+
+protected:
+    //! Results applied during the current frame
+    int             m_resultCount = 0;
+    //! Planner used by the worker thread only
+    CPathPlanner    m_planner;
+    //! Declared last so that it stops before the planner is destroyed
+    CWorkerThread   m_thread;
+};
@@ -30,8 +30,10 @@
 
 #include "math/geometry.h"
 
+#include "object/navigation_grid.h"
 #include "object/object_manager.h"
 #include "object/old_object.h"
+#include "object/path_request_queue.h"
 
 #include "object/interface/transportable_object.h"
 
@@ -39,6 +41,7 @@
 
 #include "physics/physics.h"
 
+#include <algorithm>
 #include <string.h>
 
 
@@ -46,8 +49,9 @@ const float FLY_DIST_GROUND = 80.0f;    // minimum distance to remain on the gro
 const float FLY_DEF_HEIGHT  = 50.0f;    // default flying height
 
 // Settings that define goto() accuracy:
-const float BM_DIM_STEP     = 5.0f;     // Size of one pixel on the bitmap. Setting 5 means that 5x5 square (in game units) will be represented by 1 px on the bitmap. Decreasing this value will make a bigger bitmap, and may increase accuracy. TODO: Check how it actually impacts goto() accuracy
 const float BEAM_ACCURACY   = 5.0f;    // higher value = more accurate, but slower
+const int   PATH_LOOKAHEAD   = 40;      // number of cells of the A* path merged at most into one straight line
+const int   PATH_MARGIN      = 32;      // number of cells around the start and the goal the A* path can go through
 const float SAFETY_MARGIN   = 0.5f;     // Smallest distance between two objects. Smaller = less "no route to destination", but higher probability of collisions between objects.
 // Changing SAFETY_MARGIN (old value was 4.0f) seems to have fixed many issues with goto(). TODO: maybe we could make it even smaller? Did changing it introduce any new bugs?
 
@@ -65,6 +69,7 @@ CTaskGoto::CTaskGoto(COldObject* object) : CForegroundTask(object)
 
 CTaskGoto::~CTaskGoto()
 {
+    PathCancel();
     BitmapClose();
 
     if (m_engine->GetDebugGoto() && m_object->GetSelect())
@@ -220,7 +225,14 @@ bool CTaskGoto::EventProcess(const Event &event)
             if ( m_bmCargoObject->GetType() == OBJECT_BASE )  dist = 12.0f;
         }
 
-        ret = BeamSearch(pos, goal, dist);
+        if ( m_crashMode == TGC_ASTAR )
+        {
+            ret = PathSearch(pos, goal, dist);
+        }
+        else
+        {
+            ret = BeamSearch(pos, goal, dist);
+        }
         if ( ret == ERR_OK )
         {
             if ( m_physics->GetLand() )  m_phase = TGP_BEAMWCOLD;
@@ -704,7 +716,7 @@ Error CTaskGoto::Start(Math::Vector goal, float altitude,
 
     pos = m_object->GetPosition();
     dist = Math::DistanceProjected(pos, m_goal);
-    if ( dist < 10.0f && m_crashMode == TGC_BEAM )
+    if ( dist < 10.0f && (m_crashMode == TGC_BEAM || m_crashMode == TGC_ASTAR) )
     {
         m_crashMode = TGC_RIGHTLEFT;
     }
@@ -733,7 +745,7 @@ Error CTaskGoto::Start(Math::Vector goal, float altitude,
         m_bApprox = true;
     }
 
-    if ( !m_bApprox && m_crashMode != TGC_BEAM )
+    if ( !m_bApprox && m_crashMode != TGC_BEAM && m_crashMode != TGC_ASTAR )
     {
         target = SearchTarget(goal, 1.0f);
         if ( target != nullptr )
@@ -752,7 +764,7 @@ Error CTaskGoto::Start(Math::Vector goal, float altitude,
     m_lastDistance = 1000.0f;
     m_physics->SetCollision(false);
 
-    if ( m_crashMode == TGC_BEAM )  // with the algorithm of rays?
+    if ( m_crashMode == TGC_BEAM || m_crashMode == TGC_ASTAR )  // with the algorithm of rays or A*?
     {
         target = SearchTarget(goal, 1.0f);
         if ( target != nullptr )
@@ -1644,21 +1656,9 @@ int CTaskGoto::BeamShortcut()
 
 void CTaskGoto::BeamStart()
 {
-    Math::Vector    min, max;
-
     BitmapOpen();
     BitmapObject();
 
-    min = m_object->GetPosition();
-    max = m_goal;
-    if ( min.x > max.x )  Math::Swap(min.x, max.x);
-    if ( min.z > max.z )  Math::Swap(min.z, max.z);
-    min.x -= 10.0f*BM_DIM_STEP;
-    min.z -= 10.0f*BM_DIM_STEP;
-    max.x += 10.0f*BM_DIM_STEP;
-    max.z += 10.0f*BM_DIM_STEP;
-    BitmapTerrain(min, max);
-
     if ( LeakSearch(m_leakPos, m_leakDelay) )
     {
         m_phase = TGP_BEAMLEAK;  // must first leak
@@ -1679,6 +1679,8 @@ void CTaskGoto::BeamInit()
 {
     int     i;
 
+    PathCancel();
+
     for ( i=0 ; i<MAXPOINTS ; i++ )
     {
         m_bmIter[i] = -1;
@@ -1829,6 +1831,122 @@ Math::Vector CTaskGoto::BeamPoint(const Math::Vector &startPoint,
     return resPoint;
 }
 
+// Calculates points to go from start to goal with an A* search on the bitmap.
+// The search runs on the worker thread of CPathRequestQueue, once the terrain
+// of the robot has been prepared. Returns the same values as BeamSearch.
+// goalRadius: distance at which we must approach the goal
+
+Error CTaskGoto::PathSearch(const Math::Vector &start, const Math::Vector &goal,
+                            float goalRadius)
+{
+    if ( m_bmStep == 0 )
+    {
+        Math::IntPoint min, max;
+        GetPathBounds(start, goal, min, max);
+
+        std::shared_ptr<const NavigationTerrainLayer> terrain =
+            CNavigationGrid::GetInstancePointer()->GetTerrainLayer(m_bmTerrainClass, min, max);
+        if ( terrain == nullptr )  return ERR_CONTINUE;  // terrain not ready yet
+
+        PathCancel();
+        m_bmRequest = std::make_shared<PathRequest>();
+        m_bmRequest->size = m_bmSize;
+        m_bmRequest->start = Math::IntPoint(static_cast<int>((start.x+1600.0f)/BM_DIM_STEP),
+                                            static_cast<int>((start.z+1600.0f)/BM_DIM_STEP));
+        m_bmRequest->goal = Math::IntPoint(static_cast<int>((goal.x+1600.0f)/BM_DIM_STEP),
+                                           static_cast<int>((goal.z+1600.0f)/BM_DIM_STEP));
+        m_bmRequest->goalRadius = goalRadius/BM_DIM_STEP;
+        m_bmRequest->min = min;
+        m_bmRequest->max = max;
+        unsigned char* objects = m_bmArray.get();                      // rank 0
+        unsigned char* cleared = m_bmArray.get()+2*m_bmLine*m_bmSize;  // rank 2
+        m_bmRequest->objects.assign(objects, objects+m_bmLine*m_bmSize);
+        m_bmRequest->cleared.assign(cleared, cleared+m_bmLine*m_bmSize);
+        m_bmRequest->terrain = terrain;
+        CPathRequestQueue::GetInstancePointer()->Submit(m_bmRequest);
+
+        m_bmStep ++;
+        return ERR_CONTINUE;
+    }
+
+    if ( m_bmRequest == nullptr )  // result already taken, search again
+    {
+        m_bmStep = 0;
+        return ERR_CONTINUE;
+    }
+    if ( !CPathRequestQueue::GetInstancePointer()->TakeResult(m_bmRequest) )  return ERR_CONTINUE;
+
+    std::shared_ptr<PathRequest> request = std::move(m_bmRequest);
+    m_bmStep = 0;
+    if ( request->result != ERR_OK )  return request->result;
+
+    // Converts the cells to points, from the exact start to the exact goal.
+    const std::vector<Math::IntPoint>& path = request->path;
+    std::vector<Math::Vector> points;
+    points.push_back(start);
+    for ( int i=1 ; i<static_cast<int>(path.size())-1 ; i++ )
+    {
+        points.push_back(Math::Vector((path[i].x+0.5f)*BM_DIM_STEP-1600.0f, 0.0f,
+                                      (path[i].y+0.5f)*BM_DIM_STEP-1600.0f));
+    }
+    if ( goalRadius == 0.0f )
+    {
+        points.push_back(goal);
+    }
+    else
+    {
+        points.push_back(Math::Vector((path.back().x+0.5f)*BM_DIM_STEP-1600.0f, 0.0f,
+                                      (path.back().y+0.5f)*BM_DIM_STEP-1600.0f));
+    }
+
+    // Skips the points that can be bypassed in a straight line.
+    int last = static_cast<int>(points.size())-1;
+    int anchor = 0;
+    m_bmPoints[0] = points[0];
+    m_bmTotal = 0;
+    while ( anchor < last )
+    {
+        int next = anchor+1;
+        while ( next < last && next-anchor < PATH_LOOKAHEAD &&
+                BitmapTestLine(points[anchor], points[next+1], 0.0f, false) )
+        {
+            next ++;
+        }
+
+        if ( m_bmTotal >= MAXPOINTS )  return ERR_GOTO_ITER;
+        m_bmPoints[++m_bmTotal] = points[next];
+        anchor = next;
+    }
+    return ERR_OK;
+}
+
+// Computes the cells the A* path can go through. Like the old beam search,
+// only the terrain around the start and the goal is used.
+
+void CTaskGoto::GetPathBounds(const Math::Vector &start, const Math::Vector &goal,
+                              Math::IntPoint &min, Math::IntPoint &max)
+{
+    int startX = static_cast<int>((start.x+1600.0f)/BM_DIM_STEP);
+    int startY = static_cast<int>((start.z+1600.0f)/BM_DIM_STEP);
+    int goalX = static_cast<int>((goal.x+1600.0f)/BM_DIM_STEP);
+    int goalY = static_cast<int>((goal.z+1600.0f)/BM_DIM_STEP);
+
+    min.x = std::max(std::min(startX, goalX)-PATH_MARGIN, 0);
+    min.y = std::max(std::min(startY, goalY)-PATH_MARGIN, 0);
+    max.x = std::min(std::max(startX, goalX)+PATH_MARGIN, m_bmSize-1);
+    max.y = std::min(std::max(startY, goalY)+PATH_MARGIN, m_bmSize-1);
+}
+
+// Abandons the A* search in progress.
+
+void CTaskGoto::PathCancel()
+{
+    if ( m_bmRequest == nullptr )  return;
+
+    m_bmRequest->cancelled = true;
+    m_bmRequest.reset();
+}
+
 // Tests if a path along a straight line is possible.
 
 bool CTaskGoto::BitmapTestLine(const Math::Vector &start, const Math::Vector &goal,
@@ -1897,24 +2015,36 @@ void CTaskGoto::BitmapObject()
     auto firstCrashSphere = m_object->GetFirstCrashSphere();
     float iRadius = firstCrashSphere.sphere.radius;
 
-    for (CObject* pObj : CObjectManager::GetInstancePointer()->GetAllObjects())
+    // The A* path stays around the start and the goal, the beam search can go anywhere
+    Math::Vector min(-1600.0f, 0.0f, -1600.0f);
+    Math::Vector max( 1600.0f, 0.0f,  1600.0f);
+    if ( m_crashMode == TGC_ASTAR )
     {
-        ObjectType type = pObj->GetType();
+        Math::IntPoint minCell, maxCell;
+        GetPathBounds(m_object->GetPosition(), m_bmCargoObject == nullptr ? m_goal : m_goalObject, minCell, maxCell);
+        min = Math::Vector(minCell.x*BM_DIM_STEP-1600.0f, 0.0f, minCell.y*BM_DIM_STEP-1600.0f);
+        max = Math::Vector((maxCell.x+1)*BM_DIM_STEP-1600.0f, 0.0f, (maxCell.y+1)*BM_DIM_STEP-1600.0f);
+    }
+    min.x -= iRadius+SAFETY_MARGIN;
+    min.z -= iRadius+SAFETY_MARGIN;
+    max.x += iRadius+SAFETY_MARGIN;
+    max.z += iRadius+SAFETY_MARGIN;
 
-        if ( pObj == m_object )  continue;
-        if ( pObj == m_bmCargoObject )  continue;
-        if (IsObjectBeingTransported(pObj))  continue;
+    for (const NavigationObstacle* obstacle : CNavigationGrid::GetInstancePointer()->GetObstacles(min, max))
+    {
+        if ( obstacle->object == m_object )  continue;
+        if ( obstacle->object == m_bmCargoObject )  continue;
 
-        float h = m_terrain->GetFloorLevel(pObj->GetPosition(), false);
+        float h = obstacle->floorLevel;
         if ( m_object->Implements(ObjectInterfaceType::Flying) && m_altitude > 0.0f )
         {
             h += m_altitude;
         }
 
-        for (const auto& crashSphere : pObj->GetAllCrashSpheres())
+        for (const Math::Sphere& sphere : obstacle->spheres)
         {
-            Math::Vector oPos = crashSphere.sphere.pos;
-            float oRadius = crashSphere.sphere.radius;
+            Math::Vector oPos = sphere.pos;
+            float oRadius = sphere.radius;
 
             if ( m_object->Implements(ObjectInterfaceType::Flying) && m_altitude > 0.0f )  // flying?
             {
@@ -1926,57 +2056,20 @@ void CTaskGoto::BitmapObject()
                 if ( oPos.y-oRadius > h+8.0f )  continue;
             }
 
-            if ( type == OBJECT_PARA )  oRadius -= 2.0f;
+            if ( obstacle->type == OBJECT_PARA )  oRadius -= 2.0f;
             BitmapSetCircle(oPos, oRadius+iRadius+SAFETY_MARGIN);
         }
     }
 }
 
-// Adds a section of land in the bitmap.
+// Returns the terrain restrictions of the robot.
 
-void CTaskGoto::BitmapTerrain(const Math::Vector &min, const Math::Vector &max)
+NavigationTerrainClass CTaskGoto::GetTerrainClass()
 {
-    int     minx, miny, maxx, maxy;
-
-    minx = static_cast<int>((min.x+1600.0f)/BM_DIM_STEP);
-    miny = static_cast<int>((min.z+1600.0f)/BM_DIM_STEP);
-    maxx = static_cast<int>((max.x+1600.0f)/BM_DIM_STEP);
-    maxy = static_cast<int>((max.z+1600.0f)/BM_DIM_STEP);
-
-    BitmapTerrain(minx, miny, maxx, maxy);
-}
+    NavigationTerrainClass terrainClass;
+    ObjectType type = m_object->GetType();
 
-// Adds a section of land in the bitmap.
-
-void CTaskGoto::BitmapTerrain(int minx, int miny, int maxx, int maxy)
-{
-    ObjectType  type;
-    Math::Vector    p;
-    float       aLimit, angle, h;
-    int         x, y;
-    bool        bAcceptWater, bFly;
-
-    if ( minx > maxx )  Math::Swap(minx, maxx);
-    if ( miny > maxy )  Math::Swap(miny, maxy);
-
-    if ( minx < 0          )  minx = 0;
-    if ( miny < 0          )  miny = 0;
-    if ( maxx > m_bmSize-1 )  maxx = m_bmSize-1;
-    if ( maxy > m_bmSize-1 )  maxy = m_bmSize-1;
-
-    if ( minx > m_bmMinX )  minx = m_bmMinX;
-    if ( miny > m_bmMinY )  miny = m_bmMinY;
-    if ( maxx < m_bmMaxX )  maxx = m_bmMaxX;
-    if ( maxy < m_bmMaxY )  maxy = m_bmMaxY;
-
-    if ( minx >= m_bmMinX && maxx <= m_bmMaxX &&
-         miny >= m_bmMinY && maxy <= m_bmMaxY )  return;
-
-    aLimit = 20.0f*Math::PI/180.0f;
-    bAcceptWater = false;
-    bFly = false;
-
-    type = m_object->GetType();
+    terrainClass.slopeLimit = 20.0f*Math::PI/180.0f;
 
     if ( type == OBJECT_MOBILEwa ||
          type == OBJECT_MOBILEwb ||
@@ -1986,7 +2079,7 @@ void CTaskGoto::BitmapTerrain(int minx, int miny, int maxx, int maxy)
          type == OBJECT_MOBILEwt ||
          type == OBJECT_MOBILEtg )  // wheels?
     {
-        aLimit = 20.0f*Math::PI/180.0f;
+        terrainClass.slopeLimit = 20.0f*Math::PI/180.0f;
     }
 
     if ( type == OBJECT_MOBILEta ||
@@ -1995,7 +2088,7 @@ void CTaskGoto::BitmapTerrain(int minx, int miny, int maxx, int maxy)
          type == OBJECT_MOBILEti ||
          type == OBJECT_MOBILEts )  // caterpillars?
     {
-        aLimit = 35.0f*Math::PI/180.0f;
+        terrainClass.slopeLimit = 35.0f*Math::PI/180.0f;
     }
 
     if ( type == OBJECT_MOBILErt ||
@@ -2004,19 +2097,19 @@ void CTaskGoto::BitmapTerrain(int minx, int miny, int maxx, int maxy)
          type == OBJECT_MOBILErs ||
          type == OBJECT_MOBILErp )  // large caterpillars?
     {
-        aLimit = 35.0f*Math::PI/180.0f;
+        terrainClass.slopeLimit = 35.0f*Math::PI/180.0f;
     }
 
     if ( type == OBJECT_MOBILEsa ||
          type == OBJECT_MOBILEst )  // submarine caterpillars?
     {
-        aLimit = 35.0f*Math::PI/180.0f;
-        bAcceptWater = true;
+        terrainClass.slopeLimit = 35.0f*Math::PI/180.0f;
+        terrainClass.acceptWater = true;
     }
 
     if ( type == OBJECT_MOBILEdr )  // designer caterpillars?
     {
-        aLimit = 35.0f*Math::PI/180.0f;
+        terrainClass.slopeLimit = 35.0f*Math::PI/180.0f;
     }
 
     if ( type == OBJECT_MOBILEfa ||
@@ -2026,8 +2119,8 @@ void CTaskGoto::BitmapTerrain(int minx, int miny, int maxx, int maxy)
          type == OBJECT_MOBILEfi ||
          type == OBJECT_MOBILEft )  // flying?
     {
-        aLimit = 15.0f*Math::PI/180.0f;
-        bFly = true;
+        terrainClass.slopeLimit = 15.0f*Math::PI/180.0f;
+        terrainClass.fly = true;
     }
 
     if ( type == OBJECT_MOBILEia ||
@@ -2036,73 +2129,26 @@ void CTaskGoto::BitmapTerrain(int minx, int miny, int maxx, int maxy)
          type == OBJECT_MOBILEis ||
          type == OBJECT_MOBILEii )  // insect legs?
     {
-        aLimit = 60.0f*Math::PI/180.0f;
+        terrainClass.slopeLimit = 60.0f*Math::PI/180.0f;
     }
 
-    for ( y=miny ; y<=maxy ; y++ )
-    {
-        for ( x=minx ; x<=maxx ; x++ )
-        {
-            if ( x >= m_bmMinX && x <= m_bmMaxX &&
-                 y >= m_bmMinY && y <= m_bmMaxY )  continue;
-
-            p.x = x*BM_DIM_STEP-1600.0f;
-            p.z = y*BM_DIM_STEP-1600.0f;
-
-            if ( bFly )  // flying robot?
-            {
-                h = m_terrain->GetFloorLevel(p, true);
-                if ( h >= m_terrain->GetFlyingMaxHeight()-5.0f )
-                {
-                    BitmapSetDot(0, x, y);
-                }
-                continue;
-            }
-
-            if ( !bAcceptWater )  // not going underwater?
-            {
-                h = m_terrain->GetFloorLevel(p, true);
-                if ( h < m_water->GetLevel()-2.0f )  // under water (*)?
-                {
-//?                 BitmapSetDot(0, x, y);
-                    BitmapSetCircle(p, BM_DIM_STEP*1.0f);
-                    continue;
-                }
-            }
-
-            angle = m_terrain->GetFineSlope(p);
-            if ( angle > aLimit )
-            {
-                BitmapSetDot(0, x, y);
-            }
-        }
-    }
-
-    m_bmMinX = minx;
-    m_bmMinY = miny;
-    m_bmMaxX = maxx;
-    m_bmMaxY = maxy;  // expanded rectangular area
+    return terrainClass;
 }
 
-// (*)  Accepts that a robot is 50cm under water, for example Tropica 3!
-
 // Opens an empty bitmap.
 
 bool CTaskGoto::BitmapOpen()
 {
     BitmapClose();
 
-    m_bmSize = static_cast<int>(3200.0f/BM_DIM_STEP);
-    m_bmArray = MakeUniqueArray<unsigned char>(m_bmSize*m_bmSize/8*2);
+    m_bmSize = CNavigationGrid::GetInstancePointer()->GetSize();
+    m_bmArray = MakeUniqueArray<unsigned char>(m_bmSize*m_bmSize/8*3);
     m_bmChanged = true;
 
     m_bmOffset = m_bmSize/2;
     m_bmLine = m_bmSize/8;
 
-    m_bmMinX = m_bmSize;  // non-existent rectangular area
-    m_bmMinY = m_bmSize;
-    m_bmMaxX = 0;
-    m_bmMaxY = 0;
+    m_bmTerrainClass = GetTerrainClass();
 
     return true;
 }
@@ -2156,6 +2202,7 @@ void CTaskGoto::BitmapClearCircle(const Math::Vector &pos, float radius)
             d = Math::Point(static_cast<float>(ix-cx), static_cast<float>(iy-cy)).Length();
             if ( d > r )  continue;
             BitmapClearDot(0, ix, iy);
+            BitmapSetDot(2, ix, iy);  // hides the terrain too
         }
     }
 }
@@ -2192,11 +2239,11 @@ bool CTaskGoto::BitmapTestDot(int rank, int x, int y)
     if ( x < 0 || x >= m_bmSize ||
          y < 0 || y >= m_bmSize )  return false;
 
-    if ( x < m_bmMinX || x > m_bmMaxX ||
-         y < m_bmMinY || y > m_bmMaxY )
-    {
-        BitmapTerrain(x-10,y-10, x+10,y+10);  // remade a layer
-    }
+    if ( m_bmArray[rank*m_bmLine*m_bmSize + m_bmLine*y + x/8] & (1<<x%8) )  return true;
+    if ( rank != 0 )  return false;
 
-    return m_bmArray[rank*m_bmLine*m_bmSize + m_bmLine*y + x/8] & (1<<x%8);
+    // The objects are in rank 0, the terrain comes from the shared grid
+    // unless it has been removed in rank 2.
+    if ( m_bmArray[2*m_bmLine*m_bmSize + m_bmLine*y + x/8] & (1<<x%8) )  return false;
+    return CNavigationGrid::GetInstancePointer()->IsTerrainBlocked(m_bmTerrainClass, x, y);
 }
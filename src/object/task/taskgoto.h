@@ -21,6 +21,8 @@
 
 #include "object/task/task.h"
 
+#include "object/navigation_grid.h"
+
 #include "math/vector.h"
 
 #include <memory>
@@ -32,6 +34,7 @@ struct Point;
 
 
 class CObject;
+struct PathRequest;
 
 const int MAXPOINTS = 500;
 
@@ -52,6 +55,7 @@ enum TaskGotoCrash
     TGC_LEFT        = 3,    // left
     TGC_RIGHT       = 4,    // right
     TGC_BEAM        = 5,    // algorithm "sunlight"
+    TGC_ASTAR       = 6,    // A* search on the bitmap
 };
 
 
@@ -105,11 +109,13 @@ protected:
     Error       BeamSearch(const Math::Vector &start, const Math::Vector &goal, float goalRadius);
     Error       BeamExplore(const Math::Vector &prevPos, const Math::Vector &curPos, const Math::Vector &goalPos, float goalRadius, float angle, int nbDiv, float step, int i, int nbIter);
     Math::Vector    BeamPoint(const Math::Vector &startPoint, const Math::Vector &goalPoint, float angle, float step);
+    Error       PathSearch(const Math::Vector &start, const Math::Vector &goal, float goalRadius);
+    void        GetPathBounds(const Math::Vector &start, const Math::Vector &goal, Math::IntPoint &min, Math::IntPoint &max);
+    void        PathCancel();
 
     bool        BitmapTestLine(const Math::Vector &start, const Math::Vector &goal, float stepAngle, bool bSecond);
     void        BitmapObject();
-    void        BitmapTerrain(const Math::Vector &min, const Math::Vector &max);
-    void        BitmapTerrain(int minx, int miny, int maxx, int maxy);
+    NavigationTerrainClass GetTerrainClass();
     bool        BitmapOpen();
     bool        BitmapClose();
     void        BitmapSetCircle(const Math::Vector &pos, float radius);
@@ -142,13 +148,13 @@ protected:
     int             m_bmOffset = 0;     // m_bmSize/2
     int             m_bmLine = 0;       // increment line m_bmSize/8
     std::unique_ptr<unsigned char[]> m_bmArray;      // bit table
-    int             m_bmMinX = 0, m_bmMinY = 0;
-    int             m_bmMaxX = 0, m_bmMaxY = 0;
+    NavigationTerrainClass m_bmTerrainClass;
     int             m_bmTotal = 0;      // number of points in m_bmPoints
     int             m_bmIndex = 0;      // index in m_bmPoints
     Math::Vector        m_bmPoints[MAXPOINTS+2];
     signed char     m_bmIter[MAXPOINTS+2] = {};
     int             m_bmIterCounter = 0;
+    std::shared_ptr<PathRequest> m_bmRequest;   // A* search in progress
     CObject*        m_bmCargoObject = nullptr;
     float           m_bmFinalMove = 0.0f;  // final advance distance
     float           m_bmFinalDist = 0.0f;  // effective distance to advance
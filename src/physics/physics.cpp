@@ -2462,32 +2462,37 @@ void CPhysics::FloorAdapt(float aTime, float rTime,
 void CPhysics::FloorAngle(const Math::Vector &pos, Math::Vector &angle)
 {
     Character*  character;
-    Math::Vector    pw, norm;
+    Math::Vector    pw[2];
+    float       level[2];
     float       a1, a2;
 
     character = m_object->GetCharacter();
 
-    pw.x = pos.x+character->wheelFront*cosf(angle.y+Math::PI*0.0f);
-    pw.y = pos.y;
-    pw.z = pos.z-character->wheelFront*sinf(angle.y+Math::PI*0.0f);
-    a1 = atanf(m_terrain->GetHeightToFloor(pw)/character->wheelFront);
+    pw[0].x = pos.x+character->wheelFront*cosf(angle.y+Math::PI*0.0f);
+    pw[0].y = pos.y;
+    pw[0].z = pos.z-character->wheelFront*sinf(angle.y+Math::PI*0.0f);
 
-    pw.x = pos.x+character->wheelBack*cosf(angle.y+Math::PI*1.0f);
-    pw.y = pos.y;
-    pw.z = pos.z-character->wheelBack*sinf(angle.y+Math::PI*1.0f);
-    a2 = atanf(m_terrain->GetHeightToFloor(pw)/character->wheelBack);
+    pw[1].x = pos.x+character->wheelBack*cosf(angle.y+Math::PI*1.0f);
+    pw[1].y = pos.y;
+    pw[1].z = pos.z-character->wheelBack*sinf(angle.y+Math::PI*1.0f);
+
+    m_terrain->GetFloorLevels(pw, level, 2);
+    a1 = atanf((pw[0].y-level[0])/character->wheelFront);
+    a2 = atanf((pw[1].y-level[1])/character->wheelBack);
 
     angle.z = (a2-a1)/2.0f;
 
-    pw.x = pos.x+character->wheelLeft*cosf(angle.y+Math::PI*0.5f)*cosf(angle.z);
-    pw.y = pos.y;
-    pw.z = pos.z-character->wheelLeft*sinf(angle.y+Math::PI*0.5f)*cosf(angle.z);
-    a1 = atanf(m_terrain->GetHeightToFloor(pw)/character->wheelLeft);
+    pw[0].x = pos.x+character->wheelLeft*cosf(angle.y+Math::PI*0.5f)*cosf(angle.z);
+    pw[0].y = pos.y;
+    pw[0].z = pos.z-character->wheelLeft*sinf(angle.y+Math::PI*0.5f)*cosf(angle.z);
+
+    pw[1].x = pos.x+character->wheelRight*cosf(angle.y+Math::PI*1.5f)*cosf(angle.z);
+    pw[1].y = pos.y;
+    pw[1].z = pos.z-character->wheelRight*sinf(angle.y+Math::PI*1.5f)*cosf(angle.z);
 
-    pw.x = pos.x+character->wheelRight*cosf(angle.y+Math::PI*1.5f)*cosf(angle.z);
-    pw.y = pos.y;
-    pw.z = pos.z-character->wheelRight*sinf(angle.y+Math::PI*1.5f)*cosf(angle.z);
-    a2 = atanf(m_terrain->GetHeightToFloor(pw)/character->wheelRight);
+    m_terrain->GetFloorLevels(pw, level, 2);
+    a1 = atanf((pw[0].y-level[0])/character->wheelLeft);
+    a2 = atanf((pw[1].y-level[1])/character->wheelRight);
 
     angle.x = (a2-a1)/2.0f;
 }
@@ -2521,8 +2526,12 @@ int CPhysics::ObjectAdapt(const Math::Vector &pos, const Math::Vector &angle)
     iPos = iiPos + (pos - m_object->GetPosition());
     iType = m_object->GetType();
 
-    for (CObject* pObj : CObjectManager::GetInstancePointer()->GetAllObjects())
+    // only the objects near the sphere, see CObjectManager::GetCollisionCandidates()
+    CObjectManager* objectManager = CObjectManager::GetInstancePointer();
+    for (int id : objectManager->GetCollisionCandidates(iPos, iRad))
     {
+        CObject* pObj = objectManager->GetObjectById(id);
+        if ( pObj == nullptr )  continue;  // deleted by a previous collision?
         if ( pObj == m_object )  continue;  // yourself?
         if (IsObjectBeingTransported(pObj))  continue;
         if ( pObj->Implements(ObjectInterfaceType::Destroyable) && dynamic_cast<CDestroyableObject*>(pObj)->GetDying() == DeathType::Exploding )  continue;  // is exploding?
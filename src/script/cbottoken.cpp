@@ -299,6 +299,7 @@ std::string GetHelpFilename(const char *token)
     if ( strcmp(token, "searchall"     ) == 0 )  helpfile = "cbot/searchall";
     if ( strcmp(token, "radar"         ) == 0 )  helpfile = "cbot/radar";
     if ( strcmp(token, "radarall"      ) == 0 )  helpfile = "cbot/radarall";
+    if ( strcmp(token, "radarnearest"  ) == 0 )  helpfile = "cbot/radarnearest";
     if ( strcmp(token, "direction"     ) == 0 )  helpfile = "cbot/direct";
     if ( strcmp(token, "distance"      ) == 0 )  helpfile = "cbot/dist";
     if ( strcmp(token, "distance2d"    ) == 0 )  helpfile = "cbot/dist2d";
@@ -353,6 +354,7 @@ std::string GetHelpFilename(const char *token)
     if ( strcmp(token, "InFront"       ) == 0 )  helpfile = "cbot/grab";
     if ( strcmp(token, "Behind"        ) == 0 )  helpfile = "cbot/grab";
     if ( strcmp(token, "EnergyCell"    ) == 0 )  helpfile = "cbot/grab";
+    if ( strcmp(token, "GotoAStar"     ) == 0 )  helpfile = "cbot/goto";
     if ( strcmp(token, "DisplayError"  ) == 0 )  helpfile = "cbot/message";
     if ( strcmp(token, "DisplayWarning") == 0 )  helpfile = "cbot/message";
     if ( strcmp(token, "DisplayInfo"   ) == 0 )  helpfile = "cbot/message";
@@ -458,6 +460,7 @@ bool IsFunction(const char *token)
     if ( strcmp(token, "searchall"    ) == 0 )  return true;
     if ( strcmp(token, "radar"        ) == 0 )  return true;
     if ( strcmp(token, "radarall"     ) == 0 )  return true;
+    if ( strcmp(token, "radarnearest" ) == 0 )  return true;
     if ( strcmp(token, "detect"       ) == 0 )  return true;
     if ( strcmp(token, "direction"    ) == 0 )  return true;
     if ( strcmp(token, "distance"     ) == 0 )  return true;
@@ -508,6 +511,10 @@ bool IsFunction(const char *token)
     if ( strcmp(token, "writeln"      ) == 0 )  return true;
     if ( strcmp(token, "readln"       ) == 0 )  return true;
     if ( strcmp(token, "eof"          ) == 0 )  return true;
+    if ( strcmp(token, "flush"        ) == 0 )  return true;
+    if ( strcmp(token, "readall"      ) == 0 )  return true;
+    if ( strcmp(token, "readlines"    ) == 0 )  return true;
+    if ( strcmp(token, "writelines"   ) == 0 )  return true;
     if ( strcmp(token, "deletefile"   ) == 0 )  return true;
     if ( strcmp(token, "openfile"     ) == 0 )  return true;
     if ( strcmp(token, "pendown"      ) == 0 )  return true;
@@ -564,6 +571,7 @@ const char* GetHelpText(const char *token)
     if ( strcmp(token, "searchall" ) == 0 )  return "searchall ( cat, pos, min, max, sens, filter );";
     if ( strcmp(token, "radar"     ) == 0 )  return "radar ( cat, angle, focus, min, max, sens, filter );";
     if ( strcmp(token, "radarall"  ) == 0 )  return "radarall ( cat, angle, focus, min, max, sens, filter );";
+    if ( strcmp(token, "radarnearest" ) == 0 )  return "radarnearest ( cats, angle, focus, min, max, sens, filter );";
     if ( strcmp(token, "detect"    ) == 0 )  return "detect ( cat );";
     if ( strcmp(token, "direction" ) == 0 )  return "direction ( position );";
     if ( strcmp(token, "distance2d") == 0 )  return "distance2d ( p1, p2 );";
@@ -579,7 +587,8 @@ const char* GetHelpText(const char *token)
     if ( strcmp(token, "wait"      ) == 0 )  return "wait ( time );";
     if ( strcmp(token, "move"      ) == 0 )  return "move ( distance );";
     if ( strcmp(token, "turn"      ) == 0 )  return "turn ( angle );";
-    if ( strcmp(token, "goto"      ) == 0 )  return "goto ( position, altitude );";
+    if ( strcmp(token, "goto"      ) == 0 )  return "goto ( position, altitude, goal, crash );";
+    if ( strcmp(token, "GotoAStar" ) == 0 )  return "goto ( position, altitude, goal, GotoAStar );";
     if ( strcmp(token, "grab"      ) == 0 )  return "grab ( order );";
     if ( strcmp(token, "drop"      ) == 0 )  return "drop ( order );";
     if ( strcmp(token, "sniff"     ) == 0 )  return "sniff ( );";
@@ -613,6 +622,10 @@ const char* GetHelpText(const char *token)
     if ( strcmp(token, "writeln"   ) == 0 )  return "file.writeln ( string );";
     if ( strcmp(token, "readln"    ) == 0 )  return "file.readln ( );";
     if ( strcmp(token, "eof"       ) == 0 )  return "eof ( );";
+    if ( strcmp(token, "flush"     ) == 0 )  return "file.flush ( );";
+    if ( strcmp(token, "readall"   ) == 0 )  return "file.readall ( );";
+    if ( strcmp(token, "readlines" ) == 0 )  return "file.readlines ( );";
+    if ( strcmp(token, "writelines") == 0 )  return "file.writelines ( lines );";
     if ( strcmp(token, "deletefile") == 0 )  return "deletefile ( filename );";
     if ( strcmp(token, "openfile"  ) == 0 )  return "openfile ( filename, mode );";
     if ( strcmp(token, "pendown"   ) == 0 )  return "pendown ( color, width );";
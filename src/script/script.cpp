@@ -44,7 +44,9 @@
 #include "ui/controls/interface.h"
 #include "ui/controls/list.h"
 
+#include <algorithm>
 #include <libintl.h>
+#include <map>
 
 const int CBOT_IPF = 100;       // CBOT: default number of instructions / frame
 
@@ -238,7 +240,11 @@ bool CScript::Compile()
     if (m_botProg == nullptr)
     {
         m_botProg = MakeUnique<CBot::CBotProgram>(m_object->GetBotVar());
+        m_botProg->SetProfilerEnabled(m_bProfiling);
     }
+    // The compile checks only depend on the type of the robot (see CScriptFunctions::cFire()),
+    // so the code can be shared by all the robots of the same type
+    m_botProg->SetCompileContext(static_cast<long>(m_object->GetType()) + 1);
 
     if ( m_botProg->Compile(m_script.get(), functionList, this) )
     {
@@ -309,9 +315,11 @@ bool CScript::Run()
     if ( m_mainFunction.empty() ) return false;
 
     if ( !m_botProg->Start(m_mainFunction.c_str()) )  return false;
+    if ( m_botProg->GetProfiler() != nullptr )  m_botProg->GetProfiler()->Reset();
 
     m_bRun = true;
     m_bContinue = false;
+    m_bSliceDone = false;
     m_ipf = CBOT_IPF;
     m_errMode = ERM_STOP;
 
@@ -363,7 +371,16 @@ bool CScript::Continue()
         return false;
     }
 
-    if ( m_botProg->Run(this, m_ipf) )
+    bool finished = m_bSliceDone ? m_bSliceFinished : m_botProg->Run(this, m_ipf);
+    m_bSliceDone = false;
+
+    // the slice executed in parallel stopped before a call to the game
+    if ( !finished && m_botProg->IsCallDeferred() )
+    {
+        finished = m_botProg->Run(this);
+    }
+
+    if ( finished )
     {
         m_botProg->GetError(m_error, m_cursor1, m_cursor2);
         if ( m_cursor1 < 0 || m_cursor1 > m_len ||
@@ -390,6 +407,29 @@ bool CScript::Continue()
     return false;
 }
 
+// Gives the slice of this frame to be executed in parallel with other programs.
+// Returns false if the program must be continued on the main thread.
+
+bool CScript::PrepareSlice(CBot::CBotWorkerPool::Slice& slice)
+{
+    if (m_botProg == nullptr)  return false;
+    if ( !m_bRun || m_bStepMode )  return false;
+
+    slice.program  = m_botProg.get();
+    slice.user     = this;
+    slice.timer    = m_ipf;
+    slice.finished = false;
+    return true;
+}
+
+// Stores the result of the slice executed in parallel, used by the next Continue().
+
+void CScript::SetSliceResult(bool finished)
+{
+    m_bSliceDone = true;
+    m_bSliceFinished = finished;
+}
+
 // Continues the execution of current program.
 // Returns true when execution is finished.
 
@@ -439,6 +479,7 @@ void CScript::Stop()
     }
 
     m_bRun = false;
+    m_bSliceDone = false;
 }
 
 // Indicates whether the program runs.
@@ -589,6 +630,60 @@ void CScript::UpdateList(Ui::CList* list)
     list->SetState(Ui::STATE_ENABLE);
 }
 
+// Enables or disables the execution profiler.
+
+void CScript::SetProfiling(bool bProfiling)
+{
+    m_bProfiling = bProfiling;
+    if (m_botProg != nullptr)  m_botProg->SetProfilerEnabled(bProfiling);
+}
+
+bool CScript::GetProfiling()
+{
+    return m_bProfiling;
+}
+
+// Lists the lines which executed the most instructions, with their share of the instructions.
+// Returns false if the profiler is disabled or nothing was executed.
+
+bool CScript::GetProfileReport(std::string& report)
+{
+    const int MAX_LINES = 3;  // fits on the info line of the editor
+
+    if (m_botProg == nullptr || m_script == nullptr) return false;
+    CBot::CBotProfiler* profiler = m_botProg->GetProfiler();
+    if (profiler == nullptr || profiler->GetTotalSteps() == 0) return false;
+
+    std::vector<int> lineEnds;  // offset of the end of each line
+    for (int i = 0; i < m_len; i++)
+    {
+        if (m_script[i] == '\n')  lineEnds.push_back(i);
+    }
+
+    std::map<int, long> steps;  // steps by line
+    for (const auto& instr : profiler->GetInstructions())
+    {
+        if (instr.start < 0 || instr.start > m_len) continue;
+        int line = std::lower_bound(lineEnds.begin(), lineEnds.end(), instr.start) - lineEnds.begin();
+        steps[line+1] += instr.steps;
+    }
+
+    std::vector<std::pair<int, long>> lines(steps.begin(), steps.end());
+    std::sort(lines.begin(), lines.end(), [](const std::pair<int, long>& a, const std::pair<int, long>& b)
+    {
+        return a.second > b.second;
+    });
+
+    report.clear();
+    for (int i = 0; i < static_cast<int>(lines.size()) && i < MAX_LINES; i++)
+    {
+        float percent = 100.0f * lines[i].second / profiler->GetTotalSteps();
+        if (i > 0)  report += ", ";
+        report += StrUtils::Format("%d (%.1f%%)", lines[i].first, percent);
+    }
+    return true;
+}
+
 // Colorize a string or character literal with escape sequences also colored
 
 static void HighlightString(Ui::CEdit* edit, const std::string& s, int start)
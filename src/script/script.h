@@ -73,12 +73,17 @@ public:
     bool        GetStepMode();
     bool        Run();
     bool        Continue();
+    bool        PrepareSlice(CBot::CBotWorkerPool::Slice& slice);
+    void        SetSliceResult(bool finished);
     bool        Step();
     void        Stop();
     bool        IsRunning();
     bool        IsContinue();
     bool        GetCursor(int &cursor1, int &cursor2);
     void        UpdateList(Ui::CList* list);
+    void        SetProfiling(bool bProfiling);
+    bool        GetProfiling();
+    bool        GetProfileReport(std::string& report);
     static void ColorizeScript(Ui::CEdit* edit, int rangeStart = 0, int rangeEnd = std::numeric_limits<int>::max());
     bool        IntroduceVirus();
 
@@ -120,6 +125,9 @@ protected:
     bool    m_bStepMode = false;        // step by step
     bool    m_bContinue = false;        // external function to continue
     bool    m_bCompile = false;     // compilation ok?
+    bool    m_bProfiling = false;   // execution profiler enabled?
+    bool    m_bSliceDone = false;   // slice of this frame already executed in parallel?
+    bool    m_bSliceFinished = false;   // result of that slice
     std::string m_title = "";        // script title
     std::string m_mainFunction = "";
     std::string m_filename = "";     // file name
@@ -67,6 +67,8 @@
 
 #include "ui/displaytext.h"
 
+#include <algorithm>
+
 using namespace CBot;
 
 CBotTypResult CScriptFunctions::cClassNull(CBotVar* thisclass, CBotVar* &var)
@@ -978,6 +980,15 @@ CBotTypResult CScriptFunctions::cRadarAll(CBotVar* &var, void* user)
     return compileRadar(var, user, CBotTypResult(CBotTypArrayPointer, CBotTypResult(CBotTypPointer, "object")));
 }
 
+// Compilation of instruction "radarnearest(types, angle, focus, min, max, sens, filter)".
+
+CBotTypResult CScriptFunctions::cRadarNearest(CBotVar* &var, void* user)
+{
+    if ( var == nullptr )  return CBotTypResult(CBotErrLowParam);
+    if ( var->GetType() != CBotTypArrayPointer )  return CBotTypResult(CBotErrBadParam);  // types
+    return compileRadar(var, user, CBotTypResult(CBotTypArrayPointer, CBotTypResult(CBotTypPointer, "object")));
+}
+
 // Compilation of instruction "radar(type, angle, focus, min, max, sens)".
 
 CBotTypResult CScriptFunctions::cRadar(CBotVar* &var, void* user)
@@ -1131,6 +1142,93 @@ bool CScriptFunctions::rRadarAll(CBotVar* var, CBotVar* result, int& exception,
 }
 
 
+// Checks whether an object found by the radar is of the category asked by the program,
+// the same way as radar() does.
+
+static bool IsRadarCategory(ObjectType type, int category)
+{
+    if ( category == OBJECT_NULL )  return true;  // any object, as radar(0)
+
+    if ( type == OBJECT_RUINmobilew2 ||
+         type == OBJECT_RUINmobilet1 ||
+         type == OBJECT_RUINmobilet2 ||
+         type == OBJECT_RUINmobiler1 ||
+         type == OBJECT_RUINmobiler2 )
+    {
+        type = OBJECT_RUINmobilew1;  // any ruin
+    }
+    if ( type == OBJECT_BARRIER2 ||
+         type == OBJECT_BARRIER3 ||
+         type == OBJECT_BARRICADE0 ||
+         type == OBJECT_BARRICADE1 )
+    {
+        type = OBJECT_BARRIER1;  // any barrier
+    }
+
+    if ( category == OBJECT_MOBILEpr )
+    {
+        return type == OBJECT_MOBILEwt ||
+               type == OBJECT_MOBILEtt ||
+               type == OBJECT_MOBILEft ||
+               type == OBJECT_MOBILEit ||
+               type == OBJECT_MOBILErp ||
+               type == OBJECT_MOBILEst ||
+               type == OBJECT_MOBILEpr;
+    }
+    return type == category;
+}
+
+// Instruction "radarnearest(types, angle, focus, min, max, sens, filter)".
+// Finds the nearest object of each category with a single radar pass:
+// element i of the result is what radar(types[i], ...) would return.
+// Category 0 means any object, so the pass then considers all objects.
+
+bool CScriptFunctions::rRadarNearest(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    std::vector<int> categories;
+    for ( CBotVar* item = var->GetItemList(); item != nullptr; item = item->GetNext() )
+    {
+        categories.push_back(item->GetValInt());
+    }
+
+    return runRadar(var, [&result, &categories, user](std::vector<ObjectType> types, float angle, float focus, float minDist, float maxDist, bool furthest, RadarFilter filter)
+    {
+        CObjectManager* objMan = CObjectManager::GetInstancePointer();
+        CObject* pThis = static_cast<CScript*>(user)->m_object;
+
+        bool anyCategory = std::find(categories.begin(), categories.end(), OBJECT_NULL) != categories.end();
+        if ( anyCategory )  types.clear();
+        std::vector<CObject*> found = objMan->RadarAll(pThis, types, angle, focus, minDist, maxDist, furthest, filter, true);
+
+        result->SetInit(CBotVar::InitType::DEF);
+        for ( std::size_t i = 0; i < categories.size(); i++ )
+        {
+            // The pass for any object skips these, unless they are asked explicitly
+            std::vector<CObject*> explicitFound;
+            if ( anyCategory && (categories[i] == OBJECT_TOTO || categories[i] == OBJECT_CONTROLLER) )
+            {
+                explicitFound = objMan->RadarAll(pThis, static_cast<ObjectType>(categories[i]), angle, focus, minDist, maxDist, furthest, filter, true);
+            }
+
+            CObject* best = nullptr;
+            for (CObject* obj : explicitFound.empty() ? found : explicitFound)
+            {
+                if ( IsRadarCategory(obj->GetType(), categories[i]) )
+                {
+                    best = obj;
+                    break;
+                }
+            }
+
+            CBotVar* item = result->GetItem(static_cast<int>(i), true);
+            item->SetPointer(best == nullptr ? nullptr : best->GetBotVar());
+        }
+
+        return true;
+    });
+}
+
+
 // Monitoring a task.
 
 bool CScriptFunctions::WaitForForegroundTask(CScript* script, CBotVar* result, int &exception)
@@ -3194,29 +3292,35 @@ class CBotFileColobot : public CBotFile
 public:
     static int m_numFilesOpen;
 
+    //! Size of the buffers, so that reading or logging line by line doesn't go to the disk every time
+    static const std::size_t BUFFER_SIZE = 64 * 1024;
+
     CBotFileColobot(const std::string& filename, CBotFileAccessHandler::OpenMode mode)
     {
         if (mode == CBotFileAccessHandler::OpenMode::Read)
         {
-            auto is = MakeUnique<CInputStream>(filename);
+            auto is = MakeUnique<CInputStream>(filename, BUFFER_SIZE);
             if (is->is_open())
             {
+                m_input = is.get();
                 m_file = std::move(is);
             }
         }
         else if (mode == CBotFileAccessHandler::OpenMode::Write)
         {
-            auto os = MakeUnique<COutputStream>(filename);
+            auto os = MakeUnique<COutputStream>(filename, std::ios_base::out, BUFFER_SIZE);
             if (os->is_open())
             {
+                m_output = os.get();
                 m_file = std::move(os);
             }
         }
         else if (mode == CBotFileAccessHandler::OpenMode::Append)
         {
-            auto os = MakeUnique<COutputStream>(filename, std::ios_base::app);
+            auto os = MakeUnique<COutputStream>(filename, std::ios_base::app, BUFFER_SIZE);
             if (os->is_open())
             {
+                m_output = os.get();
                 m_file = std::move(os);
             }
         }
@@ -3236,11 +3340,8 @@ public:
             m_numFilesOpen--;
         }
 
-        std::ios* file = m_file.get();
-        CInputStream* is = dynamic_cast<CInputStream*>(file);
-        if(is != nullptr) is->close();
-        COutputStream* os = dynamic_cast<COutputStream*>(file);
-        if(os != nullptr) os->close();
+        if (m_input != nullptr) m_input->close();
+        if (m_output != nullptr) m_output->close();
     }
 
     virtual bool Opened() override
@@ -3260,24 +3361,42 @@ public:
 
     virtual std::string ReadLine() override
     {
-        CInputStream* is = dynamic_cast<CInputStream*>(m_file.get());
-        assert(is != nullptr);
+        assert(m_input != nullptr);
 
         std::string line;
-        std::getline(*is, line);
+        std::getline(*m_input, line);
         return line;
     }
 
+    virtual std::string ReadAll() override
+    {
+        assert(m_input != nullptr);
+
+        std::string text;
+        char buffer[4096];
+        while (m_input->read(buffer, sizeof(buffer)) || m_input->gcount() > 0)
+        {
+            text.append(buffer, m_input->gcount());
+        }
+        return text;
+    }
+
     virtual void Write(const std::string& s) override
     {
-        COutputStream* os = dynamic_cast<COutputStream*>(m_file.get());
-        assert(os != nullptr);
+        assert(m_output != nullptr);
 
-        *os << s;
+        m_output->write(s.data(), s.length());
+    }
+
+    virtual void Flush() override
+    {
+        if (m_output != nullptr) m_output->flush();
     }
 
 private:
     std::unique_ptr<std::ios> m_file;
+    CInputStream* m_input = nullptr;
+    COutputStream* m_output = nullptr;
 };
 int CBotFileColobot::m_numFilesOpen = 0;
 
@@ -3310,7 +3429,6 @@ private:
 
 void CScriptFunctions::Init()
 {
-    CBotProgram::SetTimer(100);
     CBotProgram::Init();
 
     for (int i = 0; i < OBJECT_MAX; i++)
@@ -3348,6 +3466,8 @@ void CScriptFunctions::Init()
     CBotProgram::DefineNum("FilterEnemy",       FILTER_ENEMY);
     CBotProgram::DefineNum("FilterNeutral",     FILTER_NEUTRAL);
 
+    CBotProgram::DefineNum("GotoAStar", TGC_ASTAR);
+
     CBotProgram::DefineNum("DestructionNone",           static_cast<int>(DestructionType::NoEffect));
     CBotProgram::DefineNum("DestructionExplosion",      static_cast<int>(DestructionType::Explosion));
     CBotProgram::DefineNum("DestructionExplosionWater", static_cast<int>(DestructionType::ExplosionWater));
@@ -3402,7 +3522,7 @@ void CScriptFunctions::Init()
     bc->AddItem("x", CBotTypFloat);
     bc->AddItem("y", CBotTypFloat);
     bc->AddItem("z", CBotTypFloat);
-    bc->AddFunction("point", rPointConstructor, cPointConstructor);
+    bc->AddFunction("point", rPointConstructor, cPointConstructor, true);
 
     // Adds the class Object.
     bc = CBotClass::Create("object", nullptr);
@@ -3423,36 +3543,39 @@ void CScriptFunctions::Init()
     bc->AddItem("dead",        CBotTypResult(CBotTypBoolean), CBotVar::ProtectionLevel::ReadOnly);
     bc->AddItem("velocity",    CBotTypResult(CBotTypClass, "point"), CBotVar::ProtectionLevel::ReadOnly);
 
+    // functions registered with threadSafe = true only read the state of the game,
+    // they may run while programs run in parallel (see CRobotMain::RunScriptsInParallel())
     CBotProgram::AddFunction("endmission",rEndMission,cEndMission);
     CBotProgram::AddFunction("playmusic", rPlayMusic ,cPlayMusic);
     CBotProgram::AddFunction("stopmusic", rStopMusic ,cNull);
 
-    CBotProgram::AddFunction("getbuild",          rGetBuild,          cNull);
-    CBotProgram::AddFunction("getresearchenable", rGetResearchEnable, cNull);
-    CBotProgram::AddFunction("getresearchdone",   rGetResearchDone,   cNull);
+    CBotProgram::AddFunction("getbuild",          rGetBuild,          cNull, true);
+    CBotProgram::AddFunction("getresearchenable", rGetResearchEnable, cNull, true);
+    CBotProgram::AddFunction("getresearchdone",   rGetResearchDone,   cNull, true);
     CBotProgram::AddFunction("setbuild",          rSetBuild,          cOneInt);
     CBotProgram::AddFunction("setresearchenable", rSetResearchEnable, cOneInt);
     CBotProgram::AddFunction("setresearchdone",   rSetResearchDone,   cOneInt);
 
-    CBotProgram::AddFunction("canbuild",        rCanBuild,        cOneIntReturnBool);
-    CBotProgram::AddFunction("canresearch",     rCanResearch,     cOneIntReturnBool);
-    CBotProgram::AddFunction("researched",      rResearched,      cOneIntReturnBool);
-    CBotProgram::AddFunction("buildingenabled", rBuildingEnabled, cOneIntReturnBool);
+    CBotProgram::AddFunction("canbuild",        rCanBuild,        cOneIntReturnBool, true);
+    CBotProgram::AddFunction("canresearch",     rCanResearch,     cOneIntReturnBool, true);
+    CBotProgram::AddFunction("researched",      rResearched,      cOneIntReturnBool, true);
+    CBotProgram::AddFunction("buildingenabled", rBuildingEnabled, cOneIntReturnBool, true);
 
     CBotProgram::AddFunction("build",           rBuild,           cOneInt);
 
-    CBotProgram::AddFunction("retobject", rGetObject, cGetObject);
-    CBotProgram::AddFunction("retobjectbyid", rGetObjectById, cGetObject);
+    CBotProgram::AddFunction("retobject", rGetObject, cGetObject, true);
+    CBotProgram::AddFunction("retobjectbyid", rGetObjectById, cGetObject, true);
     CBotProgram::AddFunction("delete",    rDelete,    cDelete);
-    CBotProgram::AddFunction("search",    rSearch,    cSearch);
-    CBotProgram::AddFunction("searchall", rSearchAll, cSearchAll);
-    CBotProgram::AddFunction("radar",     rRadar,     cRadar);
-    CBotProgram::AddFunction("radarall",  rRadarAll,  cRadarAll);
+    CBotProgram::AddFunction("search",    rSearch,    cSearch, true);
+    CBotProgram::AddFunction("searchall", rSearchAll, cSearchAll, true);
+    CBotProgram::AddFunction("radar",     rRadar,     cRadar, true);
+    CBotProgram::AddFunction("radarall",  rRadarAll,  cRadarAll, true);
+    CBotProgram::AddFunction("radarnearest", rRadarNearest, cRadarNearest, true);
     CBotProgram::AddFunction("detect",    rDetect,    cDetect);
-    CBotProgram::AddFunction("direction", rDirection, cDirection);
+    CBotProgram::AddFunction("direction", rDirection, cDirection, true);
     CBotProgram::AddFunction("produce",   rProduce,   cProduce);
-    CBotProgram::AddFunction("distance",  rDistance,  cDistance);
-    CBotProgram::AddFunction("distance2d",rDistance2d,cDistance);
+    CBotProgram::AddFunction("distance",  rDistance,  cDistance, true);
+    CBotProgram::AddFunction("distance2d",rDistance2d,cDistance, true);
     CBotProgram::AddFunction("space",     rSpace,     cSpace);
     CBotProgram::AddFunction("flatspace", rFlatSpace, cFlatSpace);
     CBotProgram::AddFunction("flatground",rFlatGround,cFlatGround);
@@ -3474,13 +3597,13 @@ void CScriptFunctions::Init()
     CBotProgram::AddFunction("aim",       rAim,       cAim);
     CBotProgram::AddFunction("motor",     rMotor,     cMotor);
     CBotProgram::AddFunction("jet",       rJet,       cOneFloat);
-    CBotProgram::AddFunction("topo",      rTopo,      cTopo);
+    CBotProgram::AddFunction("topo",      rTopo,      cTopo, true);
     CBotProgram::AddFunction("message",   rMessage,   cMessage);
     CBotProgram::AddFunction("cmdline",   rCmdline,   cOneFloat);
     CBotProgram::AddFunction("ismovie",   rIsMovie,   cNull);
     CBotProgram::AddFunction("errmode",   rErrMode,   cOneFloat);
     CBotProgram::AddFunction("ipf",       rIPF,       cOneFloat);
-    CBotProgram::AddFunction("abstime",   rAbsTime,   cNull);
+    CBotProgram::AddFunction("abstime",   rAbsTime,   cNull, true);
     CBotProgram::AddFunction("pendown",   rPenDown,   cPenDown);
     CBotProgram::AddFunction("penup",     rPenUp,     cNull);
     CBotProgram::AddFunction("pencolor",  rPenColor,  cOneFloat);
@@ -3496,15 +3619,52 @@ void CScriptFunctions::Init()
 }
 
 
-// Updates the class Object.
+// Updates a point variable with a position given in the game coordinates.
 
-void CScriptFunctions::uObject(CBotVar* botThis, void* user)
+static void SetPointVar(CBotVar* pVar, const Math::Vector& pos)
 {
-    CPhysics*   physics;
-    CBotVar     *pVar, *pSub;
-    ObjectType  type;
-    Math::Vector    pos;
-    float       value;
+    CBotVar* pSub = pVar->GetItemList();  // "x"
+    pSub->SetValFloat(pos.x/g_unit);
+    pSub = pSub->GetNext();  // "y"
+    pSub->SetValFloat(pos.z/g_unit);
+    pSub = pSub->GetNext();  // "z"
+    pSub->SetValFloat(pos.y/g_unit);
+}
+
+// Marks all coordinates of a point variable as NaN.
+
+static void SetPointVarNan(CBotVar* pVar)
+{
+    CBotVar* pSub = pVar->GetItemList();  // "x"
+    pSub->SetInit(CBotVar::InitType::IS_NAN);
+    pSub = pSub->GetNext();  // "y"
+    pSub->SetInit(CBotVar::InitType::IS_NAN);
+    pSub = pSub->GetNext();  // "z"
+    pSub->SetInit(CBotVar::InitType::IS_NAN);
+}
+
+// Updates a single element of the class Object.
+// The elements are refreshed only when a program reads them, so a program
+// which only looks at the position of an object doesn't pay for the others.
+
+void CScriptFunctions::uObjectItem(CBotVar* botThis, CBotVar* item, void* user)
+{
+    static const int category    = CBotToken::InternName("category");
+    static const int position    = CBotToken::InternName("position");
+    static const int orientation = CBotToken::InternName("orientation");
+    static const int pitch       = CBotToken::InternName("pitch");
+    static const int roll        = CBotToken::InternName("roll");
+    static const int energyLevel = CBotToken::InternName("energyLevel");
+    static const int shieldLevel = CBotToken::InternName("shieldLevel");
+    static const int temperature = CBotToken::InternName("temperature");
+    static const int altitude    = CBotToken::InternName("altitude");
+    static const int lifeTime    = CBotToken::InternName("lifeTime");
+    static const int energyCell  = CBotToken::InternName("energyCell");
+    static const int load        = CBotToken::InternName("load");
+    static const int id          = CBotToken::InternName("id");
+    static const int team        = CBotToken::InternName("team");
+    static const int dead        = CBotToken::InternName("dead");
+    static const int velocity    = CBotToken::InternName("velocity");
 
     if ( user == nullptr )  return;
 
@@ -3512,141 +3672,133 @@ void CScriptFunctions::uObject(CBotVar* botThis, void* user)
     assert(obj->Implements(ObjectInterfaceType::Old));
     COldObject* object = static_cast<COldObject*>(obj);
 
-    physics = object->GetPhysics();
-
-    // Updates the object's type.
-    pVar = botThis->GetItemList();  // "category"
-    type = object->GetType();
-    pVar->SetValInt(type, object->GetName());
+    CPhysics* physics = object->GetPhysics();
+    int name = item->GetNameId();
 
-    // Updates the position of the object.
-    pVar = pVar->GetNext();  // "position"
-    if (IsObjectBeingTransported(object))
+    if ( name == category )
     {
-        pSub = pVar->GetItemList();  // "x"
-        pSub->SetInit(CBotVar::InitType::IS_NAN);
-        pSub = pSub->GetNext();  // "y"
-        pSub->SetInit(CBotVar::InitType::IS_NAN);
-        pSub = pSub->GetNext();  // "z"
-        pSub->SetInit(CBotVar::InitType::IS_NAN);
+        // Updates the object's type.
+        item->SetValInt(object->GetType(), object->GetName());
     }
-    else
-    {
-        pos = object->GetPosition();
-        float waterLevel = Gfx::CEngine::GetInstancePointer()->GetWater()->GetLevel();
-        pos.y -= waterLevel;  // relative to sea level!
-        pSub = pVar->GetItemList();  // "x"
-        pSub->SetValFloat(pos.x/g_unit);
-        pSub = pSub->GetNext();  // "y"
-        pSub->SetValFloat(pos.z/g_unit);
-        pSub = pSub->GetNext();  // "z"
-        pSub->SetValFloat(pos.y/g_unit);
-    }
-
-    // Updates the angle.
-    pos = object->GetRotation();
-    pos += object->GetTilt();
-    pVar = pVar->GetNext();  // "orientation"
-    pVar->SetValFloat(Math::NormAngle(2*Math::PI - pos.y)*180.0f/Math::PI);
-    pVar = pVar->GetNext();  // "pitch"
-    pVar->SetValFloat((Math::NormAngle(pos.z + Math::PI) - Math::PI)*180.0f/Math::PI);
-    pVar = pVar->GetNext();  // "roll"
-    pVar->SetValFloat((Math::NormAngle(pos.x + Math::PI) - Math::PI)*180.0f/Math::PI);
-
-    // Updates the energy level of the object.
-    pVar = pVar->GetNext();  // "energyLevel"
-    value = object->GetEnergyLevel();
-    pVar->SetValFloat(value);
-
-    // Updates the shield level of the object.
-    pVar = pVar->GetNext();  // "shieldLevel"
-    if ( !obj->Implements(ObjectInterfaceType::Shielded) ) value = 1.0f;
-    else value = dynamic_cast<CShieldedObject*>(object)->GetShield();
-    pVar->SetValFloat(value);
-
-    // Updates the temperature of the reactor.
-    pVar = pVar->GetNext();  // "temperature"
-    if ( !obj->Implements(ObjectInterfaceType::JetFlying) )  value = 0.0f;
-    else value = 1.0f-dynamic_cast<CJetFlyingObject*>(object)->GetReactorRange();
-    pVar->SetValFloat(value);
-
-    // Updates the height above the ground.
-    pVar = pVar->GetNext();  // "altitude"
-    if ( physics == nullptr )  value = 0.0f;
-    else                 value = physics->GetFloorHeight();
-    pVar->SetValFloat(value/g_unit);
-
-    // Updates the lifetime of the object.
-    pVar = pVar->GetNext();  // "lifeTime"
-    value = object->GetAbsTime();
-    pVar->SetValFloat(value);
-
-    // Updates the type of battery.
-    pVar = pVar->GetNext();  // "energyCell"
-    if (object->Implements(ObjectInterfaceType::Powered))
+    else if ( name == position )
     {
-        CObject* power = dynamic_cast<CPoweredObject*>(object)->GetPower();
-        if (power == nullptr)
+        // Updates the position of the object.
+        if (IsObjectBeingTransported(object))
         {
-            pVar->SetPointer(nullptr);
+            SetPointVarNan(item);
         }
-        else if (power->Implements(ObjectInterfaceType::Old))
+        else
         {
-            pVar->SetPointer(power->GetBotVar());
+            Math::Vector pos = object->GetPosition();
+            float waterLevel = Gfx::CEngine::GetInstancePointer()->GetWater()->GetLevel();
+            pos.y -= waterLevel;  // relative to sea level!
+            SetPointVar(item, pos);
         }
     }
-
-    // Updates the transported object's type.
-    pVar = pVar->GetNext();  // "load"
-    if (object->Implements(ObjectInterfaceType::Carrier))
+    else if ( name == orientation || name == pitch || name == roll )
+    {
+        // Updates the angle.
+        Math::Vector pos = object->GetRotation();
+        pos += object->GetTilt();
+        if ( name == orientation )
+            item->SetValFloat(Math::NormAngle(2*Math::PI - pos.y)*180.0f/Math::PI);
+        else if ( name == pitch )
+            item->SetValFloat((Math::NormAngle(pos.z + Math::PI) - Math::PI)*180.0f/Math::PI);
+        else
+            item->SetValFloat((Math::NormAngle(pos.x + Math::PI) - Math::PI)*180.0f/Math::PI);
+    }
+    else if ( name == energyLevel )
+    {
+        // Updates the energy level of the object.
+        item->SetValFloat(object->GetEnergyLevel());
+    }
+    else if ( name == shieldLevel )
+    {
+        // Updates the shield level of the object.
+        float value;
+        if ( !obj->Implements(ObjectInterfaceType::Shielded) ) value = 1.0f;
+        else value = dynamic_cast<CShieldedObject*>(object)->GetShield();
+        item->SetValFloat(value);
+    }
+    else if ( name == temperature )
+    {
+        // Updates the temperature of the reactor.
+        float value;
+        if ( !obj->Implements(ObjectInterfaceType::JetFlying) )  value = 0.0f;
+        else value = 1.0f-dynamic_cast<CJetFlyingObject*>(object)->GetReactorRange();
+        item->SetValFloat(value);
+    }
+    else if ( name == altitude )
     {
-        CObject* cargo = dynamic_cast<CCarrierObject*>(object)->GetCargo();
-        if (cargo == nullptr)
+        // Updates the height above the ground.
+        float value;
+        if ( physics == nullptr )  value = 0.0f;
+        else                 value = physics->GetFloorHeight();
+        item->SetValFloat(value/g_unit);
+    }
+    else if ( name == lifeTime )
+    {
+        // Updates the lifetime of the object.
+        item->SetValFloat(object->GetAbsTime());
+    }
+    else if ( name == energyCell )
+    {
+        // Updates the type of battery.
+        if (object->Implements(ObjectInterfaceType::Powered))
         {
-            pVar->SetPointer(nullptr);
+            CObject* power = dynamic_cast<CPoweredObject*>(object)->GetPower();
+            if (power == nullptr)
+            {
+                item->SetPointer(nullptr);
+            }
+            else if (power->Implements(ObjectInterfaceType::Old))
+            {
+                item->SetPointer(power->GetBotVar());
+            }
         }
-        else if (cargo->Implements(ObjectInterfaceType::Old))
+    }
+    else if ( name == load )
+    {
+        // Updates the transported object's type.
+        if (object->Implements(ObjectInterfaceType::Carrier))
         {
-            pVar->SetPointer(cargo->GetBotVar());
+            CObject* cargo = dynamic_cast<CCarrierObject*>(object)->GetCargo();
+            if (cargo == nullptr)
+            {
+                item->SetPointer(nullptr);
+            }
+            else if (cargo->Implements(ObjectInterfaceType::Old))
+            {
+                item->SetPointer(cargo->GetBotVar());
+            }
         }
     }
-
-    pVar = pVar->GetNext();  // "id"
-    value = object->GetID();
-    pVar->SetValInt(value);
-
-    pVar = pVar->GetNext();  // "team"
-    value = object->GetTeam();
-    pVar->SetValInt(value);
-
-    pVar = pVar->GetNext();  // "dead"
-    value = object->IsDying();
-    pVar->SetValInt(value);
-
-    // Updates the velocity of the object.
-    pVar = pVar->GetNext();  // "velocity"
-    if (IsObjectBeingTransported(object) || physics == nullptr)
+    else if ( name == id )
     {
-        pSub = pVar->GetItemList();  // "x"
-        pSub->SetInit(CBotVar::InitType::IS_NAN);
-        pSub = pSub->GetNext();  // "y"
-        pSub->SetInit(CBotVar::InitType::IS_NAN);
-        pSub = pSub->GetNext();  // "z"
-        pSub->SetInit(CBotVar::InitType::IS_NAN);
+        item->SetValInt(object->GetID());
     }
-    else
+    else if ( name == team )
     {
-        Math::Matrix matRotate;
-        Math::LoadRotationZXYMatrix(matRotate, object->GetRotation());
-        pos = physics->GetLinMotion(MO_CURSPEED);
-        pos = Transform(matRotate, pos);
-
-        pSub = pVar->GetItemList();  // "x"
-        pSub->SetValFloat(pos.x/g_unit);
-        pSub = pSub->GetNext();  // "y"
-        pSub->SetValFloat(pos.z/g_unit);
-        pSub = pSub->GetNext();  // "z"
-        pSub->SetValFloat(pos.y/g_unit);
+        item->SetValInt(object->GetTeam());
+    }
+    else if ( name == dead )
+    {
+        item->SetValInt(object->IsDying());
+    }
+    else if ( name == velocity )
+    {
+        // Updates the velocity of the object.
+        if (IsObjectBeingTransported(object) || physics == nullptr)
+        {
+            SetPointVarNan(item);
+        }
+        else
+        {
+            Math::Matrix matRotate;
+            Math::LoadRotationZXYMatrix(matRotate, object->GetRotation());
+            Math::Vector pos = physics->GetLinMotion(MO_CURSPEED);
+            SetPointVar(item, Transform(matRotate, pos));
+        }
     }
 }
 
@@ -3655,7 +3807,7 @@ CBotVar* CScriptFunctions::CreateObjectVar(CObject* obj)
     CBotClass* bc = CBotClass::Find("object");
     if ( bc != nullptr )
     {
-        bc->SetUpdateFunc(CScriptFunctions::uObject);
+        bc->SetUpdateItemFunc(CScriptFunctions::uObjectItem);
     }
 
     CBotVar* botVar = CBotVar::Create("", CBotTypResult(CBotTypClass, "object"));
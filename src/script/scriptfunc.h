@@ -60,6 +60,7 @@ private:
     static CBot::CBotTypResult cSearchAll(CBot::CBotVar* &var, void* user);
     static CBot::CBotTypResult cRadar(CBot::CBotVar* &var, void* user);
     static CBot::CBotTypResult cRadarAll(CBot::CBotVar* &var, void* user);
+    static CBot::CBotTypResult cRadarNearest(CBot::CBotVar* &var, void* user);
     static CBot::CBotTypResult cDetect(CBot::CBotVar* &var, void* user);
     static CBot::CBotTypResult cDirection(CBot::CBotVar* &var, void* user);
     static CBot::CBotTypResult cProduce(CBot::CBotVar* &var, void* user);
@@ -103,6 +104,7 @@ private:
     static bool rSearchAll(CBot::CBotVar* var, CBot::CBotVar* result, int& exception, void* user);
     static bool rRadar(CBot::CBotVar* var, CBot::CBotVar* result, int& exception, void* user);
     static bool rRadarAll(CBot::CBotVar* var, CBot::CBotVar* result, int& exception, void* user);
+    static bool rRadarNearest(CBot::CBotVar* var, CBot::CBotVar* result, int& exception, void* user);
     static bool rDetect(CBot::CBotVar* var, CBot::CBotVar* result, int& exception, void* user);
     static bool rDirection(CBot::CBotVar* var, CBot::CBotVar* result, int& exception, void* user);
     static bool rCanBuild(CBot::CBotVar* var, CBot::CBotVar* result, int& exception, void* user);
@@ -158,7 +160,7 @@ private:
     static CBot::CBotTypResult cPointConstructor(CBot::CBotVar* pThis, CBot::CBotVar* &var);
     static bool rPointConstructor(CBot::CBotVar* pThis, CBot::CBotVar* var, CBot::CBotVar* pResult, int& Exception, void* user);
 
-    static void uObject(CBot::CBotVar* botThis, void* user);
+    static void uObjectItem(CBot::CBotVar* botThis, CBot::CBotVar* item, void* user);
 
 private:
     static bool     WaitForForegroundTask(CScript* script, CBot::CBotVar* result, int &exception);
@@ -26,6 +26,7 @@
 #include "common/event.h"
 #include "common/logger.h"
 #include "common/settings.h"
+#include "common/stringutils.h"
 
 #include "common/resources/resourcemanager.h"
 
@@ -247,6 +248,12 @@ bool CStudio::EventProcess(const Event &event)
         m_script->Step();
     }
 
+    if ( event.type == EVENT_STUDIO_PROFILE )  // profiling?
+    {
+        m_script->SetProfiling(!m_script->GetProfiling());
+        UpdateButtons();
+    }
+
     if ( event.type == EVENT_WINDOW3 )  // window is moved?
     {
         m_editActualPos = m_editFinalPos = pw->GetPos();
@@ -375,8 +382,16 @@ bool CStudio::EventFrame(const Event &event)
         m_bRunning = false;
         UpdateFlux();  // stop
         AdjustEditScript();
-        std::string res;
-        GetResource(RES_TEXT, RT_STUDIO_PROGSTOP, res);
+        std::string res, report;
+        if ( m_script->GetProfileReport(report) )  // shows the hot lines
+        {
+            GetResource(RES_TEXT, RT_STUDIO_PROFILE, res);
+            res = StrUtils::Format(res.c_str(), report.c_str());
+        }
+        else
+        {
+            GetResource(RES_TEXT, RT_STUDIO_PROGSTOP, res);
+        }
         SetInfoText(res, false);
 
         m_event->AddEvent(Event(EVENT_OBJECT_PROGSTOP));
@@ -683,6 +698,8 @@ void CStudio::StartEditScript(CScript *script, std::string name, Program* progra
     button->SetState(STATE_SHADOW);
     button = pw->CreateButton(pos, dim, 64+29, EVENT_STUDIO_STEP);
     button->SetState(STATE_SHADOW);
+    button = pw->CreateButton(pos, dim, 41, EVENT_STUDIO_PROFILE);
+    button->SetState(STATE_SHADOW);
 
     if (!m_program->runnable)
     {
@@ -894,6 +911,13 @@ void CStudio::AdjustEditScript()
         button->SetPos(pos);
         button->SetDim(dim);
     }
+    pos.x = wpos.x+0.28f+dim.x*4;
+    button = static_cast< CButton* >(pw->SearchControl(EVENT_STUDIO_PROFILE));
+    if ( button != nullptr )
+    {
+        button->SetPos(pos);
+        button->SetDim(dim);
+    }
 }
 
 // Ends edition of a program.
@@ -921,6 +945,7 @@ bool CStudio::StopEditScript(bool closeWithErrors)
         }
     }
     m_script->SetStepMode(false);
+    m_script->SetProfiling(false);
 
     m_interface->DeleteControl(EVENT_WINDOW3);
 
@@ -1203,6 +1228,11 @@ void CStudio::UpdateButtons()
     if ( button == nullptr )  return;
     button->SetState(STATE_ENABLE, (m_bRunning && !m_bRealTime && !m_script->IsContinue()));
 
+    button = static_cast< CButton* >(pw->SearchControl(EVENT_STUDIO_PROFILE));
+    if ( button == nullptr )  return;
+    button->SetState(STATE_CHECK, m_script->GetProfiling());
+    button->SetState(STATE_ENABLE, m_program->runnable);
+
 
     button = static_cast< CButton* >(pw->SearchControl(EVENT_STUDIO_NEW));
     if ( button == nullptr )  return;
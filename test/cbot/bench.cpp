@@ -0,0 +1,275 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+// Measures the speed of the CBot compiler and interpreter on a set of typical programs
+//
+// Usage: CBot_bench [-n iterations] [benchmark...]
+//
+// The results are written to stdout as CSV, one line per benchmark:
+//   name       name of the benchmark
+//   compile_ms average time to compile the program
+//   steps      number of execution steps of one run (see CBotProgram::SetTimer())
+//   run_ms     time of the fastest run
+//   steps_per_second
+//   peak_rss_kb peak memory used by the process so far, 0 if unknown
+
+#include "common/config.h"
+
+#include "CBot/CBot.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifndef PLATFORM_WINDOWS
+#include <sys/resource.h>
+#endif
+
+using namespace CBot;
+
+namespace
+{
+
+struct Benchmark
+{
+    const char* name;
+    const char* code;
+};
+
+const Benchmark BENCHMARKS[] =
+{
+    {
+        "arithmetic",
+        "extern void Bench()\n"
+        "{\n"
+        "    int sum = 0;\n"
+        "    float x = 0;\n"
+        "    for (int i = 0; i < 100000; i++)\n"
+        "    {\n"
+        "        sum += i * 3 % 7 - (i >> 2);\n"
+        "        x = x * 0.5 + i / 3.0;\n"
+        "    }\n"
+        "}\n"
+    },
+    {
+        "array_scan",
+        "extern void Bench()\n"
+        "{\n"
+        "    int values[];\n"
+        "    for (int i = 0; i < 1000; i++) values[i] = (i * 7919) % 1000;\n"
+        "    int best = 0;\n"
+        "    for (int pass = 0; pass < 50; pass++)\n"
+        "    {\n"
+        "        for (int i = 0; i < sizeof(values); i++)\n"
+        "        {\n"
+        "            if (values[i] > best) best = values[i];\n"
+        "        }\n"
+        "    }\n"
+        "}\n"
+    },
+    {
+        "string_build",
+        "extern void Bench()\n"
+        "{\n"
+        "    for (int pass = 0; pass < 200; pass++)\n"
+        "    {\n"
+        "        string text = \"\";\n"
+        "        for (int i = 0; i < 100; i++) text += \"item\" + i + \";\";\n"
+        "        int count = 0;\n"
+        "        for (int i = 0; i < strlen(text); i += 10)\n"
+        "        {\n"
+        "            if (strmid(text, i, 4) == \"item\") count++;\n"
+        "        }\n"
+        "    }\n"
+        "}\n"
+    },
+    {
+        "class_methods",
+        "public class BenchCounter\n"
+        "{\n"
+        "    int value = 0;\n"
+        "    void Add(int n) { value += n; }\n"
+        "    int Get() { return value; }\n"
+        "}\n"
+        "extern void Bench()\n"
+        "{\n"
+        "    BenchCounter counter();\n"
+        "    for (int i = 0; i < 50000; i++)\n"
+        "    {\n"
+        "        counter.Add(i % 10);\n"
+        "        if (counter.Get() > 1000000) counter.value = 0;\n"
+        "    }\n"
+        "}\n"
+    },
+    {
+        "recursion",
+        "int Fib(int n)\n"
+        "{\n"
+        "    if (n < 2) return n;\n"
+        "    return Fib(n - 1) + Fib(n - 2);\n"
+        "}\n"
+        "extern void Bench()\n"
+        "{\n"
+        "    int result = Fib(20);\n"
+        "}\n"
+    },
+    {
+        "try_catch",
+        "void Check(int i)\n"
+        "{\n"
+        "    if (i % 2 == 0) throw 1000;\n"
+        "}\n"
+        "extern void Bench()\n"
+        "{\n"
+        "    int caught = 0;\n"
+        "    for (int i = 0; i < 20000; i++)\n"
+        "    {\n"
+        "        try\n"
+        "        {\n"
+        "            Check(i);\n"
+        "        }\n"
+        "        catch (1000) { caught++; }\n"
+        "    }\n"
+        "}\n"
+    },
+};
+
+double GetMilliseconds(std::chrono::steady_clock::duration duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+long GetPeakMemory()
+{
+#ifndef PLATFORM_WINDOWS
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) return usage.ru_maxrss;
+#endif
+    return 0;
+}
+
+bool Compile(CBotProgram& program, const std::string& code)
+{
+    std::vector<std::string> externFunctions;
+    if (program.Compile(code, externFunctions)) return true;
+
+    CBotError error;
+    int cursor1, cursor2;
+    program.GetError(error, cursor1, cursor2);
+    std::cerr << "COMPILE ERROR (code: " << error << ") @ " << cursor1 << " - " << cursor2 << std::endl;
+    return false;
+}
+
+bool Run(CBotProgram& program)
+{
+    program.Start("Bench");
+    while (!program.Run(nullptr));
+
+    CBotError error;
+    int cursor1, cursor2;
+    program.GetError(error, cursor1, cursor2);
+    if (error == CBotNoErr) return true;
+
+    std::cerr << "RUNTIME ERROR (code: " << error << ") @ " << cursor1 << " - " << cursor2 << std::endl;
+    return false;
+}
+
+bool RunBenchmark(const Benchmark& benchmark, int iterations)
+{
+    using Clock = std::chrono::steady_clock;
+
+    // each program is deleted before the next one is compiled, so the code isn't shared
+    Clock::duration compileTime = Clock::duration::zero();
+    for (int i = 0; i < iterations; i++)
+    {
+        std::unique_ptr<CBotProgram> program(new CBotProgram(nullptr));
+        Clock::time_point start = Clock::now();
+        if (!Compile(*program, benchmark.code)) return false;
+        compileTime += Clock::now() - start;
+    }
+
+    std::unique_ptr<CBotProgram> program(new CBotProgram(nullptr));
+    if (!Compile(*program, benchmark.code)) return false;
+
+    // count the steps once, the profiler slows the execution down
+    program->SetProfilerEnabled(true);
+    if (!Run(*program)) return false;
+    long steps = program->GetProfiler()->GetTotalSteps();
+    program->SetProfilerEnabled(false);
+
+    Clock::duration runTime = Clock::duration::max();
+    for (int i = 0; i < iterations; i++)
+    {
+        Clock::time_point start = Clock::now();
+        if (!Run(*program)) return false;
+        runTime = std::min(runTime, Clock::now() - start);
+    }
+
+    double runMs = GetMilliseconds(runTime);
+    std::cout << benchmark.name << ","
+              << GetMilliseconds(compileTime) / iterations << ","
+              << steps << ","
+              << runMs << ","
+              << static_cast<long>(runMs > 0.0 ? steps * 1000.0 / runMs : 0.0) << ","
+              << GetPeakMemory() << std::endl;
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    int iterations = 5;
+    std::vector<std::string> selected;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            iterations = std::max(1, atoi(argv[++i]));
+        }
+        else
+        {
+            selected.push_back(argv[i]);
+        }
+    }
+
+    CBotProgram::Init();
+
+    std::cout << "name,compile_ms,steps,run_ms,steps_per_second,peak_rss_kb" << std::endl;
+
+    bool errors = false;
+    for (const Benchmark& benchmark : BENCHMARKS)
+    {
+        if (!selected.empty() && std::find(selected.begin(), selected.end(), benchmark.name) == selected.end()) continue;
+
+        if (!RunBenchmark(benchmark, iterations))
+        {
+            std::cerr << "Benchmark " << benchmark.name << " failed" << std::endl;
+            errors = true;
+        }
+    }
+
+    CBotProgram::Free();
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,241 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+#include "CBot/CBotSnapshot.h"
+
+#include "CBot/CBotFileUtils.h"
+#include "CBot/CBotProgram.h"
+
+#include "CBot/CBotVar/CBotVar.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <sstream>
+
+using namespace CBot;
+
+class CBotSnapshotUT : public testing::Test
+{
+public:
+    CBotSnapshotUT()
+    {
+        CBotProgram::Init();
+        CBotProgram::AddFunction("RESULT", rResult, cResult);
+        m_results.clear();
+    }
+
+    ~CBotSnapshotUT()
+    {
+        CBotProgram::Free();
+    }
+
+protected:
+    static CBotTypResult cResult(CBotVar* &var, void* user)
+    {
+        if (var == nullptr) return CBotTypResult(CBotErrLowParam);
+        if (var->GetType() > CBotTypDouble) return CBotTypResult(CBotErrBadNum);
+        var = var->GetNext();
+        if (var != nullptr) return CBotTypResult(CBotErrOverParam);
+        return CBotTypResult(CBotTypVoid);
+    }
+
+    static bool rResult(CBotVar* var, CBotVar* result, int& exception, void* user)
+    {
+        m_results.push_back(var->GetValInt());
+        return true;
+    }
+
+    std::unique_ptr<CBotProgram> Compile(const std::string& code)
+    {
+        std::unique_ptr<CBotProgram> program(new CBotProgram());
+        std::vector<std::string> externs;
+        EXPECT_TRUE(program->Compile(code, externs));
+        return program;
+    }
+
+    static std::vector<int> m_results;
+};
+
+std::vector<int> CBotSnapshotUT::m_results;
+
+TEST_F(CBotSnapshotUT, EmptySnapshot)
+{
+    CBotSnapshotWriter writer;
+    std::stringstream ss;
+    ASSERT_TRUE(writer.Write(ss));
+
+    CBotSnapshotReader reader;
+    ASSERT_TRUE(reader.Read(ss));
+    EXPECT_EQ(reader.GetEntryCount(), 0u);
+    EXPECT_FALSE(reader.HasEntry(1));
+    EXPECT_EQ(reader.GetEntry(1), nullptr);
+}
+
+TEST_F(CBotSnapshotUT, EntriesInAnyOrder)
+{
+    CBotSnapshotWriter writer;
+    WriteString(writer.AddEntry(10), "first");
+    WriteLong(writer.AddEntry(20), -123456789);
+    writer.AddEntry(30);                            // empty entry
+    WriteString(writer.AddEntry(40), "a much longer entry which will be cancelled");
+    writer.CancelEntry();
+    WriteFloat(writer.AddEntry(50), 1.5f);
+    EXPECT_EQ(writer.GetEntryCount(), 4u);
+
+    std::stringstream ss;
+    ASSERT_TRUE(writer.Write(ss));
+    ss << "data after the snapshot";
+
+    CBotSnapshotReader reader;
+    ASSERT_TRUE(reader.Read(ss));
+    EXPECT_EQ(reader.GetEntryCount(), 4u);
+    EXPECT_FALSE(reader.HasEntry(40));
+
+    // each entry ends where the next one starts
+    std::istream* entry = reader.GetEntry(50);
+    ASSERT_NE(entry, nullptr);
+    float f = 0.0f;
+    char c;
+    ASSERT_TRUE(ReadFloat(*entry, f));
+    EXPECT_EQ(f, 1.5f);
+    EXPECT_FALSE(ReadByte(*entry, c));
+
+    std::string s;
+    ASSERT_TRUE(ReadString(*reader.GetEntry(10), s));
+    EXPECT_EQ(s, "first");
+
+    long l = 0;
+    ASSERT_TRUE(ReadLong(*reader.GetEntry(20), l));
+    EXPECT_EQ(l, -123456789);
+
+    ASSERT_NE(reader.GetEntry(30), nullptr);
+    EXPECT_FALSE(ReadByte(*reader.GetEntry(30), c));
+
+    // the stream is left right after the snapshot
+    std::string rest;
+    std::getline(ss, rest);
+    EXPECT_EQ(rest, "data after the snapshot");
+}
+
+TEST_F(CBotSnapshotUT, RejectsOtherData)
+{
+    CBotSnapshotReader reader;
+
+    std::stringstream notSnapshot("not a snapshot");
+    EXPECT_FALSE(reader.Read(notSnapshot));
+
+    CBotSnapshotWriter writer;
+    WriteString(writer.AddEntry(1), "entry");
+    std::stringstream ss;
+    ASSERT_TRUE(writer.Write(ss));
+
+    std::string otherVersion = ss.str();
+    otherVersion[8] = 0x7F;                         // first byte after the magic
+    std::stringstream otherVersionStream(otherVersion);
+    EXPECT_FALSE(reader.Read(otherVersionStream));
+
+    std::string truncated = ss.str();
+    truncated.resize(truncated.size() - 2);
+    std::stringstream truncatedStream(truncated);
+    EXPECT_FALSE(reader.Read(truncatedStream));
+    EXPECT_FALSE(reader.HasEntry(1));
+}
+
+TEST_F(CBotSnapshotUT, ProgramStateRoundTrip)
+{
+    const std::string code =
+        "extern void Main()\n"
+        "{\n"
+        "    int sum = 0;\n"
+        "    string text = \"\";\n"
+        "    int[] squares;\n"
+        "    for (int i = 0; i < 20; i++)\n"
+        "    {\n"
+        "        sum += i;\n"
+        "        squares[i] = i * i;\n"
+        "        text += \"x\";\n"
+        "    }\n"
+        "    RESULT(sum);\n"
+        "    RESULT(squares[19]);\n"
+        "    RESULT(strlen(text));\n"
+        "}\n";
+
+    // uninterrupted execution
+    std::unique_ptr<CBotProgram> reference = Compile(code);
+    reference->Start("Main");
+    while (!reference->Run(nullptr, 0));
+    ASSERT_EQ(reference->GetError(), CBotNoErr);
+    const std::vector<int> expected = m_results;
+    ASSERT_EQ(expected, std::vector<int>({190, 361, 20}));
+
+    // save programs stopped at different points, and one which isn't running
+    CBotSnapshotWriter writer;
+    for (long id = 1; id <= 3; id++)
+    {
+        std::unique_ptr<CBotProgram> program = Compile(code);
+        program->Start("Main");
+        for (int step = 0; step < id * 40; step++)
+        {
+            ASSERT_FALSE(program->Run(nullptr, 0));
+        }
+        ASSERT_TRUE(program->SaveState(writer.AddEntry(id)));
+    }
+    std::unique_ptr<CBotProgram> stopped = Compile(code);
+    ASSERT_TRUE(stopped->SaveState(writer.AddEntry(4)));
+
+    std::stringstream ss;
+    ASSERT_TRUE(writer.Write(ss));
+
+    CBotSnapshotReader reader;
+    ASSERT_TRUE(reader.Read(ss));
+    ASSERT_EQ(reader.GetEntryCount(), 4u);
+
+    // each one resumes where it was saved
+    for (long id = 3; id >= 1; id--)
+    {
+        m_results.clear();
+        std::unique_ptr<CBotProgram> program = Compile(code);
+        ASSERT_TRUE(program->RestoreState(*reader.GetEntry(id)));
+        while (!program->Run(nullptr, 0));
+        EXPECT_EQ(program->GetError(), CBotNoErr);
+        EXPECT_EQ(m_results, expected) << "entry " << id;
+    }
+
+    std::unique_ptr<CBotProgram> program = Compile(code);
+    ASSERT_TRUE(program->RestoreState(*reader.GetEntry(4)));
+    std::string function;
+    int start, end;
+    EXPECT_FALSE(program->GetRunPos(function, start, end));
+}
+
+TEST_F(CBotSnapshotUT, LegacyStreamRoundTrip)
+{
+    // the format of version 1 saves, each program in its own block
+    std::stringstream block;
+    WriteString(block, "program state");
+    WriteLong(block, 42);
+
+    std::stringstream file;
+    ASSERT_TRUE(WriteStream(file, block));
+
+    std::stringstream restored;
+    ASSERT_TRUE(ReadStream(file, restored));
+    EXPECT_EQ(restored.str(), block.str());
+}
@@ -122,3 +122,44 @@ TEST_F(CBotTokenUT, BasicProgram)
         {"}",           ID_CLBLK},
     });
 }
+
+TEST_F(CBotTokenUT, LongestOperator)
+{
+    ExecuteTest("a>>>=b>>=c>>>d<<=e**f!=g%=h", {
+        {"a",    TokenTypVar},
+        {">>>=", ID_ASSSR},
+        {"b",    TokenTypVar},
+        {">>=",  ID_ASSASR},
+        {"c",    TokenTypVar},
+        {">>>",  ID_SR},
+        {"d",    TokenTypVar},
+        {"<<=",  ID_ASSSL},
+        {"e",    TokenTypVar},
+        {"**",   ID_POWER},
+        {"f",    TokenTypVar},
+        {"!=",   ID_NE},
+        {"g",    TokenTypVar},
+        {"%=",   ID_ASSMODULO},
+        {"h",    TokenTypVar},
+    });
+}
+
+TEST_F(CBotTokenUT, InternedNames)
+{
+    auto tokens = CBotToken::CompileTokens("pos = pos + position;");
+    ASSERT_TRUE(tokens != nullptr);
+    CBotToken* first = tokens.get()->GetNext();
+    CBotToken* second = first->GetNext()->GetNext();
+    CBotToken* third = second->GetNext()->GetNext();
+
+    EXPECT_NE(first->GetNameId(), 0);
+    EXPECT_EQ(first->GetNameId(), second->GetNameId());
+    EXPECT_NE(first->GetNameId(), third->GetNameId());
+    EXPECT_EQ(first->GetNameId(), CBotToken::InternName("pos"));
+
+    // copies keep the ID, renamed tokens get a new one
+    CBotToken copy(*third);
+    EXPECT_EQ(copy.GetNameId(), third->GetNameId());
+    copy.SetString("pos");
+    EXPECT_EQ(copy.GetNameId(), first->GetNameId());
+}
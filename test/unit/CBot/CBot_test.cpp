@@ -18,8 +18,13 @@
  */
 
 #include "CBot/CBot.h"
+#include "CBot/CBotVar/CBotVarClass.h"
+#include "CBot/CBotVar/CBotVarString.h"
 
 #include <gtest/gtest.h>
+
+#include <algorithm>
+#include <map>
 #include <stdexcept>
 
 extern bool g_cbotTestSaveState;
@@ -218,6 +223,11 @@ private:
     }
 
 protected:
+    //! Compile with CBotProgram::SetBytecodeEnabled(), bytecode is not used in step mode so the tests run with a timer
+    bool m_bytecode = false;
+    //! Run with CBotProgram::SetProfilerEnabled()
+    bool m_profiler = false;
+
     std::unique_ptr<CBotProgram> ExecuteTest(const std::string& code, CBotError expectedError = CBotNoErr)
     {
         CBotError expectedCompileError = expectedError < 6000 ? expectedError : CBotNoErr;
@@ -225,6 +235,8 @@ protected:
 
         auto program = std::unique_ptr<CBotProgram>(new CBotProgram());
         std::vector<std::string> tests;
+        program->SetBytecodeEnabled(m_bytecode);
+        program->SetProfilerEnabled(m_profiler);
         program->Compile(code, tests);
 
         CBotError error;
@@ -251,16 +263,17 @@ protected:
             try
             {
                 program->Start(test);
+                int timer = m_bytecode ? 100 : 0;
                 if (g_cbotTestSaveState)
                 {
-                    while (!program->Run(nullptr, 0)) // save/restore at each step
+                    while (!program->Run(nullptr, timer)) // save/restore at each step
                     {
                         TestSaveAndRestore(program.get());
                     }
                 }
                 else
                 {
-                    while (!program->Run(nullptr, 0)); // execute in step mode
+                    while (!program->Run(nullptr, timer)); // execute in step mode
                 }
                 program->GetError(error, cursor1, cursor2);
                 if (error != expectedRuntimeError)
@@ -1856,6 +1869,19 @@ TEST_F(CBotUT, StringFunctions)
         "    ASSERT(strright(\"asdf\", 15) == \"asdf\");\n"
         "    ASSERT(strright(\"asdf\", -15) == \"\");\n"
         "}\n"
+        "extern void StringFunctionsOnSubstrings()\n"
+        "{\n"
+        "    string s = \"Hello, world\";\n"
+        "    string w = strmid(s, 7, 5);\n"
+        "    ASSERT(w == \"world\");\n"
+        "    ASSERT(strleft(w, 3) == \"wor\");\n"
+        "    ASSERT(strright(strleft(s, 5), 2) == \"lo\");\n"
+        "    ASSERT(strfind(w, \"l\") == 3);\n"
+        "    ASSERT(strfind(strleft(s, 4), \"\") == 0);\n"
+        "    s = \"changed\";\n"
+        "    ASSERT(w == \"world\");\n"
+        "    ASSERT(strlen(w + s) == 12);\n"
+        "}\n"
     );
 }
 
@@ -3197,3 +3223,1019 @@ TEST_F(CBotUT, ClassTestPrivateMethod)
         CBotErrPrivate
     );
 }
+
+TEST_F(CBotUT, BytecodeExpressions)
+{
+    m_bytecode = true;
+    auto program = ExecuteTest(
+        "extern void IntegerMath()\n"
+        "{\n"
+        "    int a = 7, b = 2;\n"
+        "    ASSERT(a + b * 3 == 13);\n"
+        "    ASSERT((a - b) * -b == -10);\n"
+        "    ASSERT(a / b == 3);\n"
+        "    ASSERT(a % b == 1);\n"
+        "    ASSERT(b ** 10 == 1024);\n"
+        "    ASSERT((a << b) == 28);\n"
+        "    ASSERT((-a >> 1) == -4);\n"
+        "    ASSERT((-a >>> 28) == 15);\n"
+        "    ASSERT((a & b | 8 ^ 1) == 11);\n"
+        "    ASSERT(~a == -8);\n"
+        "}\n"
+        "\n"
+        "extern void FloatMath()\n"
+        "{\n"
+        "    int a = 7;\n"
+        "    float f = 0.5;\n"
+        "    ASSERT(a * f == 3.5);\n"
+        "    ASSERT(a / 2.0 == 3.5);\n"
+        "    ASSERT(a % 2.5 == 2);\n"
+        "    ASSERT(f ** 2 == 0.25);\n"
+        "    ASSERT(a > f && f >= 0.5 && !(f < 0));\n"
+        "    float r = a + f;\n"
+        "    ASSERT(r == 7.5);\n"
+        "}\n"
+        "\n"
+        "extern void ShortCircuit()\n"
+        "{\n"
+        "    int zero = 0;\n"
+        "    bool t = true;\n"
+        "    ASSERT(zero == 0 || 1 / zero == 1);\n"
+        "    ASSERT(!(zero != 0 && 1 / zero == 1));\n"
+        "    ASSERT((t ^ false) == true);\n"
+        "}\n"
+    );
+    EXPECT_GT(program->GetBytecodeCount(), 0);
+
+    ExecuteTest(
+        "extern void BytecodeDivideByZero()\n"
+        "{\n"
+        "    int a = 5, b = 0;\n"
+        "    int c = a / b;\n"
+        "}\n",
+        CBotErrZeroDiv
+    );
+
+    ExecuteTest(
+        "extern void BytecodeNan()\n"
+        "{\n"
+        "    float a = nan;\n"
+        "    float c = a + 1;\n"
+        "}\n",
+        CBotErrNan
+    );
+}
+
+TEST_F(CBotUT, LocalVariableSlots)
+{
+    ExecuteTest(
+        "int Fact(int n)\n"
+        "{\n"
+        "    int r = 1;\n"
+        "    if (n > 1) r = n * Fact(n - 1);\n"
+        "    return r;\n"
+        "}\n"
+        "\n"
+        "extern void RecursionKeepsOwnLocals()\n"
+        "{\n"
+        "    int n = 5;\n"
+        "    ASSERT(Fact(n) == 120);\n"
+        "    ASSERT(n == 5);\n"
+        "}\n"
+        "\n"
+        "extern void BlockLocalsAreRecreated()\n"
+        "{\n"
+        "    int sum = 0;\n"
+        "    for (int i = 0; i < 5; i++)\n"
+        "    {\n"
+        "        int x;\n"
+        "        x = i * 2;\n"
+        "        {\n"
+        "            int y = x + 1;\n"
+        "            sum += y;\n"
+        "        }\n"
+        "    }\n"
+        "    ASSERT(sum == 25);\n"
+        "    for (int i = 0; i < 3; i++)\n"
+        "    {\n"
+        "        int[] a;\n"
+        "        a[i] = i;\n"
+        "        ASSERT(sizeof(a) == i + 1);\n"
+        "    }\n"
+        "}\n"
+        "\n"
+        "public class SlotTest\n"
+        "{\n"
+        "    int field = 3;\n"
+        "    int Add(int value)\n"
+        "    {\n"
+        "        int local = value + field;\n"
+        "        field = local;\n"
+        "        return local;\n"
+        "    }\n"
+        "}\n"
+        "\n"
+        "extern void MethodLocalsAndFields()\n"
+        "{\n"
+        "    SlotTest t();\n"
+        "    int local = 10;\n"
+        "    ASSERT(t.Add(local) == 13);\n"
+        "    ASSERT(t.Add(1) == 14);\n"
+        "    ASSERT(local == 10);\n"
+        "}\n"
+    );
+}
+
+TEST_F(CBotUT, ArrayIndexing)
+{
+    ExecuteTest(
+        "extern void ArrayGrowsOnWrite()\n"
+        "{\n"
+        "    int a[];\n"
+        "    for (int i = 0; i < 500; i++) a[i] = i * 2;\n"
+        "    ASSERT(sizeof(a) == 500);\n"
+        "    int sum = 0;\n"
+        "    for (int i = 499; i >= 0; i--) sum += a[i];\n"
+        "    ASSERT(sum == 249500);\n"
+        "    a[700] = 1;\n"
+        "    ASSERT(sizeof(a) == 701);\n"
+        "}\n"
+        "\n"
+        "extern void ArraySharedBetweenPointers()\n"
+        "{\n"
+        "    float a[] = {0.5};\n"
+        "    float b[] = a;\n"
+        "    b[3] = 1.5;\n"
+        "    ASSERT(sizeof(a) == 4);\n"
+        "    ASSERT(a[3] == 1.5);\n"
+        "    string s[] = {\"a\", \"b\", \"c\"};\n"
+        "    s[1] = s[2] + s[0];\n"
+        "    ASSERT(s[1] == \"ca\");\n"
+        "}\n"
+    );
+
+    ExecuteTest(
+        "extern void ArrayLimit()\n"
+        "{\n"
+        "    int a[3];\n"
+        "    a[3] = 1;\n"
+        "}\n",
+        CBotErrOutArray
+    );
+}
+
+TEST_F(CBotUT, Profiler)
+{
+    m_profiler = true;
+    auto program = ExecuteTest(
+        "int Square(int x)\n"
+        "{\n"
+        "    return x * x;\n"
+        "}\n"
+        "\n"
+        "extern void ProfiledLoop()\n"
+        "{\n"
+        "    int sum = 0;\n"
+        "    for (int i = 0; i < 10; i++) sum += Square(i);\n"
+        "    ASSERT(sum == 285);\n"
+        "}\n"
+    );
+    CBotProfiler* profiler = program->GetProfiler();
+    ASSERT_NE(profiler, nullptr);
+    EXPECT_GT(profiler->GetTotalSteps(), 0);
+
+    long steps = 0;
+    for (const auto& instr : profiler->GetInstructions())
+    {
+        EXPECT_LE(instr.start, instr.end);
+        steps += instr.steps;
+    }
+    EXPECT_EQ(steps, profiler->GetTotalSteps());
+
+    bool foundSquare = false;
+    for (const auto& function : profiler->GetFunctions())
+    {
+        if (function.name == "Square")
+        {
+            foundSquare = true;
+            EXPECT_EQ(function.calls, 10);
+            EXPECT_EQ(function.callers.at("ProfiledLoop"), 10);
+            EXPECT_GT(function.steps, 0);
+        }
+        if (function.name == "ProfiledLoop")
+        {
+            EXPECT_EQ(function.calls, 1);
+            EXPECT_EQ(function.callers.at(""), 1);
+        }
+    }
+    EXPECT_TRUE(foundSquare);
+
+    std::stringstream report;
+    profiler->WriteFlatReport(report, 5);
+    profiler->WriteCallGraph(report);
+    EXPECT_NE(report.str().find("called 10 times by ProfiledLoop"), std::string::npos);
+
+    program->SetProfilerEnabled(false);
+    EXPECT_EQ(program->GetProfiler(), nullptr);
+}
+
+TEST_F(CBotUT, InstructionBudget)
+{
+    const std::string code =
+        "extern void Busy()\n"
+        "{\n"
+        "    int sum = 0;\n"
+        "    for (int i = 0; i < 200; i++) sum += i;\n"
+        "    ASSERT(sum == 19900);\n"
+        "}\n";
+
+    std::vector<std::string> externs;
+    std::unique_ptr<CBotProgram> alone(new CBotProgram());
+    std::unique_ptr<CBotProgram> busy(new CBotProgram());
+    std::unique_ptr<CBotProgram> other(new CBotProgram());
+    ASSERT_TRUE(alone->Compile(code, externs));
+    ASSERT_TRUE(busy->Compile(code, externs));
+    ASSERT_TRUE(other->Compile(code, externs));
+
+    int aloneRuns = 1;
+    alone->Start("Busy");
+    while (!alone->Run(nullptr, 10)) aloneRuns++;
+    EXPECT_EQ(alone->GetError(), CBotNoErr);
+
+    // another program running in between doesn't change how many slices are needed
+    int runs = 1;
+    busy->Start("Busy");
+    other->Start("Busy");
+    while (!busy->Run(nullptr, 10))
+    {
+        runs++;
+        if (other->Run(nullptr, 1000)) other->Start("Busy");
+    }
+    EXPECT_EQ(busy->GetError(), CBotNoErr);
+    EXPECT_EQ(runs, aloneRuns);
+
+    const CBotRunStats& stats = busy->GetRunStats();
+    EXPECT_EQ(stats.slices + stats.skippedSlices, runs);
+    EXPECT_GT(stats.exhaustedSlices, 0);
+    EXPECT_EQ(stats.steps, alone->GetRunStats().steps);
+    EXPECT_LE(stats.steps, 10 * (runs + 1));
+    EXPECT_GT(stats.lastSliceSteps, 0);
+
+    busy->ResetRunStats();
+    EXPECT_EQ(busy->GetRunStats().steps, 0);
+    EXPECT_EQ(busy->GetTimer(), 10);
+}
+
+TEST_F(CBotUT, WorkerPool)
+{
+    // classes are always public, every program gets its own
+    const std::string code =
+        "public class Counter%\n"
+        "{\n"
+        "    int value = 0;\n"
+        "    void Add(int n) { value += n; }\n"
+        "}\n"
+        "\n"
+        "extern void Count()\n"
+        "{\n"
+        "    Counter% c = new Counter%();\n"
+        "    int[] squares;\n"
+        "    for (int i = 0; i < 100; i++)\n"
+        "    {\n"
+        "        squares[i] = i * i;\n"
+        "        c.Add(i);\n"
+        "    }\n"
+        "    if (c.value != 4950 || squares[99] != 9801) throw 1000;\n"  // ASSERT() can't be used outside of the main thread
+        "    int wrong = 1 / 0;\n"
+        "}\n";
+
+    std::vector<std::unique_ptr<CBotProgram>> programs;
+    for (int i = 0; i < 16; i++)
+    {
+        std::string source = code;
+        for (std::size_t pos; (pos = source.find('%')) != std::string::npos; )
+            source.replace(pos, 1, std::to_string(10 + i));  // same length, same error position
+
+        std::vector<std::string> externs;
+        programs.push_back(std::unique_ptr<CBotProgram>(new CBotProgram()));
+        ASSERT_TRUE(programs.back()->Compile(source, externs));
+        programs.back()->Start("Count");
+    }
+
+    CBotWorkerPool pool(4);
+    EXPECT_EQ(pool.GetThreadCount(), 4);
+
+    std::vector<CBotWorkerPool::Slice> slices;
+    for (auto& program : programs)
+        slices.push_back({program.get(), nullptr, 20, false});
+
+    int batches = 0;
+    while (!slices.empty())
+    {
+        ASSERT_LT(++batches, 10000);
+        pool.Run(slices);
+        slices.erase(std::remove_if(slices.begin(), slices.end(), [](const CBotWorkerPool::Slice& slice)
+        {
+            return slice.finished;
+        }), slices.end());
+    }
+
+    // every program stopped on its own error, at the same place
+    int start, end;
+    CBotError error;
+    programs[0]->GetError(error, start, end);
+    EXPECT_EQ(error, CBotErrZeroDiv);
+    for (auto& program : programs)
+    {
+        int otherStart, otherEnd;
+        program->GetError(error, otherStart, otherEnd);
+        EXPECT_EQ(error, CBotErrZeroDiv);
+        EXPECT_EQ(otherStart, start);
+        EXPECT_EQ(otherEnd, end);
+    }
+}
+
+TEST_F(CBotUT, CompiledProgramCache)
+{
+    const std::string code =
+        "int Twice(int n) { return 2 * n; }\n"
+        "extern void Main()\n"
+        "{\n"
+        "    int sum = 0;\n"
+        "    for (int i = 0; i < 10; i++) sum += Twice(i);\n"
+        "    ASSERT(sum == 90);\n"
+        "}\n";
+
+    std::vector<std::string> externs;
+    std::unique_ptr<CBotProgram> first(new CBotProgram());
+    std::unique_ptr<CBotProgram> second(new CBotProgram());
+    ASSERT_TRUE(first->Compile(code, externs));
+    ASSERT_TRUE(second->Compile(code, externs));
+    ASSERT_EQ(externs, std::vector<std::string>{"Main"});
+
+    // the functions are compiled once and shared
+    EXPECT_EQ(first->GetFunctions(), second->GetFunctions());
+
+    // but each program has its own execution
+    first->Start("Main");
+    second->Start("Main");
+    while (!first->Run(nullptr, 5))
+    {
+        second->Run(nullptr, 3);
+    }
+    EXPECT_EQ(first->GetError(), CBotNoErr);
+
+    // the code outlives the program which compiled it
+    first.reset();
+    while (!second->Run(nullptr, 5));
+    EXPECT_EQ(second->GetError(), CBotNoErr);
+
+    // a different program isn't shared
+    std::unique_ptr<CBotProgram> other(new CBotProgram());
+    ASSERT_TRUE(other->Compile(code + "\n", externs));
+    EXPECT_NE(other->GetFunctions(), second->GetFunctions());
+
+    // the compile checks may depend on the user pointer, unless a compile context is given
+    int firstUser = 0, secondUser = 0;
+    std::unique_ptr<CBotProgram> withUser(new CBotProgram());
+    ASSERT_TRUE(withUser->Compile(code, externs, &firstUser));
+    EXPECT_NE(withUser->GetFunctions(), second->GetFunctions());
+    std::unique_ptr<CBotProgram> withOtherUser(new CBotProgram());
+    ASSERT_TRUE(withOtherUser->Compile(code, externs, &secondUser));
+    EXPECT_NE(withOtherUser->GetFunctions(), withUser->GetFunctions());
+
+    withUser->SetCompileContext(1);
+    withOtherUser->SetCompileContext(1);
+    ASSERT_TRUE(withUser->Compile(code, externs, &firstUser));
+    ASSERT_TRUE(withOtherUser->Compile(code, externs, &secondUser));
+    EXPECT_EQ(withOtherUser->GetFunctions(), withUser->GetFunctions());
+
+    // programs defining public functions aren't shared, and the code compiled before them is forgotten
+    const std::string publicCode =
+        "public int Thrice(int n) { return 3 * n; }\n"
+        "extern void Main() { ASSERT(Thrice(2) == 6); }\n";
+    std::unique_ptr<CBotProgram> withPublic(new CBotProgram());
+    ASSERT_TRUE(withPublic->Compile(publicCode, externs));
+
+    std::unique_ptr<CBotProgram> third(new CBotProgram());
+    ASSERT_TRUE(third->Compile(code, externs));
+    EXPECT_NE(third->GetFunctions(), second->GetFunctions());
+
+    // the shared code keeps the function identifiers found by the compiler, a public function
+    // defined again afterwards is found by name by each program, without changing the shared code
+    const std::string callsPublic = "extern void CallsPublic() { ASSERT(Thrice(2) == 6); }\n";
+    std::unique_ptr<CBotProgram> firstCaller(new CBotProgram());
+    std::unique_ptr<CBotProgram> secondCaller(new CBotProgram());
+    ASSERT_TRUE(firstCaller->Compile(callsPublic, externs));
+    ASSERT_TRUE(secondCaller->Compile(callsPublic, externs));
+    EXPECT_EQ(firstCaller->GetFunctions(), secondCaller->GetFunctions());
+
+    ASSERT_TRUE(withPublic->Compile("public int Thrice(int n) { return n + n + n; }\n", externs));
+    for (CBotProgram* caller : { firstCaller.get(), secondCaller.get(), firstCaller.get() })
+    {
+        caller->Start("CallsPublic");
+        while (!caller->Run(nullptr, 5));
+        EXPECT_EQ(caller->GetError(), CBotNoErr);
+    }
+}
+
+TEST_F(CBotUT, IncrementalCompilation)
+{
+    const std::string before =
+        "int Twice(int n) { return 2 * n; }\n"
+        "int Expected() { return 6; }\n"
+        "public int Thrice(int n) { return 3 * n; }\n"
+        "extern void Main()\n"
+        "{\n"
+        "    ASSERT(Twice(3) == Expected());\n"
+        "    ASSERT(Thrice(2) == 6);\n"
+        "}\n";
+    const std::string after =
+        "int Twice(int n) { return n + n + n; }\n"
+        "int Expected() { return 9; }\n"
+        "public int Thrice(int n) { return 3 * n; }\n"
+        "extern void Main()\n"
+        "{\n"
+        "    ASSERT(Twice(3) == Expected());\n"
+        "    ASSERT(Thrice(2) == 6);\n"
+        "}\n";
+
+    auto run = [](CBotProgram* program, const std::string& name)
+    {
+        program->Start(name);
+        while (!program->Run(nullptr, 100));
+        return program->GetError();
+    };
+
+    std::vector<std::string> externs;
+    std::unique_ptr<CBotProgram> program(new CBotProgram());
+    ASSERT_TRUE(program->Compile(before, externs));
+    EXPECT_EQ(program->GetReusedFunctionCount(), 0);
+    EXPECT_EQ(run(program.get(), "Main"), CBotNoErr);
+    std::vector<CBotFunction*> compiled(program->GetFunctions().begin(), program->GetFunctions().end());
+
+    // only the functions which changed are compiled again
+    ASSERT_TRUE(program->Compile(after, externs));
+    ASSERT_EQ(externs, std::vector<std::string>{"Main"});
+    EXPECT_EQ(program->GetReusedFunctionCount(), 2);
+    std::vector<CBotFunction*> recompiled(program->GetFunctions().begin(), program->GetFunctions().end());
+    ASSERT_EQ(recompiled.size(), 4u);
+    EXPECT_NE(recompiled[0], compiled[0]);
+    EXPECT_NE(recompiled[1], compiled[1]);
+    EXPECT_EQ(recompiled[2], compiled[2]);
+    EXPECT_EQ(recompiled[3], compiled[3]);
+    EXPECT_EQ(run(program.get(), "Main"), CBotNoErr);
+
+    // the reused functions moved with the code before them
+    int start, stop;
+    ASSERT_TRUE(program->GetPosition("Main", start, stop));
+    EXPECT_EQ(start, static_cast<int>(after.find("extern void Main")));
+    EXPECT_EQ(stop, static_cast<int>(after.rfind('}')) + 1);
+
+    // the reused public functions are still available to other programs
+    std::unique_ptr<CBotProgram> other(new CBotProgram());
+    ASSERT_TRUE(other->Compile("extern void Other() { ASSERT(Thrice(4) == 12); }", externs));
+    EXPECT_EQ(run(other.get(), "Other"), CBotNoErr);
+    other.reset();
+
+    // changing a declaration compiles everything, as the calls may resolve differently
+    std::string changed = after;
+    changed.replace(changed.find("int Twice(int n)"), 16, "int Twice(float n)");
+    ASSERT_TRUE(program->Compile(changed, externs));
+    EXPECT_EQ(program->GetReusedFunctionCount(), 0);
+    EXPECT_EQ(run(program.get(), "Main"), CBotNoErr);
+
+    // and so does compiling after an error
+    EXPECT_FALSE(program->Compile(changed + "int", externs));
+    ASSERT_TRUE(program->Compile(changed, externs));
+    EXPECT_EQ(program->GetReusedFunctionCount(), 0);
+    ASSERT_TRUE(program->Compile(changed + "\n", externs));
+    EXPECT_EQ(program->GetReusedFunctionCount(), 4);
+    EXPECT_EQ(run(program.get(), "Main"), CBotNoErr);
+
+    // the code shared with other programs is never modified
+    const std::string shared =
+        "int Four() { return 4; }\n"
+        "extern void Main() { ASSERT(Four() == 4); }\n";
+    std::unique_ptr<CBotProgram> first(new CBotProgram());
+    std::unique_ptr<CBotProgram> second(new CBotProgram());
+    ASSERT_TRUE(first->Compile(shared, externs));
+    ASSERT_TRUE(second->Compile(shared, externs));
+    ASSERT_TRUE(first->Compile("\n" + shared, externs));
+    EXPECT_EQ(first->GetReusedFunctionCount(), 0);
+    EXPECT_EQ(run(second.get(), "Main"), CBotNoErr);
+    second.reset();
+    ASSERT_TRUE(first->Compile(shared, externs));
+    EXPECT_EQ(first->GetReusedFunctionCount(), 2);
+    EXPECT_EQ(run(first.get(), "Main"), CBotNoErr);
+
+    // the instructions chained to a call move too, so errors still point at the right token
+    std::unique_ptr<CBotProgram> lib(new CBotProgram());
+    ASSERT_TRUE(lib->Compile("public class ChainedCall { int m(int x) { return x; } }\n"
+                             "extern void Lib() {}\n", externs));
+    const std::string chained =
+        "ChainedCall F() { ChainedCall c(); return c; }\n"
+        "extern void Chained() { int z = 0; int y = F().m(1/z); }\n";
+    const std::string chainedAfter =
+        "ChainedCall F() { ChainedCall c = new ChainedCall(); return c; }\n"
+        "extern void Chained() { int z = 0; int y = F().m(1/z); }\n";
+    ASSERT_TRUE(program->Compile(chained, externs));
+    ASSERT_TRUE(program->Compile(chainedAfter, externs));
+    EXPECT_EQ(program->GetReusedFunctionCount(), 1);
+    EXPECT_EQ(run(program.get(), "Chained"), CBotErrZeroDiv);
+    CBotError error;
+    ASSERT_TRUE(program->GetError(error, start, stop));
+    EXPECT_EQ(start, static_cast<int>(chainedAfter.find("/z")));
+    EXPECT_EQ(stop, start + 1);
+}
+
+TEST_F(CBotUT, ConstantFolding)
+{
+    auto program = ExecuteTest(
+        "extern void FoldedExpressions()\n"
+        "{\n"
+        "    float deg = 2 * 3.5 / 7;\n"
+        "    ASSERT(deg == 1);\n"
+        "    ASSERT(-(1 + 2) * 3 == -9);\n"
+        "    ASSERT(\"a\" + 1 + \"b\" == \"a1b\");\n"
+        "    ASSERT((CBotErrZeroDiv > 0) == true);\n"
+        "    int x = 4;\n"
+        "    ASSERT(x * (2 + 3) == 20);\n"
+        "}\n"
+        "\n"
+        "extern void DeadBranches()\n"
+        "{\n"
+        "    int n = 0;\n"
+        "    if (1 > 2) FAIL();\n"
+        "    if (true) n++; else FAIL();\n"
+        "    while (2 < 1) FAIL();\n"
+        "    ASSERT(n == 1);\n"
+        "}\n"
+    );
+    EXPECT_GT(program->GetEliminatedNodeCount(), 0);
+
+    // folding an error is left to the execution
+    ExecuteTest(
+        "extern void FoldedDivideByZero()\n"
+        "{\n"
+        "    int a = 1 / 0;\n"
+        "}\n",
+        CBotErrZeroDiv
+    );
+
+    // nothing to fold
+    program = ExecuteTest(
+        "extern void NotFolded()\n"
+        "{\n"
+        "    int a = 1;\n"
+        "    int b = a + 1;\n"
+        "    while (a < b) a++;\n"
+        "}\n"
+    );
+    EXPECT_EQ(program->GetEliminatedNodeCount(), 0);
+}
+
+namespace
+{
+
+std::map<std::string, int> g_itemUpdates;
+CBotVar* g_lazyInstance = nullptr;
+
+void uLazyItem(CBotVar* thisVar, CBotVar* item, void* user)
+{
+    item->SetValInt(++g_itemUpdates[item->GetName()]);
+}
+
+CBotTypResult cGetLazy(CBotVar* &var, void* user)
+{
+    if (var != nullptr) return CBotTypResult(CBotErrOverParam);
+    return CBotTypResult(CBotTypPointer, "lazy");
+}
+
+bool rGetLazy(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    result->SetPointer(g_lazyInstance);
+    return true;
+}
+
+} // namespace
+
+TEST_F(CBotUT, UpdateItemsOnRead)
+{
+    CBotClass* bc = CBotClass::Create("lazy", nullptr, false);
+    bc->AddItem("a", CBotTypResult(CBotTypInt), CBotVar::ProtectionLevel::ReadOnly);
+    bc->AddItem("b", CBotTypResult(CBotTypInt), CBotVar::ProtectionLevel::ReadOnly);
+    bc->SetUpdateItemFunc(uLazyItem);
+    CBotProgram::AddFunction("GetLazy", rGetLazy, cGetLazy);
+
+    int user = 0;
+    g_itemUpdates.clear();
+    g_lazyInstance = CBotVar::Create("", CBotTypResult(CBotTypClass, "lazy"));
+    g_lazyInstance->SetUserPtr(&user);
+
+    // each access to the instance makes its elements out of date, but only the ones read are refreshed
+    ExecuteTest(
+        "extern void ReadOneItem()\n"
+        "{\n"
+        "    lazy l = GetLazy();\n"
+        "    int first = l.a;\n"
+        "    ASSERT(first > 0);\n"
+        "    ASSERT(l.a > first);\n"
+        "    ASSERT(GetLazy().a > first);\n"
+        "}\n"
+    );
+    if (!g_cbotTestSaveState) // saving the stack refreshes the whole instance
+    {
+        EXPECT_EQ(g_itemUpdates["a"], 3);
+        EXPECT_EQ(g_itemUpdates["b"], 0);
+    }
+
+    // an element is refreshed at most once between two updates
+    g_itemUpdates.clear();
+    g_lazyInstance->Update(nullptr);
+    EXPECT_EQ(g_lazyInstance->GetItem("b")->GetValInt(), 1);
+    EXPECT_EQ(g_lazyInstance->GetItem("b")->GetValInt(), 1);
+
+    // reading the whole instance refreshes everything which is out of date
+    g_lazyInstance->Update(nullptr);
+    g_lazyInstance->GetValString();
+    EXPECT_EQ(g_itemUpdates["a"], 1);
+    EXPECT_EQ(g_itemUpdates["b"], 2);
+
+    // elements of a deleted object are not refreshed any more
+    g_lazyInstance->Update(nullptr);
+    g_lazyInstance->SetUserPtr(OBJECTDELETED);
+    g_lazyInstance->GetValString();
+    EXPECT_EQ(g_itemUpdates["a"], 1);
+    EXPECT_EQ(g_itemUpdates["b"], 2);
+
+    CBotVar::Destroy(g_lazyInstance);
+    g_lazyInstance = nullptr;
+}
+
+TEST_F(CBotUT, SharedInstanceInParallel)
+{
+    CBotClass* bc = CBotClass::Create("lazy", nullptr, false);
+    bc->AddItem("a", CBotTypResult(CBotTypInt), CBotVar::ProtectionLevel::ReadOnly);
+    bc->SetUpdateItemFunc(uLazyItem);
+    CBotProgram::AddFunction("GetLazy", rGetLazy, cGetLazy, true);
+
+    int user = 0;
+    g_itemUpdates.clear();
+    g_lazyInstance = CBotVar::Create("", CBotTypResult(CBotTypClass, "lazy"));
+    g_lazyInstance->SetUserPtr(&user);
+
+    const std::string code =
+        "extern void ReadShared()\n"
+        "{\n"
+        "    for (int i = 0; i < 50; i++)\n"
+        "    {\n"
+        "        lazy l = GetLazy();\n"
+        "        if (l.a <= 0) throw 1000;\n"
+        "    }\n"
+        "}\n";
+
+    std::vector<std::unique_ptr<CBotProgram>> programs;
+    std::vector<CBotWorkerPool::Slice> slices;
+    for (int i = 0; i < 8; i++)
+    {
+        std::vector<std::string> externs;
+        programs.push_back(std::unique_ptr<CBotProgram>(new CBotProgram()));
+        ASSERT_TRUE(programs.back()->Compile(code, externs));
+        programs.back()->Start("ReadShared");
+        slices.push_back({programs.back().get(), nullptr, 20, false});
+    }
+
+    // the shared instance is refreshed once per batch, before any program reads it
+    CBotWorkerPool pool(4);
+    int batches = 0;
+    while (!slices.empty())
+    {
+        ASSERT_LT(++batches, 10000);
+        pool.Run(slices);
+        EXPECT_LE(g_itemUpdates["a"], batches);
+        slices.erase(std::remove_if(slices.begin(), slices.end(), [](const CBotWorkerPool::Slice& slice)
+        {
+            return slice.finished;
+        }), slices.end());
+    }
+    EXPECT_GE(g_itemUpdates["a"], batches - 1);  // the last batch only leaves the loops
+    for (auto& program : programs)
+        EXPECT_EQ(program->GetError(), CBotNoErr);
+
+    // only the host keeps the instance alive
+    programs.clear();
+    g_lazyInstance->SetUserPtr(OBJECTDELETED);
+    CBotVar::Destroy(g_lazyInstance);
+    g_lazyInstance = nullptr;
+}
+
+namespace
+{
+
+int g_hostCalls = 0;
+
+CBotTypResult cHostCall(CBotVar* &var, void* user)
+{
+    if (var != nullptr) return CBotTypResult(CBotErrOverParam);
+    return CBotTypResult(CBotTypInt);
+}
+
+bool rHostCall(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    result->SetValInt(++g_hostCalls);
+    return true;
+}
+
+} // namespace
+
+TEST_F(CBotUT, DeferredCallInParallel)
+{
+    CBotProgram::AddFunction("HostCall", rHostCall, cHostCall);
+
+    const std::string code =
+        "extern void CallHost()\n"
+        "{\n"
+        "    float a = sqrt(4);\n"
+        "    int b = 0;\n"
+        "    for (int i = 0; i < 3; i++) b += HostCall();\n"
+        "    if (a != 2 || b == 0) throw 1000;\n"
+        "}\n";
+
+    std::vector<std::unique_ptr<CBotProgram>> programs;
+    std::vector<CBotWorkerPool::Slice> slices;
+    for (int i = 0; i < 8; i++)
+    {
+        std::vector<std::string> externs;
+        programs.push_back(std::unique_ptr<CBotProgram>(new CBotProgram()));
+        ASSERT_TRUE(programs.back()->Compile(code, externs));
+        programs.back()->Start("CallHost");
+        slices.push_back({programs.back().get(), nullptr, 1000, false});
+    }
+
+    // thread safe calls run in the batch, the other ones wait for the end of the batch
+    g_hostCalls = 0;
+    CBotWorkerPool pool(4);
+    pool.Run(slices);
+    EXPECT_EQ(g_hostCalls, 0);
+
+    for (std::size_t i = 0; i < slices.size(); i++)
+    {
+        EXPECT_FALSE(slices[i].finished);
+        ASSERT_TRUE(programs[i]->IsCallDeferred());
+
+        // the rest of the slice runs on this thread, with the budget left
+        EXPECT_TRUE(programs[i]->Run(nullptr));
+        EXPECT_EQ(programs[i]->GetError(), CBotNoErr);
+        EXPECT_FALSE(programs[i]->IsCallDeferred());
+        EXPECT_EQ(programs[i]->GetRunStats().slices, 1);
+    }
+    EXPECT_EQ(g_hostCalls, 3 * 8);
+
+    // outside of a batch nothing is deferred
+    g_hostCalls = 0;
+    ASSERT_TRUE(programs[0]->Start("CallHost"));
+    EXPECT_TRUE(programs[0]->Run(nullptr, 1000));
+    EXPECT_FALSE(programs[0]->IsCallDeferred());
+    EXPECT_EQ(g_hostCalls, 3);
+}
+
+TEST_F(CBotUT, ClassInstanceRegistry)
+{
+    CBotClass* bc = CBotClass::Create("registered", nullptr, false);
+    bc->AddItem("a", CBotTypResult(CBotTypInt));
+
+    std::size_t count = CBotVarClass::GetInstanceCount();
+    CBotVar* first = CBotVar::Create("", CBotTypResult(CBotTypClass, "registered"));
+    CBotVar* second = CBotVar::Create("", CBotTypResult(CBotTypClass, "registered"));
+    EXPECT_EQ(CBotVarClass::GetInstanceCount(), count + 2);
+
+    first->SetIdent(123456);
+    EXPECT_EQ(CBotVarClass::Find(123456), first->GetPointer());
+    EXPECT_EQ(CBotVarClass::Find(-1), nullptr);
+
+    CBotVar::Destroy(first);
+    EXPECT_EQ(CBotVarClass::Find(123456), nullptr);
+    EXPECT_EQ(CBotVarClass::GetInstanceCount(), count + 1);
+
+    CBotVar::Destroy(second);
+    EXPECT_EQ(CBotVarClass::GetInstanceCount(), count);
+}
+
+TEST_F(CBotUT, SharedStrings)
+{
+    CBotVar* original = CBotVar::Create("", CBotTypString);
+    original->SetValString("shared characters");
+
+    CBotVar* copy = CBotVar::Create("", CBotTypString);
+    copy->Copy(original);
+    EXPECT_EQ(copy->GetValString(), "shared characters");
+
+    // the copy refers to the same characters, and a new value doesn't change them
+    CBotSharedString value = static_cast<CBotVarString*>(copy)->GetValSharedString();
+    EXPECT_EQ(value.Data(), static_cast<CBotVarString*>(original)->GetValSharedString().Data());
+    original->SetValString("new value");
+    EXPECT_EQ(value.ToString(), "shared characters");
+
+    CBotSharedString part = value.Substr(7, 5);
+    EXPECT_EQ(part.ToString(), "chara");
+    EXPECT_EQ(part.Data(), value.Data() + 7);
+    EXPECT_EQ(part.Find(CBotSharedString("ar")), 2u);
+    EXPECT_EQ(part.Find(CBotSharedString("s")), std::string::npos);
+    EXPECT_TRUE(part == CBotSharedString("chara"));
+
+    CBotVar::Destroy(copy);
+    CBotVar::Destroy(original);
+}
+
+namespace
+{
+
+std::map<std::string, std::string> g_memoryFiles;
+
+class CBotMemoryFile : public CBotFile
+{
+public:
+    CBotMemoryFile(const std::string& filename, CBotFileAccessHandler::OpenMode mode)
+        : m_filename(filename), m_mode(mode)
+    {
+        if (mode == CBotFileAccessHandler::OpenMode::Write) g_memoryFiles[filename].clear();
+    }
+
+    ~CBotMemoryFile() override
+    {
+        Flush();
+    }
+
+    bool Opened() override { return m_mode != CBotFileAccessHandler::OpenMode::Read || g_memoryFiles.count(m_filename) > 0; }
+    bool Errored() override { return false; }
+    bool IsEOF() override { return m_position >= g_memoryFiles[m_filename].length(); }
+
+    std::string ReadLine() override
+    {
+        const std::string& text = g_memoryFiles[m_filename];
+        std::size_t end = std::min(text.find('\n', m_position), text.length());
+        std::string line = text.substr(m_position, end - m_position);
+        m_position = end + 1;
+        return line;
+    }
+
+    std::string ReadAll() override
+    {
+        const std::string& text = g_memoryFiles[m_filename];
+        std::string rest = m_position < text.length() ? text.substr(m_position) : "";
+        m_position = text.length();
+        return rest;
+    }
+
+    void Write(const std::string& s) override { m_buffer += s; }
+
+    void Flush() override
+    {
+        g_memoryFiles[m_filename] += m_buffer;
+        m_buffer.clear();
+    }
+
+private:
+    std::string m_filename;
+    CBotFileAccessHandler::OpenMode m_mode;
+    std::size_t m_position = 0;
+    std::string m_buffer;
+};
+
+class CBotMemoryFileAccessHandler : public CBotFileAccessHandler
+{
+public:
+    std::unique_ptr<CBotFile> OpenFile(const std::string& filename, OpenMode mode) override
+    {
+        return std::unique_ptr<CBotFile>(new CBotMemoryFile(filename, mode));
+    }
+
+    bool DeleteFile(const std::string& filename) override
+    {
+        return g_memoryFiles.erase(filename) > 0;
+    }
+};
+
+bool rFileContent(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    result->SetValString(g_memoryFiles[var->GetValString()]);
+    return true;
+}
+
+} // namespace
+
+TEST_F(CBotUT, FileBulkReadWrite)
+{
+    // open files are closed by the destructor of the "file" instance replaced when the stack is restored
+    if (g_cbotTestSaveState) return;
+
+    SetFileAccessHandler(std::unique_ptr<CBotFileAccessHandler>(new CBotMemoryFileAccessHandler()));
+    CBotProgram::AddFunction("FileContent", rFileContent, cStrStr);
+    g_memoryFiles.clear();
+
+    ExecuteTest(
+        "extern void WriteAndReadLines()\n"
+        "{\n"
+        "    file f(\"log.txt\", \"w\");\n"
+        "    f.writeln(\"first\");\n"
+        "    string[] lines = { \"second\", \"third\" };\n"
+        "    f.writelines(lines);\n"
+        "    ASSERT(FileContent(\"log.txt\") == \"\");\n"
+        "    f.flush();\n"
+        "    ASSERT(FileContent(\"log.txt\") == \"first\\nsecond\\nthird\\n\");\n"
+        "    f.close();\n"
+        "\n"
+        "    f.open(\"log.txt\", \"r\");\n"
+        "    ASSERT(f.readln() == \"first\");\n"
+        "    string[] rest = f.readlines();\n"
+        "    ASSERT(sizeof(rest) == 2);\n"
+        "    ASSERT(rest[0] == \"second\");\n"
+        "    ASSERT(rest[1] == \"third\");\n"
+        "    ASSERT(f.eof());\n"
+        "    f.close();\n"
+        "\n"
+        "    f.open(\"log.txt\", \"r\");\n"
+        "    ASSERT(f.readall() == \"first\\nsecond\\nthird\\n\");\n"
+        "    f.close();\n"
+        "}\n"
+    );
+}
+
+TEST_F(CBotUT, InlineCaches)
+{
+    // the same call sites see several classes, more than the cache holds
+    ExecuteTest(
+        "public class CacheBase\n"
+        "{\n"
+        "    int a = 1;\n"
+        "    int Value() { return a; }\n"
+        "    int Twice() { return 2 * Value(); }\n"
+        "    synchronized int Locked() { return a + 100; }\n"
+        "}\n"
+        "public class CacheChild extends CacheBase\n"
+        "{\n"
+        "    int b = 10;\n"
+        "    int Value() { return a + b; }\n"
+        "}\n"
+        "public class CacheOther1 extends CacheBase { int Value() { return 1000; } }\n"
+        "public class CacheOther2 extends CacheBase { int Value() { return 2000; } }\n"
+        "public class CacheOther3 extends CacheChild { int c = 5; }\n"
+        "public class CacheOther4 extends CacheChild { int Value() { return b; } }\n"
+        "extern void InlineCaches()\n"
+        "{\n"
+        "    CacheBase[] items;\n"
+        "    items[0] = new CacheBase();\n"
+        "    items[1] = new CacheChild();\n"
+        "    items[2] = new CacheOther1();\n"
+        "    items[3] = new CacheOther2();\n"
+        "    items[4] = new CacheOther3();\n"
+        "    items[5] = new CacheOther4();\n"
+        "    int[] expected = { 105, 135, 3102, 6102, 135, 132 };\n"
+        "    for (int i = 0; i < 30; i++)\n"
+        "    {\n"
+        "        CacheBase item = items[i % 6];\n"
+        "        item.a = 1;\n"
+        "        ASSERT(item.Value() + item.Twice() + item.a + item.Locked() == expected[i % 6]);\n"
+        "    }\n"
+        "    CacheOther3 other = items[4];\n"
+        "    ASSERT(other.b + other.c == 15);\n"
+        "}\n"
+    );
+
+    // redefining a class invalidates the calls cached by other programs
+    const std::string definition =
+        "public int CacheExpected() { return %d; }\n"
+        "public class CacheCell\n"
+        "{\n"
+        "    int value = %d;\n"
+        "    int Get() { return value * %d; }\n"
+        "}\n";
+    auto define = [&definition](int value, int factor)
+    {
+        std::vector<char> code(definition.size() + 32);
+        snprintf(code.data(), code.size(), definition.c_str(), value * factor, value, factor);
+        return std::string(code.data());
+    };
+    auto run = [](CBotProgram* program, const std::string& name)
+    {
+        program->Start(name);
+        while (!program->Run(nullptr, 100));
+        return program->GetError();
+    };
+
+    std::vector<std::string> externs;
+    std::unique_ptr<CBotProgram> cell(new CBotProgram());
+    ASSERT_TRUE(cell->Compile(define(1, 1), externs));
+    std::unique_ptr<CBotProgram> user(new CBotProgram());
+    ASSERT_TRUE(user->Compile(
+        "extern void UseCell()\n"
+        "{\n"
+        "    CacheCell cell = new CacheCell();\n"
+        "    for (int i = 0; i < 3; i++) ASSERT(cell.Get() == CacheExpected());\n"
+        "}\n", externs));
+    EXPECT_EQ(run(user.get(), "UseCell"), CBotNoErr);
+
+    ASSERT_TRUE(cell->Compile(define(2, 10), externs));
+    EXPECT_EQ(run(user.get(), "UseCell"), CBotNoErr);
+}
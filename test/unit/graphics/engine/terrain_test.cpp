@@ -0,0 +1,109 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+#include "common/make_unique.h"
+
+#include "graphics/engine/engine.h"
+#include "graphics/engine/terrain.h"
+#include "graphics/engine/water.h"
+
+#include <gtest/gtest.h>
+#include <hippomocks.h>
+
+#include <memory>
+#include <vector>
+
+using namespace Gfx;
+using namespace HippoMocks;
+
+class CTerrainUT : public testing::Test
+{
+protected:
+    ~CTerrainUT() NOEXCEPT
+    {}
+
+    void SetUp() override
+    {
+        m_engine = m_mocks.Mock<CEngine>();
+        m_water = m_mocks.Mock<CWater>();
+        m_mocks.OnCall(m_engine, CEngine::GetWater).Return(m_water);
+        m_mocks.OnCall(m_engine, CEngine::SetTerrainVision);
+        m_mocks.OnCallOverload(m_water, static_cast<float (CWater::*)()>(&CWater::GetLevel)).Return(-100.0f);
+        CEngine::ReplaceInstance(m_engine);
+
+        // 3200x3200, like the terrain of the missions
+        m_terrain = MakeUnique<CTerrain>();
+        m_terrain->Generate(20, 4, 10.0f, 200.0f, 2, 0.5f);
+        m_terrain->RandomizeRelief();
+    }
+
+    void TearDown() override
+    {
+        m_terrain.reset();
+        CEngine::ReplaceInstance(nullptr);
+    }
+
+    MockRepository m_mocks;
+    CEngine* m_engine = nullptr;
+    CWater* m_water = nullptr;
+    std::unique_ptr<CTerrain> m_terrain;
+};
+
+TEST_F(CTerrainUT, FloorLevelsNearBuilding)
+{
+    // Spreads over 4 cells of the zone grid
+    Math::Vector center(10.0f, 0.0f, -10.0f);
+    m_terrain->AddBuildingLevel(center, 8.0f, 24.0f, 4.0f, 0.5f);
+    ASSERT_NE(m_terrain->GetFloorLevel(center, true), m_terrain->GetFloorLevel(center));
+
+    // Each position off the terrain comes before positions on it, in the same or another cell
+    std::vector<Math::Vector> positions;
+    for (float x = -20.0f; x <= 40.0f; x += 5.0f)
+    {
+        positions.push_back(Math::Vector(x, 7.0f, 2000.0f));
+        for (float z = -40.0f; z <= 20.0f; z += 5.0f)
+        {
+            positions.push_back(Math::Vector(x, 0.0f, z));
+        }
+    }
+    positions.push_back(Math::Vector(-1700.0f, -3.0f, -1700.0f));
+    positions.push_back(Math::Vector(-1595.0f, 0.0f, -1595.0f));
+
+    std::vector<float> levels(positions.size());
+    m_terrain->GetFloorLevels(positions.data(), levels.data(), static_cast<int>(positions.size()));
+    for (std::size_t i = 0; i < positions.size(); i++)
+    {
+        Math::Vector pos = positions[i];
+        if (! m_terrain->AdjustToFloor(pos))
+        {
+            EXPECT_FLOAT_EQ(positions[i].y, levels[i]) << "position " << i;  // off the terrain
+            continue;
+        }
+        EXPECT_FLOAT_EQ(m_terrain->GetFloorLevel(positions[i]), levels[i]) << "position " << i;
+    }
+
+    // The same without the building levels
+    m_terrain->GetFloorLevels(positions.data(), levels.data(), static_cast<int>(positions.size()), true);
+    for (std::size_t i = 0; i < positions.size(); i++)
+    {
+        Math::Vector pos = positions[i];
+        if (! m_terrain->AdjustToFloor(pos, true))  continue;
+        EXPECT_FLOAT_EQ(m_terrain->GetFloorLevel(positions[i], true), levels[i]) << "position " << i;
+    }
+}
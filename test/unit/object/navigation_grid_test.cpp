@@ -0,0 +1,197 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+/*
+  Unit tests for the navigation grid shared by the goto() tasks.
+ */
+
+#include "object/navigation_grid.h"
+
+#include "common/make_unique.h"
+
+#include "graphics/engine/engine.h"
+#include "graphics/engine/terrain.h"
+#include "graphics/engine/water.h"
+
+#include "object/object_manager.h"
+
+#include "object/test_object.h"
+
+#include <gtest/gtest.h>
+#include <hippomocks.h>
+
+#include <algorithm>
+#include <memory>
+
+using namespace HippoMocks;
+
+class CNavigationGridUT : public testing::Test
+{
+protected:
+    ~CNavigationGridUT() NOEXCEPT
+    {}
+
+    void SetUp() override
+    {
+        m_engine = m_mocks.Mock<Gfx::CEngine>();
+        m_water = m_mocks.Mock<Gfx::CWater>();
+        m_mocks.OnCall(m_engine, Gfx::CEngine::GetWater).Return(m_water);
+        m_mocks.OnCall(m_engine, Gfx::CEngine::SetTerrainVision);
+        m_mocks.OnCallOverload(m_water, static_cast<float (Gfx::CWater::*)()>(&Gfx::CWater::GetLevel)).Return(-100.0f);
+        Gfx::CEngine::ReplaceInstance(m_engine);
+
+        // 3200x3200, like the terrain of the missions
+        m_terrain = MakeUnique<Gfx::CTerrain>();
+        m_terrain->Generate(20, 4, 10.0f, 200.0f, 2, 0.5f);
+
+        m_objectManager = MakeUnique<CObjectManager>(MakeUnique<CTestObjectFactory>());
+        m_grid = MakeUnique<CNavigationGrid>(m_terrain.get(), m_water);
+    }
+
+    void TearDown() override
+    {
+        m_grid.reset();
+        m_objectManager.reset();
+        m_terrain.reset();
+        Gfx::CEngine::ReplaceInstance(nullptr);
+    }
+
+    CObject* CreateObject(Math::Vector pos, float radius)
+    {
+        CObject* object = m_objectManager->CreateObject(pos, 0.0f, OBJECT_STONE);
+        object->AddCrashSphere(CrashSphere(Math::Vector(0.0f, 0.0f, 0.0f), radius));
+        return object;
+    }
+
+    static int CountComputedBlocks(const NavigationTerrainLayer& layer)
+    {
+        return static_cast<int>(std::count(layer.computedBlocks.begin(), layer.computedBlocks.end(), true));
+    }
+
+    MockRepository m_mocks;
+    Gfx::CEngine* m_engine = nullptr;
+    Gfx::CWater* m_water = nullptr;
+    std::unique_ptr<Gfx::CTerrain> m_terrain;
+    std::unique_ptr<CObjectManager> m_objectManager;
+    std::unique_ptr<CNavigationGrid> m_grid;
+};
+
+TEST_F(CNavigationGridUT, TerrainLayerAroundSearch)
+{
+    NavigationTerrainClass terrainClass;
+    terrainClass.slopeLimit = 0.5f;
+
+    // Cells 99 to 131 with the neighbours, in the blocks of 16 cells 6 to 8
+    std::shared_ptr<const NavigationTerrainLayer> layer =
+        m_grid->GetTerrainLayer(terrainClass, Math::IntPoint(100, 100), Math::IntPoint(130, 130));
+    ASSERT_NE(nullptr, layer);
+    EXPECT_EQ(9, CountComputedBlocks(*layer));
+    EXPECT_FALSE(layer->IsBlocked(115, 115));  // the terrain is flat
+
+    // The same kind of robot shares the layer
+    EXPECT_EQ(layer, m_grid->GetTerrainLayer(terrainClass, Math::IntPoint(110, 110), Math::IntPoint(120, 120)));
+    EXPECT_EQ(9, CountComputedBlocks(*layer));
+}
+
+TEST_F(CNavigationGridUT, TerrainBlocksPerFrame)
+{
+    NavigationTerrainClass terrainClass;
+    terrainClass.slopeLimit = 0.5f;
+    int size = m_grid->GetSize();
+
+    // The whole terrain is 40x40 blocks, 64 of them are computed in one frame
+    int frames = 1;
+    while (m_grid->GetTerrainLayer(terrainClass, Math::IntPoint(0, 0), Math::IntPoint(size-1, size-1)) == nullptr)
+    {
+        // Nothing more can be computed during this frame
+        EXPECT_EQ(nullptr, m_grid->GetTerrainLayer(terrainClass, Math::IntPoint(size-20, size-20), Math::IntPoint(size-1, size-1)));
+        m_grid->NewFrame();
+        frames++;
+        ASSERT_LE(frames, 100);
+    }
+    EXPECT_EQ(25, frames);
+}
+
+TEST_F(CNavigationGridUT, TerrainChange)
+{
+    NavigationTerrainClass terrainClass;
+    terrainClass.slopeLimit = 0.5f;
+
+    std::shared_ptr<const NavigationTerrainLayer> before =
+        m_grid->GetTerrainLayer(terrainClass, Math::IntPoint(100, 100), Math::IntPoint(130, 130));
+    ASSERT_NE(nullptr, before);
+
+    m_terrain->RandomizeRelief();
+
+    // The new layer only computes the blocks of the next search
+    std::shared_ptr<const NavigationTerrainLayer> after =
+        m_grid->GetTerrainLayer(terrainClass, Math::IntPoint(305, 305), Math::IntPoint(310, 310));
+    ASSERT_NE(nullptr, after);
+    EXPECT_NE(before, after);
+    EXPECT_EQ(1, CountComputedBlocks(*after));
+    EXPECT_EQ(9, CountComputedBlocks(*before));  // still usable by a search in progress
+}
+
+TEST_F(CNavigationGridUT, ObstaclesInArea)
+{
+    CObject* nearObject = CreateObject(Math::Vector(10.0f, 0.0f, 10.0f), 2.0f);
+    CObject* farObject = CreateObject(Math::Vector(500.0f, 0.0f, 500.0f), 2.0f);
+
+    const std::vector<const NavigationObstacle*>& obstacles =
+        m_grid->GetObstacles(Math::Vector(-50.0f, 0.0f, -50.0f), Math::Vector(50.0f, 0.0f, 50.0f));
+    ASSERT_EQ(1u, obstacles.size());
+    EXPECT_EQ(nearObject, obstacles[0]->object);
+    ASSERT_EQ(1u, obstacles[0]->spheres.size());
+    EXPECT_FLOAT_EQ(10.0f, obstacles[0]->spheres[0].pos.x);
+    EXPECT_FLOAT_EQ(2.0f, obstacles[0]->spheres[0].radius);
+
+    // The whole terrain
+    const std::vector<const NavigationObstacle*>& all =
+        m_grid->GetObstacles(Math::Vector(-1600.0f, 0.0f, -1600.0f), Math::Vector(1600.0f, 0.0f, 1600.0f));
+    ASSERT_EQ(2u, all.size());
+    EXPECT_EQ(nearObject, all[0]->object);
+    EXPECT_EQ(farObject, all[1]->object);
+}
+
+TEST_F(CNavigationGridUT, ObstacleChanges)
+{
+    Math::Vector min(-50.0f, 0.0f, -50.0f);
+    Math::Vector max(50.0f, 0.0f, 50.0f);
+    CObject* object = CreateObject(Math::Vector(0.0f, 0.0f, 0.0f), 2.0f);
+
+    ASSERT_EQ(1u, m_grid->GetObstacles(min, max).size());
+    EXPECT_FLOAT_EQ(2.0f, m_grid->GetObstacles(min, max)[0]->spheres[0].radius);
+
+    // Another sphere, but the same number of spheres
+    object->DeleteAllCrashSpheres();
+    object->AddCrashSphere(CrashSphere(Math::Vector(0.0f, 0.0f, 0.0f), 3.0f));
+    ASSERT_EQ(1u, m_grid->GetObstacles(min, max).size());
+    EXPECT_FLOAT_EQ(3.0f, m_grid->GetObstacles(min, max)[0]->spheres[0].radius);
+
+    object->SetScale(2.0f);
+    ASSERT_EQ(1u, m_grid->GetObstacles(min, max).size());
+    EXPECT_FLOAT_EQ(6.0f, m_grid->GetObstacles(min, max)[0]->spheres[0].radius);
+
+    object->SetPosition(Math::Vector(20.0f, 0.0f, 0.0f));
+    ASSERT_EQ(1u, m_grid->GetObstacles(min, max).size());
+    EXPECT_FLOAT_EQ(20.0f, m_grid->GetObstacles(min, max)[0]->spheres[0].pos.x);
+
+    m_objectManager->DeleteObject(object);
+    EXPECT_EQ(0u, m_grid->GetObstacles(min, max).size());
+}
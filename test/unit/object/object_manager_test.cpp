@@ -0,0 +1,117 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+/*
+  Unit tests for the collision grid of the object manager.
+ */
+
+#include "object/object_manager.h"
+
+#include "common/make_unique.h"
+
+#include "object/test_object.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+class CObjectManagerUT : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        m_objectManager = MakeUnique<CObjectManager>(MakeUnique<CTestObjectFactory>());
+
+        // Far away objects, so that small areas are looked up cell by cell
+        for (int i = 0; i < 10; i++)
+        {
+            CreateObject(Math::Vector(1000.0f + i*50.0f, 0.0f, 1000.0f), 1.0f);
+        }
+    }
+
+    void TearDown() override
+    {
+        m_objectManager.reset();
+    }
+
+    CObject* CreateObject(Math::Vector pos, float radius)
+    {
+        CObject* object = m_objectManager->CreateObject(pos, 0.0f, OBJECT_STONE);
+        object->AddCrashSphere(CrashSphere(Math::Vector(0.0f, 0.0f, 0.0f), radius));
+        m_objectManager->UpdateObjectPosition(object);
+        return object;
+    }
+
+    //! Checks whether the object may touch the sphere according to the collision grid
+    bool IsCandidate(CObject* object, Math::Vector center, float radius)
+    {
+        std::vector<int> candidates = m_objectManager->GetCollisionCandidates(center, radius);
+        return std::find(candidates.begin(), candidates.end(), object->GetID()) != candidates.end();
+    }
+
+    std::unique_ptr<CObjectManager> m_objectManager;
+};
+
+TEST_F(CObjectManagerUT, CollisionCandidatesAfterMove)
+{
+    CObject* object = CreateObject(Math::Vector(5.0f, 0.0f, 5.0f), 2.0f);
+    EXPECT_TRUE(IsCandidate(object, Math::Vector(6.0f, 0.0f, 5.0f), 1.0f));
+
+    object->SetPosition(Math::Vector(36.0f, 0.0f, 5.0f));
+    EXPECT_FALSE(IsCandidate(object, Math::Vector(6.0f, 0.0f, 5.0f), 1.0f));
+    EXPECT_TRUE(IsCandidate(object, Math::Vector(37.0f, 0.0f, 5.0f), 1.0f));
+
+    std::vector<int> candidates = m_objectManager->GetCollisionCandidates(Math::Vector(37.0f, 0.0f, 5.0f), 1.0f);
+    EXPECT_EQ(1u, candidates.size());
+}
+
+TEST_F(CObjectManagerUT, CollisionCandidatesAfterScale)
+{
+    // From 34 to 38, then from 28 to 44 once scaled
+    CObject* object = CreateObject(Math::Vector(36.0f, 0.0f, 5.0f), 2.0f);
+    EXPECT_FALSE(IsCandidate(object, Math::Vector(29.5f, 0.0f, 5.0f), 1.0f));
+
+    object->SetScale(4.0f);
+    EXPECT_TRUE(IsCandidate(object, Math::Vector(29.5f, 0.0f, 5.0f), 1.0f));
+
+    object->SetScale(1.0f);
+    EXPECT_FALSE(IsCandidate(object, Math::Vector(29.5f, 0.0f, 5.0f), 1.0f));
+}
+
+TEST_F(CObjectManagerUT, CollisionCandidatesOnCellBoundary)
+{
+    // Spheres from 15 to 17, across the boundary of the cells of 16 units
+    CObject* object = CreateObject(Math::Vector(13.0f, 0.0f, 5.0f), 2.0f);
+    EXPECT_TRUE(IsCandidate(object, Math::Vector(16.0f, 0.0f, 5.0f), 1.0f));
+
+    object->SetPosition(Math::Vector(19.0f, 0.0f, 5.0f));
+    EXPECT_TRUE(IsCandidate(object, Math::Vector(16.0f, 0.0f, 5.0f), 1.0f));
+
+    object->SetPosition(Math::Vector(5.0f, 0.0f, 19.0f));
+    EXPECT_TRUE(IsCandidate(object, Math::Vector(5.0f, 0.0f, 16.0f), 1.0f));
+    EXPECT_FALSE(IsCandidate(object, Math::Vector(16.0f, 0.0f, 5.0f), 1.0f));
+
+    // From -5 to -1, then from -7 to 1 once scaled, across the boundary at 0
+    object->SetPosition(Math::Vector(-3.0f, 0.0f, 5.0f));
+    EXPECT_FALSE(IsCandidate(object, Math::Vector(1.5f, 0.0f, 5.0f), 1.0f));
+    object->SetScale(2.0f);
+    EXPECT_TRUE(IsCandidate(object, Math::Vector(1.5f, 0.0f, 5.0f), 1.0f));
+}
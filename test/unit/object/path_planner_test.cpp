@@ -0,0 +1,194 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+/*
+  Unit tests for the A* search used by goto().
+ */
+
+#include "object/path_planner.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+class CPathPlannerUT : public testing::Test
+{
+protected:
+    void SetGrid(int size)
+    {
+        m_size = size;
+        m_blocked.assign(size*size, false);
+    }
+
+    void Block(int x, int y)
+    {
+        m_blocked[x+y*m_size] = true;
+    }
+
+    Error Search(Math::IntPoint start, Math::IntPoint goal, float goalRadius = 0.0f,
+                 int maxNodes = 100000, int maxExpansions = 100000)
+    {
+        m_planner.Start(m_size, start, goal, goalRadius, maxNodes);
+        return m_planner.Search([this](int x, int y) { return m_blocked[x+y*m_size]; }, maxExpansions);
+    }
+
+    //! Checks that the path is made of free neighbouring cells, without cutting corners
+    void CheckPath(const std::vector<Math::IntPoint>& path)
+    {
+        for (std::size_t i = 0; i < path.size(); i++)
+        {
+            EXPECT_FALSE(m_blocked[path[i].x+path[i].y*m_size]) << "cell " << i;
+            if (i == 0)  continue;
+
+            int dx = path[i].x-path[i-1].x;
+            int dy = path[i].y-path[i-1].y;
+            ASSERT_LE(std::abs(dx), 1) << "step " << i;
+            ASSERT_LE(std::abs(dy), 1) << "step " << i;
+            ASSERT_TRUE(dx != 0 || dy != 0) << "step " << i;
+            if (dx != 0 && dy != 0)
+            {
+                EXPECT_FALSE(m_blocked[(path[i-1].x+dx)+path[i-1].y*m_size]) << "step " << i;
+                EXPECT_FALSE(m_blocked[path[i-1].x+(path[i-1].y+dy)*m_size]) << "step " << i;
+            }
+        }
+    }
+
+    static float GetLength(const std::vector<Math::IntPoint>& path)
+    {
+        float length = 0.0f;
+        for (std::size_t i = 1; i < path.size(); i++)
+        {
+            bool diagonal = path[i].x != path[i-1].x && path[i].y != path[i-1].y;
+            length += diagonal ? sqrtf(2.0f) : 1.0f;
+        }
+        return length;
+    }
+
+    CPathPlanner m_planner;
+    int m_size = 0;
+    std::vector<bool> m_blocked;
+};
+
+TEST_F(CPathPlannerUT, StraightPath)
+{
+    SetGrid(10);
+
+    ASSERT_EQ(ERR_OK, Search(Math::IntPoint(1, 2), Math::IntPoint(8, 2)));
+    const std::vector<Math::IntPoint>& path = m_planner.GetPath();
+    ASSERT_EQ(8u, path.size());
+    CheckPath(path);
+    for (std::size_t i = 0; i < path.size(); i++)
+    {
+        EXPECT_EQ(static_cast<int>(i)+1, path[i].x);
+        EXPECT_EQ(2, path[i].y);
+    }
+}
+
+TEST_F(CPathPlannerUT, OptimalLength)
+{
+    SetGrid(10);
+
+    // 3 diagonal and 3 straight moves
+    ASSERT_EQ(ERR_OK, Search(Math::IntPoint(0, 0), Math::IntPoint(6, 3)));
+    CheckPath(m_planner.GetPath());
+    EXPECT_NEAR(3.0f+3.0f*sqrtf(2.0f), GetLength(m_planner.GetPath()), 1e-4f);
+
+    // Around the end of a wall from 0:5 to 5:5, through 6:4, 6:5 and 6:6 since the corner can't be cut
+    for (int x = 0; x < 6; x++)  Block(x, 5);
+    ASSERT_EQ(ERR_OK, Search(Math::IntPoint(2, 3), Math::IntPoint(2, 7)));
+    const std::vector<Math::IntPoint>& path = m_planner.GetPath();
+    CheckPath(path);
+    EXPECT_EQ(Math::IntPoint(2, 3), path.front());
+    EXPECT_EQ(Math::IntPoint(2, 7), path.back());
+    EXPECT_NEAR(8.0f+2.0f*sqrtf(2.0f), GetLength(path), 1e-4f);
+}
+
+TEST_F(CPathPlannerUT, NoCornerCutting)
+{
+    SetGrid(3);
+    Block(1, 0);
+
+    ASSERT_EQ(ERR_OK, Search(Math::IntPoint(0, 0), Math::IntPoint(1, 1)));
+    const std::vector<Math::IntPoint>& path = m_planner.GetPath();
+    ASSERT_EQ(3u, path.size());
+    EXPECT_EQ(Math::IntPoint(0, 1), path[1]);
+    CheckPath(path);
+
+    // Both corners blocked, the diagonal is closed
+    Block(0, 1);
+    EXPECT_EQ(ERR_GOTO_IMPOSSIBLE, Search(Math::IntPoint(0, 0), Math::IntPoint(1, 1)));
+}
+
+TEST_F(CPathPlannerUT, UnreachableGoal)
+{
+    SetGrid(10);
+    for (int y = 0; y < 10; y++)  Block(5, y);
+
+    EXPECT_EQ(ERR_GOTO_IMPOSSIBLE, Search(Math::IntPoint(1, 1), Math::IntPoint(8, 8)));
+}
+
+TEST_F(CPathPlannerUT, MaxNodes)
+{
+    SetGrid(100);
+    for (int y = 0; y < 100; y++)  Block(50, y);
+
+    EXPECT_EQ(ERR_GOTO_ITER, Search(Math::IntPoint(10, 10), Math::IntPoint(90, 90), 0.0f, 200));
+
+    // The same search with enough nodes finds out there is no path
+    EXPECT_EQ(ERR_GOTO_IMPOSSIBLE, Search(Math::IntPoint(10, 10), Math::IntPoint(90, 90)));
+}
+
+TEST_F(CPathPlannerUT, GoalRadius)
+{
+    SetGrid(20);
+    Block(15, 5);  // the goal itself may be occupied
+
+    ASSERT_EQ(ERR_OK, Search(Math::IntPoint(2, 5), Math::IntPoint(15, 5), 3.0f));
+    const std::vector<Math::IntPoint>& path = m_planner.GetPath();
+    CheckPath(path);
+    EXPECT_EQ(Math::IntPoint(12, 5), path.back());
+    EXPECT_NEAR(10.0f, GetLength(path), 1e-4f);
+}
+
+TEST_F(CPathPlannerUT, ResumeAfterContinue)
+{
+    SetGrid(30);
+    for (int y = 0; y < 25; y++)  Block(15, y);
+
+    ASSERT_EQ(ERR_OK, Search(Math::IntPoint(2, 2), Math::IntPoint(28, 2)));
+    std::vector<Math::IntPoint> expected = m_planner.GetPath();
+
+    Error result = Search(Math::IntPoint(2, 2), Math::IntPoint(28, 2), 0.0f, 100000, 10);
+    int calls = 1;
+    while (result == ERR_CONTINUE)
+    {
+        result = m_planner.Search([this](int x, int y) { return m_blocked[x+y*m_size]; }, 10);
+        calls++;
+    }
+
+    EXPECT_EQ(ERR_OK, result);
+    EXPECT_GT(calls, 1);
+    ASSERT_EQ(expected.size(), m_planner.GetPath().size());
+    for (std::size_t i = 0; i < expected.size(); i++)
+    {
+        EXPECT_EQ(expected[i], m_planner.GetPath()[i]);
+    }
+}
@@ -0,0 +1,167 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+/*
+  Unit tests for the queue running the goto() searches on a worker thread.
+ */
+
+#include "object/path_request_queue.h"
+
+#include "object/navigation_grid.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+class CPathRequestQueueUT : public testing::Test
+{
+protected:
+    static const int GRID_SIZE = 32;
+
+    void SetUp() override
+    {
+        auto terrain = std::make_shared<NavigationTerrainLayer>();
+        terrain->size = GRID_SIZE;
+        terrain->cells.assign(GRID_SIZE*GRID_SIZE, 0);
+        m_terrain = terrain;
+    }
+
+    std::shared_ptr<PathRequest> CreateRequest(Math::IntPoint start, Math::IntPoint goal)
+    {
+        auto request = std::make_shared<PathRequest>();
+        request->size = GRID_SIZE;
+        request->start = start;
+        request->goal = goal;
+        request->min = Math::IntPoint(0, 0);
+        request->max = Math::IntPoint(GRID_SIZE-1, GRID_SIZE-1);
+        request->objects.assign(GRID_SIZE/8*GRID_SIZE, 0);
+        request->cleared.assign(GRID_SIZE/8*GRID_SIZE, 0);
+        request->terrain = m_terrain;
+        return request;
+    }
+
+    static void Block(PathRequest& request, int x, int y)
+    {
+        request.objects[GRID_SIZE/8*y + x/8] |= 1<<x%8;
+    }
+
+    //! Waits for the worker thread to finish the request
+    static bool WaitDone(const PathRequest& request)
+    {
+        for (int i = 0; i < 10000; i++)
+        {
+            if (request.done.load(std::memory_order_acquire))  return true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return false;
+    }
+
+    std::shared_ptr<const NavigationTerrainLayer> m_terrain;
+    //! Declared last so that its worker thread stops first
+    CPathRequestQueue m_queue;
+};
+
+TEST_F(CPathRequestQueueUT, SearchesPath)
+{
+    std::shared_ptr<PathRequest> request = CreateRequest(Math::IntPoint(1, 1), Math::IntPoint(30, 1));
+    m_queue.Submit(request);
+
+    ASSERT_TRUE(WaitDone(*request));
+    EXPECT_TRUE(m_queue.TakeResult(request));
+    ASSERT_EQ(ERR_OK, request->result);
+    ASSERT_EQ(30u, request->path.size());
+    EXPECT_EQ(Math::IntPoint(1, 1), request->path.front());
+    EXPECT_EQ(Math::IntPoint(30, 1), request->path.back());
+}
+
+TEST_F(CPathRequestQueueUT, SearchBounds)
+{
+    // A wall from 10:0 to 10:20, the path has to go around its end
+    std::shared_ptr<PathRequest> inside = CreateRequest(Math::IntPoint(5, 5), Math::IntPoint(15, 5));
+    std::shared_ptr<PathRequest> outside = CreateRequest(Math::IntPoint(5, 5), Math::IntPoint(15, 5));
+    for (int y = 0; y <= 20; y++)
+    {
+        Block(*inside, 10, y);
+        Block(*outside, 10, y);
+    }
+    outside->max = Math::IntPoint(GRID_SIZE-1, 20);  // the end of the wall is out of bounds
+
+    m_queue.Submit(inside);
+    m_queue.Submit(outside);
+    ASSERT_TRUE(WaitDone(*inside));
+    ASSERT_TRUE(WaitDone(*outside));
+
+    ASSERT_EQ(ERR_OK, inside->result);
+    int maxY = 0;
+    for (const Math::IntPoint& cell : inside->path)  maxY = std::max(maxY, cell.y);
+    EXPECT_EQ(21, maxY);
+    EXPECT_EQ(ERR_GOTO_IMPOSSIBLE, outside->result);
+}
+
+TEST_F(CPathRequestQueueUT, CancelledRequest)
+{
+    std::shared_ptr<PathRequest> cancelled = CreateRequest(Math::IntPoint(1, 1), Math::IntPoint(30, 30));
+    std::shared_ptr<PathRequest> next = CreateRequest(Math::IntPoint(1, 1), Math::IntPoint(30, 30));
+    cancelled->cancelled = true;
+
+    m_queue.Submit(cancelled);
+    m_queue.Submit(next);
+    ASSERT_TRUE(WaitDone(*cancelled));
+    ASSERT_TRUE(WaitDone(*next));
+
+    // The cancelled request is not searched, but still marked as done
+    EXPECT_EQ(ERR_CONTINUE, cancelled->result);
+    EXPECT_TRUE(cancelled->path.empty());
+    EXPECT_EQ(ERR_OK, next->result);
+    EXPECT_FALSE(next->path.empty());
+}
+
+TEST_F(CPathRequestQueueUT, ResultsPerFrame)
+{
+    // A request still waiting for its search doesn't count
+    std::shared_ptr<PathRequest> pending = CreateRequest(Math::IntPoint(1, 1), Math::IntPoint(30, 30));
+    EXPECT_FALSE(m_queue.TakeResult(pending));
+
+    std::vector<std::shared_ptr<PathRequest>> requests;
+    for (int i = 0; i < 6; i++)
+    {
+        requests.push_back(CreateRequest(Math::IntPoint(1, i), Math::IntPoint(30, i)));
+        m_queue.Submit(requests.back());
+    }
+    for (const auto& request : requests)
+    {
+        ASSERT_TRUE(WaitDone(*request));
+    }
+
+    // Only 4 results can be applied in one frame
+    for (int i = 0; i < 4; i++)
+    {
+        EXPECT_TRUE(m_queue.TakeResult(requests[i])) << "request " << i;
+    }
+    EXPECT_FALSE(m_queue.TakeResult(requests[4]));
+    EXPECT_FALSE(m_queue.TakeResult(requests[5]));
+
+    m_queue.NewFrame();
+    EXPECT_TRUE(m_queue.TakeResult(requests[4]));
+    EXPECT_TRUE(m_queue.TakeResult(requests[5]));
+}
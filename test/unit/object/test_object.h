@@ -0,0 +1,95 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2020, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+#pragma once
+
+#include "common/make_unique.h"
+
+#include "object/object.h"
+#include "object/object_create_params.h"
+#include "object/object_factory.h"
+#include "object/object_manager.h"
+
+/**
+ * \class CTestObject
+ * \brief Object without any model, only a position, a rotation, a scale and crash spheres
+ *
+ * The crash spheres are moved and scaled with the object, but not rotated.
+ */
+class CTestObject : public CObject
+{
+public:
+    CTestObject(int id, ObjectType type, const Math::Vector& pos)
+        : CObject(id, type)
+    {
+        m_position = pos;
+    }
+
+    void Write(CLevelParserLine*) override {}
+    void Read(CLevelParserLine*) override {}
+    void SetTransparency(float) override {}
+
+    void SetPosition(const Math::Vector& pos) override
+    {
+        m_position = pos;
+        CObjectManager::GetInstancePointer()->UpdateObjectPosition(this);
+    }
+
+    void SetRotation(const Math::Vector& rotation) override
+    {
+        m_rotation = rotation;
+    }
+
+    void SetScale(const Math::Vector& scale) override
+    {
+        m_scale = scale;
+        m_crashSphereRevision++;
+        CObjectManager::GetInstancePointer()->UpdateObjectPosition(this);
+    }
+
+protected:
+    void TransformCrashSphere(Math::Sphere& crashSphere) override
+    {
+        crashSphere.pos = crashSphere.pos * m_scale.x + m_position;
+        crashSphere.radius *= m_scale.x;
+    }
+
+    void TransformCameraCollisionSphere(Math::Sphere& collisionSphere) override
+    {
+        TransformCrashSphere(collisionSphere);
+    }
+};
+
+/**
+ * \class CTestObjectFactory
+ * \brief Creates a CTestObject whatever the type asked for
+ */
+class CTestObjectFactory : public CObjectFactory
+{
+public:
+    CTestObjectFactory()
+        : CObjectFactory(nullptr, nullptr, nullptr, nullptr, nullptr)
+    {}
+
+    CObjectUPtr CreateObject(const ObjectCreateParams& params) override
+    {
+        CObjectUPtr object = MakeUnique<CTestObject>(params.id, params.type, params.pos);
+        return object;
+    }
+};